@@ -0,0 +1,257 @@
+// Heap allocations on the steady-state sample path.
+//
+// Writes a capture of JSON frames and one of binary frames, then replays
+// each as fast as possible through IngestMux and the same pipeline as
+// engine_headless (uncouple, track, calibrate while collecting, latency
+// stamps and a plot history stage standing in for the render thread, with
+// a jsonl and a csv sink reading the broadcast ring on their own threads).
+// After a warm-up the allocator is counted on every thread while the next
+// samples go through; any allocation fails the run.
+//
+// On glibc, malloc, calloc, realloc and the aligned variants are replaced,
+// which also catches operator new and the C library; elsewhere only
+// operator new is counted.
+//
+//   alloc_check [samples=100000]
+#include "capture.h"
+#include "ingest_mux.h"
+#include "wire_protocol.h"
+#include "hand.h"
+#include "uncoupler.h"
+#include "calibration.h"
+#include "history.h"
+#include "pipeline.h"
+#include "sinks.h"
+#include "latency_monitor.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool> g_counting(false);
+static std::atomic<uint64_t> g_allocations(0);
+
+// Kept out of line so a debugger can break on the first offending call
+__attribute__((noinline)) static void countAllocation() {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#ifdef __GLIBC__
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size) {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        countAllocation();
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        countAllocation();
+        return __libc_realloc(pointer, size);
+    }
+
+    void* memalign(size_t alignment, size_t size) {
+        countAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) {
+        countAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** pointer, size_t alignment, size_t size) {
+        countAllocation();
+        *pointer = __libc_memalign(alignment, size);
+        return *pointer ? 0 : ENOMEM;
+    }
+
+    void free(void* pointer) {
+        __libc_free(pointer);
+    }
+}
+#else
+void* operator new(size_t size) {
+    countAllocation();
+    if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+#endif
+
+// Samples run before counting starts: fills the windows, sink buffers and plot history
+static const uint64_t WARMUP_SAMPLES = Plot::MAX_POINTS + 2000;
+
+// Samples per rendered frame at 1 kHz and 60 Hz
+static const size_t SAMPLES_PER_FRAME = 17;
+
+// Write count samples at 1 kHz, one frame per read, in the chosen wire format
+static bool writeCapture(const std::string& path, uint64_t count, bool binary) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::fwrite(Serial::CAPTURE_MAGIC, 1, sizeof(Serial::CAPTURE_MAGIC), file);
+
+    for (uint64_t i = 0; i < count; i++) {
+        Serial::ImuSample sample;
+        double t = i * 0.001;
+        sample.ax = static_cast<int>(8000 * std::cos(t)) + static_cast<int>((i * 7919) % 61) - 30;
+        sample.ay = static_cast<int>(8000 * std::sin(t)) + static_cast<int>((i * 104729) % 53) - 26;
+        sample.az = 14000 + static_cast<int>((i * 31) % 41) - 20;
+        sample.gx = static_cast<int>((i * 13) % 23) - 11;
+        sample.gy = static_cast<int>((i * 17) % 29) - 14;
+        sample.gz = 131 + static_cast<int>((i * 19) % 31) - 15;
+
+        char frame[128];
+        uint32_t size;
+        if (binary) {
+            sample.device_time_us = static_cast<uint32_t>(i * 1000);
+            size = static_cast<uint32_t>(Serial::encodeBinarySample(sample, static_cast<uint16_t>(i),
+                                                                    reinterpret_cast<uint8_t*>(frame)));
+        } else {
+            size = static_cast<uint32_t>(std::snprintf(frame, sizeof(frame),
+                "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\r\n",
+                sample.ax, sample.ay, sample.az, sample.gx, sample.gy, sample.gz));
+        }
+        uint64_t time_ns = i * 1000000;
+        std::fwrite(&time_ns, sizeof(time_ns), 1, file);
+        std::fwrite(&size, sizeof(size), 1, file);
+        std::fwrite(frame, 1, size, file);
+    }
+    return std::fclose(file) == 0;
+}
+
+// Replay one capture through the whole chain; returns false if anything allocated once warm
+static bool run(const char* name, const std::string& capturePath, const std::string& outputDir, uint64_t samples) {
+    Serial::IngestMux mux;
+    std::unique_ptr<Serial::SerialSource> source =
+        Serial::ReplaySource::open(capturePath, Serial::ReplayPace::AsFastAsPossible);
+    if (!source || mux.addSource(std::move(source)) < 0) return false;
+
+    Uncoupler::SensorUncoupler uncoupler;
+    Hand::HandTracker tracker;
+    Calibration::Calibrator calibrator;
+    Metrics::LatencyMonitor latency;
+    Plot::PlotHistory history;
+    uint64_t plotted = 0;
+
+    Pipeline::Pipeline pipeline;
+    pipeline.addStage("uncouple", [&](Pipeline::FusedSample& sample) {
+        sample.uncoupled = uncoupler.processData(sample.raw);
+        sample.times.uncoupled_ns = Serial::hostTimeNs();
+    });
+    pipeline.addStage("track", [&](Pipeline::FusedSample& sample) {
+        tracker.update(sample.raw);
+        Hand::TrackerState state = tracker.getState();
+        sample.calibrated.ax = static_cast<int>(state.acceleration.x);
+        sample.calibrated.gx = static_cast<int>(state.gyroscope.x);
+        sample.velocity = state.velocity;
+        sample.times.tracked_ns = Serial::hostTimeNs();
+        latency.recordProcessing(sample.times);
+    });
+    pipeline.addStage("calibrate", [&](Pipeline::FusedSample& sample) {
+        calibrator.update(&sample.raw);
+    });
+    pipeline.addStage("plot", [&](Pipeline::FusedSample& sample) {
+        history.append(Plot::toPlotPoint(sample.calibrated, plotted * 1e-3f));
+        if (++plotted % SAMPLES_PER_FRAME == 0) {
+            history.trim();
+            history.updateRanges();
+            latency.recordOutput(sample.times, Serial::hostTimeNs());
+        }
+    });
+    for (const char* sink : { "jsonl", "csv" }) {
+        std::unique_ptr<Pipeline::Stage> stage =
+            Pipeline::createSink(std::string(sink) + ":" + outputDir + "/alloc_check." + sink);
+        if (!stage) return false;
+        pipeline.addStage(std::move(stage), Pipeline::Execution::Broadcast);
+    }
+
+    // Collect for the whole run; the countdown never ends
+    calibrator.startCalibration(3600);
+    pipeline.start();
+
+    uint64_t pushed = 0;
+    uint64_t counted = 0;
+    while (mux.openDeviceCount() > 0) {
+        mux.poll(0, [&](const Serial::ImuSample& sample) {
+            if (pushed == WARMUP_SAMPLES) {
+                // The sinks have written at least once (stats() allocates, so before counting)
+                while (true) {
+                    std::vector<Pipeline::StageStats> stats = pipeline.stats();
+                    if (stats[stats.size() - 2].processed > 0 && stats.back().processed > 0) break;
+                    std::this_thread::yield();
+                }
+                g_allocations = 0;
+                g_counting = true;
+            } else if (counted == samples) {
+                g_counting = false;
+            }
+
+            pipeline.push(sample);
+            pushed++;
+            if (g_counting.load(std::memory_order_relaxed)) counted++;
+        });
+    }
+    g_counting = false;
+    pipeline.stop();
+
+    uint64_t allocations = g_allocations.load();
+    bool ok = counted >= samples && allocations == 0;
+    std::printf("%-7s %llu samples replayed, %llu counted after %llu warm-up: %llu allocations  %s\n", name,
+                static_cast<unsigned long long>(pushed), static_cast<unsigned long long>(counted),
+                static_cast<unsigned long long>(WARMUP_SAMPLES), static_cast<unsigned long long>(allocations),
+                ok ? "ok" : counted < samples ? "TOO FEW SAMPLES" : "ALLOCATED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint64_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    if (samples == 0) return 1;
+
+    // Room for the warm-up plus a read's worth of samples past the count
+    uint64_t total = WARMUP_SAMPLES + samples + 10000;
+    std::string dir = "/tmp";
+    if (const char* tmp = std::getenv("TMPDIR")) dir = tmp;
+
+    bool ok = true;
+    for (bool binary : { false, true }) {
+        const char* name = binary ? "binary" : "json";
+        std::string path = dir + "/alloc_check_" + name + ".cap";
+        if (!writeCapture(path, total, binary)) {
+            std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+            return 1;
+        }
+        ok &= run(name, path, dir, samples);
+        std::remove(path.c_str());
+    }
+    std::remove((dir + "/alloc_check.jsonl").c_str());
+    std::remove((dir + "/alloc_check.csv").c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// BatchUncoupler against one SensorUncoupler per sensor.
+//
+// Simulated gloves of 1 to 32 IMUs (each its own device with its own noise,
+// all playing the same hand motion) are fed through both: N SensorUncoupler
+// instances in the MovingAverage mode, one processData call per sensor per
+// step, and one BatchUncoupler, one process call per step. Each is timed
+// over the whole recording (fastest of five passes) and reported as
+// sensor-samples per microsecond. The outputs of the first pass are
+// compared, and the largest gravity and linear acceleration differences (in
+// counts) are printed; they should be rounding-sized.
+//
+//   batch_bench [seconds=20] [rate_hz=100]
+#include "simulator.h"
+#include "uncoupler.h"
+#include "batch_uncoupler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Timed passes per configuration; the fastest counts
+static const int PASSES = 5;
+
+// Both sides use the same cutoffs
+static const float GRAVITY_CUTOFF_HZ = 0.28f;
+static const float LINEAR_CUTOFF_HZ = 0.07f;
+
+static const size_t SENSOR_COUNTS[] = { 1, 4, 6, 16, 32 };
+
+static const char* PROFILE = "rest:1,rotate:x:60:1,shake:y:0.4:3:3,rotate:z:90:2,tap:x:3,rest:1,rotate:x:-60:1";
+
+static double maxDifference(const std::vector<Uncoupler::UncoupledData>& a, const std::vector<Uncoupler::UncoupledData>& b,
+                            bool gravity) {
+    double worst = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (gravity) {
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].grav_x - b[i].grav_x)));
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].grav_y - b[i].grav_y)));
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].grav_z - b[i].grav_z)));
+        } else {
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].ax_linear - b[i].ax_linear)));
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].ay_linear - b[i].ay_linear)));
+            worst = std::max(worst, static_cast<double>(std::fabs(a[i].az_linear - b[i].az_linear)));
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 20.0;
+    double rateHz = argc > 2 ? std::atof(argv[2]) : 100.0;
+    if (seconds <= 0.0 || rateHz <= 0.0) return 1;
+
+    std::vector<Simulator::MotionSegment> profile;
+    if (!Simulator::parseProfile(PROFILE, profile)) {
+        std::fprintf(stderr, "Bad profile\n");
+        return 1;
+    }
+    size_t steps = static_cast<size_t>(seconds * rateHz);
+
+    std::printf("%8s %16s %16s %8s %14s %14s\n", "sensors", "separate /us", "batch /us", "speedup", "max grav diff",
+                "max lin diff");
+    bool ok = true;
+    for (size_t sensors : SENSOR_COUNTS) {
+        // Record every sensor's readings up front, step-major like the batch consumes them
+        std::vector<Serial::ImuSample> samples(steps * sensors);
+        for (size_t sensor = 0; sensor < sensors; sensor++) {
+            Simulator::ImuModel model(profile, Simulator::SensorErrors(), static_cast<uint32_t>(100 + sensor));
+            for (size_t step = 0; step < steps; step++) {
+                samples[step * sensors + sensor] = model.next(1.0 / rateHz);
+            }
+        }
+
+        std::vector<Uncoupler::UncoupledData> separateOut(samples.size());
+        std::vector<Uncoupler::UncoupledData> batchOut(samples.size());
+        Clock::duration separateBest = Clock::duration::max();
+        Clock::duration batchBest = Clock::duration::max();
+        for (int pass = 0; pass < PASSES; pass++) {
+            std::vector<Uncoupler::SensorUncoupler> separate(sensors);
+            for (Uncoupler::SensorUncoupler& uncoupler : separate) {
+                uncoupler.setSampleRate(static_cast<float>(rateHz));
+                uncoupler.setGravityCutoff(GRAVITY_CUTOFF_HZ);
+                uncoupler.setLinearCutoff(LINEAR_CUTOFF_HZ);
+            }
+            auto start = Clock::now();
+            for (size_t step = 0; step < steps; step++) {
+                for (size_t sensor = 0; sensor < sensors; sensor++) {
+                    size_t at = step * sensors + sensor;
+                    separateOut[at] = separate[sensor].processData(samples[at]);
+                }
+            }
+            separateBest = std::min(separateBest, Clock::now() - start);
+
+            Uncoupler::BatchUncoupler batch(sensors);
+            batch.setSampleRate(static_cast<float>(rateHz));
+            batch.setGravityCutoff(GRAVITY_CUTOFF_HZ);
+            batch.setLinearCutoff(LINEAR_CUTOFF_HZ);
+            start = Clock::now();
+            for (size_t step = 0; step < steps; step++) {
+                batch.process(&samples[step * sensors], &batchOut[step * sensors]);
+            }
+            batchBest = std::min(batchBest, Clock::now() - start);
+        }
+
+        double separateUs = std::chrono::duration<double, std::micro>(separateBest).count();
+        double batchUs = std::chrono::duration<double, std::micro>(batchBest).count();
+        double gravityDiff = maxDifference(separateOut, batchOut, true);
+        double linearDiff = maxDifference(separateOut, batchOut, false);
+        ok &= std::isfinite(gravityDiff) && std::isfinite(linearDiff);
+        std::printf("%8zu %16.1f %16.1f %7.2fx %14.4f %14.4f\n", sensors, samples.size() / separateUs,
+                    samples.size() / batchUs, separateUs / batchUs, gravityDiff, linearDiff);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Throughput, ordering and lapping of Concurrency::BroadcastRing.
+//
+// One writer publishes numbered items to three readers. Every word of an
+// item carries its number, so a read mixing two writes shows up as torn.
+// Whatever a reader did not read must be counted as missed, and the
+// numbers it did read must only increase. Two runs:
+//   free    the writer publishes as fast as it can; any reader may be
+//           lapped, none may see a torn item
+//   paced   the writer publishes quarter-ring bursts 1 ms apart; the two
+//           readers that keep up must miss nothing, the one that sleeps
+//           200 us per item must be lapped without slowing the writer
+//
+//   broadcast_bench [items=2000000]
+#include "broadcast_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Roughly the size of a fused sample
+struct Item {
+    uint64_t words[20];
+};
+
+struct ReaderResult {
+    uint64_t received = 0;
+    uint64_t missed = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;  // Numbers that did not increase
+    uint64_t gaps = 0;       // Numbers skipped (must match missed)
+};
+
+static void readUntil(Concurrency::BroadcastRing<Item>& ring, uint64_t items, std::atomic<bool>& ready,
+                      std::chrono::microseconds pause, ReaderResult& result) {
+    Concurrency::BroadcastRing<Item>::Reader reader(ring);
+    ready = true;
+
+    uint64_t expected = 0;
+    Item item;
+    while (expected < items) {
+        if (!reader.tryRead(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t number = item.words[0];
+        for (uint64_t word : item.words) {
+            if (word != number) {
+                result.torn++;
+                break;
+            }
+        }
+        if (number < expected) result.backwards++;
+        if (number > expected) result.gaps += number - expected;
+        expected = number + 1;
+        if (pause.count() > 0) std::this_thread::sleep_for(pause);
+    }
+    result.received = reader.received();
+    result.missed = reader.missed();
+}
+
+// Publish items while readers follow (burst 0 = as fast as possible); returns false on a torn,
+// reordered or miscounted read, or if a reader expected to keep up missed anything
+static bool run(const char* name, uint64_t items, size_t capacity, const std::vector<std::chrono::microseconds>& pauses,
+                size_t burst) {
+    Concurrency::BroadcastRing<Item> ring(capacity);
+    std::vector<ReaderResult> results(pauses.size());
+    std::vector<std::thread> readers;
+    std::vector<std::atomic<bool>> ready(pauses.size());
+    for (size_t r = 0; r < pauses.size(); r++) {
+        readers.emplace_back(readUntil, std::ref(ring), items, std::ref(ready[r]), pauses[r], std::ref(results[r]));
+    }
+    for (std::atomic<bool>& flag : ready) {
+        while (!flag) std::this_thread::yield();
+    }
+
+    auto start = Clock::now();
+    Item item;
+    for (uint64_t i = 0; i < items; i++) {
+        for (uint64_t& word : item.words) word = i;
+        ring.publish(item);
+        if (burst > 0 && (i + 1) % burst == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Every reader stops at the last item, which stays in the ring once the writer is done
+    for (size_t r = 0; r < readers.size(); r++) {
+        readers[r].join();
+    }
+
+    bool ok = true;
+    std::printf("%-10s %6.1f M items/s published, %llu laps\n", name, items / seconds * 1e-6,
+                static_cast<unsigned long long>(ring.lapped()));
+    for (size_t r = 0; r < results.size(); r++) {
+        const ReaderResult& res = results[r];
+        bool counted = res.received + res.missed == items && res.gaps == res.missed;
+        bool keptUp = burst == 0 || pauses[r].count() > 0 || res.missed == 0;
+        bool readerOk = res.torn == 0 && res.backwards == 0 && counted && keptUp;
+        ok &= readerOk;
+        std::printf("    reader %zu (%4lld us pause)  %9llu read  %9llu missed  %llu torn  %s\n", r,
+                    static_cast<long long>(pauses[r].count()), static_cast<unsigned long long>(res.received),
+                    static_cast<unsigned long long>(res.missed), static_cast<unsigned long long>(res.torn),
+                    readerOk ? "ok" : "UNEXPECTED");
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint64_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000ull;
+    using us = std::chrono::microseconds;
+
+    bool ok = true;
+    ok &= run("free", items, 1024, { us(0), us(0), us(200) }, 0);
+    ok &= run("paced", 256 * 200, 1024, { us(0), us(0), us(200) }, 256);
+    return ok ? 0 : 1;
+}
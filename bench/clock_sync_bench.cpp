@@ -0,0 +1,102 @@
+// Accuracy of Serial::ClockSync on a modelled USB link.
+//
+// A device samples at a fixed rate on a crystal that is off by a few tens of
+// ppm and stamps each reading with its 32-bit micros() counter (started just
+// before the wrap so the unwrap path is exercised). The host only sees bytes
+// when its ingest loop wakes, every ~10 ms with scheduler jitter, after a USB
+// latency with an exponential tail. For each run the jitter of the sample
+// intervals is compared when taken from arrival times and from the mapped
+// device times.
+//
+//   clock_sync_bench [seconds=120]
+#include "clock_sync.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Stats {
+    double mean = 0.0;
+    double stddev = 0.0;
+    double maxAbs = 0.0;
+};
+
+static Stats summarize(const std::vector<double>& values) {
+    Stats stats;
+    for (double v : values) stats.mean += v;
+    stats.mean /= values.size();
+    for (double v : values) {
+        stats.stddev += (v - stats.mean) * (v - stats.mean);
+        stats.maxAbs = std::max(stats.maxAbs, std::fabs(v - stats.mean));
+    }
+    stats.stddev = std::sqrt(stats.stddev / values.size());
+    return stats;
+}
+
+static bool run(double rateHz, double clockPpm, double seconds) {
+    std::mt19937 rng(42);
+    std::exponential_distribution<double> usbTail(1.0 / 0.5e-3);
+    std::uniform_real_distribution<double> wakeJitter(-2e-3, 2e-3);
+
+    // Host-time ground truth of each reading, and when the host saw it
+    const double period = 1.0 / rateHz;
+    const uint32_t startMicros = 0xFFFFFFFFu - 3000000u;
+    const double hostStart = 1000.0;
+
+    Serial::ClockSync clock;
+    std::vector<double> rawIntervals;
+    std::vector<double> mappedIntervals;
+    std::vector<double> mappedError;
+
+    double nextWake = hostStart;
+    double prevArrival = 0.0;
+    double prevMapped = 0.0;
+    size_t count = static_cast<size_t>(seconds * rateHz);
+
+    for (size_t i = 0; i < count; i++) {
+        double trueTime = hostStart + i * period;
+        uint32_t micros = startMicros + static_cast<uint32_t>(static_cast<uint64_t>(i * period * 1e6 * (1.0 + clockPpm * 1e-6)));
+
+        // Bytes reach the driver after the USB latency; the loop picks them up on its next wakeup
+        double inDriver = trueTime + 1e-3 + usbTail(rng);
+        while (nextWake < inDriver) {
+            nextWake += 10e-3 + wakeJitter(rng);
+        }
+        double arrival = nextWake;
+
+        int64_t mappedNs = clock.update(micros, static_cast<int64_t>(arrival * 1e9));
+        double mapped = mappedNs * 1e-9;
+
+        // Skip the first seconds while the fit converges
+        if (i * period > 10.0) {
+            rawIntervals.push_back(arrival - prevArrival);
+            mappedIntervals.push_back(mapped - prevMapped);
+            mappedError.push_back(mapped - trueTime);
+        }
+        prevArrival = arrival;
+        prevMapped = mapped;
+    }
+
+    Stats raw = summarize(rawIntervals);
+    Stats mapped = summarize(mappedIntervals);
+    Stats error = summarize(mappedError);
+
+    std::printf("%5.0f Hz %+5.0f ppm  dt jitter raw %8.1f us  mapped %6.2f us (max %6.2f)  "
+                "offset %5.2f ms +-%5.1f us  drift est %+6.1f ppm\n",
+                rateHz, clockPpm, raw.stddev * 1e6, mapped.stddev * 1e6, mapped.maxAbs * 1e6,
+                error.mean * 1e3, error.maxAbs * 1e6, clock.driftPpm());
+
+    // The mapped times must be far steadier than arrivals and track the true drift
+    return mapped.stddev < raw.stddev / 20.0 && std::fabs(clock.driftPpm() - clockPpm) < 5.0;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 120.0;
+
+    bool ok = true;
+    ok &= run(50.0, 40.0, seconds);
+    ok &= run(1000.0, -80.0, seconds);
+    ok &= run(10000.0, 20.0, seconds);
+    return ok ? 0 : 1;
+}
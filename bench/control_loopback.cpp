@@ -0,0 +1,161 @@
+// Control channel round trip against a Simulator::FakeDevice behind a pty.
+//
+// The host walks the device through the firmware's commands the way main
+// does at startup: JSON at 50 Hz, then binary, a faster baud rate, 1 kHz,
+// a different DLPF and wider ranges, and back to JSON. Each step checks the
+// reported status, that samples keep flowing at the new rate, that the
+// decoder followed the format switch without dropping frames, and that
+// IngestMux rescales counts so a device at rest still reads +1 g.
+//
+//   control_loopback
+#include "ingest_mux.h"
+#include "pty_loopback.h"
+#include "simulator.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct HostState {
+    Serial::IngestMux mux;
+    bool haveReport = false;
+    Serial::ConfigReport report;
+    uint64_t samples = 0;
+    double azSum = 0.0;
+};
+
+// Poll until the device answers or the timeout passes
+static bool waitForReport(HostState& host, double timeout_s) {
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout_s));
+    while (!host.haveReport && Clock::now() < deadline) {
+        host.mux.poll(10, [&](const Serial::ImuSample& sample) {
+            host.samples++;
+            host.azSum += sample.az;
+        });
+    }
+    return host.haveReport;
+}
+
+// Send one command and compare the answer
+static bool step(HostState& host, const char* name, Serial::ControlCommand command, uint32_t value,
+                 Serial::ControlStatus expected) {
+    host.haveReport = false;
+    if (!host.mux.sendCommand(0, command, value)) {
+        std::printf("%-24s send failed\n", name);
+        return false;
+    }
+    if (!waitForReport(host, 2.0)) {
+        std::printf("%-24s no report\n", name);
+        return false;
+    }
+
+    const Serial::DeviceConfig& config = host.report.config;
+    bool ok = host.report.status == expected && host.report.command == command;
+    std::printf("%-24s status %d  -> %4u Hz dlpf %u ranges %u/%u %-6s %7lu baud  %s\n",
+                name, static_cast<int>(host.report.status), static_cast<unsigned>(config.rate_hz),
+                static_cast<unsigned>(config.dlpf), static_cast<unsigned>(config.accel_range),
+                static_cast<unsigned>(config.gyro_range), config.binary ? "binary" : "json",
+                static_cast<unsigned long>(config.baud_rate), ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+// Count samples for a while and check the rate and the rescaled gravity reading
+static bool measure(HostState& host, double seconds, double expectedHz) {
+    host.samples = 0;
+    host.azSum = 0.0;
+    auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    while (Clock::now() < end) {
+        host.mux.poll(10, [&](const Serial::ImuSample& sample) {
+            host.samples++;
+            host.azSum += sample.az;
+        });
+    }
+
+    double rate = host.samples / seconds;
+    double az = host.samples > 0 ? host.azSum / host.samples : 0.0;
+    bool ok = std::fabs(rate - expectedHz) < expectedHz * 0.1 && std::fabs(az - Simulator::ACCEL_COUNTS_PER_G) < 200.0;
+    std::printf("%-24s %6.0f samples/s (expect %.0f), mean az %6.0f counts (expect %.0f)  %s\n",
+                "  stream", rate, expectedHz, az, Simulator::ACCEL_COUNTS_PER_G, ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+int main() {
+    Serial::PtyLoopback pty;
+    if (!pty.open()) return 1;
+
+    // Device at rest, powered up with the firmware defaults
+    std::vector<Simulator::MotionSegment> profile;
+    Simulator::parseProfile("rest:60", profile);
+    Simulator::FakeDevice device(profile, Simulator::SensorErrors(), Simulator::FaultConfig(), Serial::DeviceConfig(), 1);
+
+    std::atomic<bool> running(true);
+    std::thread deviceThread([&]() {
+        auto start = Clock::now();
+        auto nextWake = start;
+        double nextSample = 0.0;
+        std::vector<char> out;
+        char commands[256];
+
+        while (running) {
+            double now = std::chrono::duration<double>(Clock::now() - start).count();
+            out.clear();
+            long n;
+            while ((n = pty.read(commands, sizeof(commands))) > 0) {
+                device.receive(commands, static_cast<size_t>(n), out);
+            }
+            while (nextSample <= now) {
+                device.sample(out);
+                nextSample += device.samplePeriod();
+            }
+            if (!out.empty()) pty.write(out.data(), out.size());
+
+            nextWake += std::chrono::microseconds(500);
+            std::this_thread::sleep_until(nextWake);
+        }
+    });
+
+    HostState host;
+    if (host.mux.addSource(Serial::openSerialSource(pty.devicePath())) < 0) return 1;
+    host.mux.setConfigCallback([&](int, const Serial::ConfigReport& report) {
+        host.report = report;
+        host.haveReport = true;
+    });
+
+    using Command = Serial::ControlCommand;
+    using Status = Serial::ControlStatus;
+    bool ok = true;
+    ok &= step(host, "get config", Command::GetConfig, 0, Status::Ok);
+    ok &= measure(host, 1.0, 50.0);
+    ok &= step(host, "1 kHz over JSON", Command::SetRate, 1000, Status::LinkTooSlow);
+    ok &= step(host, "binary format", Command::SetFormat, 1, Status::Ok);
+    ok &= step(host, "921600 baud", Command::SetBaud, 921600, Status::Ok);
+    ok &= step(host, "1 kHz", Command::SetRate, 1000, Status::Ok);
+    ok &= step(host, "DLPF 3", Command::SetFilter, 3, Status::Ok);
+    ok &= step(host, "DLPF 9", Command::SetFilter, 9, Status::BadValue);
+    ok &= step(host, "accel +-8 g", Command::SetAccelRange, 2, Status::Ok);
+    ok &= step(host, "gyro +-500 deg/s", Command::SetGyroRange, 1, Status::Ok);
+    ok &= measure(host, 1.0, 1000.0);
+    ok &= step(host, "JSON at 1 kHz", Command::SetFormat, 0, Status::LinkTooSlow);
+    ok &= step(host, "200 Hz", Command::SetRate, 200, Status::Ok);
+    ok &= step(host, "JSON format", Command::SetFormat, 0, Status::Ok);
+    ok &= step(host, "unknown command", static_cast<Command>(0x7F), 0, Status::Unknown);
+    ok &= measure(host, 1.0, 200.0);
+
+    running = false;
+    deviceThread.join();
+
+    // Every frame across the format and rate switches must have decoded
+    Serial::IngestCounters stats = host.mux.stats(0);
+    bool clean = stats.crc_failures == 0 && stats.parse_failures == 0 && stats.sequence_gaps == 0;
+    std::printf("ingest: %llu frames, %llu CRC failures, %llu parse failures, %llu missing  %s\n",
+                static_cast<unsigned long long>(stats.frames_decoded),
+                static_cast<unsigned long long>(stats.crc_failures),
+                static_cast<unsigned long long>(stats.parse_failures),
+                static_cast<unsigned long long>(stats.sequence_gaps), clean ? "ok" : "UNEXPECTED");
+
+    return ok && clean ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+// Per-sample cost of every step a reading goes through, in one run.
+//
+// Covers the legacy parseJsonToDict parser, readAndProcess framing over an
+// in-memory port (JSON and binary streams), SensorUncoupler::processData at
+// several gravity window sizes and in the orientation and Kalman modes,
+// BatchUncoupler::process for a 16-sensor glove (per sensor-sample),
+// HandTracker::update, Calibrator::update while idle and while
+// collecting, and the plot path: building and queueing
+// a point (what Plot::addDataPoint does on the sensor thread) and a 60 Hz
+// frame's drain, trim and range update over a full history (what
+// renderFrame does before drawing). The plot cases use the GL-free
+// PlotHistory, so no window is needed.
+//
+// Each case first doubles its iteration count until one pass takes 20 ms
+// (or reaches --iterations), which doubles as warm-up, then runs five timed
+// repeats; the median and the fastest repeat are reported. --json writes
+// the results for comparing runs.
+//
+//   engine_bench [--iterations N] [--filter substring] [--json file]
+#include "serial.h"
+#include "hand.h"
+#include "calibration.h"
+#include "uncoupler.h"
+#include "batch_uncoupler.h"
+#include "history.h"
+#include "spsc_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Set by CMake; numbers from unoptimised builds are not comparable with release ones
+#ifndef ENGINE_BENCH_BUILD_TYPE
+#define ENGINE_BENCH_BUILD_TYPE "unknown"
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Timed repeats per case
+static const int REPEATS = 5;
+
+// Shortest repeat worth timing
+static const std::chrono::milliseconds MIN_REPEAT_TIME(20);
+
+// Samples per rendered frame at 1 kHz and 60 Hz
+static const size_t SAMPLES_PER_FRAME = 17;
+
+// Keeps results alive so the optimiser cannot drop the work
+static volatile long long g_sink = 0;
+
+struct Result {
+    std::string name;
+    size_t iterations = 0;
+    double ns_per_sample = 0.0;      // Median of the repeats
+    double min_ns_per_sample = 0.0;  // Fastest repeat
+};
+
+// Port that replays a byte stream forever in fixed-size chunks, like a USB serial driver
+class MemorySource : public Serial::SerialSource {
+public:
+    MemorySource(std::string stream, size_t chunk)
+        : m_stream(std::move(stream)), m_chunk(chunk), m_offset(0)
+    {
+    }
+
+    bool isOpen() const override { return true; }
+    bool waitReadable(int) override { return true; }
+    Serial::NativeHandle nativeHandle() const override { return Serial::INVALID_NATIVE_HANDLE; }
+    void close() override {}
+
+    long read(char* buffer, size_t size) override {
+        size_t count = std::min({ size, m_chunk, m_stream.size() - m_offset });
+        std::copy(m_stream.data() + m_offset, m_stream.data() + m_offset + count, buffer);
+        m_offset = (m_offset + count) % m_stream.size();
+        return static_cast<long>(count);
+    }
+
+private:
+    std::string m_stream;
+    size_t m_chunk;
+    size_t m_offset;
+};
+
+class Runner {
+public:
+    Runner(size_t iterations, std::string filter)
+        : m_iterations(iterations), m_filter(std::move(filter))
+    {
+    }
+
+    // Time body(i) for i in [0, iterations); each call handles samplesPerCall samples
+    template <typename Body>
+    void run(const std::string& name, Body&& body, size_t samplesPerCall = 1) {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return;
+
+        size_t maxIterations = std::max<size_t>(1, m_iterations / samplesPerCall);
+        size_t iterations = 1;
+        while (true) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                body(i);
+            }
+            if (Clock::now() - start >= MIN_REPEAT_TIME || iterations >= maxIterations) break;
+            iterations = std::min(iterations * 2, maxIterations);
+        }
+
+        std::vector<double> perSample;
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                body(i);
+            }
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            perSample.push_back(ns / (iterations * samplesPerCall));
+        }
+        std::sort(perSample.begin(), perSample.end());
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations * samplesPerCall;
+        result.ns_per_sample = perSample[REPEATS / 2];
+        result.min_ns_per_sample = perSample.front();
+        std::printf("%-32s %10.1f ns/sample  (min %.1f)\n", name.c_str(),
+                    result.ns_per_sample, result.min_ns_per_sample);
+        m_results.push_back(result);
+    }
+
+    const std::vector<Result>& results() const { return m_results; }
+
+private:
+    size_t m_iterations;
+    std::string m_filter;
+    std::vector<Result> m_results;
+};
+
+static bool writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    out << "{\n  \"benchmark\": \"engine_bench\",\n  \"build_type\": \"" << ENGINE_BENCH_BUILD_TYPE
+        << "\",\n  \"results\": [\n";
+    char line[256];
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_sample\": %.2f, "
+                      "\"min_ns_per_sample\": %.2f, \"samples_per_second\": %.0f}%s\n",
+                      r.name.c_str(), r.iterations, r.ns_per_sample, r.min_ns_per_sample,
+                      r.ns_per_sample > 0 ? 1e9 / r.ns_per_sample : 0.0, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = 1000000;
+    std::string filter;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: engine_bench [--iterations N] [--filter substring] [--json file]\n");
+            return 1;
+        }
+    }
+    if (iterations == 0) return 1;
+
+    // A spread of magnitudes and signs like a real capture, as typed samples and in both wire formats
+    const size_t sampleCount = 1024;
+    std::vector<Serial::ImuSample> samples(sampleCount);
+    std::vector<std::string> jsonFrames;
+    std::string jsonStream;
+    std::string binaryStream;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> accel(-32768, 32767);
+    std::uniform_int_distribution<int> gyro(-2000, 2000);
+    for (size_t i = 0; i < sampleCount; i++) {
+        Serial::ImuSample& s = samples[i];
+        s.ax = accel(rng); s.ay = accel(rng); s.az = accel(rng);
+        s.gx = gyro(rng); s.gy = gyro(rng); s.gz = gyro(rng);
+
+        char line[128];
+        int len = std::snprintf(line, sizeof(line), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}",
+                                s.ax, s.ay, s.az, s.gx, s.gy, s.gz);
+        jsonFrames.emplace_back(line, len);
+        jsonStream += jsonFrames.back();
+        jsonStream += "\r\n";
+
+        uint8_t frame[Serial::BINARY_TIMED_SAMPLE_WIRE_SIZE];
+        size_t size = Serial::encodeBinarySample(s, static_cast<uint16_t>(i), frame);
+        binaryStream.append(reinterpret_cast<const char*>(frame), size);
+    }
+    auto sampleAt = [&samples](size_t i) -> const Serial::ImuSample& { return samples[i % sampleCount]; };
+
+    Runner runner(iterations, filter);
+
+    // Parsing and framing
+    runner.run("parseJsonToDict", [&](size_t i) {
+        std::unordered_map<std::string, int> data = parseJsonToDict(jsonFrames[i % sampleCount]);
+        g_sink = g_sink + data["ax"];
+    });
+    {
+        MemorySource source(jsonStream, 64);
+        Serial::FrameDecoder decoder;
+        runner.run("readAndProcess/json", [&](size_t) {
+            g_sink = g_sink + readAndProcess(source, decoder)["gz"];
+        });
+    }
+    {
+        MemorySource source(binaryStream, 64);
+        Serial::FrameDecoder decoder;
+        runner.run("readAndProcess/binary", [&](size_t) {
+            g_sink = g_sink + readAndProcess(source, decoder)["gz"];
+        });
+    }
+
+    // Processing chain
+    for (size_t window : { 10, 50, 200, 1000 }) {
+        Uncoupler::SensorUncoupler uncoupler(window);
+        runner.run("uncoupler/window_" + std::to_string(window), [&](size_t i) {
+            g_sink = g_sink + static_cast<long long>(uncoupler.processData(sampleAt(i)).ax_linear);
+        });
+    }
+    {
+        Uncoupler::SensorUncoupler uncoupler;
+        uncoupler.setGravityMode(Uncoupler::GravityMode::Orientation);
+        runner.run("uncoupler/orientation", [&](size_t i) {
+            g_sink = g_sink + static_cast<long long>(uncoupler.processData(sampleAt(i)).ax_linear);
+        });
+    }
+    {
+        Uncoupler::SensorUncoupler uncoupler;
+        uncoupler.setGravityMode(Uncoupler::GravityMode::Kalman);
+        runner.run("uncoupler/kalman", [&](size_t i) {
+            g_sink = g_sink + static_cast<long long>(uncoupler.processData(sampleAt(i)).ax_linear);
+        });
+    }
+    {
+        // A 16-IMU glove stepped at once; reported per sensor-sample like the cases above
+        const size_t sensors = 16;
+        Uncoupler::BatchUncoupler batch(sensors);
+        std::vector<Uncoupler::UncoupledData> out(sensors);
+        runner.run("uncoupler/batch_16", [&](size_t i) {
+            batch.process(&samples[(i * sensors) % sampleCount], out.data());
+            g_sink = g_sink + static_cast<long long>(out[0].ax_linear);
+        }, sensors);
+    }
+    {
+        Hand::HandTracker tracker;
+        runner.run("hand_tracker/update", [&](size_t i) {
+            tracker.update(sampleAt(i));
+            g_sink = g_sink + static_cast<long long>(tracker.getVelocity().x);
+        });
+    }
+    {
+        Calibration::Calibrator calibrator;
+        runner.run("calibrator/idle", [&](size_t i) {
+            calibrator.update(&sampleAt(i));
+        });
+
+        // Long enough that the countdown never finishes during the run
+        calibrator.startCalibration(3600);
+        runner.run("calibrator/collecting", [&](size_t i) {
+            calibrator.update(&sampleAt(i));
+        });
+    }
+
+    // Plot path
+    {
+        Hand::HandTracker tracker;
+        Concurrency::SpscQueue<Plot::PlotPoint> queue(4096);
+        runner.run("plot/add_point", [&](size_t i) {
+            Plot::PlotPoint point = Plot::toPlotPoint(sampleAt(i), static_cast<float>(i) * 1e-3f);
+            Hand::Vector3D velocity = tracker.getVelocity();
+            point.vx = velocity.x;
+            point.vy = velocity.y;
+            point.vz = velocity.z;
+            queue.tryPush(point);
+
+            // Consume it right away so the queue never fills
+            Plot::PlotPoint drained;
+            queue.tryPop(drained);
+        });
+    }
+    {
+        Plot::PlotHistory history;
+        for (size_t i = 0; i < Plot::MAX_POINTS; i++) {
+            history.append(Plot::toPlotPoint(sampleAt(i), static_cast<float>(i) * 1e-3f));
+        }
+        runner.run("plot/frame_full_history", [&](size_t i) {
+            for (size_t n = 0; n < SAMPLES_PER_FRAME; n++) {
+                history.append(Plot::toPlotPoint(sampleAt(i + n), static_cast<float>(i) * 1e-3f));
+            }
+            history.trim();
+            history.updateRanges();
+            g_sink = g_sink + static_cast<long long>(history.ranges().accel.max);
+        }, SAMPLES_PER_FRAME);
+        runner.run("plot/update_ranges_full_history", [&](size_t) {
+            history.updateRanges();
+            g_sink = g_sink + static_cast<long long>(history.ranges().gyro.min);
+        });
+    }
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, runner.results())) return 1;
+    return 0;
+}
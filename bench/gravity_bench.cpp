@@ -0,0 +1,144 @@
+// Accuracy and cost of the SensorUncoupler gravity modes.
+//
+// The simulator plays scripted motion (tilts, a sustained shake, rotation
+// while shaking, and a long session on a gyro whose bias is large and
+// wandering) with sensor noise, and knows the true gravity direction at
+// every sample. Each scenario is fed through a SensorUncoupler in each
+// mode; the angle between each estimate and the truth is summarised after
+// a two second settling period, along with the time per processData call.
+// For the Kalman mode the learned gyro bias is printed next to the true bias
+// at the end (the configured bias plus the drift), and the bench fails if
+// they are further apart than MAX_BIAS_ERROR_DPS on any axis. Linear motion
+// read as tilt would show up here first.
+//
+//   gravity_bench [seconds=60] [rate_hz=100]
+#include "simulator.h"
+#include "uncoupler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Samples before this are not scored; both estimators start from rest
+static const double SETTLE_SECONDS = 2.0;
+
+// Largest acceptable difference between the Kalman mode's final bias and the truth, per axis
+static const double MAX_BIAS_ERROR_DPS = 0.5;
+
+struct Scenario {
+    const char* name;
+    const char* profile;
+    double gyro_bias_dps;   // On every axis
+    double gyro_drift_dps;  // Bias random walk per sqrt(second)
+};
+
+static const Scenario SCENARIOS[] = {
+    { "tilts", "rest:2,rotate:x:90:1,rest:2,rotate:y:-60:1.5,rest:2,rotate:x:-90:1,rotate:y:60:1.5", 0.3, 0.0 },
+    { "shake", "rest:2,shake:x:0.5:2:6,rest:2,shake:y:0.3:0.5:6", 0.3, 0.0 },
+    { "rotate+shake", "rest:2,rotate:z:120:3,shake:x:0.4:3:4,rotate:x:45:2,tap:y:3,rest:1,rotate:x:-45:2", 0.3, 0.0 },
+    { "biased+drift", "rest:5,rotate:x:30:1,rest:5,rotate:x:-30:1,rotate:y:45:1,rest:5,rotate:y:-45:1", 2.0, 0.02 },
+};
+
+static const Uncoupler::GravityMode MODES[] = {
+    Uncoupler::GravityMode::MovingAverage, Uncoupler::GravityMode::Orientation, Uncoupler::GravityMode::Kalman
+};
+
+struct Score {
+    double mean_deg = 0.0;
+    double p95_deg = 0.0;
+    double max_deg = 0.0;
+    double ns_per_sample = 0.0;
+    float gyro_bias_dps[3] = { 0.0f, 0.0f, 0.0f };  // Kalman mode's final estimate
+    double true_bias_dps[3] = { 0.0, 0.0, 0.0 };    // Simulator's bias at the end
+};
+
+static double angleDegrees(const float estimate[3], const double truth[3]) {
+    double dot = estimate[0] * truth[0] + estimate[1] * truth[1] + estimate[2] * truth[2];
+    double norm = std::sqrt(estimate[0] * estimate[0] + estimate[1] * estimate[1] + estimate[2] * estimate[2]);
+    if (norm <= 0.0) return 180.0;
+    return std::acos(std::max(-1.0, std::min(1.0, dot / norm))) * 180.0 / 3.14159265358979;
+}
+
+static Score run(const Scenario& scenario, const std::vector<Simulator::MotionSegment>& profile,
+                 Uncoupler::GravityMode mode, double seconds, double rateHz) {
+    Simulator::SensorErrors errors;
+    for (double& bias : errors.gyro_bias_dps) bias = scenario.gyro_bias_dps;
+    errors.gyro_drift_dps = scenario.gyro_drift_dps;
+    Simulator::ImuModel model(profile, errors, 7);
+
+    Uncoupler::SensorUncoupler uncoupler;
+    uncoupler.setSampleRate(static_cast<float>(rateHz));
+    uncoupler.setGravityMode(mode);
+
+    size_t count = static_cast<size_t>(seconds * rateHz);
+    double dt = 1.0 / rateHz;
+    std::vector<double> errorsDeg;
+    errorsDeg.reserve(count);
+    Clock::duration spent(0);
+    for (size_t i = 0; i < count; i++) {
+        Serial::ImuSample sample = model.next(dt);
+        auto start = Clock::now();
+        Uncoupler::UncoupledData data = uncoupler.processData(sample);
+        spent += Clock::now() - start;
+
+        if (model.time() < SETTLE_SECONDS) continue;
+        double truth[3];
+        model.gravityDirection(truth);
+        float estimate[3] = { data.grav_x, data.grav_y, data.grav_z };
+        errorsDeg.push_back(angleDegrees(estimate, truth));
+    }
+
+    Score score;
+    score.ns_per_sample = std::chrono::duration<double, std::nano>(spent).count() / count;
+    model.gyroBias(score.true_bias_dps);
+    Uncoupler::GravityEstimate estimate = uncoupler.getGravityEstimate();
+    for (int i = 0; i < 3; i++) {
+        score.gyro_bias_dps[i] = estimate.gyro_bias[i] / static_cast<float>(Simulator::GYRO_COUNTS_PER_DPS);
+    }
+    if (errorsDeg.empty()) return score;
+    for (double e : errorsDeg) score.mean_deg += e;
+    score.mean_deg /= errorsDeg.size();
+    std::sort(errorsDeg.begin(), errorsDeg.end());
+    score.p95_deg = errorsDeg[errorsDeg.size() * 95 / 100];
+    score.max_deg = errorsDeg.back();
+    return score;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 60.0;
+    double rateHz = argc > 2 ? std::atof(argv[2]) : 100.0;
+    if (seconds <= SETTLE_SECONDS || rateHz <= 0.0) return 1;
+
+    std::printf("%-14s %-12s %10s %10s %10s %12s\n", "scenario", "mode", "mean deg", "p95 deg", "max deg", "ns/sample");
+    bool ok = true;
+    for (const Scenario& scenario : SCENARIOS) {
+        std::vector<Simulator::MotionSegment> profile;
+        if (!Simulator::parseProfile(scenario.profile, profile)) {
+            std::fprintf(stderr, "Bad profile for %s\n", scenario.name);
+            return 1;
+        }
+        for (Uncoupler::GravityMode mode : MODES) {
+            Score score = run(scenario, profile, mode, seconds, rateHz);
+            ok &= std::isfinite(score.mean_deg);
+            std::printf("%-14s %-12s %10.2f %10.2f %10.2f %12.1f", scenario.name, Uncoupler::gravityModeName(mode),
+                        score.mean_deg, score.p95_deg, score.max_deg, score.ns_per_sample);
+            if (mode == Uncoupler::GravityMode::Kalman) {
+                double worst = 0.0;
+                for (int i = 0; i < 3; i++) {
+                    worst = std::max(worst, std::fabs(score.gyro_bias_dps[i] - score.true_bias_dps[i]));
+                }
+                bool biasOk = worst <= MAX_BIAS_ERROR_DPS;
+                ok &= biasOk;
+                std::printf("   bias %.2f %.2f %.2f deg/s (true %.2f %.2f %.2f)%s", score.gyro_bias_dps[0],
+                            score.gyro_bias_dps[1], score.gyro_bias_dps[2], score.true_bias_dps[0],
+                            score.true_bias_dps[1], score.true_bias_dps[2], biasOk ? "" : "  BIAS ERROR");
+            }
+            std::printf("\n");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Accuracy and cost of Metrics::LatencyHistogram.
+//
+// Records a long-tailed mix of latencies (mostly tens of microseconds with
+// occasional multi-millisecond stalls), then compares p50/p99/p99.9 against
+// the exact percentiles of the sorted values; each must be within the
+// histogram's 1/32 bucket width. Then times record() on one thread and
+// checks that four threads recording at once lose no counts.
+//
+//   latency_bench [samples=1000000]
+#include "latency_histogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t exactPercentile(const std::vector<int64_t>& sorted, double quantile) {
+    size_t rank = static_cast<size_t>(std::ceil(quantile * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static bool checkAccuracy(size_t samples) {
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> body(std::log(20000.0), 0.5);
+    std::uniform_real_distribution<double> stall(1e6, 8e6);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    std::vector<int64_t> values(samples);
+    Metrics::LatencyHistogram histogram;
+    for (int64_t& value : values) {
+        value = static_cast<int64_t>(coin(rng) < 0.005 ? stall(rng) : body(rng));
+        histogram.record(value);
+    }
+    std::sort(values.begin(), values.end());
+
+    Metrics::LatencySummary s = histogram.summary();
+    bool ok = s.count == samples && s.max == values.back();
+    const double quantiles[] = { 0.5, 0.99, 0.999 };
+    const int64_t measured[] = { s.p50, s.p99, s.p999 };
+    for (int i = 0; i < 3; i++) {
+        int64_t exact = exactPercentile(values, quantiles[i]);
+        double error = std::fabs(static_cast<double>(measured[i] - exact)) / exact;
+        bool within = error <= 1.0 / 32;
+        ok &= within;
+        std::printf("p%-5g exact %9.1f us  histogram %9.1f us  error %5.2f%%  %s\n",
+                    quantiles[i] * 100, exact * 1e-3, measured[i] * 1e-3, error * 100, within ? "ok" : "TOO FAR");
+    }
+    std::printf("max    exact %9.1f us  histogram %9.1f us  %s\n",
+                values.back() * 1e-3, s.max * 1e-3, s.max == values.back() ? "ok" : "WRONG");
+    return ok;
+}
+
+static void timeRecord(size_t samples) {
+    Metrics::LatencyHistogram histogram;
+    auto start = Clock::now();
+    for (size_t i = 0; i < samples; i++) {
+        histogram.record(static_cast<int64_t>((i * 2654435761u) % 10000000));
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+    std::printf("record  %.1f ns each (one thread)\n", ns);
+}
+
+static bool checkConcurrent(size_t samples) {
+    const int threads = 4;
+    Metrics::LatencyHistogram histogram;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([&histogram, samples, t]() {
+            for (size_t i = 0; i < samples; i++) {
+                histogram.record(static_cast<int64_t>(1000 * (t + 1) + i % 1000));
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+
+    Metrics::LatencySummary s = histogram.summary();
+    bool ok = s.count == samples * threads && s.max == 1000 * threads + 999;
+    std::printf("concurrent  %d threads, %llu of %llu counted, max %lld ns  %s\n", threads,
+                static_cast<unsigned long long>(s.count), static_cast<unsigned long long>(samples * threads),
+                static_cast<long long>(s.max), ok ? "ok" : "LOST COUNTS");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (samples == 0) return 1;
+
+    bool ok = checkAccuracy(samples);
+    timeRecord(samples);
+    ok &= checkConcurrent(samples);
+    return ok ? 0 : 1;
+}
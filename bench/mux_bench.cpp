@@ -0,0 +1,119 @@
+// Multi-port ingest benchmark for Serial::IngestMux.
+//
+// N pty pairs stand in for N IMUs. A single writer thread paces frames into
+// every device at the requested rate; the ingest loop on the main thread owns
+// all ports through one IngestMux and is the only thread whose CPU time is
+// reported.
+//
+//   mux_bench [devices=16] [rate_hz=1000] [seconds=5] [json|binary]
+//   rate_hz = 0 writes as fast as the ptys accept to find the ceiling
+#include "ingest_mux.h"
+#include "pty_loopback.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    int deviceCount = argc > 1 ? std::atoi(argv[1]) : 16;
+    int rateHz = argc > 2 ? std::atoi(argv[2]) : 1000;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 5.0;
+    bool binary = argc > 4 && std::strcmp(argv[4], "binary") == 0;
+
+    if (deviceCount < 1 || deviceCount > static_cast<int>(Serial::MAX_DEVICES)) {
+        std::fprintf(stderr, "devices must be 1..%zu\n", Serial::MAX_DEVICES);
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Serial::PtyLoopback>> ptys;
+    Serial::IngestMux mux;
+    for (int i = 0; i < deviceCount; i++) {
+        std::unique_ptr<Serial::PtyLoopback> pty = std::make_unique<Serial::PtyLoopback>();
+        if (!pty->open()) return 1;
+        if (mux.addSource(Serial::openSerialSource(pty->devicePath())) < 0) return 1;
+        ptys.push_back(std::move(pty));
+    }
+
+    // Writer: one frame per device per tick (or batches when unpaced)
+    std::atomic<bool> writing(true);
+    std::atomic<long long> framesSent(0);
+    std::thread writer([&]() {
+        const int batch = rateHz > 0 ? 1 : 32;
+        auto period = rateHz > 0 ? std::chrono::nanoseconds(1000000000LL / rateHz) : std::chrono::nanoseconds(0);
+        auto nextTick = Clock::now();
+        auto end = nextTick + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        uint16_t sequence = 0;
+        char text[128];
+        uint8_t frame[Serial::BINARY_TIMED_SAMPLE_WIRE_SIZE];
+
+        while (Clock::now() < end) {
+            for (int d = 0; d < deviceCount; d++) {
+                for (int b = 0; b < batch; b++) {
+                    Serial::ImuSample s;
+                    s.ax = sequence;
+                    s.gz = d;
+                    if (binary) {
+                        size_t len = Serial::encodeBinarySample(s, sequence, frame);
+                        ptys[d]->write(reinterpret_cast<const char*>(frame), len);
+                    } else {
+                        int len = std::snprintf(text, sizeof(text), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\n",
+                                                s.ax, -1234, 16384, 12, -34, s.gz);
+                        ptys[d]->write(text, len);
+                    }
+                    framesSent++;
+                }
+            }
+            sequence++;
+            if (rateHz > 0) {
+                nextTick += period;
+                std::this_thread::sleep_until(nextTick);
+            }
+        }
+        writing = false;
+    });
+
+    // Ingest: one thread, one wait call for all ports
+    std::vector<long long> perDevice(deviceCount, 0);
+    long long received = 0;
+    double cpuStart = threadCpuSeconds();
+    auto wallStart = Clock::now();
+    int idlePolls = 0;
+    while (writing || idlePolls < 3) {
+        size_t n = mux.poll(100, [&](const Serial::ImuSample& sample) {
+            perDevice[sample.device]++;
+            received++;
+        });
+        idlePolls = (n == 0 && !writing) ? idlePolls + 1 : 0;
+    }
+    double cpu = threadCpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    writer.join();
+
+    long long minDevice = perDevice[0];
+    long long maxDevice = perDevice[0];
+    for (long long count : perDevice) {
+        minDevice = count < minDevice ? count : minDevice;
+        maxDevice = count > maxDevice ? count : maxDevice;
+    }
+
+    std::printf("devices=%d rate=%dHz format=%s\n", deviceCount, rateHz, binary ? "binary" : "json");
+    std::printf("  samples  %lld/%lld received (per device %lld..%lld)\n",
+                received, framesSent.load(), minDevice, maxDevice);
+    std::printf("  rate     %.0f samples/s\n", received / wall);
+    std::printf("  ingest   %.1f%% of one core, %.0f ns CPU/sample\n",
+                100.0 * cpu / wall, received > 0 ? cpu * 1e9 / received : 0.0);
+
+    return received == framesSent.load() ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Per-sample parse cost: legacy parseJsonToDict versus Serial::parseSample.
+//
+// Frames are generated up front in the firmware's exact printf format so the
+// loop measures parsing only. Each parser runs over the same frame set; the
+// checksum keeps the optimiser from discarding the work.
+#include "serial.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    // A spread of magnitudes and signs like a real capture
+    const int frameCount = 1024;
+    std::vector<std::string> frames;
+    frames.reserve(frameCount);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> accel(-32768, 32767);
+    std::uniform_int_distribution<int> gyro(-2000, 2000);
+    char line[128];
+    for (int i = 0; i < frameCount; i++) {
+        int len = std::snprintf(line, sizeof(line), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}",
+                                accel(rng), accel(rng), accel(rng), gyro(rng), gyro(rng), gyro(rng));
+        frames.emplace_back(line, len);
+    }
+
+    // Legacy map parser
+    long long checksum = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        std::unordered_map<std::string, int> data = parseJsonToDict(frames[i & (frameCount - 1)]);
+        checksum += data["ax"] + data["gz"];
+    }
+    double mapNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+
+    // Typed zero-allocation parser
+    long long typedChecksum = 0;
+    Serial::ImuSample sample;
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        const std::string& frame = frames[i & (frameCount - 1)];
+        if (Serial::parseSample(frame.data(), frame.size(), sample)) {
+            typedChecksum += sample.ax + sample.gz;
+        }
+    }
+    double typedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+
+    std::printf("parseJsonToDict     %8.1f ns/sample\n", mapNs);
+    std::printf("Serial::parseSample %8.1f ns/sample  (%.1fx)\n", typedNs, mapNs / typedNs);
+
+    if (checksum != typedChecksum) {
+        std::fprintf(stderr, "Parsers disagree (%lld vs %lld)\n", checksum, typedChecksum);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Throughput and isolation of Pipeline::Pipeline.
+//
+// The real uncoupler and hand tracker run as fused stages, followed by a
+// sink that checks sequence order. Four runs:
+//   fused     sink inline; the producer pays for every stage
+//   threaded  sink on its own thread; every pushed sample must arrive in
+//             order, minus the ones counted as dropped
+//   slow      a sink that takes 2 ms per sample behind a 1 kHz producer;
+//             as a threaded stage it may drop samples but must not hold up
+//             the producer (compare the push latency to the fused run)
+//   broadcast the slow sink and a fast one both reading the broadcast
+//             ring at 1 kHz; the fast one must get every sample while the
+//             slow one is lapped, and neither may hold up the producer
+//
+//   pipeline_bench [samples=1000000]
+#include "pipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Last stage: sequence numbers must only ever increase
+class OrderCheck : public Pipeline::Stage {
+public:
+    explicit OrderCheck(std::chrono::microseconds cost) : m_cost(cost) {}
+
+    const char* name() const override { return "check"; }
+
+    void process(Pipeline::FusedSample& sample) override {
+        if (m_seen > 0 && sample.raw.sequence <= m_last) m_outOfOrder++;
+        m_last = sample.raw.sequence;
+        m_seen++;
+        if (m_cost.count() > 0) std::this_thread::sleep_for(m_cost);
+    }
+
+    unsigned int m_last = 0;
+    uint64_t m_seen = 0;
+    uint64_t m_outOfOrder = 0;
+
+private:
+    std::chrono::microseconds m_cost;
+};
+
+static const char* executionName(Pipeline::Execution execution) {
+    switch (execution) {
+        case Pipeline::Execution::Threaded:  return "threaded";
+        case Pipeline::Execution::Broadcast: return "broadcast";
+        default:                             return "fused";
+    }
+}
+
+static void printStages(const Pipeline::Pipeline& pipeline) {
+    for (const Pipeline::StageStats& stage : pipeline.stats()) {
+        std::printf("    %-9s %-9s %9llu done %7.0f ns each  queue %4zu/%-4zu  %llu dropped\n",
+                    stage.name.c_str(), executionName(stage.execution),
+                    static_cast<unsigned long long>(stage.processed), stage.mean_process_ns,
+                    stage.queue_depth, stage.queue_capacity, static_cast<unsigned long long>(stage.dropped));
+    }
+}
+
+// Push count samples (rateHz 0 = as fast as possible); returns false on a lost or reordered sample
+static bool run(const char* name, Pipeline::Execution sinkExecution, std::chrono::microseconds sinkCost,
+                uint64_t count, int rateHz) {
+    Uncoupler::SensorUncoupler uncoupler;
+    Hand::HandTracker tracker;
+
+    Pipeline::Pipeline pipeline;
+    pipeline.addStage("uncouple", [&](Pipeline::FusedSample& sample) {
+        sample.uncoupled = uncoupler.processData(sample.raw);
+    });
+    pipeline.addStage("track", [&](Pipeline::FusedSample& sample) {
+        tracker.update(sample.raw);
+        sample.velocity = tracker.getVelocity();
+    });
+    std::unique_ptr<OrderCheck> owned = std::make_unique<OrderCheck>(sinkCost);
+    OrderCheck* check = owned.get();
+    pipeline.addStage(std::move(owned), sinkExecution);
+    pipeline.start();
+
+    std::vector<double> pushNs;
+    pushNs.reserve(count);
+    Serial::ImuSample sample;
+    sample.az = 16384;
+    sample.has_sequence = true;
+
+    auto start = Clock::now();
+    auto next = start;
+    for (uint64_t i = 0; i < count; i++) {
+        sample.sequence = static_cast<unsigned int>(i);
+        sample.gx = static_cast<int>(i % 200) - 100;
+        auto before = Clock::now();
+        pipeline.push(sample);
+        pushNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+
+        if (rateHz > 0) {
+            next += std::chrono::microseconds(1000000 / rateHz);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    pipeline.stop();
+    std::vector<Pipeline::StageStats> stats = pipeline.stats();
+
+    std::sort(pushNs.begin(), pushNs.end());
+    uint64_t dropped = stats.back().dropped;
+    bool ok = check->m_outOfOrder == 0 && check->m_seen + dropped == count;
+    std::printf("%-9s %8.2f M samples/s pushed  push p50 %8.0f ns  p99 %9.0f ns  %llu arrived, %llu dropped  %s\n",
+                name, count / seconds * 1e-6, pushNs[pushNs.size() / 2], pushNs[pushNs.size() * 99 / 100],
+                static_cast<unsigned long long>(check->m_seen), static_cast<unsigned long long>(dropped),
+                ok ? "ok" : "UNEXPECTED");
+    printStages(pipeline);
+    return ok;
+}
+
+// A fast and a 2 ms sink reading the broadcast ring behind a 1 kHz producer
+static bool runBroadcast(uint64_t count) {
+    Pipeline::Pipeline pipeline;
+    pipeline.addStage("source", [](Pipeline::FusedSample&) {});
+    std::unique_ptr<OrderCheck> ownedFast = std::make_unique<OrderCheck>(std::chrono::microseconds(0));
+    std::unique_ptr<OrderCheck> ownedSlow = std::make_unique<OrderCheck>(std::chrono::microseconds(2000));
+    OrderCheck* fast = ownedFast.get();
+    OrderCheck* slow = ownedSlow.get();
+    pipeline.addStage(std::move(ownedSlow), Pipeline::Execution::Broadcast, 256);
+    pipeline.addStage(std::move(ownedFast), Pipeline::Execution::Broadcast, 256);
+    pipeline.start();
+
+    std::vector<double> pushNs;
+    pushNs.reserve(count);
+    Serial::ImuSample sample;
+    sample.has_sequence = true;
+    auto next = Clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        sample.sequence = static_cast<unsigned int>(i);
+        auto before = Clock::now();
+        pipeline.push(sample);
+        pushNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+        next += std::chrono::microseconds(1000);
+        std::this_thread::sleep_until(next);
+    }
+    pipeline.stop();
+    std::vector<Pipeline::StageStats> stats = pipeline.stats();
+
+    std::sort(pushNs.begin(), pushNs.end());
+    bool fastOk = fast->m_outOfOrder == 0 && fast->m_seen == count && stats[2].dropped == 0;
+    bool slowOk = slow->m_outOfOrder == 0 && slow->m_seen + stats[1].dropped == count && stats[1].dropped > 0;
+    std::printf("%-9s push p50 %8.0f ns  p99 %9.0f ns  fast sink %llu arrived, slow sink %llu arrived, %llu missed  %s\n",
+                "broadcast", pushNs[pushNs.size() / 2], pushNs[pushNs.size() * 99 / 100],
+                static_cast<unsigned long long>(fast->m_seen), static_cast<unsigned long long>(slow->m_seen),
+                static_cast<unsigned long long>(stats[1].dropped), fastOk && slowOk ? "ok" : "UNEXPECTED");
+    printStages(pipeline);
+    return fastOk && slowOk;
+}
+
+int main(int argc, char** argv) {
+    uint64_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000ull;
+    using Execution = Pipeline::Execution;
+    std::chrono::microseconds none(0);
+    std::chrono::microseconds slow(2000);
+
+    bool ok = true;
+    ok &= run("fused", Execution::Fused, none, count, 0);
+    ok &= run("threaded", Execution::Threaded, none, count, 0);
+    ok &= run("slow", Execution::Threaded, slow, 2000, 1000);
+    ok &= run("slow", Execution::Fused, slow, 500, 1000);
+    ok &= runBroadcast(2000);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Offline profile of the processing chain on a recorded byte stream.
+//
+// Without a file argument a short session is recorded first: a pty stands in
+// for the ESP32 and the host side is wrapped in Serial::CaptureSource, exactly
+// as `main --capture` does. The capture is then replayed as fast as possible
+// through the same decoder, SensorUncoupler and HandTracker the app uses,
+// several passes in a row. The checksum covers the uncoupler output so two
+// builds can be compared on identical input.
+//
+//   replay_bench [capture-file] [passes=5]
+#include "capture.h"
+#include "ingest_mux.h"
+#include "pty_loopback.h"
+#include "hand.h"
+#include "uncoupler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+// Record `count` samples at 1 kHz from a simulated device
+static bool recordSession(const std::string& path, int count) {
+    Serial::PtyLoopback pty;
+    if (!pty.open()) return false;
+    std::unique_ptr<Serial::CaptureSource> capture =
+        Serial::CaptureSource::open(Serial::openSerialSource(pty.devicePath()), path);
+    if (!capture) return false;
+
+    std::thread writer([&]() {
+        char text[128];
+        auto nextTick = Clock::now();
+        for (int i = 0; i < count; i++) {
+            // Slow rotation about z with a little noise on every channel
+            double t = i * 0.001;
+            int len = std::snprintf(text, sizeof(text), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\n",
+                                    static_cast<int>(8000 * std::cos(t)) + (i * 7919) % 61 - 30,
+                                    static_cast<int>(8000 * std::sin(t)) + (i * 104729) % 53 - 26,
+                                    14000 + (i * 31) % 41 - 20,
+                                    (i * 13) % 23 - 11, (i * 17) % 29 - 14, 131 + (i * 19) % 31 - 15);
+            pty.write(text, len);
+            nextTick += std::chrono::milliseconds(1);
+            std::this_thread::sleep_until(nextTick);
+        }
+    });
+
+    Serial::FrameDecoder decoder;
+    char buffer[1024];
+    int received = 0;
+    while (received < count && capture->waitReadable(500)) {
+        long n = capture->read(buffer, sizeof(buffer));
+        if (n < 0) break;
+        decoder.feed(buffer, static_cast<size_t>(n), [&](const Serial::Frame&) { received++; });
+    }
+    writer.join();
+    capture->close();
+    return received == count;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "replay_bench.cap";
+    int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    if (argc <= 1) {
+        std::printf("recording 2000 samples to %s\n", path.c_str());
+        if (!recordSession(path, 2000)) {
+            std::fprintf(stderr, "recording failed\n");
+            return 1;
+        }
+    }
+
+    std::unique_ptr<Serial::ReplaySource> replay = Serial::ReplaySource::open(path, Serial::ReplayPace::AsFastAsPossible);
+    if (!replay) return 1;
+    Serial::ReplaySource* replaySource = replay.get();
+
+    Serial::IngestMux mux;
+    if (mux.addSource(std::move(replay)) < 0) return 1;
+
+    std::printf("%-6s %10s %12s %12s %12s  %s\n", "pass", "samples", "samples/s", "ns/sample", "MB/s", "checksum");
+    bool consistent = true;
+    uint64_t firstChecksum = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        Uncoupler::SensorUncoupler uncoupler;
+        Hand::HandTracker tracker;
+        uint64_t checksum = 1469598103934665603ULL;  // FNV-1a over the uncoupler output
+        size_t samples = 0;
+
+        replaySource->rewind();
+        auto start = Clock::now();
+        while (mux.openDeviceCount() > 0) {
+            samples += mux.poll(0, [&](const Serial::ImuSample& sample) {
+                Uncoupler::UncoupledData data = uncoupler.processData(sample);
+                tracker.update(sample);
+
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&data);
+                for (size_t i = 0; i < sizeof(data); i++) {
+                    checksum = (checksum ^ bytes[i]) * 1099511628211ULL;
+                }
+            });
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (pass == 0) firstChecksum = checksum;
+        consistent &= checksum == firstChecksum;
+        std::printf("%-6d %10zu %12.0f %12.0f %12.1f  %016llx\n", pass, samples, samples / elapsed,
+                    elapsed * 1e9 / samples, replaySource->totalBytes() / elapsed / 1e6,
+                    static_cast<unsigned long long>(checksum));
+    }
+
+    std::printf("%s\n", consistent ? "deterministic" : "OUTPUT DIFFERS BETWEEN PASSES");
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+// Latency and CPU cost of the sensor thread's ingest loop.
+//
+// A writer thread paces binary frames into a pty at a fixed rate and records
+// when each sequence number went out. The main thread runs one of two loops
+// over an IngestMux on the other end, the way main.cpp's sensorThread does:
+//   sleep  poll(100 ms) then sleep 10 ms after every wakeup (the old loop)
+//   event  poll(-1): block until bytes arrive, stopped with wake()
+// For each sample the time from write() to the callback is recorded; the
+// loop thread's CPU time and wakeups are reported alongside. A rate of 0
+// measures the idle cost with nothing arriving.
+//
+//   sensor_loop_bench [seconds=3]
+#include "ingest_mux.h"
+#include "pty_loopback.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+struct Result {
+    double p50_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+    double cpu_percent = 0.0;
+    double wakeups_per_s = 0.0;
+    size_t received = 0;
+    size_t sent = 0;
+};
+
+static bool run(bool eventDriven, int rateHz, double seconds, Result& result) {
+    Serial::PtyLoopback pty;
+    if (!pty.open()) return false;
+
+    Serial::IngestMux mux;
+    if (mux.addSource(Serial::openSerialSource(pty.devicePath())) < 0) return false;
+
+    // Send time of each sequence number (16 bits on the wire)
+    std::vector<std::atomic<int64_t>> sentAt(65536);
+    size_t count = static_cast<size_t>(rateHz * seconds);
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]() {
+        auto next = Clock::now();
+        Serial::ImuSample sample;
+        sample.az = 16384;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t frame[Serial::BINARY_TIMED_SAMPLE_WIRE_SIZE];
+            sample.device_time_us = static_cast<uint32_t>(Serial::hostTimeNs() / 1000);
+            size_t length = Serial::encodeBinarySample(sample, static_cast<uint16_t>(i), frame);
+            sentAt[i & 0xFFFF].store(Serial::hostTimeNs(), std::memory_order_release);
+            pty.write(reinterpret_cast<const char*>(frame), length);
+
+            next += std::chrono::microseconds(1000000 / rateHz);
+            std::this_thread::sleep_until(next);
+        }
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        } else {
+            // Let the last frames drain through the slowest loop
+            std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        }
+        done = true;
+        mux.wake();
+    });
+
+    std::vector<double> latencies;
+    latencies.reserve(count);
+    size_t wakeups = 0;
+    double cpuStart = threadCpuSeconds();
+    auto start = Clock::now();
+
+    auto onSample = [&](const Serial::ImuSample& sample) {
+        int64_t now = Serial::hostTimeNs();
+        int64_t sent = sentAt[sample.sequence & 0xFFFF].load(std::memory_order_acquire);
+        latencies.push_back((now - sent) * 1e-3);
+    };
+    while (!done) {
+        wakeups++;
+        if (eventDriven) {
+            mux.poll(-1, onSample);
+        } else {
+            mux.poll(100, onSample);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu = threadCpuSeconds() - cpuStart;
+    writer.join();
+
+    result.received = latencies.size();
+    result.sent = count;
+    result.cpu_percent = cpu / elapsed * 100.0;
+    result.wakeups_per_s = wakeups / elapsed;
+    result.p50_us = percentile(latencies, 0.50);
+    result.p99_us = percentile(latencies, 0.99);
+    result.max_us = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+
+    bool ok = true;
+    std::printf("loop   rate Hz  latency p50 us    p99 us    max us   cpu %%  wakeups/s  received\n");
+    for (int rateHz : {0, 50, 200, 1000}) {
+        Result sleep;
+        Result event;
+        if (!run(false, rateHz, seconds, sleep) || !run(true, rateHz, seconds, event)) return 1;
+
+        for (int i = 0; i < 2; i++) {
+            const Result& r = i == 0 ? sleep : event;
+            std::printf("%-6s %7d  %14.0f %9.0f %9.0f %7.2f %10.1f  %zu/%zu\n",
+                        i == 0 ? "sleep" : "event", rateHz, r.p50_us, r.p99_us, r.max_us,
+                        r.cpu_percent, r.wakeups_per_s, r.received, r.sent);
+        }
+
+        // Neither loop may lose samples; once frames come faster than the
+        // 10 ms sleep the event loop must cut the tail latency
+        ok &= event.received == event.sent && sleep.received == sleep.sent;
+        if (rateHz > 100) ok &= event.p99_us < sleep.p99_us;
+    }
+    return ok ? 0 : 1;
+}
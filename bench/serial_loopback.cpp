@@ -0,0 +1,143 @@
+// Pty loopback harness for the serial ingest path.
+//
+// A writer thread plays the ESP32 and pushes firmware-format JSON lines into
+// the master end of a pseudo-terminal; the reader opens the device end with
+// Serial::openSerialSource() exactly as main.cpp opens a real port.
+//
+//   throughput: writer bursts frames, reader counts bytes/frames per second
+//   latency:    writer sends one frame at a time and waits for the reader to
+//               see it, measuring write-to-wakeup time
+//
+// Both phases run once with WaitMode::Event and once with WaitMode::BusyPoll.
+#include "serial_port.h"
+#include "pty_loopback.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const char* waitModeName(Serial::WaitMode mode) {
+    return mode == Serial::WaitMode::Event ? "event" : "busy-poll";
+}
+
+static int formatFrame(char* out, size_t size, int i) {
+    return std::snprintf(out, size, "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\n",
+                         i % 16384, -(i % 8192), 16384, i % 250, -(i % 125), 7);
+}
+
+static bool runThroughput(Serial::WaitMode mode, int frameCount) {
+    Serial::PtyLoopback pty;
+    if (!pty.open()) return false;
+
+    Serial::PortConfig config;
+    config.wait_mode = mode;
+    std::unique_ptr<Serial::SerialSource> source = Serial::openSerialSource(pty.devicePath(), config);
+    if (!source) return false;
+
+    size_t bytesSent = 0;
+    std::vector<char> stream;
+    stream.reserve(static_cast<size_t>(frameCount) * 64);
+    char frame[128];
+    for (int i = 0; i < frameCount; i++) {
+        int len = formatFrame(frame, sizeof(frame), i);
+        stream.insert(stream.end(), frame, frame + len);
+    }
+    bytesSent = stream.size();
+
+    auto start = Clock::now();
+    std::thread writer([&]() {
+        pty.write(stream.data(), stream.size());
+    });
+
+    char buffer[4096];
+    size_t bytesReceived = 0;
+    int framesReceived = 0;
+    while (bytesReceived < bytesSent) {
+        if (!source->waitReadable(1000)) break;
+        long n = source->read(buffer, sizeof(buffer));
+        if (n < 0) break;
+        bytesReceived += static_cast<size_t>(n);
+        framesReceived += static_cast<int>(std::count(buffer, buffer + n, '\n'));
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    writer.join();
+
+    std::printf("throughput %-9s frames=%d/%d bytes=%zu  %.0f frames/s  %.2f MB/s\n",
+                waitModeName(mode), framesReceived, frameCount, bytesReceived,
+                framesReceived / elapsed, bytesReceived / elapsed / 1e6);
+    return framesReceived == frameCount;
+}
+
+static bool runLatency(Serial::WaitMode mode, int frameCount) {
+    Serial::PtyLoopback pty;
+    if (!pty.open()) return false;
+
+    Serial::PortConfig config;
+    config.wait_mode = mode;
+    std::unique_ptr<Serial::SerialSource> source = Serial::openSerialSource(pty.devicePath(), config);
+    if (!source) return false;
+
+    std::atomic<int> acknowledged(-1);
+    std::atomic<long long> sentAt(0);
+    std::vector<double> latencies;
+    latencies.reserve(frameCount);
+
+    std::thread writer([&]() {
+        char frame[128];
+        for (int i = 0; i < frameCount; i++) {
+            int len = formatFrame(frame, sizeof(frame), i);
+            sentAt = Clock::now().time_since_epoch().count();
+            pty.write(frame, len);
+            while (acknowledged.load() < i) std::this_thread::yield();
+        }
+    });
+
+    char buffer[256];
+    for (int i = 0; i < frameCount; i++) {
+        bool gotLine = false;
+        while (!gotLine) {
+            if (!source->waitReadable(1000)) break;
+            long n = source->read(buffer, sizeof(buffer));
+            if (n < 0) break;
+            gotLine = std::find(buffer, buffer + n, '\n') != buffer + n;
+        }
+        if (!gotLine) break;
+        long long now = Clock::now().time_since_epoch().count();
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::duration(now - sentAt.load())).count());
+        acknowledged = i;
+    }
+    acknowledged = frameCount;
+    writer.join();
+
+    if (latencies.empty()) return false;
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("latency    %-9s n=%zu  p50=%.1fus  p99=%.1fus  max=%.1fus\n",
+                waitModeName(mode), latencies.size(),
+                latencies[latencies.size() / 2],
+                latencies[latencies.size() * 99 / 100],
+                latencies.back());
+    return static_cast<int>(latencies.size()) == frameCount;
+}
+
+int main(int argc, char** argv) {
+    int frameCount = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int latencyCount = std::min(frameCount, 10000);
+
+    bool ok = true;
+    for (Serial::WaitMode mode : { Serial::WaitMode::Event, Serial::WaitMode::BusyPoll }) {
+        ok &= runThroughput(mode, frameCount);
+        ok &= runLatency(mode, latencyCount);
+    }
+
+    if (!ok) {
+        std::cerr << "Loopback lost data" << std::endl;
+        return 1;
+    }
+    return 0;
+}
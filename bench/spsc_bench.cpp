@@ -0,0 +1,105 @@
+// Throughput and ordering of Concurrency::SpscQueue.
+//
+// A producer pushes sequence numbers as fast as it can while a consumer
+// drains them, once popping one item at a time and once draining in
+// batches the way the plot renderer does each frame. Refused pushes are
+// retried, so every number must come out exactly once and in order; the
+// overrun counter shows how often the producer found the queue full.
+// A last run paces the consumer like a 60 Hz renderer against a 1 kHz
+// producer to check a full frame's worth of samples fits in the plot queue.
+//
+//   spsc_bench [items=10000000]
+#include "spsc_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static bool run(const char* name, size_t capacity, uint64_t items, bool batched) {
+    Concurrency::SpscQueue<uint64_t> queue(capacity);
+
+    auto start = Clock::now();
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < items; i++) {
+            while (!queue.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t expected = 0;
+    uint64_t outOfOrder = 0;
+    auto check = [&](const uint64_t& value) {
+        if (value != expected) outOfOrder++;
+        expected = value + 1;
+    };
+    while (expected < items) {
+        if (batched) {
+            if (queue.drain(check) == 0) std::this_thread::yield();
+        } else {
+            uint64_t value;
+            if (queue.tryPop(value)) {
+                check(value);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    producer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool ok = outOfOrder == 0;
+    std::printf("%-10s capacity %6zu  %6.1f M items/s  %10llu full  %s\n",
+                name, queue.capacity(), items / seconds * 1e-6,
+                static_cast<unsigned long long>(queue.overruns()), ok ? "ok" : "OUT OF ORDER");
+    return ok;
+}
+
+// 1 kHz producer against a consumer that drains every 16.7 ms, as Plot does
+static bool runPaced(size_t capacity, double seconds) {
+    Concurrency::SpscQueue<uint64_t> queue(capacity);
+    const uint64_t items = static_cast<uint64_t>(seconds * 1000.0);
+
+    std::thread producer([&]() {
+        auto next = Clock::now();
+        for (uint64_t i = 0; i < items; i++) {
+            queue.tryPush(i);
+            next += std::chrono::milliseconds(1);
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    uint64_t received = 0;
+    size_t peak = 0;
+    auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds + 0.1));
+    auto frame = Clock::now();
+    while (Clock::now() < end) {
+        frame += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frame);
+        peak = std::max(peak, queue.size());
+        received += queue.drain([](const uint64_t&) {});
+    }
+    producer.join();
+    received += queue.drain([](const uint64_t&) {});
+
+    bool ok = queue.overruns() == 0 && received == items;
+    std::printf("paced      capacity %6zu  %llu of %llu items, peak occupancy %zu, %llu dropped  %s\n",
+                queue.capacity(), static_cast<unsigned long long>(received),
+                static_cast<unsigned long long>(items), peak,
+                static_cast<unsigned long long>(queue.overruns()), ok ? "ok" : "UNEXPECTED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint64_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000ull;
+
+    bool ok = true;
+    ok &= run("pop", 1024, items, false);
+    ok &= run("drain", 1024, items, true);
+    ok &= run("drain", 64, items, true);
+    ok &= runPaced(4096, 2.0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Consistency and cost of the tracker and uncoupler state snapshots.
+//
+// One thread feeds HandTracker and SensorUncoupler samples whose three
+// axes are always equal, the way the sensor thread does. Three readers poll
+// getState() and getGravityEstimate() as fast as they can, and a settings
+// thread keeps toggling calibration, offsets, alpha and the gravity window
+// like the keyboard thread. A snapshot whose axes differ, whose
+// acceleration is not the one from its own update, or whose update count
+// goes backwards was torn. The writer's time per sample is reported alone
+// and with the readers running.
+//
+//   state_publish_bench [samples=2000000]
+#include "hand.h"
+#include "uncoupler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct ReaderResult {
+    uint64_t reads = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+// Sample n has every axis equal to n (mod 4096) and is 1 ms after sample n-1
+static Serial::ImuSample sampleAt(uint64_t n) {
+    Serial::ImuSample sample;
+    int value = static_cast<int>(n % 4096) + 1000;
+    sample.ax = sample.ay = sample.az = value;
+    sample.gx = sample.gy = sample.gz = value;
+    sample.host_time_ns = static_cast<int64_t>(n + 1) * 1000000;
+    return sample;
+}
+
+static bool allEqual(float x, float y, float z) {
+    return x == y && y == z;
+}
+
+static void readUntil(const Hand::HandTracker& tracker, const Uncoupler::SensorUncoupler& uncoupler,
+                      const std::atomic<bool>& done, ReaderResult& result) {
+    uint64_t lastUpdates = 0;
+    uint64_t lastSamples = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+        Hand::TrackerState state = tracker.getState();
+        bool consistent = allEqual(state.acceleration.x, state.acceleration.y, state.acceleration.z)
+            && allEqual(state.gyroscope.x, state.gyroscope.y, state.gyroscope.z)
+            && allEqual(state.velocity.x, state.velocity.y, state.velocity.z);
+        if (state.updates > 0) {
+            consistent &= state.acceleration.x == static_cast<float>(sampleAt(state.updates - 1).ax);
+        }
+        if (state.updates < lastUpdates) result.backwards++;
+        lastUpdates = state.updates;
+
+        Uncoupler::GravityEstimate estimate = uncoupler.getGravityEstimate();
+        consistent &= allEqual(estimate.direction[0], estimate.direction[1], estimate.direction[2])
+            && allEqual(estimate.filtered[0], estimate.filtered[1], estimate.filtered[2]);
+        if (estimate.samples < lastSamples) result.backwards++;
+        lastSamples = estimate.samples;
+
+        if (!consistent) result.torn++;
+        result.reads++;
+    }
+}
+
+// Feed count samples; returns nanoseconds per sample
+static double feed(Hand::HandTracker& tracker, Uncoupler::SensorUncoupler& uncoupler, uint64_t first, uint64_t count) {
+    auto start = Clock::now();
+    for (uint64_t n = first; n < first + count; n++) {
+        Serial::ImuSample sample = sampleAt(n);
+        uncoupler.processData(sample);
+        tracker.update(sample);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+}
+
+int main(int argc, char** argv) {
+    uint64_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000ull;
+    if (samples == 0) return 1;
+
+    Hand::HandTracker tracker;
+    Uncoupler::SensorUncoupler uncoupler;
+
+    double aloneNs = feed(tracker, uncoupler, 0, samples);
+
+    std::atomic<bool> done(false);
+    std::vector<ReaderResult> results(3);
+    std::vector<std::thread> readers;
+    for (ReaderResult& result : results) {
+        readers.emplace_back(readUntil, std::cref(tracker), std::cref(uncoupler), std::cref(done), std::ref(result));
+    }
+
+    // Calibration offsets are whole numbers and equal on every axis, so they keep the axes equal
+    uint64_t settingChanges = 0;
+    std::thread settings([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            bool enable = settingChanges % 2 == 0;
+            float offset = static_cast<float>(settingChanges % 7);
+            tracker.setCalibrationOffsets(offset, offset, offset, offset, offset, offset);
+            tracker.enableCalibration(enable);
+            uncoupler.setGyroCalibrationOffsets(offset, offset, offset);
+            uncoupler.enableGyroCalibration(enable);
+            uncoupler.setLowPassFilterAlpha(enable ? 0.02f : 0.05f);
+            uncoupler.setGravityFilterSize(enable ? 50 : 20);
+            settingChanges++;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    double contendedNs = feed(tracker, uncoupler, samples, samples);
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    settings.join();
+
+    Hand::TrackerState last = tracker.getState();
+    bool ok = last.updates == 2 * samples && uncoupler.getGravityEstimate().samples == 2 * samples;
+    std::printf("writer  %.1f ns/sample alone, %.1f ns/sample with %zu readers and %llu setting changes\n",
+                aloneNs, contendedNs, readers.size(), static_cast<unsigned long long>(settingChanges));
+    if (std::thread::hardware_concurrency() < readers.size() + 2) {
+        std::printf("    (fewer cores than threads: the second figure includes time-slicing, not just contention)\n");
+    }
+    for (size_t r = 0; r < results.size(); r++) {
+        const ReaderResult& res = results[r];
+        bool readerOk = res.torn == 0 && res.backwards == 0;
+        ok &= readerOk;
+        std::printf("    reader %zu  %10llu snapshots  %llu torn  %llu backwards  %s\n", r,
+                    static_cast<unsigned long long>(res.reads), static_cast<unsigned long long>(res.torn),
+                    static_cast<unsigned long long>(res.backwards), readerOk ? "ok" : "UNEXPECTED");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Round-trip check and size comparison for the JSON and binary wire formats.
+//
+// Random samples are encoded exactly as the firmware sends them, written into
+// a pty, and decoded on the device end through Serial::openSerialSource() and
+// Serial::FrameDecoder. Four passes:
+//   json    every frame must come back bit-exact
+//   binary  every frame must come back bit-exact, sequence numbers included
+//   mixed   the device flips format every few hundred frames with a burst of
+//           boot-log text in between; at most one frame may be lost per flip
+//   flips   as mixed, but flipping every 20 frames and fed to the decoder
+//           straight from memory in 4096-byte reads, so one read holds both
+//           formats and the next flip back; the same loss limit applies
+#include "serial.h"
+#include "pty_loopback.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+enum class Format { Json, Binary, Mixed, Flips };
+
+static const char* formatName(Format format) {
+    switch (format) {
+        case Format::Json:   return "json";
+        case Format::Binary: return "binary";
+        case Format::Mixed:  return "mixed";
+        default:             return "flips";
+    }
+}
+
+static bool sameChannels(const Serial::ImuSample& a, const Serial::ImuSample& b) {
+    return a.ax == b.ax && a.ay == b.ay && a.az == b.az &&
+           a.gx == b.gx && a.gy == b.gy && a.gz == b.gz;
+}
+
+static bool runPass(Format format, const std::vector<Serial::ImuSample>& samples) {
+    bool switching = format == Format::Mixed || format == Format::Flips;
+    const size_t switchEvery = format == Format::Flips ? 20 : 250;
+
+    // Build the byte stream up front so the writer only does I/O
+    std::vector<char> stream;
+    stream.reserve(samples.size() * 80);
+    int switches = 0;
+    bool binary = format == Format::Binary;
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (switching && i > 0 && i % switchEvery == 0) {
+            binary = !binary;
+            switches++;
+            const char* log = "I (1234) MPU6050: switching output format\n";
+            stream.insert(stream.end(), log, log + std::char_traits<char>::length(log));
+        }
+
+        const Serial::ImuSample& s = samples[i];
+        if (binary) {
+            uint8_t frame[Serial::BINARY_TIMED_SAMPLE_WIRE_SIZE];
+            size_t len = Serial::encodeBinarySample(s, static_cast<uint16_t>(i), frame);
+            stream.insert(stream.end(), frame, frame + len);
+        } else {
+            char frame[128];
+            int len = std::snprintf(frame, sizeof(frame), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\n",
+                                    s.ax, s.ay, s.az, s.gx, s.gy, s.gz);
+            stream.insert(stream.end(), frame, frame + len);
+        }
+    }
+
+    // Match decoded samples against the sent ones in order, allowing gaps
+    Serial::FrameDecoder decoder;
+    size_t expected = 0;
+    size_t received = 0;
+    size_t mismatched = 0;
+    char buffer[4096];
+    auto onFrame = [&](const Serial::Frame& frame) {
+        Serial::ImuSample sample;
+        if (!Serial::decodeSample(frame, sample)) return;
+
+        size_t match = expected;
+        while (match < samples.size() && !sameChannels(samples[match], sample)) match++;
+        if (match == samples.size()) {
+            mismatched++;
+            return;
+        }
+        if (frame.type == Serial::FrameType::Binary && sample.sequence != (match & 0xFFFF)) {
+            mismatched++;
+        }
+        received++;
+        expected = match + 1;
+    };
+
+    auto start = Clock::now();
+    if (format == Format::Flips) {
+        for (size_t at = 0; at < stream.size(); at += sizeof(buffer)) {
+            size_t n = std::min(sizeof(buffer), stream.size() - at);
+            decoder.feed(stream.data() + at, n, onFrame);
+        }
+    } else {
+        Serial::PtyLoopback pty;
+        if (!pty.open()) return false;
+        std::unique_ptr<Serial::SerialSource> source = Serial::openSerialSource(pty.devicePath());
+        if (!source) return false;
+
+        std::thread writer([&]() {
+            pty.write(stream.data(), stream.size());
+        });
+        while (expected < samples.size()) {
+            if (!source->waitReadable(500)) break;
+            long n = source->read(buffer, sizeof(buffer));
+            if (n < 0) break;
+            decoder.feed(buffer, static_cast<size_t>(n), onFrame);
+        }
+        writer.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Link budget at the firmware's 115200 8N1 (10 bits per byte)
+    double bytesPerSample = static_cast<double>(stream.size()) / samples.size();
+    double linkRate = 115200.0 / 10.0 / bytesPerSample;
+
+    size_t allowedLoss = switching ? static_cast<size_t>(switches) : 0;
+    bool ok = mismatched == 0 && received + allowedLoss >= samples.size();
+
+    std::printf("%-7s %zu/%zu samples  %.1f bytes/sample  %.0f samples/s @115200  decode %.0f samples/s  %s\n",
+                formatName(format), received, samples.size(), bytesPerSample, linkRate,
+                received / elapsed, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> channel(-32768, 32767);
+    std::vector<Serial::ImuSample> samples(count);
+    for (Serial::ImuSample& s : samples) {
+        s.ax = channel(rng);
+        s.ay = channel(rng);
+        s.az = channel(rng);
+        s.gx = channel(rng);
+        s.gy = channel(rng);
+        s.gz = channel(rng);
+    }
+
+    bool ok = true;
+    ok &= runPass(Format::Json, samples);
+    ok &= runPass(Format::Binary, samples);
+    ok &= runPass(Format::Mixed, samples);
+    ok &= runPass(Format::Flips, samples);
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,10 @@
 // Mode selection (true = scan for I2C devices, false = read MPU6050 data)
 bool scanMode = false;
 
+// Output format (true = COBS/CRC16 binary frames, false = JSON text lines)
+// Layout must match libSerial/wire_protocol.h on the host
+bool binaryMode = false;
+
 static const char *TAG = "MPU6050";
 
 // I2C pins
@@ -13,6 +17,10 @@ static const char *TAG = "MPU6050";
 
 // MPU6050 register addresses
 #define MPU6050_ADDR         0x68
+#define MPU6050_SMPLRT_DIV   0x19
+#define MPU6050_CONFIG       0x1A  // DLPF_CFG in bits 2:0
+#define MPU6050_GYRO_CONFIG  0x1B  // FS_SEL in bits 4:3
+#define MPU6050_ACCEL_CONFIG 0x1C  // AFS_SEL in bits 4:3
 #define MPU6050_PWR_MGMT_1   0x6B
 #define MPU6050_GYRO_START   0x3B  // Gyroscope data comes first
 #define MPU6050_ACCEL_START  0x43  // Accelerometer data comes second
@@ -46,6 +54,254 @@ int16_t combineBytes(uint8_t high, uint8_t low) {
   return (int16_t)((high << 8) | low);
 }
 
+// Binary frame constants (see libSerial/wire_protocol.h)
+#define BINARY_TYPE_TIMED_SAMPLE  0x02
+#define BINARY_PAYLOAD_SIZE       21  // type + seq(2) + micros(4) + 6 channels(12) + crc(2)
+
+// Sequence number of the next sample (both formats)
+uint16_t frameSequence = 0;
+
+// Settings the host can change over the control channel (see libSerial/control_protocol.h)
+#define CMD_GET_CONFIG       0x10
+#define CMD_SET_RATE         0x11
+#define CMD_SET_FILTER       0x12
+#define CMD_SET_ACCEL_RANGE  0x13
+#define CMD_SET_GYRO_RANGE   0x14
+#define CMD_SET_BAUD         0x15
+#define CMD_SET_FORMAT       0x16
+
+#define STATUS_OK            0
+#define STATUS_BAD_VALUE     1
+#define STATUS_LINK_TOO_SLOW 2
+#define STATUS_UNKNOWN       3
+
+#define BINARY_TYPE_CONFIG   0x03
+#define CONFIG_PAYLOAD_SIZE  15   // type + cmd + status + rate(2) + dlpf + ranges(2) + format + baud(4) + crc(2)
+#define COMMAND_PAYLOAD_SIZE 7    // type + value(4) + crc(2)
+#define JSON_SAMPLE_MAX_SIZE 100  // Longest JSON sample line
+
+uint16_t outputRateHz = 50;
+uint8_t dlpfConfig = 0;
+uint8_t accelRange = 0;
+uint8_t gyroRange = 0;
+uint32_t baudRate = 115200;
+
+// Next sample time in micros()
+uint32_t nextSampleTime = 0;
+
+// Host command bytes collected until the 0x00 delimiter
+uint8_t commandBuffer[32];
+size_t commandLength = 0;
+bool commandOverflow = false;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// COBS-encode a block so it contains no zero bytes; returns encoded length
+size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t codeIndex = 0;
+  size_t writeIndex = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[codeIndex] = code;
+      codeIndex = writeIndex++;
+      code = 1;
+    } else {
+      out[writeIndex++] = in[i];
+      code++;
+    }
+  }
+  out[codeIndex] = code;
+  return writeIndex;
+}
+
+// Undo COBS; returns decoded length, 0 if malformed
+size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t readIndex = 0;
+  size_t writeIndex = 0;
+
+  while (readIndex < length) {
+    uint8_t code = in[readIndex++];
+    if (code == 0 || readIndex + code - 1 > length) return 0;
+    for (uint8_t i = 1; i < code; i++) {
+      out[writeIndex++] = in[readIndex++];
+    }
+    if (code < 0xFF && readIndex < length) {
+      out[writeIndex++] = 0;
+    }
+  }
+  return writeIndex;
+}
+
+// Store a 16-bit value little-endian
+void putInt16(uint8_t *out, int16_t value) {
+  out[0] = (uint8_t)(value & 0xFF);
+  out[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+// Store a 32-bit value little-endian
+void putUint32(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)(value & 0xFF);
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+// Send one timestamped sample as a zero-terminated COBS frame (23 bytes on the wire)
+void sendBinarySample(uint32_t timestamp, int16_t ax, int16_t ay, int16_t az, int16_t gx, int16_t gy, int16_t gz) {
+  uint8_t payload[BINARY_PAYLOAD_SIZE];
+  payload[0] = BINARY_TYPE_TIMED_SAMPLE;
+  putInt16(&payload[1], (int16_t)frameSequence);
+  putUint32(&payload[3], timestamp);
+  putInt16(&payload[7], ax);
+  putInt16(&payload[9], ay);
+  putInt16(&payload[11], az);
+  putInt16(&payload[13], gx);
+  putInt16(&payload[15], gy);
+  putInt16(&payload[17], gz);
+
+  uint16_t crc = crc16(payload, BINARY_PAYLOAD_SIZE - 2);
+  payload[19] = (uint8_t)(crc & 0xFF);
+  payload[20] = (uint8_t)(crc >> 8);
+
+  uint8_t frame[BINARY_PAYLOAD_SIZE + 2];
+  size_t length = cobsEncode(payload, BINARY_PAYLOAD_SIZE, frame);
+  frame[length++] = 0x00;  // Frame delimiter
+
+  Serial.write(frame, length);
+}
+
+// Samples per second the UART can carry in the given format (90% of the line rate)
+uint32_t maxRateForLink(bool binary, uint32_t baud) {
+  uint32_t frameBytes = binary ? BINARY_PAYLOAD_SIZE + 2 : JSON_SAMPLE_MAX_SIZE;
+  return (uint32_t)(baud * 0.9 / (frameBytes * 10));
+}
+
+// Program sample rate divider, DLPF and full-scale ranges
+void applySensorConfig() {
+  // Gyro output is 8 kHz with the DLPF off, 1 kHz otherwise
+  uint32_t base = (dlpfConfig == 0) ? 8000 : 1000;
+  uint32_t divider = base / outputRateHz;
+  divider = divider > 0 ? divider - 1 : 0;
+  writeRegister(MPU6050_SMPLRT_DIV, (uint8_t)(divider > 255 ? 255 : divider));
+  writeRegister(MPU6050_CONFIG, dlpfConfig & 0x07);
+  writeRegister(MPU6050_GYRO_CONFIG, (gyroRange & 0x03) << 3);
+  writeRegister(MPU6050_ACCEL_CONFIG, (accelRange & 0x03) << 3);
+}
+
+// Answer a command with the settings now in force, in the current output format
+void sendConfigReport(uint8_t command, uint8_t status, bool newBinary) {
+  if (binaryMode) {
+    uint8_t payload[CONFIG_PAYLOAD_SIZE];
+    payload[0] = BINARY_TYPE_CONFIG;
+    payload[1] = command;
+    payload[2] = status;
+    putInt16(&payload[3], (int16_t)outputRateHz);
+    payload[5] = dlpfConfig;
+    payload[6] = accelRange;
+    payload[7] = gyroRange;
+    payload[8] = newBinary ? 1 : 0;
+    putUint32(&payload[9], baudRate);
+
+    uint16_t crc = crc16(payload, CONFIG_PAYLOAD_SIZE - 2);
+    payload[13] = (uint8_t)(crc & 0xFF);
+    payload[14] = (uint8_t)(crc >> 8);
+
+    uint8_t frame[CONFIG_PAYLOAD_SIZE + 2];
+    size_t length = cobsEncode(payload, CONFIG_PAYLOAD_SIZE, frame);
+    frame[length++] = 0x00;
+    Serial.write(frame, length);
+  } else {
+    Serial.printf("{\"cfg\":%u,\"st\":%u,\"rate\":%u,\"dlpf\":%u,\"ar\":%u,\"gr\":%u,\"fmt\":%u,\"baud\":%lu}\n",
+                  command, status, outputRateHz, dlpfConfig, accelRange, gyroRange,
+                  newBinary ? 1u : 0u, (unsigned long)baudRate);
+  }
+}
+
+// Validate and apply one command, report, then switch format or baud if asked
+void handleCommand(const uint8_t *frame, size_t length) {
+  uint8_t payload[COMMAND_PAYLOAD_SIZE];
+  if (length > COMMAND_PAYLOAD_SIZE + 1) return;
+  if (cobsDecode(frame, length, payload) != COMMAND_PAYLOAD_SIZE) return;
+  uint16_t expected = (uint16_t)(payload[5] | (payload[6] << 8));
+  if (crc16(payload, COMMAND_PAYLOAD_SIZE - 2) != expected) return;
+
+  uint8_t command = payload[0];
+  uint32_t value = (uint32_t)payload[1] | ((uint32_t)payload[2] << 8) |
+                   ((uint32_t)payload[3] << 16) | ((uint32_t)payload[4] << 24);
+
+  // Candidate settings; only committed if valid and the link can carry the stream
+  uint16_t rate = outputRateHz;
+  uint8_t dlpf = dlpfConfig;
+  uint8_t aRange = accelRange;
+  uint8_t gRange = gyroRange;
+  uint32_t baud = baudRate;
+  bool binary = binaryMode;
+  uint8_t status = STATUS_OK;
+
+  switch (command) {
+    case CMD_GET_CONFIG: break;
+    case CMD_SET_RATE:        if (value < 1 || value > 1000) status = STATUS_BAD_VALUE; else rate = (uint16_t)value; break;
+    case CMD_SET_FILTER:      if (value > 6) status = STATUS_BAD_VALUE; else dlpf = (uint8_t)value; break;
+    case CMD_SET_ACCEL_RANGE: if (value > 3) status = STATUS_BAD_VALUE; else aRange = (uint8_t)value; break;
+    case CMD_SET_GYRO_RANGE:  if (value > 3) status = STATUS_BAD_VALUE; else gRange = (uint8_t)value; break;
+    case CMD_SET_BAUD:        if (value < 9600 || value > 2000000) status = STATUS_BAD_VALUE; else baud = value; break;
+    case CMD_SET_FORMAT:      if (value > 1) status = STATUS_BAD_VALUE; else binary = value == 1; break;
+    default:                  status = STATUS_UNKNOWN; break;
+  }
+  if (status == STATUS_OK && rate > maxRateForLink(binary, baud)) {
+    status = STATUS_LINK_TOO_SLOW;
+  }
+
+  if (status == STATUS_OK) {
+    outputRateHz = rate;
+    dlpfConfig = dlpf;
+    accelRange = aRange;
+    gyroRange = gRange;
+    baudRate = baud;
+    applySensorConfig();
+  }
+
+  // The report is the last frame in the old format and at the old baud rate
+  sendConfigReport(command, status, status == STATUS_OK ? binary : binaryMode);
+  if (status != STATUS_OK) return;
+
+  binaryMode = binary;
+  if (command == CMD_SET_BAUD) {
+    Serial.flush();
+    Serial.updateBaudRate(baudRate);
+  }
+}
+
+// Collect host bytes into frames and run every complete command
+void pollCommands() {
+  while (Serial.available() > 0) {
+    uint8_t b = (uint8_t)Serial.read();
+    if (b == 0x00) {
+      if (!commandOverflow && commandLength > 0) {
+        handleCommand(commandBuffer, commandLength);
+      }
+      commandLength = 0;
+      commandOverflow = false;
+    } else if (commandLength < sizeof(commandBuffer)) {
+      commandBuffer[commandLength++] = b;
+    } else {
+      commandOverflow = true;
+    }
+  }
+}
+
 // Function to scan I2C bus
 void scanI2C() {
   byte error, address;
@@ -86,6 +342,9 @@ void readMPU6050() {
   // Read all sensor data at once (14 bytes)
   readRegisters(MPU6050_GYRO_START, data, 14);
   
+  // Stamp the reading so the host can recover jitter-free sample times
+  uint32_t timestamp = micros();
+  
   // Process gyroscope data (comes first)
   int16_t gx = combineBytes(data[0], data[1]);
   int16_t gy = combineBytes(data[2], data[3]);
@@ -96,15 +355,19 @@ void readMPU6050() {
   int16_t ay = combineBytes(data[10], data[11]);
   int16_t az = combineBytes(data[12], data[13]);
   
-  // Print formatted serial packet (JSON format)
-  Serial.printf("{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}\n", 
-               ax, ay, az, gx, gy, gz);
-  
-  delay(20); // 50Hz (20ms delay)
+  if (binaryMode) {
+    // Compact binary frame
+    sendBinarySample(timestamp, ax, ay, az, gx, gy, gz);
+  } else {
+    // Print formatted serial packet (JSON format, t = micros, n = sequence)
+    Serial.printf("{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d,\"t\":%lu,\"n\":%u}\n", 
+                 ax, ay, az, gx, gy, gz, (unsigned long)timestamp, (unsigned)frameSequence);
+  }
+  frameSequence++;
 }
 
 void setup() {
-  Serial.begin(115200);
+  Serial.begin(baudRate);
   ESP_LOGI(TAG, "Initializing I2C...");
   
   // Initialize I2C
@@ -113,6 +376,8 @@ void setup() {
   if (!scanMode) {
     // Initialize MPU6050 if in read mode
     writeRegister(MPU6050_PWR_MGMT_1, 0x00);
+    applySensorConfig();
+    nextSampleTime = micros();
     ESP_LOGI(TAG, "MPU6050 initialized and awake");
   } else {
     ESP_LOGI(TAG, "I2C Scanner ready");
@@ -124,6 +389,18 @@ void loop() {
   if (scanMode) {
     scanI2C();
   } else {
-    readMPU6050();
+    pollCommands();
+
+    // Pace readings from micros() so the output rate follows SetRate exactly
+    uint32_t periodUs = 1000000UL / outputRateHz;
+    uint32_t now = micros();
+    if ((int32_t)(now - nextSampleTime) >= 0) {
+      readMPU6050();
+      nextSampleTime += periodUs;
+      // Fell more than a period behind (e.g. after a baud switch): don't burst to catch up
+      if ((int32_t)(now - nextSampleTime) >= (int32_t)periodUs) {
+        nextSampleTime = now + periodUs;
+      }
+    }
   }
 }
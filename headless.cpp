@@ -0,0 +1,206 @@
+// Motion capture engine without a window, for machines with no display.
+//
+// Runs the same ingest and processing chain as main.cpp (uncoupler and hand
+// tracker on the ingest thread, each sink reading the broadcast ring on its
+// own thread) and links no graphics or audio libraries. Stops on Ctrl+C /
+// SIGTERM or when every port has closed, then prints each device's and
+// stage's counters and the latency percentiles. Exits with status 2 if
+// --latency-budget-us is given and the end-to-end p99 (byte arrival to the
+// first sink) went over it. The real-time options pin the ingest (main)
+// thread and the sink workers to cores, raise the ingest thread to
+// SCHED_FIFO and lock and prefault memory; whatever the OS refuses is
+// reported with the stats instead of stopping the run.
+//
+//   engine_headless [port ...] [--replay file ...] [--fast] [--capture file]
+//                   [--format json|binary] [--baud N] [--dlpf N] [--accel-range N]
+//                   [--gyro-range N] [--rate HZ] [--sink csv:file|jsonl:file ...]
+//                   [--stats SECONDS] [--latency-budget-us N] [--gravity average|orientation|kalman]
+//                   [--cpu-ingest LIST] [--cpu-workers LIST] [--rt-priority N]
+//                   [--mlock on|off] [--prefault-mb N] [--jitter-check N]
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "libSerial/serial.h"
+#include "libSerial/ingest_mux.h"
+#include "libSerial/capture.h"
+#include "libSerial/device_setup.h"
+#include "libHand/hand.h"
+#include "libUncoupler/uncoupler.h"
+#include "libPipeline/pipeline.h"
+#include "libPipeline/core_stages.h"
+#include "libPipeline/sinks.h"
+#include "libMetrics/latency_monitor.h"
+#include "libRealtime/realtime.h"
+
+static std::atomic<bool> g_running(true);
+static Serial::IngestMux* g_mux = nullptr;
+
+// Only touches an atomic flag and the mux's wake descriptor, both safe in a handler
+static void onSignal(int) {
+    g_running = false;
+    if (g_mux) g_mux->wake();
+}
+
+static void printUsage() {
+    std::cerr << "usage: engine_headless [port ...] [--replay file ...] [--fast] [--capture file]\n"
+                 "                       [--format json|binary] [--baud N] [--dlpf N] [--accel-range N]\n"
+                 "                       [--gyro-range N] [--rate HZ] [--sink csv:file|jsonl:file ...]\n"
+                 "                       [--stats SECONDS] [--latency-budget-us N] [--gravity average|orientation|kalman]\n"
+                 "                       [--cpu-ingest LIST] [--cpu-workers LIST] [--rt-priority N]\n"
+                 "                       [--mlock on|off] [--prefault-mb N] [--jitter-check N]" << std::endl;
+}
+
+static void printStats(const Serial::IngestMux& mux, const Pipeline::Pipeline& pipeline,
+                       const Metrics::LatencyMonitor& latency, const Realtime::RealtimeOptions& realtime) {
+    for (size_t i = 0; i < mux.deviceCount(); i++) {
+        Serial::IngestCounters stats = mux.stats(static_cast<int>(i));
+        std::cerr << "Device " << i << ": " << stats.frames_decoded << " frames, "
+                  << stats.crc_failures << " CRC failures, " << stats.parse_failures << " parse failures, "
+                  << stats.sequence_gaps << " missing frames" << std::endl;
+    }
+    for (const Pipeline::StageStats& stage : pipeline.stats()) {
+        std::cerr << "Stage " << stage.name << ": " << stage.processed << " samples ("
+                  << stage.samples_per_second << "/s, " << stage.mean_process_ns << " ns each)";
+        if (stage.execution != Pipeline::Execution::Fused) {
+            std::cerr << ", queue " << stage.queue_depth << "/" << stage.queue_capacity
+                      << ", " << stage.dropped << " dropped";
+        }
+        std::cerr << std::endl;
+    }
+    latency.print(std::cerr);
+    if (realtime.enabled()) realtime.report(std::cerr);
+}
+
+int main(int argc, char** argv) {
+    Serial::DeviceSetup deviceSetup;
+    std::vector<std::string> portNames;
+    std::vector<std::string> replayFiles;
+    std::vector<std::string> sinkSpecs;
+    std::string capturePath;
+    Serial::ReplayPace replayPace = Serial::ReplayPace::Recorded;
+    double statsInterval = 0.0;
+    Metrics::LatencyMonitor latency;
+    Realtime::RealtimeOptions realtime;
+    Uncoupler::GravityMode gravityMode = Uncoupler::GravityMode::MovingAverage;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFiles.push_back(argv[++i]);
+        } else if (arg == "--fast") {
+            replayPace = Serial::ReplayPace::AsFastAsPossible;
+        } else if (arg == "--sink" && i + 1 < argc) {
+            sinkSpecs.push_back(argv[++i]);
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statsInterval = std::atof(argv[++i]);
+        } else if (arg == "--latency-budget-us" && i + 1 < argc) {
+            latency.setBudget(static_cast<int64_t>(std::atof(argv[++i]) * 1000.0));
+        } else if (arg == "--gravity" && i + 1 < argc) {
+            if (!Uncoupler::parseGravityMode(argv[++i], gravityMode)) {
+                printUsage();
+                return 1;
+            }
+        } else if (i + 1 < argc && deviceSetup.parseOption(arg, argv[i + 1])) {
+            i++;
+        } else if (i + 1 < argc && realtime.parseOption(arg, argv[i + 1])) {
+            i++;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            printUsage();
+            return 1;
+        } else {
+            portNames.push_back(arg);
+        }
+    }
+    if (portNames.empty() && replayFiles.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    Serial::IngestMux mux;
+    for (size_t i = 0; i < portNames.size(); i++) {
+        std::unique_ptr<Serial::SerialSource> source = Serial::openSerialSource(portNames[i]);
+        if (source && !capturePath.empty()) {
+            std::string path = portNames.size() > 1 ? capturePath + "." + std::to_string(i) : capturePath;
+            source = Serial::CaptureSource::open(std::move(source), path);
+        }
+        if (!source || mux.addSource(std::move(source)) < 0) {
+            std::cerr << "Failed to open " << portNames[i] << std::endl;
+            return 1;
+        }
+    }
+    for (const std::string& replayFile : replayFiles) {
+        std::unique_ptr<Serial::SerialSource> source = Serial::ReplaySource::open(replayFile, replayPace);
+        if (!source || mux.addSource(std::move(source)) < 0) return 1;
+    }
+
+    // Same chain as the windowed build, minus the plot
+    Uncoupler::SensorUncoupler uncoupler;
+    uncoupler.setGravityMode(gravityMode);
+    Hand::HandTracker tracker;
+    Pipeline::Pipeline pipeline;
+    Pipeline::addCoreStages(pipeline, uncoupler, tracker, latency);
+    if (!Pipeline::addSinks(pipeline, sinkSpecs, &latency)) return 1;
+
+    // The primary device's rate rescales the gravity window (counted in samples) and the
+    // nominal time step; the filter cutoffs are in Hz and stay put. The gyro scale
+    // follows its range (131 counts per deg/s at FS_SEL 0, halving with each step)
+    deviceSetup.start(mux, [&uncoupler](int id, const Serial::ConfigReport& report) {
+        if (report.status != Serial::ControlStatus::Ok) {
+            std::cerr << "Device " << id << " rejected command 0x" << std::hex << static_cast<int>(report.command)
+                      << std::dec << " (status " << static_cast<int>(report.status) << ")" << std::endl;
+            return;
+        }
+        std::cerr << "Device " << id << ": " << report.config.rate_hz << " Hz, "
+                  << (report.config.binary ? "binary" : "JSON") << " at " << report.config.baud_rate << " baud" << std::endl;
+        if (id == 0) {
+            uncoupler.setSampleRate(static_cast<float>(report.config.rate_hz));
+            uncoupler.setGyroScale(131.0f / (1 << report.config.gyro_range));
+        }
+    });
+
+    // Memory first, so the pipeline's buffers are locked as they are allocated; workers
+    // start before the main thread takes the ingest settings, so they do not inherit them
+    realtime.applyToProcess();
+    realtime.measureWakeupJitter();
+    pipeline.setWorkerSetup([&realtime](const std::string& stage) {
+        realtime.applyToThisThread(Realtime::ThreadRole::Worker, stage);
+    });
+
+    g_mux = &mux;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    pipeline.start();
+    realtime.applyToThisThread(Realtime::ThreadRole::Ingest, "ingest");
+
+    // Ingest on the main thread; wake for the stats line when one is due
+    int64_t statsPeriodNs = static_cast<int64_t>(statsInterval * 1e9);
+    int64_t nextStats = Serial::hostTimeNs() + statsPeriodNs;
+    while (g_running && mux.openDeviceCount() > 0) {
+        int timeout_ms = -1;
+        if (statsPeriodNs > 0) {
+            int64_t remaining = nextStats - Serial::hostTimeNs();
+            timeout_ms = remaining > 0 ? static_cast<int>(remaining / 1000000) + 1 : 0;
+        }
+        mux.poll(timeout_ms, [&pipeline](const Serial::ImuSample& sample) {
+            if (sample.device == 0) {
+                pipeline.push(sample);
+            }
+        });
+        if (statsPeriodNs > 0 && Serial::hostTimeNs() >= nextStats) {
+            printStats(mux, pipeline, latency, realtime);
+            nextStats += statsPeriodNs;
+        }
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    g_mux = nullptr;
+    pipeline.stop();
+    printStats(mux, pipeline, latency, realtime);
+    return latency.overBudget() ? 2 : 0;
+}
@@ -13,12 +13,11 @@ namespace Calibration {
         return duration_cast<duration<double>>(now.time_since_epoch()).count();
     }
 
-    // Helper function to calculate average of a vector of integers
-    static double calculateAverage(const std::vector<int>& values) {
-        if (values.empty()) return 0.0;
+    // Helper function to calculate the average of a running sum
+    static double calculateAverage(int64_t sum, int count) {
+        if (count == 0) return 0.0;
         
-        double sum = std::accumulate(values.begin(), values.end(), 0.0);
-        return sum / values.size();
+        return static_cast<double>(sum) / count;
     }
 
     Calibrator::Calibrator()
@@ -28,14 +27,14 @@ namespace Calibration {
         , m_callback(nullptr)
         , m_completeCallback(nullptr)
         , m_lastUpdateTime(0.0)
+        , m_ax_sum(0)
+        , m_ay_sum(0)
+        , m_az_sum(0)
+        , m_gx_sum(0)
+        , m_gy_sum(0)
+        , m_gz_sum(0)
+        , m_sampleCount(0)
     {
-        // Initialize vectors with a reasonable capacity
-        m_ax_samples.reserve(500);
-        m_ay_samples.reserve(500);
-        m_az_samples.reserve(500);
-        m_gx_samples.reserve(500);
-        m_gy_samples.reserve(500);
-        m_gz_samples.reserve(500);
     }
 
     void Calibrator::startCalibration(int duration, CalibrationCallback callback, CalibrationCompleteCallback completeCallback) {
@@ -44,12 +43,13 @@ namespace Calibration {
         }
 
         // Clear any previous calibration data
-        m_ax_samples.clear();
-        m_ay_samples.clear();
-        m_az_samples.clear();
-        m_gx_samples.clear();
-        m_gy_samples.clear();
-        m_gz_samples.clear();
+        m_ax_sum = 0;
+        m_ay_sum = 0;
+        m_az_sum = 0;
+        m_gx_sum = 0;
+        m_gy_sum = 0;
+        m_gz_sum = 0;
+        m_sampleCount = 0;
 
         // Reset results
         m_results = CalibrationResults();
@@ -86,16 +86,37 @@ namespace Calibration {
             if (sensorData->count("ax") && sensorData->count("ay") && sensorData->count("az") &&
                 sensorData->count("gx") && sensorData->count("gy") && sensorData->count("gz")) {
                 
-                // Store samples
-                m_ax_samples.push_back(sensorData->at("ax"));
-                m_ay_samples.push_back(sensorData->at("ay"));
-                m_az_samples.push_back(sensorData->at("az"));
-                m_gx_samples.push_back(sensorData->at("gx"));
-                m_gy_samples.push_back(sensorData->at("gy"));
-                m_gz_samples.push_back(sensorData->at("gz"));
+                Serial::ImuSample sample;
+                sample.ax = sensorData->at("ax");
+                sample.ay = sensorData->at("ay");
+                sample.az = sensorData->at("az");
+                sample.gx = sensorData->at("gx");
+                sample.gy = sensorData->at("gy");
+                sample.gz = sensorData->at("gz");
+                update(&sample);
+                return;
             }
         }
 
+        update(static_cast<const Serial::ImuSample*>(nullptr));
+    }
+
+    void Calibrator::update(const Serial::ImuSample* sample) {
+        if (!m_isCalibrating) {
+            return;
+        }
+
+        // Store samples if provided
+        if (sample != nullptr) {
+            m_ax_sum += sample->ax;
+            m_ay_sum += sample->ay;
+            m_az_sum += sample->az;
+            m_gx_sum += sample->gx;
+            m_gy_sum += sample->gy;
+            m_gz_sum += sample->gz;
+            m_sampleCount++;
+        }
+
         // Calculate elapsed time since last update
         double currentTime = getCurrentTime();
         double elapsedSeconds = currentTime - m_lastUpdateTime;
@@ -141,15 +162,15 @@ namespace Calibration {
 
     void Calibrator::processCollectedData() {
         // Calculate sample count
-        m_results.sample_count = m_ax_samples.size();
+        m_results.sample_count = m_sampleCount;
         
         // Calculate averages
-        m_results.ax_avg = calculateAverage(m_ax_samples);
-        m_results.ay_avg = calculateAverage(m_ay_samples);
-        m_results.az_avg = calculateAverage(m_az_samples);
-        m_results.gx_avg = calculateAverage(m_gx_samples);
-        m_results.gy_avg = calculateAverage(m_gy_samples);
-        m_results.gz_avg = calculateAverage(m_gz_samples);
+        m_results.ax_avg = calculateAverage(m_ax_sum, m_sampleCount);
+        m_results.ay_avg = calculateAverage(m_ay_sum, m_sampleCount);
+        m_results.az_avg = calculateAverage(m_az_sum, m_sampleCount);
+        m_results.gx_avg = calculateAverage(m_gx_sum, m_sampleCount);
+        m_results.gy_avg = calculateAverage(m_gy_sum, m_sampleCount);
+        m_results.gz_avg = calculateAverage(m_gz_sum, m_sampleCount);
     }
 
     const CalibrationResults& Calibrator::getResults() const {
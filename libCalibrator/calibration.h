@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <vector>
 #include <unordered_map>
+#include "../libSerial/sample.h"
 
 namespace Calibration {
 
@@ -62,6 +65,17 @@ namespace Calibration {
          */
         void update(const std::unordered_map<std::string, int>* sensorData = nullptr);
 
+        /**
+         * Process a calibration step with a typed sample
+         * @param sample Current sensor sample to collect, or nullptr to only advance the countdown
+         */
+        void update(const Serial::ImuSample* sample);
+
+        /**
+         * Advance the countdown without a sample (keeps update(nullptr) unambiguous)
+         */
+        void update(std::nullptr_t) { update(static_cast<const Serial::ImuSample*>(nullptr)); }
+
         /**
          * Get the latest calibration results
          * @return The calculated calibration results
@@ -79,13 +93,14 @@ namespace Calibration {
         CalibrationCompleteCallback m_completeCallback;
         double m_lastUpdateTime;
 
-        // Accumulator for sensor data
-        std::vector<int> m_ax_samples;
-        std::vector<int> m_ay_samples;
-        std::vector<int> m_az_samples;
-        std::vector<int> m_gx_samples;
-        std::vector<int> m_gy_samples;
-        std::vector<int> m_gz_samples;
+        // Running sums of the collected sensor data (no per-sample storage)
+        int64_t m_ax_sum;
+        int64_t m_ay_sum;
+        int64_t m_az_sum;
+        int64_t m_gx_sum;
+        int64_t m_gy_sum;
+        int64_t m_gz_sum;
+        int m_sampleCount;
 
         // Calibration results
         CalibrationResults m_results;
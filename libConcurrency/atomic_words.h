@@ -0,0 +1,46 @@
+#pragma once
+
+// Copying a trivially copyable value into and out of relaxed atomic words,
+// for the sequence-guarded containers (Seqlock, BroadcastRing). A copy that
+// races a store is well defined this way; the caller's sequence number tells
+// whether it was torn. Not meant to be used on its own.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Concurrency {
+
+    // Number of 64-bit words that hold a T
+    template <typename T>
+    constexpr size_t wordCount() {
+        return (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    }
+
+    // Copy value into words (wordCount<T>() of them), the last one zero-padded
+    template <typename T>
+    void storeWords(std::atomic<uint64_t>* words, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "values are copied as raw words");
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+        for (size_t i = 0; i < wordCount<T>(); i++) {
+            uint64_t word = 0;
+            size_t offset = i * sizeof(uint64_t);
+            std::memcpy(&word, bytes + offset, offset + sizeof(uint64_t) <= sizeof(T) ? sizeof(uint64_t) : sizeof(T) - offset);
+            words[i].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    // Copy words (wordCount<T>() of them) back out into value
+    template <typename T>
+    void loadWords(const std::atomic<uint64_t>* words, T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "values are copied as raw words");
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+        for (size_t i = 0; i < wordCount<T>(); i++) {
+            uint64_t word = words[i].load(std::memory_order_relaxed);
+            size_t offset = i * sizeof(uint64_t);
+            std::memcpy(bytes + offset, &word, offset + sizeof(uint64_t) <= sizeof(T) ? sizeof(uint64_t) : sizeof(T) - offset);
+        }
+    }
+}
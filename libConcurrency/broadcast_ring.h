@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "atomic_words.h"
+#include "spsc_queue.h"
+
+namespace Concurrency {
+
+    /**
+     * Single-writer, multi-reader broadcast ring. Every item is written once
+     * into a pre-allocated slot and each reader walks the ring at its own
+     * pace with its own cursor, so readers never see each other. The writer
+     * never waits: a reader that falls a whole ring behind is lapped, skips
+     * to half a ring behind the writer and counts what it missed.
+     *
+     * Each slot is guarded by a sequence number like a seqlock and holds the
+     * item as relaxed atomic words, so a read that races the writer reusing
+     * the slot is detected (and counted as missed) instead of being torn.
+     * T must be trivially copyable.
+     */
+    template <typename T>
+    class BroadcastRing {
+        static_assert(std::is_trivially_copyable<T>::value, "BroadcastRing items are copied as raw words");
+
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            std::atomic<uint64_t> sequence{0};  // 2n+1 while item n is written, 2n+2 once it is complete
+            std::atomic<uint64_t> words[wordCount<T>()];
+        };
+
+    public:
+        /**
+         * One consumer's view of the ring. Owned and used by a single thread;
+         * its counters can be read from any thread.
+         */
+        class Reader {
+        public:
+            /**
+             * Constructor; the reader sees items published from now on
+             * @param ring Ring to follow (must outlive the reader)
+             */
+            explicit Reader(const BroadcastRing& ring)
+                : m_ring(ring), m_position(ring.published()), m_received(0), m_missed(0)
+            {
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            /**
+             * Take the next item, skipping ahead if the writer lapped this reader
+             * @param item Receives a consistent copy of the item
+             * @return False if there is nothing new
+             */
+            bool tryRead(T& item) {
+                uint64_t position = m_position.load(std::memory_order_relaxed);
+                while (true) {
+                    uint64_t published = m_ring.m_published.load(std::memory_order_acquire);
+                    if (position == published) return false;
+                    if (published - position > m_ring.capacity()) {
+                        position = skip(position, published);
+                        continue;
+                    }
+
+                    const Slot& slot = m_ring.m_slots[position & m_ring.m_mask];
+                    uint64_t expected = 2 * position + 2;
+                    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                        position = skip(position, m_ring.m_published.load(std::memory_order_acquire));
+                        continue;
+                    }
+                    loadWords(slot.words, item);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+                        // The writer came round and reused the slot while we copied it
+                        position = skip(position, m_ring.m_published.load(std::memory_order_acquire));
+                        continue;
+                    }
+
+                    m_position.store(position + 1, std::memory_order_relaxed);
+                    bump(m_received, 1);
+                    return true;
+                }
+            }
+
+            /**
+             * Hand every new item to a callback
+             * @param onItem Called as onItem(const T&) in publication order
+             * @param maxItems Stop after this many
+             * @return Number of items delivered
+             */
+            template <typename Callback>
+            size_t poll(Callback&& onItem, size_t maxItems = SIZE_MAX) {
+                size_t count = 0;
+                while (count < maxItems && tryRead(m_scratch)) {
+                    onItem(static_cast<const T&>(m_scratch));
+                    count++;
+                }
+                return count;
+            }
+
+            /**
+             * Get the number of items published but not yet read
+             * @return Items behind the writer (may exceed capacity until the next read)
+             */
+            uint64_t lag() const {
+                return m_ring.published() - m_position.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * Get the number of items read
+             * @return Count since construction
+             */
+            uint64_t received() const {
+                return m_received.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * Get the number of items lost to being lapped
+             * @return Count since construction
+             */
+            uint64_t missed() const {
+                return m_missed.load(std::memory_order_relaxed);
+            }
+
+        private:
+            // Single-writer counter increment
+            static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+                counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+            }
+
+            // Rejoin half a ring behind the writer so the next lap is not immediate
+            uint64_t skip(uint64_t position, uint64_t published) {
+                uint64_t rejoin = published - m_ring.capacity() / 2;
+                if (rejoin <= position) rejoin = position + 1;
+                bump(m_missed, rejoin - position);
+                m_ring.m_lapped.fetch_add(1, std::memory_order_relaxed);
+                m_position.store(rejoin, std::memory_order_relaxed);
+                return rejoin;
+            }
+
+            const BroadcastRing& m_ring;
+            std::atomic<uint64_t> m_position;
+            std::atomic<uint64_t> m_received;
+            std::atomic<uint64_t> m_missed;
+            T m_scratch;
+        };
+
+        /**
+         * Constructor
+         * @param capacity Minimum number of items kept (rounded up to a power of two)
+         */
+        explicit BroadcastRing(size_t capacity)
+            : m_published(0), m_lapped(0)
+        {
+            size_t size = 2;
+            while (size < capacity) size <<= 1;
+            m_mask = size - 1;
+            m_slots.reset(new Slot[size]);
+        }
+
+        BroadcastRing(const BroadcastRing&) = delete;
+        BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+        /**
+         * Make an item visible to every reader (writer thread only; never blocks)
+         * @param item Item to copy in
+         */
+        void publish(const T& item) {
+            uint64_t position = m_published.load(std::memory_order_relaxed);
+            Slot& slot = m_slots[position & m_mask];
+
+            slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            storeWords(slot.words, item);
+            slot.sequence.store(2 * position + 2, std::memory_order_release);
+            m_published.store(position + 1, std::memory_order_release);
+        }
+
+        /**
+         * Get the number of items published
+         * @return Count since construction
+         */
+        uint64_t published() const {
+            return m_published.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Get the number of slots
+         * @return Capacity (a power of two)
+         */
+        size_t capacity() const {
+            return m_mask + 1;
+        }
+
+        /**
+         * Get how often any reader was lapped
+         * @return Lap count since construction, over all readers
+         */
+        uint64_t lapped() const {
+            return m_lapped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Writer side
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_published;
+
+        // Shared by readers, only touched when one is lapped
+        alignas(CACHE_LINE_SIZE) mutable std::atomic<uint64_t> m_lapped;
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_mask;
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include "atomic_words.h"
+#include "spsc_queue.h"
+
+namespace Concurrency {
+
+    /**
+     * Latest-value snapshot with one writer and any number of readers. The
+     * writer never waits; a reader copies the value and retries if a store
+     * overlapped the copy, so it always gets one complete value and never a
+     * mix of two. The value is held as relaxed atomic words (as in
+     * BroadcastRing), so the racing copy is well defined. T must be
+     * trivially copyable; callers with several writers must serialise them.
+     */
+    template <typename T>
+    class Seqlock {
+        static_assert(std::is_trivially_copyable<T>::value, "Seqlock values are copied as raw words");
+
+    public:
+        /**
+         * Constructor
+         * @param initial Value readers see until the first store
+         */
+        explicit Seqlock(const T& initial = T())
+            : m_sequence(0)
+        {
+            storeWords(m_words, initial);
+        }
+
+        Seqlock(const Seqlock&) = delete;
+        Seqlock& operator=(const Seqlock&) = delete;
+
+        /**
+         * Replace the value (one writer at a time; never blocks)
+         * @param value Value to copy in
+         */
+        void store(const T& value) {
+            uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+            m_sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            storeWords(m_words, value);
+            m_sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        /**
+         * Copy out the latest complete value (any thread)
+         * @return Value of the last finished store
+         */
+        T load() const {
+            T value;
+            while (true) {
+                uint64_t before = m_sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    // A store is half done; it only takes a few word writes
+                    std::this_thread::yield();
+                    continue;
+                }
+                loadWords(m_words, value);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_sequence.load(std::memory_order_relaxed) == before) return value;
+            }
+        }
+
+        /**
+         * Get the number of stores so far, to check for a new value without copying it
+         * @return Store count since construction
+         */
+        uint64_t version() const {
+            return m_sequence.load(std::memory_order_acquire) / 2;
+        }
+
+    private:
+        // Odd while a store is in progress; stores so far = sequence / 2
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_sequence;
+        std::atomic<uint64_t> m_words[wordCount<T>()];
+    };
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Concurrency {
+
+    // Typical cache line; producer and consumer state live on separate lines
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /**
+     * Bounded single-producer/single-consumer ring buffer. Both sides are
+     * wait-free: a push or pop is a few loads and one release store, and a
+     * full queue refuses the push (counted as an overrun) instead of
+     * blocking the producer. Each side keeps a cached copy of the other
+     * side's index so the shared line is only read when the cache runs out.
+     */
+    template <typename T>
+    class SpscQueue {
+    public:
+        /**
+         * Constructor
+         * @param capacity Minimum number of items (rounded up to a power of two)
+         */
+        explicit SpscQueue(size_t capacity)
+            : m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0), m_overruns(0)
+        {
+            size_t size = 2;
+            while (size < capacity) size <<= 1;
+            m_mask = size - 1;
+            m_slots.reset(new T[size]);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        /**
+         * Append an item (producer thread only)
+         * @param item Item to copy in
+         * @return False if the queue was full and the item was dropped
+         */
+        bool tryPush(const T& item) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cachedHead > m_mask) {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                if (tail - m_cachedHead > m_mask) {
+                    m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            m_slots[tail & m_mask] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Remove the oldest item (consumer thread only)
+         * @param item Receives the item
+         * @return False if the queue was empty
+         */
+        bool tryPop(T& item) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cachedTail) {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cachedTail) return false;
+            }
+            item = m_slots[head & m_mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Hand every queued item to a callback, releasing the slots once at the end (consumer thread only)
+         * @param onItem Called as onItem(const T&) in FIFO order
+         * @return Number of items consumed
+         */
+        template <typename Callback>
+        size_t drain(Callback&& onItem) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            size_t count = m_cachedTail - head;
+            for (size_t i = 0; i < count; i++) {
+                onItem(static_cast<const T&>(m_slots[(head + i) & m_mask]));
+            }
+            m_head.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        /**
+         * Get the number of queued items (exact from either side's thread, a snapshot elsewhere)
+         * @return Occupancy
+         */
+        size_t size() const {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            size_t head = m_head.load(std::memory_order_acquire);
+            return tail - head <= m_mask + 1 ? tail - head : 0;
+        }
+
+        /**
+         * Get the number of slots
+         * @return Capacity (a power of two)
+         */
+        size_t capacity() const {
+            return m_mask + 1;
+        }
+
+        /**
+         * Get the number of pushes refused because the queue was full
+         * @return Overrun count since construction
+         */
+        uint64_t overruns() const {
+            return m_overruns.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Consumer side
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+        size_t m_cachedTail;
+
+        // Producer side
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+        size_t m_cachedHead;
+        std::atomic<uint64_t> m_overruns;
+
+        alignas(CACHE_LINE_SIZE) std::unique_ptr<T[]> m_slots;
+        size_t m_mask;
+    };
+}
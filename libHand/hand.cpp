@@ -1,40 +1,58 @@
 #include "hand.h"
+#include <algorithm>
 
 namespace Hand {
 
 HandTracker::HandTracker() 
     : m_accel{0.0f, 0.0f, 0.0f}, m_gyro{0.0f, 0.0f, 0.0f}, 
-      m_velocity{0.0f, 0.0f, 0.0f}, m_firstUpdate(true),
-      m_accelOffset{0.0f, 0.0f, 0.0f}, m_gyroOffset{0.0f, 0.0f, 0.0f},
-      m_calibrationEnabled(false)
+      m_velocity{0.0f, 0.0f, 0.0f}, m_firstUpdate(true), m_updates(0)
 {
     // Initialize the timestamp
     m_lastUpdateTime = std::chrono::steady_clock::now();
 }
 
 void HandTracker::update(const std::unordered_map<std::string, int>& data) {
-    // Get current time for velocity calculation
+    Serial::ImuSample sample;
+    sample.ax = data.at("ax");
+    sample.ay = data.at("ay");
+    sample.az = data.at("az");
+    sample.gx = data.at("gx");
+    sample.gy = data.at("gy");
+    sample.gz = data.at("gz");
+    update(sample);
+}
+
+void HandTracker::update(const Serial::ImuSample& sample) {
+    // Use the sample's own time (device clock mapped to host) for velocity
+    // calculation; fall back to now for samples without one
     auto currentTime = std::chrono::steady_clock::now();
+    if (sample.host_time_ns != 0) {
+        currentTime = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(sample.host_time_ns)));
+    }
     
     // Save previous acceleration values for velocity calculation
     Vector3D prevAccel = m_accel;
     
+    // One copy of the settings, so a concurrent change applies from the next sample
+    TrackerSettings settings = m_settings.load();
+    
     // Get raw data
-    int raw_ax = data.at("ax");
-    int raw_ay = data.at("ay");
-    int raw_az = data.at("az");
-    int raw_gx = data.at("gx");
-    int raw_gy = data.at("gy");
-    int raw_gz = data.at("gz");
+    int raw_ax = sample.ax;
+    int raw_ay = sample.ay;
+    int raw_az = sample.az;
+    int raw_gx = sample.gx;
+    int raw_gy = sample.gy;
+    int raw_gz = sample.gz;
     
     // Apply calibration if enabled
-    if (m_calibrationEnabled) {
-        // raw_ax = applyCalibratedOffset(raw_ax, m_accelOffset.x);
-        // raw_ay = applyCalibratedOffset(raw_ay, m_accelOffset.y);
-        // raw_az = applyCalibratedOffset(raw_az, m_accelOffset.z);
-        raw_gx = applyCalibratedOffset(raw_gx, m_gyroOffset.x);
-        raw_gy = applyCalibratedOffset(raw_gy, m_gyroOffset.y);
-        raw_gz = applyCalibratedOffset(raw_gz, m_gyroOffset.z);
+    if (settings.calibrationEnabled) {
+        // raw_ax = applyCalibratedOffset(raw_ax, settings.accelOffset.x);
+        // raw_ay = applyCalibratedOffset(raw_ay, settings.accelOffset.y);
+        // raw_az = applyCalibratedOffset(raw_az, settings.accelOffset.z);
+        raw_gx = applyCalibratedOffset(raw_gx, settings.gyroOffset.x);
+        raw_gy = applyCalibratedOffset(raw_gy, settings.gyroOffset.y);
+        raw_gz = applyCalibratedOffset(raw_gz, settings.gyroOffset.z);
     }
     
     // Update data with calibrated values
@@ -48,13 +66,22 @@ void HandTracker::update(const std::unordered_map<std::string, int>& data) {
     
     // Update velocity based on acceleration data
     updateVelocity(prevAccel, currentTime);
+    
+    // Publish the new pose for readers on other threads
+    TrackerState state;
+    state.acceleration = m_accel;
+    state.gyroscope = m_gyro;
+    state.velocity = m_velocity;
+    state.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime.time_since_epoch()).count();
+    state.updates = ++m_updates;
+    m_state.store(state);
 }
 
 void HandTracker::updateVelocity(const Vector3D& prevAccel, const std::chrono::steady_clock::time_point& currentTime) {
     // Calculate time delta in seconds
     if (!m_firstUpdate) {
         std::chrono::duration<float> deltaTime = currentTime - m_lastUpdateTime;
-        float dt = deltaTime.count();
+        float dt = std::max(deltaTime.count(), 0.0f);
         
         // Basic velocity calculation using trapezoidal integration:
         // v(t+dt) = v(t) + (a(t) + a(t+dt))/2 * dt
@@ -70,25 +97,36 @@ void HandTracker::updateVelocity(const Vector3D& prevAccel, const std::chrono::s
 }
 
 Vector3D HandTracker::getAcceleration() const {
-    return m_accel;
+    return m_state.load().acceleration;
 }
 
 Vector3D HandTracker::getGyroscope() const {
-    return m_gyro;
+    return m_state.load().gyroscope;
 }
 
 Vector3D HandTracker::getVelocity() const {
-    return m_velocity;
+    return m_state.load().velocity;
+}
+
+TrackerState HandTracker::getState() const {
+    return m_state.load();
+}
+
+template <typename Change>
+void HandTracker::changeSettings(Change&& change) {
+    // Read-modify-publish; update() never takes this lock
+    std::lock_guard<std::mutex> lock(m_settingsMutex);
+    TrackerSettings settings = m_settings.load();
+    change(settings);
+    m_settings.store(settings);
 }
 
 void HandTracker::setCalibrationOffsets(float ax_offset, float ay_offset, float az_offset,
                                        float gx_offset, float gy_offset, float gz_offset) {
-    m_accelOffset.x = ax_offset;
-    m_accelOffset.y = ay_offset;
-    m_accelOffset.z = az_offset;
-    m_gyroOffset.x = gx_offset;
-    m_gyroOffset.y = gy_offset;
-    m_gyroOffset.z = gz_offset;
+    changeSettings([&](TrackerSettings& settings) {
+        settings.accelOffset = Vector3D(ax_offset, ay_offset, az_offset);
+        settings.gyroOffset = Vector3D(gx_offset, gy_offset, gz_offset);
+    });
 }
 
 int HandTracker::applyCalibratedOffset(int value, float offset) const {
@@ -98,11 +136,13 @@ int HandTracker::applyCalibratedOffset(int value, float offset) const {
 }
 
 void HandTracker::enableCalibration(bool enable) {
-    m_calibrationEnabled = enable;
+    changeSettings([enable](TrackerSettings& settings) {
+        settings.calibrationEnabled = enable;
+    });
 }
 
 bool HandTracker::isCalibrationEnabled() const {
-    return m_calibrationEnabled;
+    return m_settings.load().calibrationEnabled;
 }
 
 } // namespace Hand 
\ No newline at end of file
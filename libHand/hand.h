@@ -1,7 +1,12 @@
 #pragma once
 
 #include <unordered_map>
+#include <string>
 #include <chrono>
+#include <cstdint>
+#include <mutex>
+#include "../libSerial/sample.h"
+#include "../libConcurrency/seqlock.h"
 
 namespace Hand {
     // Simple 3D vector structure
@@ -18,7 +23,26 @@ namespace Hand {
             : x(x_val), y(y_val), z(z_val) {}
     };
 
-    // Extremely simple Hand data class that only stores raw data
+    // One consistent copy of everything the tracker publishes after an update
+    struct TrackerState {
+        Vector3D acceleration;
+        Vector3D gyroscope;
+        Vector3D velocity;
+        int64_t time_ns = 0;   // Host time of the sample (0 before the first update)
+        uint64_t updates = 0;  // Samples applied so far
+    };
+
+    // Calibration settings, changed from other threads and read once per update
+    struct TrackerSettings {
+        Vector3D accelOffset;
+        Vector3D gyroOffset;
+        bool calibrationEnabled = false;
+    };
+
+    // Extremely simple Hand data class that only stores raw data.
+    // update() must be called from one thread at a time; the getters and
+    // calibration setters may be called from any thread. Readers get a
+    // snapshot published after each update, never a half-written one.
     class HandTracker {
     public:
         // Constructor
@@ -27,6 +51,9 @@ namespace Hand {
         // Update with new sensor data (no processing)
         void update(const std::unordered_map<std::string, int>& data);
         
+        // Update with a typed sample (no map lookups)
+        void update(const Serial::ImuSample& sample);
+        
         // Get raw acceleration
         Vector3D getAcceleration() const;
         
@@ -36,6 +63,9 @@ namespace Hand {
         // Get calculated velocity
         Vector3D getVelocity() const;
         
+        // Get acceleration, gyroscope and velocity from the same update
+        TrackerState getState() const;
+        
         // Set calibration offsets
         void setCalibrationOffsets(float ax_offset, float ay_offset, float az_offset,
                                   float gx_offset, float gy_offset, float gz_offset);
@@ -53,22 +83,27 @@ namespace Hand {
         // Update velocity based on acceleration data
         void updateVelocity(const Vector3D& prevAccel, const std::chrono::steady_clock::time_point& currentTime);
         
-        // Raw sensor data
+        // Change the settings (serialised, since several threads may set them)
+        template <typename Change>
+        void changeSettings(Change&& change);
+        
+        // Raw sensor data (updating thread only)
         Vector3D m_accel;
         Vector3D m_gyro;
         
-        // Calculated velocity
+        // Calculated velocity (updating thread only)
         Vector3D m_velocity;
         
         // Timestamp for velocity calculation
         std::chrono::steady_clock::time_point m_lastUpdateTime;
         bool m_firstUpdate;
+        uint64_t m_updates;
         
-        // Calibration offsets
-        Vector3D m_accelOffset;
-        Vector3D m_gyroOffset;
+        // What readers see, republished after every update
+        Concurrency::Seqlock<TrackerState> m_state;
         
-        // Calibration state
-        bool m_calibrationEnabled;
+        // Calibration offsets and state; the mutex only orders the setters
+        Concurrency::Seqlock<TrackerSettings> m_settings;
+        std::mutex m_settingsMutex;
     };
 } 
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "latency_histogram.h"
+#include <cmath>
+
+namespace Metrics {
+
+    // Index of the highest set bit (value > 0)
+    static inline int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(value);
+#else
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+#endif
+    }
+
+    LatencyHistogram::LatencyHistogram() {
+        reset();
+    }
+
+    size_t LatencyHistogram::bucketOf(uint64_t value) {
+        // Exact below two full rows of sub-buckets
+        if (value < 2 * SUB_BUCKETS) return static_cast<size_t>(value);
+
+        int shift = highestBit(value) - HISTOGRAM_SUB_BUCKET_BITS;
+        if (shift > HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS - 1) return BUCKET_COUNT - 1;
+
+        // The top HISTOGRAM_SUB_BUCKET_BITS + 1 bits pick the sub-bucket within the power of two
+        size_t top = static_cast<size_t>(value >> shift) - SUB_BUCKETS;
+        return 2 * SUB_BUCKETS + static_cast<size_t>(shift - 1) * SUB_BUCKETS + top;
+    }
+
+    int64_t LatencyHistogram::bucketUpperEdge(size_t bucket) {
+        if (bucket < 2 * SUB_BUCKETS) return static_cast<int64_t>(bucket);
+
+        size_t shift = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+        uint64_t top = (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+        return static_cast<int64_t>(((top + 1) << shift) - 1);
+    }
+
+    void LatencyHistogram::record(int64_t ns) {
+        uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+        m_counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_total.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+
+        int64_t previous = m_max.load(std::memory_order_relaxed);
+        while (static_cast<int64_t>(value) > previous &&
+               !m_max.compare_exchange_weak(previous, static_cast<int64_t>(value), std::memory_order_relaxed)) {
+        }
+    }
+
+    int64_t LatencyHistogram::percentile(double quantile) const {
+        uint64_t total = m_total.load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+
+        // Rank of the measurement we want, 1-based
+        uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * total));
+        if (rank < 1) rank = 1;
+
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            seen += m_counts[bucket].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                // Never report beyond the largest value actually seen
+                int64_t edge = bucketUpperEdge(bucket);
+                int64_t max = m_max.load(std::memory_order_relaxed);
+                return edge < max ? edge : max;
+            }
+        }
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+    LatencySummary LatencyHistogram::summary() const {
+        LatencySummary summary;
+        summary.count = m_total.load(std::memory_order_relaxed);
+        if (summary.count == 0) return summary;
+
+        summary.p50 = percentile(0.50);
+        summary.p99 = percentile(0.99);
+        summary.p999 = percentile(0.999);
+        summary.max = m_max.load(std::memory_order_relaxed);
+        summary.mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) / summary.count;
+        return summary;
+    }
+
+    void LatencyHistogram::reset() {
+        for (std::atomic<uint64_t>& count : m_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_total.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+}
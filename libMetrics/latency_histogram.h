@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Metrics {
+
+    // Sub-buckets per power of two: values are kept to within 1/32 (~3%)
+    constexpr int HISTOGRAM_SUB_BUCKET_BITS = 5;
+
+    // Largest value kept apart; anything longer lands in the last bucket (~18 minutes)
+    constexpr int HISTOGRAM_MAX_BITS = 40;
+
+    // Percentiles of a histogram, in nanoseconds
+    struct LatencySummary {
+        uint64_t count = 0;
+        int64_t p50 = 0;
+        int64_t p99 = 0;
+        int64_t p999 = 0;
+        int64_t max = 0;
+        double mean = 0.0;
+    };
+
+    /**
+     * HDR-style latency histogram. Values below 64 ns get their own bucket;
+     * above that every power of two is split into 32 equal buckets, so the
+     * relative error stays under 3% from nanoseconds to minutes in a fixed
+     * 10 KB table. Recording is a couple of relaxed atomic adds, safe from
+     * any number of threads; readers see a slightly stale but usable view.
+     */
+    class LatencyHistogram {
+    public:
+        LatencyHistogram();
+
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        /**
+         * Add one measurement
+         * @param ns Latency in nanoseconds (negative values count as 0)
+         */
+        void record(int64_t ns);
+
+        /**
+         * Get the value below which a share of the measurements fall
+         * @param quantile 0..1 (0.99 = p99)
+         * @return Upper edge of the bucket holding that measurement, 0 if empty
+         */
+        int64_t percentile(double quantile) const;
+
+        /**
+         * Get count, p50/p99/p99.9, max and mean in one pass
+         * @return Summary (all zero if nothing was recorded)
+         */
+        LatencySummary summary() const;
+
+        /**
+         * Forget every measurement (not atomic with respect to concurrent record())
+         */
+        void reset();
+
+    private:
+        static constexpr size_t SUB_BUCKETS = size_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_COUNT =
+            2 * SUB_BUCKETS + (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+        // Bucket a value falls in, and the largest value a bucket holds
+        static size_t bucketOf(uint64_t value);
+        static int64_t bucketUpperEdge(size_t bucket);
+
+        std::atomic<uint64_t> m_counts[BUCKET_COUNT];
+        std::atomic<uint64_t> m_total;
+        std::atomic<uint64_t> m_sum;
+        std::atomic<int64_t> m_max;
+    };
+}
@@ -0,0 +1,78 @@
+#include "latency_monitor.h"
+#include <cstdio>
+
+namespace Metrics {
+
+    const char* latencyStageName(LatencyStage stage) {
+        switch (stage) {
+            case LatencyStage::Decode:   return "decode";
+            case LatencyStage::Uncouple: return "uncouple";
+            case LatencyStage::Track:    return "track";
+            case LatencyStage::Output:   return "output";
+            case LatencyStage::EndToEnd: return "end-to-end";
+            default:                     return "?";
+        }
+    }
+
+    LatencyMonitor::LatencyMonitor()
+        : m_budgetNs(0)
+    {
+    }
+
+    void LatencyMonitor::recordProcessing(const SampleTimes& times) {
+        if (times.arrival_ns == 0) return;
+
+        m_histograms[static_cast<size_t>(LatencyStage::Decode)].record(times.decoded_ns - times.arrival_ns);
+        if (times.uncoupled_ns != 0) {
+            m_histograms[static_cast<size_t>(LatencyStage::Uncouple)].record(times.uncoupled_ns - times.decoded_ns);
+        }
+        if (times.tracked_ns != 0 && times.uncoupled_ns != 0) {
+            m_histograms[static_cast<size_t>(LatencyStage::Track)].record(times.tracked_ns - times.uncoupled_ns);
+        }
+    }
+
+    void LatencyMonitor::recordOutput(const SampleTimes& times, int64_t output_ns) {
+        if (times.arrival_ns == 0) return;
+
+        if (times.tracked_ns != 0) {
+            m_histograms[static_cast<size_t>(LatencyStage::Output)].record(output_ns - times.tracked_ns);
+        }
+        m_histograms[static_cast<size_t>(LatencyStage::EndToEnd)].record(output_ns - times.arrival_ns);
+    }
+
+    LatencySummary LatencyMonitor::summary(LatencyStage stage) const {
+        return m_histograms[static_cast<size_t>(stage)].summary();
+    }
+
+    void LatencyMonitor::setBudget(int64_t p99_ns) {
+        m_budgetNs = p99_ns;
+    }
+
+    bool LatencyMonitor::overBudget() const {
+        return m_budgetNs > 0 && summary(LatencyStage::EndToEnd).p99 > m_budgetNs;
+    }
+
+    void LatencyMonitor::print(std::ostream& out) const {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-11s %10s %10s %10s %10s %10s\n",
+                      "latency us", "count", "p50", "p99", "p99.9", "max");
+        out << line;
+        for (size_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+            LatencySummary s = m_histograms[i].summary();
+            std::snprintf(line, sizeof(line), "%-11s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+                          latencyStageName(static_cast<LatencyStage>(i)), static_cast<unsigned long long>(s.count),
+                          s.p50 * 1e-3, s.p99 * 1e-3, s.p999 * 1e-3, s.max * 1e-3);
+            out << line;
+        }
+        if (m_budgetNs > 0) {
+            out << "end-to-end p99 budget " << m_budgetNs * 1e-3 << " us: "
+                << (overBudget() ? "EXCEEDED" : "met") << std::endl;
+        }
+    }
+
+    void LatencyMonitor::reset() {
+        for (LatencyHistogram& histogram : m_histograms) {
+            histogram.reset();
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "latency_histogram.h"
+
+namespace Metrics {
+
+    // Host steady-clock stamps a sample collects on its way through the engine (0 = not taken)
+    struct SampleTimes {
+        int64_t arrival_ns = 0;    // Bytes returned by read()
+        int64_t decoded_ns = 0;    // Frame decoded into a sample
+        int64_t uncoupled_ns = 0;  // Gravity estimate done
+        int64_t tracked_ns = 0;    // Hand tracker updated
+    };
+
+    // Intervals the monitor keeps a histogram for
+    enum class LatencyStage {
+        Decode,    // arrival -> decoded
+        Uncouple,  // decoded -> uncoupled
+        Track,     // uncoupled -> tracked
+        Output,    // tracked -> first drawn or emitted
+        EndToEnd,  // arrival -> first drawn or emitted
+        Count
+    };
+
+    constexpr size_t LATENCY_STAGE_COUNT = static_cast<size_t>(LatencyStage::Count);
+
+    /**
+     * Get a stage's display name
+     * @param stage Stage
+     * @return Short lowercase name
+     */
+    const char* latencyStageName(LatencyStage stage);
+
+    /**
+     * Per-stage and end-to-end latency of the sample path. The processing
+     * stages are recorded once per sample, output by whichever consumer
+     * shows or sends the sample first. Safe to record and read from any thread.
+     */
+    class LatencyMonitor {
+    public:
+        LatencyMonitor();
+
+        /**
+         * Record decode, uncouple and track intervals of a sample
+         * @param times Stamps up to tracked_ns
+         */
+        void recordProcessing(const SampleTimes& times);
+
+        /**
+         * Record that a sample was drawn or emitted
+         * @param times Stamps the sample carried
+         * @param output_ns When it became visible
+         */
+        void recordOutput(const SampleTimes& times, int64_t output_ns);
+
+        /**
+         * Get one stage's percentiles
+         * @param stage Stage
+         * @return Summary in nanoseconds
+         */
+        LatencySummary summary(LatencyStage stage) const;
+
+        /**
+         * Set the end-to-end p99 the engine must stay under
+         * @param p99_ns Budget in nanoseconds (0 = none)
+         */
+        void setBudget(int64_t p99_ns);
+
+        /**
+         * Check the end-to-end p99 against the budget
+         * @return True if a budget is set and exceeded
+         */
+        bool overBudget() const;
+
+        /**
+         * Write a table of every stage's percentiles in microseconds
+         * @param out Stream to print to
+         */
+        void print(std::ostream& out) const;
+
+        /**
+         * Forget every measurement
+         */
+        void reset();
+
+    private:
+        LatencyHistogram m_histograms[LATENCY_STAGE_COUNT];
+        int64_t m_budgetNs;
+    };
+}
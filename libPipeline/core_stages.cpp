@@ -0,0 +1,43 @@
+#include "core_stages.h"
+#include "sinks.h"
+#include "../libSerial/clock_sync.h"
+
+namespace Pipeline {
+
+    void addCoreStages(Pipeline& pipeline, Uncoupler::SensorUncoupler& uncoupler, Hand::HandTracker& tracker,
+                       Metrics::LatencyMonitor& latency) {
+        pipeline.addStage("uncouple", [&uncoupler](FusedSample& sample) {
+            sample.uncoupled = uncoupler.processData(sample.raw);
+            sample.times.uncoupled_ns = Serial::hostTimeNs();
+        });
+
+        // The tracker's calibrated values stand in for the raw ones downstream
+        pipeline.addStage("track", [&tracker, &latency](FusedSample& sample) {
+            tracker.update(sample.raw);
+            Hand::TrackerState state = tracker.getState();
+            sample.calibrated.ax = static_cast<int>(state.acceleration.x);
+            sample.calibrated.ay = static_cast<int>(state.acceleration.y);
+            sample.calibrated.az = static_cast<int>(state.acceleration.z);
+            sample.calibrated.gx = static_cast<int>(state.gyroscope.x);
+            sample.calibrated.gy = static_cast<int>(state.gyroscope.y);
+            sample.calibrated.gz = static_cast<int>(state.gyroscope.z);
+            sample.velocity = state.velocity;
+            sample.times.tracked_ns = Serial::hostTimeNs();
+            latency.recordProcessing(sample.times);
+        });
+    }
+
+    bool addSinks(Pipeline& pipeline, const std::vector<std::string>& specs, Metrics::LatencyMonitor* latency) {
+        for (size_t i = 0; i < specs.size(); i++) {
+            std::unique_ptr<Stage> sink = createSink(specs[i]);
+            if (!sink) return false;
+            pipeline.addStage(std::move(sink), Execution::Broadcast);
+            if (i == 0 && latency) {
+                pipeline.addStage("emitted", [latency](FusedSample& sample) {
+                    latency->recordOutput(sample.times, Serial::hostTimeNs());
+                });
+            }
+        }
+        return true;
+    }
+}
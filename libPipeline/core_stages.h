@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "pipeline.h"
+
+namespace Pipeline {
+
+    /**
+     * Add the stages every build of the engine runs first: "uncouple"
+     * (gravity and linear acceleration) and "track" (hand tracker update,
+     * its calibrated readings and velocity, and the processing latency).
+     * Both run fused on the ingest thread; the objects must outlive the pipeline.
+     * @param pipeline Pipeline to add to (before it starts)
+     * @param uncoupler Uncoupler fed every raw sample
+     * @param tracker Hand tracker fed every raw sample
+     * @param latency Monitor the processing time is recorded in
+     */
+    void addCoreStages(Pipeline& pipeline, Uncoupler::SensorUncoupler& uncoupler, Hand::HandTracker& tracker,
+                       Metrics::LatencyMonitor& latency);
+
+    /**
+     * Add one broadcast sink per spec (see createSink), in order. With a
+     * latency monitor, an "emitted" stage after the first sink records a
+     * sample as out once that sink has written it.
+     * @param pipeline Pipeline to add to (before it starts)
+     * @param specs Sink specs
+     * @param latency Monitor the output time is recorded in, or nullptr when
+     *                something else records it
+     * @return false if a spec could not be turned into a sink
+     */
+    bool addSinks(Pipeline& pipeline, const std::vector<std::string>& specs, Metrics::LatencyMonitor* latency);
+}
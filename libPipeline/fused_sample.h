@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../libSerial/sample.h"
+#include "../libUncoupler/uncoupler.h"
+#include "../libHand/hand.h"
+#include "../libMetrics/latency_monitor.h"
+
+namespace Pipeline {
+
+    // One reading as it moves through the stages; each stage fills in its part
+    struct FusedSample {
+        Serial::ImuSample raw;              // As decoded and rescaled by the ingest loop
+        Serial::ImuSample calibrated;       // Offsets removed by the hand tracker
+        Uncoupler::UncoupledData uncoupled; // Gravity estimate and linear acceleration
+        Hand::Vector3D velocity;            // Tracker velocity after this reading
+        Metrics::SampleTimes times;         // Stamps for latency accounting
+    };
+}
@@ -0,0 +1,271 @@
+#include "pipeline.h"
+#include "../libConcurrency/spsc_queue.h"
+#include "../libConcurrency/broadcast_ring.h"
+#include "../libSerial/clock_sync.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Pipeline {
+
+    // Longest a worker sleeps before rechecking its queue; a safety net, wakeups are signalled
+    static const std::chrono::milliseconds WORKER_IDLE_WAIT(50);
+
+    struct Pipeline::Node {
+        std::unique_ptr<Stage> stage;
+        Execution execution = Execution::Fused;
+        size_t queueCapacity = 0;
+
+        // Written only by the thread that runs the stage (or pushes into its queue)
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> busyNs{0};
+    };
+
+    struct Pipeline::Segment {
+        size_t begin = 0;  // Node range run by this segment
+        size_t end = 0;
+
+        // Input of a threaded segment, or the cursor of a broadcast one; both null for the producer's segment
+        std::unique_ptr<Concurrency::SpscQueue<FusedSample>> queue;
+        std::unique_ptr<Concurrency::BroadcastRing<FusedSample>::Reader> reader;
+        std::thread thread;
+
+        // Sleep/wake handshake so an idle worker costs no CPU
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::atomic<bool> sleeping{false};
+        bool stopping = false;  // Guarded by mutex
+    };
+
+    // Single-writer counter increment (no read-modify-write needed)
+    static inline void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    FunctionStage::FunctionStage(std::string name, std::function<void(FusedSample&)> process)
+        : m_name(std::move(name)), m_process(std::move(process))
+    {
+    }
+
+    const char* FunctionStage::name() const {
+        return m_name.c_str();
+    }
+
+    void FunctionStage::process(FusedSample& sample) {
+        m_process(sample);
+    }
+
+    Pipeline::Pipeline()
+        : m_startNs(0), m_started(false)
+    {
+    }
+
+    Pipeline::~Pipeline() {
+        stop();
+    }
+
+    void Pipeline::addStage(std::unique_ptr<Stage> stage, Execution execution, size_t queueCapacity) {
+        if (m_started || !stage) return;
+
+        std::unique_ptr<Node> node = std::make_unique<Node>();
+        node->stage = std::move(stage);
+        node->execution = execution;
+        node->queueCapacity = execution != Execution::Fused ? queueCapacity : 0;
+        m_nodes.push_back(std::move(node));
+    }
+
+    void Pipeline::addStage(const std::string& name, std::function<void(FusedSample&)> process,
+                            Execution execution, size_t queueCapacity) {
+        addStage(std::make_unique<FunctionStage>(name, std::move(process)), execution, queueCapacity);
+    }
+
+    void Pipeline::setWorkerSetup(std::function<void(const std::string&)> setup) {
+        if (m_started) return;
+        m_workerSetup = std::move(setup);
+    }
+
+    void Pipeline::start() {
+        if (m_started) return;
+
+        // One ring shared by every broadcast stage, sized for the largest request
+        m_segments.clear();
+        m_bus.reset();
+        bool broadcast = false;
+        size_t busCapacity = 0;
+        for (const std::unique_ptr<Node>& node : m_nodes) {
+            if (node->execution == Execution::Broadcast) {
+                broadcast = true;
+                busCapacity = std::max(busCapacity, node->queueCapacity);
+            }
+        }
+        if (broadcast) {
+            m_bus = std::make_unique<Concurrency::BroadcastRing<FusedSample>>(busCapacity);
+        }
+
+        // Split the chain at every threaded and broadcast stage; segment 0 runs on the producer
+        m_segments.push_back(std::make_unique<Segment>());
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            if (m_nodes[i]->execution == Execution::Fused) continue;
+
+            m_segments.back()->end = i;
+            std::unique_ptr<Segment> segment = std::make_unique<Segment>();
+            segment->begin = i;
+            if (m_nodes[i]->execution == Execution::Threaded) {
+                segment->queue = std::make_unique<Concurrency::SpscQueue<FusedSample>>(m_nodes[i]->queueCapacity);
+            } else {
+                segment->reader = std::make_unique<Concurrency::BroadcastRing<FusedSample>::Reader>(*m_bus);
+            }
+            m_segments.push_back(std::move(segment));
+        }
+        m_segments.back()->end = m_nodes.size();
+
+        m_startNs = Serial::hostTimeNs();
+        m_started = true;
+        for (size_t i = 1; i < m_segments.size(); i++) {
+            m_segments[i]->thread = std::thread(&Pipeline::runWorker, this, i);
+        }
+    }
+
+    void Pipeline::stop() {
+        if (!m_started) return;
+
+        // Stop front to back so each worker drains what the one before it handed over
+        for (size_t i = 0; i < m_segments.size(); i++) {
+            Segment& segment = *m_segments[i];
+            if (i == 0) {
+                for (size_t n = segment.begin; n < segment.end; n++) {
+                    m_nodes[n]->stage->finish();
+                }
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(segment.mutex);
+                segment.stopping = true;
+            }
+            segment.wakeup.notify_one();
+            segment.thread.join();
+        }
+        m_started = false;
+    }
+
+    void Pipeline::push(const Serial::ImuSample& sample) {
+        if (!m_started) return;
+
+        FusedSample fused;
+        fused.raw = sample;
+        fused.calibrated = sample;
+        fused.times.arrival_ns = sample.arrival_ns;
+        fused.times.decoded_ns = sample.decoded_ns;
+        runSegment(0, fused);
+    }
+
+    void Pipeline::runSegment(size_t index, FusedSample& sample) {
+        Segment& segment = *m_segments[index];
+        for (size_t n = segment.begin; n < segment.end; n++) {
+            Node& node = *m_nodes[n];
+            int64_t begin = Serial::hostTimeNs();
+            node.stage->process(sample);
+            bump(node.busyNs, static_cast<uint64_t>(Serial::hostTimeNs() - begin));
+            bump(node.processed);
+        }
+
+        // The producer's output goes to every broadcast segment at once
+        if (index == 0 && m_bus) {
+            m_bus->publish(sample);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (size_t i = 1; i < m_segments.size(); i++) {
+                if (m_segments[i]->reader) wake(*m_segments[i]);
+            }
+        }
+
+        // Broadcast segments read the ring instead of a hand-off from the segment before them
+        if (index + 1 == m_segments.size() || !m_segments[index + 1]->queue) return;
+
+        Segment& next = *m_segments[index + 1];
+        if (!next.queue->tryPush(sample)) {
+            bump(m_nodes[next.begin]->dropped);
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake(next);
+    }
+
+    void Pipeline::wake(Segment& segment) {
+        // Pairs with the fence in runWorker: either the worker sees the sample or we see it sleeping
+        if (segment.sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(segment.mutex);
+            segment.wakeup.notify_one();
+        }
+    }
+
+    void Pipeline::runWorker(size_t index) {
+        Segment& segment = *m_segments[index];
+        FusedSample sample;
+        if (m_workerSetup) m_workerSetup(m_nodes[segment.begin]->stage->name());
+
+        while (true) {
+            if (segment.queue) {
+                while (segment.queue->tryPop(sample)) {
+                    runSegment(index, sample);
+                }
+            } else {
+                while (segment.reader->tryRead(sample)) {
+                    runSegment(index, sample);
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(segment.mutex);
+            segment.sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool idle = segment.queue ? segment.queue->size() == 0 : segment.reader->lag() == 0;
+            if (idle) {
+                if (segment.stopping) break;
+                segment.wakeup.wait_for(lock, WORKER_IDLE_WAIT);
+            }
+            segment.sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        for (size_t n = segment.begin; n < segment.end; n++) {
+            m_nodes[n]->stage->finish();
+        }
+    }
+
+    std::vector<StageStats> Pipeline::stats() const {
+        double seconds = m_startNs > 0 ? (Serial::hostTimeNs() - m_startNs) * 1e-9 : 0.0;
+
+        std::vector<StageStats> result;
+        result.reserve(m_nodes.size());
+        for (size_t n = 0; n < m_nodes.size(); n++) {
+            const Node& node = *m_nodes[n];
+            StageStats stats;
+            stats.name = node.stage->name();
+            stats.execution = node.execution;
+            stats.processed = node.processed.load(std::memory_order_relaxed);
+            stats.dropped = node.dropped.load(std::memory_order_relaxed);
+            stats.queue_capacity = node.queueCapacity;
+            stats.samples_per_second = seconds > 0 ? stats.processed / seconds : 0.0;
+            stats.mean_process_ns = stats.processed > 0
+                ? static_cast<double>(node.busyNs.load(std::memory_order_relaxed)) / stats.processed : 0.0;
+            result.push_back(stats);
+        }
+
+        // Queue depth lives on the segment the threaded or broadcast stage starts
+        for (size_t i = 1; i < m_segments.size(); i++) {
+            const Segment& segment = *m_segments[i];
+            if (segment.begin >= result.size()) continue;
+
+            StageStats& stats = result[segment.begin];
+            if (segment.queue) {
+                stats.queue_depth = segment.queue->size();
+            } else {
+                stats.queue_depth = static_cast<size_t>(std::min<uint64_t>(segment.reader->lag(), m_bus->capacity()));
+                stats.queue_capacity = m_bus->capacity();
+                stats.dropped = segment.reader->missed();
+            }
+        }
+        return result;
+    }
+}
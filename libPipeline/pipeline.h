@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fused_sample.h"
+
+namespace Concurrency {
+    template <typename T> class BroadcastRing;
+}
+
+namespace Pipeline {
+
+    // Where a stage runs
+    enum class Execution {
+        Fused,     // Inline on the thread that ran the previous stage
+        Threaded,  // On its own thread behind a bounded queue
+        Broadcast  // On its own thread, reading the producer's output from the shared ring
+    };
+
+    // Input queue size of a threaded stage and the broadcast ring (about a second at 1 kHz)
+    constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+    /**
+     * One processing step. process() is only ever called from one thread at
+     * a time, so a stage needs no locking for its own state.
+     */
+    class Stage {
+    public:
+        virtual ~Stage() = default;
+
+        /**
+         * Get the name shown in the stats
+         * @return Stage name
+         */
+        virtual const char* name() const = 0;
+
+        /**
+         * Handle one sample
+         * @param sample Sample to read and fill in; later stages see the changes
+         */
+        virtual void process(FusedSample& sample) = 0;
+
+        /**
+         * Called on the stage's thread after its last sample (flush files here)
+         */
+        virtual void finish() {}
+    };
+
+    // Stage around a callable, for stages that are a few lines of glue
+    class FunctionStage : public Stage {
+    public:
+        FunctionStage(std::string name, std::function<void(FusedSample&)> process);
+
+        const char* name() const override;
+        void process(FusedSample& sample) override;
+
+    private:
+        std::string m_name;
+        std::function<void(FusedSample&)> m_process;
+    };
+
+    // Health of one stage
+    struct StageStats {
+        std::string name;
+        Execution execution = Execution::Fused;
+        uint64_t processed = 0;         // Samples handled
+        uint64_t dropped = 0;           // Samples refused by a full queue, or missed by a lapped broadcast reader
+        size_t queue_depth = 0;         // Samples waiting (threaded and broadcast stages)
+        size_t queue_capacity = 0;      // 0 for fused stages
+        double samples_per_second = 0;  // Throughput since start()
+        double mean_process_ns = 0;     // Mean time inside process()
+    };
+
+    /**
+     * Chain of stages fed by the ingest thread. Consecutive fused stages run
+     * back to back on one thread; a threaded stage starts a new segment with
+     * its own thread and a wait-free input queue, and the fused stages after
+     * it run on that thread too. A full queue drops the sample (counted on
+     * the stage) instead of blocking the thread in front of it.
+     *
+     * Samples leaving the producer's segment are also written once into a
+     * broadcast ring when there are broadcast stages. Each broadcast stage
+     * starts a segment that reads the ring on its own thread at its own
+     * pace, so a slow sink only loses its own samples (it is lapped and
+     * counts what it missed) and never delays the producer or other sinks.
+     */
+    class Pipeline {
+    public:
+        Pipeline();
+        ~Pipeline();
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        /**
+         * Append a stage (before start() only)
+         * @param stage Stage to take ownership of
+         * @param execution Fused, on its own thread, or on its own thread reading the broadcast ring
+         * @param queueCapacity Input queue size for a threaded stage (broadcast: ring size, the largest wins)
+         */
+        void addStage(std::unique_ptr<Stage> stage, Execution execution = Execution::Fused,
+                      size_t queueCapacity = DEFAULT_QUEUE_CAPACITY);
+
+        /**
+         * Append a stage built from a callable (before start() only)
+         * @param name Stage name
+         * @param process Called with each sample
+         * @param execution Fused, on its own thread, or on its own thread reading the broadcast ring
+         * @param queueCapacity Input queue size for a threaded stage (broadcast: ring size, the largest wins)
+         */
+        void addStage(const std::string& name, std::function<void(FusedSample&)> process,
+                      Execution execution = Execution::Fused, size_t queueCapacity = DEFAULT_QUEUE_CAPACITY);
+
+        /**
+         * Run a callable at the start of every worker thread, e.g. to pin it
+         * to a core (before start() only)
+         * @param setup Called on the new thread with the name of the first stage it runs
+         */
+        void setWorkerSetup(std::function<void(const std::string&)> setup);
+
+        /**
+         * Start the threads of threaded stages
+         */
+        void start();
+
+        /**
+         * Process every queued sample, run each stage's finish() and join the
+         * threads. Call after the producer has stopped pushing.
+         */
+        void stop();
+
+        /**
+         * Run a sample through the pipeline (one producer thread only)
+         * @param sample Decoded sample; fills raw, calibrated and the arrival and decode stamps
+         */
+        void push(const Serial::ImuSample& sample);
+
+        /**
+         * Get every stage's counters (safe from any thread)
+         * @return One entry per stage in pipeline order
+         */
+        std::vector<StageStats> stats() const;
+
+    private:
+        struct Node;
+        struct Segment;
+
+        // Run a segment's stages on one sample and hand it to the next segment
+        void runSegment(size_t index, FusedSample& sample);
+
+        // Thread body of a threaded or broadcast segment
+        void runWorker(size_t index);
+
+        // Signal a segment's worker if it is asleep (after a seq_cst fence)
+        void wake(Segment& segment);
+
+        std::vector<std::unique_ptr<Node>> m_nodes;
+        std::vector<std::unique_ptr<Segment>> m_segments;
+        std::unique_ptr<Concurrency::BroadcastRing<FusedSample>> m_bus;  // Null without broadcast stages
+        std::function<void(const std::string&)> m_workerSetup;
+        std::atomic<int64_t> m_startNs;
+        bool m_started;
+    };
+}
@@ -0,0 +1,111 @@
+#include "sinks.h"
+#include <cstdio>
+#include <iostream>
+
+namespace Pipeline {
+
+    // Writes one line per sample; the file is buffered and flushed in finish()
+    class CsvRecorder : public Stage {
+    public:
+        explicit CsvRecorder(std::FILE* file)
+            : m_file(file)
+        {
+            std::fputs("host_time_ns,device,ax,ay,az,gx,gy,gz,cal_ax,cal_ay,cal_az,cal_gx,cal_gy,cal_gz,"
+                       "grav_x,grav_y,grav_z,lin_ax,lin_ay,lin_az,vx,vy,vz\n", m_file);
+        }
+
+        ~CsvRecorder() override {
+            if (m_file != stdout) std::fclose(m_file);
+        }
+
+        const char* name() const override {
+            return "csv";
+        }
+
+        void process(FusedSample& sample) override {
+            const Serial::ImuSample& raw = sample.raw;
+            const Serial::ImuSample& cal = sample.calibrated;
+            const Uncoupler::UncoupledData& uncoupled = sample.uncoupled;
+            std::fprintf(m_file, "%lld,%u,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%g,%g,%g,%g,%g,%g,%g,%g,%g\n",
+                         static_cast<long long>(raw.host_time_ns), raw.device,
+                         raw.ax, raw.ay, raw.az, raw.gx, raw.gy, raw.gz,
+                         cal.ax, cal.ay, cal.az, cal.gx, cal.gy, cal.gz,
+                         uncoupled.grav_x, uncoupled.grav_y, uncoupled.grav_z,
+                         uncoupled.ax_linear, uncoupled.ay_linear, uncoupled.az_linear,
+                         sample.velocity.x, sample.velocity.y, sample.velocity.z);
+        }
+
+        void finish() override {
+            std::fflush(m_file);
+        }
+
+    private:
+        std::FILE* m_file;
+    };
+
+    // One JSON object per sample, for piping into other tools
+    class JsonLinesWriter : public Stage {
+    public:
+        explicit JsonLinesWriter(std::FILE* file)
+            : m_file(file)
+        {
+        }
+
+        ~JsonLinesWriter() override {
+            if (m_file != stdout) std::fclose(m_file);
+        }
+
+        const char* name() const override {
+            return "jsonl";
+        }
+
+        void process(FusedSample& sample) override {
+            const Serial::ImuSample& cal = sample.calibrated;
+            const Uncoupler::UncoupledData& uncoupled = sample.uncoupled;
+            std::fprintf(m_file, "{\"t\":%lld,\"dev\":%u,\"a\":[%d,%d,%d],\"g\":[%d,%d,%d],"
+                                 "\"grav\":[%g,%g,%g],\"lin\":[%g,%g,%g],\"v\":[%g,%g,%g]}\n",
+                         static_cast<long long>(sample.raw.host_time_ns), sample.raw.device,
+                         cal.ax, cal.ay, cal.az, cal.gx, cal.gy, cal.gz,
+                         uncoupled.grav_x, uncoupled.grav_y, uncoupled.grav_z,
+                         uncoupled.ax_linear, uncoupled.ay_linear, uncoupled.az_linear,
+                         sample.velocity.x, sample.velocity.y, sample.velocity.z);
+        }
+
+        void finish() override {
+            std::fflush(m_file);
+        }
+
+    private:
+        std::FILE* m_file;
+    };
+
+    // "-" is standard output
+    static std::FILE* openOutput(const std::string& path) {
+        if (path == "-") return stdout;
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            std::cerr << "Failed to open " << path << " for recording" << std::endl;
+        }
+        return file;
+    }
+
+    std::unique_ptr<Stage> createSink(const std::string& spec) {
+        size_t colon = spec.find(':');
+        std::string name = spec.substr(0, colon);
+        std::string argument = colon == std::string::npos ? std::string() : spec.substr(colon + 1);
+
+        if (name == "csv" || name == "jsonl") {
+            if (argument.empty()) {
+                std::cerr << "The " << name << " sink needs a file: " << name << ":<path> (- for stdout)" << std::endl;
+                return nullptr;
+            }
+            std::FILE* file = openOutput(argument);
+            if (!file) return nullptr;
+            if (name == "csv") return std::make_unique<CsvRecorder>(file);
+            return std::make_unique<JsonLinesWriter>(file);
+        }
+
+        std::cerr << "Unknown sink: " << name << std::endl;
+        return nullptr;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "pipeline.h"
+
+namespace Pipeline {
+
+    /**
+     * Build an output stage from a command line spec. New sinks are added
+     * here, so the application only passes the specs through.
+     *   csv:<path>    Record every fused sample to a CSV file
+     *   jsonl:<path>  Stream every fused sample as JSON lines
+     * A path of "-" writes to standard output.
+     * @param spec Sink name, optionally followed by ':' and its argument
+     * @return Stage to attach (best run threaded), or nullptr if the spec is unknown or fails
+     */
+    std::unique_ptr<Stage> createSink(const std::string& spec);
+}
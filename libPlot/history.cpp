@@ -0,0 +1,102 @@
+#include "history.h"
+#include <algorithm>
+
+namespace Plot {
+    // Range over three series of equal, non-zero length
+    static ValueRange rangeOf(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z) {
+        ValueRange range;
+        range.min = std::min({
+            *std::min_element(x.begin(), x.end()),
+            *std::min_element(y.begin(), y.end()),
+            *std::min_element(z.begin(), z.end())
+        });
+        range.max = std::max({
+            *std::max_element(x.begin(), x.end()),
+            *std::max_element(y.begin(), y.end()),
+            *std::max_element(z.begin(), z.end())
+        });
+        return range;
+    }
+
+    PlotPoint toPlotPoint(const Serial::ImuSample& sample, float time) {
+        PlotPoint point;
+        point.time = time;
+        point.ax = static_cast<float>(sample.ax);
+        point.ay = static_cast<float>(sample.ay);
+        point.az = static_cast<float>(sample.az);
+        point.gx = static_cast<float>(sample.gx);
+        point.gy = static_cast<float>(sample.gy);
+        point.gz = static_cast<float>(sample.gz);
+        return point;
+    }
+
+    PlotHistory::PlotHistory(size_t maxPoints)
+        : m_maxPoints(maxPoints)
+    {
+        for (std::vector<float>* series : {
+                 &m_data.times,
+                 &m_data.ax_data, &m_data.ay_data, &m_data.az_data,
+                 &m_data.gx_data, &m_data.gy_data, &m_data.gz_data,
+                 &m_data.vx_data, &m_data.vy_data, &m_data.vz_data,
+                 &m_data.gravity_x_data, &m_data.gravity_y_data, &m_data.gravity_z_data,
+                 &m_data.linear_ax_data, &m_data.linear_ay_data, &m_data.linear_az_data}) {
+            series->reserve(maxPoints);
+        }
+    }
+
+    void PlotHistory::append(const PlotPoint& point) {
+        m_data.times.push_back(point.time);
+        m_data.ax_data.push_back(point.ax);
+        m_data.ay_data.push_back(point.ay);
+        m_data.az_data.push_back(point.az);
+        m_data.gx_data.push_back(point.gx);
+        m_data.gy_data.push_back(point.gy);
+        m_data.gz_data.push_back(point.gz);
+        m_data.vx_data.push_back(point.vx);
+        m_data.vy_data.push_back(point.vy);
+        m_data.vz_data.push_back(point.vz);
+        m_data.gravity_x_data.push_back(point.gravity_x);
+        m_data.gravity_y_data.push_back(point.gravity_y);
+        m_data.gravity_z_data.push_back(point.gravity_z);
+        m_data.linear_ax_data.push_back(point.linear_ax);
+        m_data.linear_ay_data.push_back(point.linear_ay);
+        m_data.linear_az_data.push_back(point.linear_az);
+    }
+
+    void PlotHistory::trim() {
+        if (m_data.times.size() <= m_maxPoints) return;
+
+        auto excess = static_cast<std::ptrdiff_t>(m_data.times.size() - m_maxPoints);
+        for (std::vector<float>* series : {
+                 &m_data.times,
+                 &m_data.ax_data, &m_data.ay_data, &m_data.az_data,
+                 &m_data.gx_data, &m_data.gy_data, &m_data.gz_data,
+                 &m_data.vx_data, &m_data.vy_data, &m_data.vz_data,
+                 &m_data.gravity_x_data, &m_data.gravity_y_data, &m_data.gravity_z_data,
+                 &m_data.linear_ax_data, &m_data.linear_ay_data, &m_data.linear_az_data}) {
+            series->erase(series->begin(), series->begin() + excess);
+        }
+    }
+
+    void PlotHistory::updateRanges() {
+        if (m_data.times.empty()) return;
+
+        m_ranges.accel = rangeOf(m_data.ax_data, m_data.ay_data, m_data.az_data);
+        m_ranges.gyro = rangeOf(m_data.gx_data, m_data.gy_data, m_data.gz_data);
+        m_ranges.velocity = rangeOf(m_data.vx_data, m_data.vy_data, m_data.vz_data);
+        m_ranges.gravity = rangeOf(m_data.gravity_x_data, m_data.gravity_y_data, m_data.gravity_z_data);
+        m_ranges.linear_accel = rangeOf(m_data.linear_ax_data, m_data.linear_ay_data, m_data.linear_az_data);
+    }
+
+    const SensorData& PlotHistory::data() const {
+        return m_data;
+    }
+
+    const DataRanges& PlotHistory::ranges() const {
+        return m_ranges;
+    }
+
+    size_t PlotHistory::size() const {
+        return m_data.times.size();
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "../libSerial/sample.h"
+#include "../libMetrics/latency_monitor.h"
+
+// Plot history without any window or GL code, so it can be benchmarked and
+// reused by front ends other than the ImGui one
+namespace Plot {
+    // Maximum number of data points to store
+    constexpr int MAX_POINTS = 1000;
+    
+    // One sample's worth of plot values, handed from the sensor thread to the renderer
+    struct PlotPoint {
+        float time = 0.0f;
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        float gx = 0.0f, gy = 0.0f, gz = 0.0f;
+        float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+        float gravity_x = 0.0f, gravity_y = 0.0f, gravity_z = 0.0f;
+        float linear_ax = 0.0f, linear_ay = 0.0f, linear_az = 0.0f;
+        Metrics::SampleTimes times;  // Stamps of the sample, if the caller passed them
+    };
+    
+    // Data structure to store sensor data for plotting (owned by the render thread)
+    struct SensorData {
+        std::vector<float> times;
+        
+        // Accelerometer data
+        std::vector<float> ax_data;
+        std::vector<float> ay_data;
+        std::vector<float> az_data;
+        
+        // Gyroscope data
+        std::vector<float> gx_data;
+        std::vector<float> gy_data;
+        std::vector<float> gz_data;
+        
+        // Velocity data
+        std::vector<float> vx_data;
+        std::vector<float> vy_data;
+        std::vector<float> vz_data;
+        
+        // Gravity vector data
+        std::vector<float> gravity_x_data;
+        std::vector<float> gravity_y_data;
+        std::vector<float> gravity_z_data;
+        
+        // Linear acceleration (gravity removed) data
+        std::vector<float> linear_ax_data;
+        std::vector<float> linear_ay_data;
+        std::vector<float> linear_az_data;
+    };
+    
+    // Smallest and largest value of a group of series
+    struct ValueRange {
+        float min = 0.0f;
+        float max = 0.0f;
+    };
+    
+    // Ranges the auto-fit axes follow
+    struct DataRanges {
+        ValueRange accel;
+        ValueRange gyro;
+        ValueRange velocity;
+        ValueRange gravity = { -10.0f, 10.0f };
+        ValueRange linear_accel;
+    };
+    
+    /**
+     * Copy a sample's raw readings into a plot point
+     * @param sample Sample to plot
+     * @param time Plot time in seconds
+     * @return Point with time, accelerometer and gyroscope filled in
+     */
+    PlotPoint toPlotPoint(const Serial::ImuSample& sample, float time);
+    
+    /**
+     * The last MAX_POINTS plot points as one array per series (what ImPlot
+     * draws from), plus each group's value range for auto-fitting
+     */
+    class PlotHistory {
+    public:
+        /**
+         * Constructor
+         * @param maxPoints Points kept by trim()
+         */
+        explicit PlotHistory(size_t maxPoints = MAX_POINTS);
+        
+        /**
+         * Add a point after the newest one
+         * @param point Point to add
+         */
+        void append(const PlotPoint& point);
+        
+        /**
+         * Drop the oldest points beyond the limit, a whole frame's excess at once
+         */
+        void trim();
+        
+        /**
+         * Recompute every group's range over the points kept
+         */
+        void updateRanges();
+        
+        /**
+         * Get the series
+         * @return Points kept, oldest first
+         */
+        const SensorData& data() const;
+        
+        /**
+         * Get the ranges from the last updateRanges()
+         * @return Ranges of each group
+         */
+        const DataRanges& ranges() const;
+        
+        /**
+         * Get the number of points kept
+         * @return Point count
+         */
+        size_t size() const;
+        
+    private:
+        SensorData m_data;
+        DataRanges m_ranges;
+        size_t m_maxPoints;
+    };
+}
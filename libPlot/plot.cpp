@@ -1,5 +1,7 @@
 #include "plot.h"
 #include "../libHand/hand.h"
+#include "../libSerial/clock_sync.h"
+#include "../libConcurrency/spsc_queue.h"
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
@@ -14,6 +16,7 @@ extern Hand::HandTracker g_tracker;
 namespace Plot {
     // Forward declarations
     void updateDataRanges();
+    void drainSampleQueue();
     void drawPlots();
     void drawControls();
 
@@ -24,7 +27,12 @@ namespace Plot {
 
     // Global variables
     static GLFWwindow* g_window = nullptr;
-    static SensorData g_sensor_data;
+    static PlotHistory g_history;
+    static const SensorData& g_sensor_data = g_history.data();
+    static Concurrency::SpscQueue<PlotPoint> g_sample_queue(SAMPLE_QUEUE_CAPACITY);
+    static size_t g_queue_peak = 0;
+    static Metrics::LatencyMonitor* g_latency = nullptr;
+    static std::vector<Metrics::SampleTimes> g_frame_times;  // Stamps of the points drawn this frame
     static bool g_initialized = false;
     static float g_plot_height = 300.0f;
     static bool g_auto_fit = true;
@@ -102,24 +110,6 @@ namespace Plot {
         ImGui_ImplGlfw_InitForOpenGL(g_window, true);
         ImGui_ImplOpenGL3_Init("#version 330 core");
 
-        // Initialize data
-        g_sensor_data.times.reserve(MAX_POINTS);
-        g_sensor_data.ax_data.reserve(MAX_POINTS);
-        g_sensor_data.ay_data.reserve(MAX_POINTS);
-        g_sensor_data.az_data.reserve(MAX_POINTS);
-        g_sensor_data.gx_data.reserve(MAX_POINTS);
-        g_sensor_data.gy_data.reserve(MAX_POINTS);
-        g_sensor_data.gz_data.reserve(MAX_POINTS);
-        g_sensor_data.vx_data.reserve(MAX_POINTS);
-        g_sensor_data.vy_data.reserve(MAX_POINTS);
-        g_sensor_data.vz_data.reserve(MAX_POINTS);
-        g_sensor_data.gravity_x_data.reserve(MAX_POINTS);
-        g_sensor_data.gravity_y_data.reserve(MAX_POINTS);
-        g_sensor_data.gravity_z_data.reserve(MAX_POINTS);
-        g_sensor_data.linear_ax_data.reserve(MAX_POINTS);
-        g_sensor_data.linear_ay_data.reserve(MAX_POINTS);
-        g_sensor_data.linear_az_data.reserve(MAX_POINTS);
-
         g_initialized = true;
         return true;
     }
@@ -146,135 +136,99 @@ namespace Plot {
         show_linear_accel = show_linear_accel_plot;
     }
 
-    void addDataPoint(const std::unordered_map<std::string, int>& sensor_data) {
-        if (!g_initialized) return;
-        
-        static float start_time = -1.0f;
-        float current_time = static_cast<float>(glfwGetTime());
-        
-        if (start_time < 0.0f) {
-            start_time = current_time;
-        }
-        
-        float time = current_time - start_time;
-        
-        std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
-        
-        // Add time
-        g_sensor_data.times.push_back(time);
-        
-        // Add accelerometer data
-        g_sensor_data.ax_data.push_back(static_cast<float>(sensor_data.count("ax") ? sensor_data.at("ax") : 0));
-        g_sensor_data.ay_data.push_back(static_cast<float>(sensor_data.count("ay") ? sensor_data.at("ay") : 0));
-        g_sensor_data.az_data.push_back(static_cast<float>(sensor_data.count("az") ? sensor_data.at("az") : 0));
-        
-        // Add gyroscope data
-        g_sensor_data.gx_data.push_back(static_cast<float>(sensor_data.count("gx") ? sensor_data.at("gx") : 0));
-        g_sensor_data.gy_data.push_back(static_cast<float>(sensor_data.count("gy") ? sensor_data.at("gy") : 0));
-        g_sensor_data.gz_data.push_back(static_cast<float>(sensor_data.count("gz") ? sensor_data.at("gz") : 0));
+    // Convert a map sample to the typed sample (missing keys read as 0)
+    static Serial::ImuSample sampleFromMap(const std::unordered_map<std::string, int>& sensor_data) {
+        Serial::ImuSample sample;
+        sample.ax = sensor_data.count("ax") ? sensor_data.at("ax") : 0;
+        sample.ay = sensor_data.count("ay") ? sensor_data.at("ay") : 0;
+        sample.az = sensor_data.count("az") ? sensor_data.at("az") : 0;
+        sample.gx = sensor_data.count("gx") ? sensor_data.at("gx") : 0;
+        sample.gy = sensor_data.count("gy") ? sensor_data.at("gy") : 0;
+        sample.gz = sensor_data.count("gz") ? sensor_data.at("gz") : 0;
+        return sample;
+    }
+
+    // Plot time in seconds: the sample's own timestamp when it has one, otherwise now
+    static float sampleTime(const Serial::ImuSample& sample) {
+        static int64_t start_ns = -1;
+        int64_t time_ns = sample.host_time_ns != 0 ? sample.host_time_ns : Serial::hostTimeNs();
         
-        // Get velocity data from the main application's tracker
-        Hand::Vector3D velocity = g_tracker.getVelocity();
-        g_sensor_data.vx_data.push_back(velocity.x);
-        g_sensor_data.vy_data.push_back(velocity.y);
-        g_sensor_data.vz_data.push_back(velocity.z);
-        
-        // Add placeholder data for gravity and linear acceleration
-        g_sensor_data.gravity_x_data.push_back(0.0f);
-        g_sensor_data.gravity_y_data.push_back(0.0f);
-        g_sensor_data.gravity_z_data.push_back(0.0f);
-        g_sensor_data.linear_ax_data.push_back(g_sensor_data.ax_data.back());
-        g_sensor_data.linear_ay_data.push_back(g_sensor_data.ay_data.back());
-        g_sensor_data.linear_az_data.push_back(g_sensor_data.az_data.back());
-        
-        // Limit the number of data points
-        if (g_sensor_data.times.size() > MAX_POINTS) {
-            g_sensor_data.times.erase(g_sensor_data.times.begin());
-            g_sensor_data.ax_data.erase(g_sensor_data.ax_data.begin());
-            g_sensor_data.ay_data.erase(g_sensor_data.ay_data.begin());
-            g_sensor_data.az_data.erase(g_sensor_data.az_data.begin());
-            g_sensor_data.gx_data.erase(g_sensor_data.gx_data.begin());
-            g_sensor_data.gy_data.erase(g_sensor_data.gy_data.begin());
-            g_sensor_data.gz_data.erase(g_sensor_data.gz_data.begin());
-            g_sensor_data.vx_data.erase(g_sensor_data.vx_data.begin());
-            g_sensor_data.vy_data.erase(g_sensor_data.vy_data.begin());
-            g_sensor_data.vz_data.erase(g_sensor_data.vz_data.begin());
-            g_sensor_data.gravity_x_data.erase(g_sensor_data.gravity_x_data.begin());
-            g_sensor_data.gravity_y_data.erase(g_sensor_data.gravity_y_data.begin());
-            g_sensor_data.gravity_z_data.erase(g_sensor_data.gravity_z_data.begin());
-            g_sensor_data.linear_ax_data.erase(g_sensor_data.linear_ax_data.begin());
-            g_sensor_data.linear_ay_data.erase(g_sensor_data.linear_ay_data.begin());
-            g_sensor_data.linear_az_data.erase(g_sensor_data.linear_az_data.begin());
+        if (start_ns < 0) {
+            start_ns = time_ns;
         }
         
-        // Update data ranges for auto-fitting
-        updateDataRanges();
+        return static_cast<float>((time_ns - start_ns) * 1e-9);
     }
-    
+
+    void addDataPoint(const std::unordered_map<std::string, int>& sensor_data) {
+        addDataPoint(sampleFromMap(sensor_data));
+    }
+
     void addDataPointWithGravity(const std::unordered_map<std::string, int>& sensor_data,
                               float gravity_x, float gravity_y, float gravity_z,
                               float linear_ax, float linear_ay, float linear_az) {
-        if (!g_initialized) return;
-        
-        static float start_time = -1.0f;
-        float current_time = static_cast<float>(glfwGetTime());
+        addDataPointWithGravity(sampleFromMap(sensor_data), gravity_x, gravity_y, gravity_z,
+                                linear_ax, linear_ay, linear_az);
+    }
+
+    // Fill the fields both add functions share, including the tracker's current velocity
+    static PlotPoint makePlotPoint(const Serial::ImuSample& sample) {
+        PlotPoint point = toPlotPoint(sample, sampleTime(sample));
         
-        if (start_time < 0.0f) {
-            start_time = current_time;
-        }
+        // Get velocity data from the main application's tracker (a published snapshot, safe from any thread)
+        Hand::Vector3D velocity = g_tracker.getVelocity();
+        point.vx = velocity.x;
+        point.vy = velocity.y;
+        point.vz = velocity.z;
+        return point;
+    }
+
+    void addDataPoint(const Serial::ImuSample& sample) {
+        if (!g_initialized) return;
         
-        float time = current_time - start_time;
+        PlotPoint point = makePlotPoint(sample);
         
-        std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
+        // No gravity estimate: linear acceleration is the raw reading
+        point.linear_ax = point.ax;
+        point.linear_ay = point.ay;
+        point.linear_az = point.az;
         
-        // Add time
-        g_sensor_data.times.push_back(time);
+        // Never blocks; a full queue drops the point and counts an overrun
+        g_sample_queue.tryPush(point);
+    }
+    
+    void addDataPointWithGravity(const Serial::ImuSample& sample,
+                              float gravity_x, float gravity_y, float gravity_z,
+                              float linear_ax, float linear_ay, float linear_az,
+                              const Metrics::SampleTimes* times) {
+        if (!g_initialized) return;
         
-        // Add accelerometer data
-        g_sensor_data.ax_data.push_back(static_cast<float>(sensor_data.count("ax") ? sensor_data.at("ax") : 0));
-        g_sensor_data.ay_data.push_back(static_cast<float>(sensor_data.count("ay") ? sensor_data.at("ay") : 0));
-        g_sensor_data.az_data.push_back(static_cast<float>(sensor_data.count("az") ? sensor_data.at("az") : 0));
+        PlotPoint point = makePlotPoint(sample);
+        if (times) point.times = *times;
+        point.gravity_x = gravity_x;
+        point.gravity_y = gravity_y;
+        point.gravity_z = gravity_z;
+        point.linear_ax = linear_ax;
+        point.linear_ay = linear_ay;
+        point.linear_az = linear_az;
         
-        // Add gyroscope data
-        g_sensor_data.gx_data.push_back(static_cast<float>(sensor_data.count("gx") ? sensor_data.at("gx") : 0));
-        g_sensor_data.gy_data.push_back(static_cast<float>(sensor_data.count("gy") ? sensor_data.at("gy") : 0));
-        g_sensor_data.gz_data.push_back(static_cast<float>(sensor_data.count("gz") ? sensor_data.at("gz") : 0));
+        g_sample_queue.tryPush(point);
+    }
+    
+    // Move everything the sensor thread queued into the plot history (render thread)
+    void drainSampleQueue() {
+        g_queue_peak = std::max(g_queue_peak, g_sample_queue.size());
+        
+        size_t added = g_sample_queue.drain([](const PlotPoint& point) {
+            g_history.append(point);
+            if (g_latency && point.times.arrival_ns != 0) {
+                g_frame_times.push_back(point.times);
+            }
+        });
+        if (added == 0) return;
         
-        // Get velocity data from the main application's tracker
-        Hand::Vector3D velocity = g_tracker.getVelocity();
-        g_sensor_data.vx_data.push_back(velocity.x);
-        g_sensor_data.vy_data.push_back(velocity.y);
-        g_sensor_data.vz_data.push_back(velocity.z);
-        
-        // Add gravity vector data
-        g_sensor_data.gravity_x_data.push_back(gravity_x);
-        g_sensor_data.gravity_y_data.push_back(gravity_y);
-        g_sensor_data.gravity_z_data.push_back(gravity_z);
-        
-        // Add linear acceleration data (acceleration with gravity removed)
-        g_sensor_data.linear_ax_data.push_back(linear_ax);
-        g_sensor_data.linear_ay_data.push_back(linear_ay);
-        g_sensor_data.linear_az_data.push_back(linear_az);
-        
-        // Limit the number of data points
-        if (g_sensor_data.times.size() > MAX_POINTS) {
-            g_sensor_data.times.erase(g_sensor_data.times.begin());
-            g_sensor_data.ax_data.erase(g_sensor_data.ax_data.begin());
-            g_sensor_data.ay_data.erase(g_sensor_data.ay_data.begin());
-            g_sensor_data.az_data.erase(g_sensor_data.az_data.begin());
-            g_sensor_data.gx_data.erase(g_sensor_data.gx_data.begin());
-            g_sensor_data.gy_data.erase(g_sensor_data.gy_data.begin());
-            g_sensor_data.gz_data.erase(g_sensor_data.gz_data.begin());
-            g_sensor_data.vx_data.erase(g_sensor_data.vx_data.begin());
-            g_sensor_data.vy_data.erase(g_sensor_data.vy_data.begin());
-            g_sensor_data.vz_data.erase(g_sensor_data.vz_data.begin());
-            g_sensor_data.gravity_x_data.erase(g_sensor_data.gravity_x_data.begin());
-            g_sensor_data.gravity_y_data.erase(g_sensor_data.gravity_y_data.begin());
-            g_sensor_data.gravity_z_data.erase(g_sensor_data.gravity_z_data.begin());
-            g_sensor_data.linear_ax_data.erase(g_sensor_data.linear_ax_data.begin());
-            g_sensor_data.linear_ay_data.erase(g_sensor_data.linear_ay_data.begin());
-            g_sensor_data.linear_az_data.erase(g_sensor_data.linear_az_data.begin());
-        }
+        // Limit the number of data points, trimming a whole frame's excess at once
+        g_history.trim();
         
         // Update data ranges for auto-fitting
         updateDataRanges();
@@ -282,87 +236,19 @@ namespace Plot {
     
     // Helper to update data ranges for auto-fitting
     void updateDataRanges() {
-        if (g_sensor_data.times.size() > 0) {
-            // Update accelerometer data range
-            float accel_min = std::min({
-                *std::min_element(g_sensor_data.ax_data.begin(), g_sensor_data.ax_data.end()),
-                *std::min_element(g_sensor_data.ay_data.begin(), g_sensor_data.ay_data.end()),
-                *std::min_element(g_sensor_data.az_data.begin(), g_sensor_data.az_data.end())
-            });
-            
-            float accel_max = std::max({
-                *std::max_element(g_sensor_data.ax_data.begin(), g_sensor_data.ax_data.end()),
-                *std::max_element(g_sensor_data.ay_data.begin(), g_sensor_data.ay_data.end()),
-                *std::max_element(g_sensor_data.az_data.begin(), g_sensor_data.az_data.end())
-            });
-            
-            g_accel_data_min = accel_min;
-            g_accel_data_max = accel_max;
-            
-            // Update gyroscope data range
-            float gyro_min = std::min({
-                *std::min_element(g_sensor_data.gx_data.begin(), g_sensor_data.gx_data.end()),
-                *std::min_element(g_sensor_data.gy_data.begin(), g_sensor_data.gy_data.end()),
-                *std::min_element(g_sensor_data.gz_data.begin(), g_sensor_data.gz_data.end())
-            });
-            
-            float gyro_max = std::max({
-                *std::max_element(g_sensor_data.gx_data.begin(), g_sensor_data.gx_data.end()),
-                *std::max_element(g_sensor_data.gy_data.begin(), g_sensor_data.gy_data.end()),
-                *std::max_element(g_sensor_data.gz_data.begin(), g_sensor_data.gz_data.end())
-            });
-            
-            g_gyro_data_min = gyro_min;
-            g_gyro_data_max = gyro_max;
-            
-            // Update velocity data range
-            float velocity_min = std::min({
-                *std::min_element(g_sensor_data.vx_data.begin(), g_sensor_data.vx_data.end()),
-                *std::min_element(g_sensor_data.vy_data.begin(), g_sensor_data.vy_data.end()),
-                *std::min_element(g_sensor_data.vz_data.begin(), g_sensor_data.vz_data.end())
-            });
-            
-            float velocity_max = std::max({
-                *std::max_element(g_sensor_data.vx_data.begin(), g_sensor_data.vx_data.end()),
-                *std::max_element(g_sensor_data.vy_data.begin(), g_sensor_data.vy_data.end()),
-                *std::max_element(g_sensor_data.vz_data.begin(), g_sensor_data.vz_data.end())
-            });
-            
-            g_velocity_data_min = velocity_min;
-            g_velocity_data_max = velocity_max;
-            
-            // Update gravity data range
-            float gravity_min = std::min({
-                *std::min_element(g_sensor_data.gravity_x_data.begin(), g_sensor_data.gravity_x_data.end()),
-                *std::min_element(g_sensor_data.gravity_y_data.begin(), g_sensor_data.gravity_y_data.end()),
-                *std::min_element(g_sensor_data.gravity_z_data.begin(), g_sensor_data.gravity_z_data.end())
-            });
-            
-            float gravity_max = std::max({
-                *std::max_element(g_sensor_data.gravity_x_data.begin(), g_sensor_data.gravity_x_data.end()),
-                *std::max_element(g_sensor_data.gravity_y_data.begin(), g_sensor_data.gravity_y_data.end()),
-                *std::max_element(g_sensor_data.gravity_z_data.begin(), g_sensor_data.gravity_z_data.end())
-            });
-            
-            g_gravity_data_min = gravity_min;
-            g_gravity_data_max = gravity_max;
-            
-            // Update linear acceleration data range
-            float linear_accel_min = std::min({
-                *std::min_element(g_sensor_data.linear_ax_data.begin(), g_sensor_data.linear_ax_data.end()),
-                *std::min_element(g_sensor_data.linear_ay_data.begin(), g_sensor_data.linear_ay_data.end()),
-                *std::min_element(g_sensor_data.linear_az_data.begin(), g_sensor_data.linear_az_data.end())
-            });
-            
-            float linear_accel_max = std::max({
-                *std::max_element(g_sensor_data.linear_ax_data.begin(), g_sensor_data.linear_ax_data.end()),
-                *std::max_element(g_sensor_data.linear_ay_data.begin(), g_sensor_data.linear_ay_data.end()),
-                *std::max_element(g_sensor_data.linear_az_data.begin(), g_sensor_data.linear_az_data.end())
-            });
-            
-            g_linear_accel_data_min = linear_accel_min;
-            g_linear_accel_data_max = linear_accel_max;
-        }
+        g_history.updateRanges();
+        
+        const DataRanges& ranges = g_history.ranges();
+        g_accel_data_min = ranges.accel.min;
+        g_accel_data_max = ranges.accel.max;
+        g_gyro_data_min = ranges.gyro.min;
+        g_gyro_data_max = ranges.gyro.max;
+        g_velocity_data_min = ranges.velocity.min;
+        g_velocity_data_max = ranges.velocity.max;
+        g_gravity_data_min = ranges.gravity.min;
+        g_gravity_data_max = ranges.gravity.max;
+        g_linear_accel_data_min = ranges.linear_accel.min;
+        g_linear_accel_data_max = ranges.linear_accel.max;
     }
 
     void drawPlots() {
@@ -384,13 +270,10 @@ namespace Plot {
         
         // Set the time range for the sliding window
         float latest_time = 0.0f;
-        {
-            std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
-            if (!g_sensor_data.times.empty()) {
-                latest_time = g_sensor_data.times.back();
-                g_x_min = latest_time - g_time_window;
-                g_x_max = latest_time;
-            }
+        if (!g_sensor_data.times.empty()) {
+            latest_time = g_sensor_data.times.back();
+            g_x_min = latest_time - g_time_window;
+            g_x_max = latest_time;
         }
         
         // Update Y axis limits based on auto-fit settings
@@ -442,7 +325,6 @@ namespace Plot {
                 ImPlot::SetupAxisLimits(ImAxis_X1, g_x_min, g_x_max, ImGuiCond_Always);
                 ImPlot::SetupAxisLimits(ImAxis_Y1, g_accel_y_min, g_accel_y_max, ImGuiCond_Always);
                 
-                std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
                 if (!g_sensor_data.times.empty()) {
                     ImPlot::SetNextLineStyle(X_AXIS_COLOR, 2.0f);
                     ImPlot::PlotLine("X", g_sensor_data.times.data(), g_sensor_data.ax_data.data(), g_sensor_data.times.size());
@@ -465,7 +347,6 @@ namespace Plot {
                 ImPlot::SetupAxisLimits(ImAxis_X1, g_x_min, g_x_max, ImGuiCond_Always);
                 ImPlot::SetupAxisLimits(ImAxis_Y1, g_gyro_y_min, g_gyro_y_max, ImGuiCond_Always);
                 
-                std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
                 if (!g_sensor_data.times.empty()) {
                     ImPlot::SetNextLineStyle(X_AXIS_COLOR, 2.0f);
                     ImPlot::PlotLine("X", g_sensor_data.times.data(), g_sensor_data.gx_data.data(), g_sensor_data.times.size());
@@ -488,7 +369,6 @@ namespace Plot {
                 ImPlot::SetupAxisLimits(ImAxis_X1, g_x_min, g_x_max, ImGuiCond_Always);
                 ImPlot::SetupAxisLimits(ImAxis_Y1, g_velocity_y_min, g_velocity_y_max, ImGuiCond_Always);
                 
-                std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
                 if (!g_sensor_data.times.empty()) {
                     ImPlot::SetNextLineStyle(X_AXIS_COLOR, 2.0f);
                     ImPlot::PlotLine("X", g_sensor_data.times.data(), g_sensor_data.vx_data.data(), g_sensor_data.times.size());
@@ -511,7 +391,6 @@ namespace Plot {
                 ImPlot::SetupAxisLimits(ImAxis_X1, g_x_min, g_x_max, ImGuiCond_Always);
                 ImPlot::SetupAxisLimits(ImAxis_Y1, g_gravity_y_min, g_gravity_y_max, ImGuiCond_Always);
                 
-                std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
                 if (!g_sensor_data.times.empty()) {
                     ImPlot::SetNextLineStyle(X_AXIS_COLOR, 2.0f);
                     ImPlot::PlotLine("X", g_sensor_data.times.data(), g_sensor_data.gravity_x_data.data(), g_sensor_data.times.size());
@@ -534,7 +413,6 @@ namespace Plot {
                 ImPlot::SetupAxisLimits(ImAxis_X1, g_x_min, g_x_max, ImGuiCond_Always);
                 ImPlot::SetupAxisLimits(ImAxis_Y1, g_linear_accel_y_min, g_linear_accel_y_max, ImGuiCond_Always);
                 
-                std::lock_guard<std::mutex> lock(g_sensor_data.mtx);
                 if (!g_sensor_data.times.empty()) {
                     ImPlot::SetNextLineStyle(X_AXIS_COLOR, 2.0f);
                     ImPlot::PlotLine("X", g_sensor_data.times.data(), g_sensor_data.linear_ax_data.data(), g_sensor_data.times.size());
@@ -565,6 +443,29 @@ namespace Plot {
             ImGui::Checkbox("Linear Acceleration", &show_linear_accel);
             
             ImGui::Separator();
+            QueueStats queue = getQueueStats();
+            ImGui::Text("Sample queue: %zu / %zu (peak %zu), %llu dropped", queue.occupancy, queue.capacity,
+                        queue.peak, static_cast<unsigned long long>(queue.overruns));
+            
+            ImGui::Separator();
+            
+            if (g_latency && ImGui::TreeNode("Latency (us)")) {
+                ImGui::Text("%-11s %8s %8s %8s %8s %8s", "", "count", "p50", "p99", "p99.9", "max");
+                for (size_t i = 0; i < Metrics::LATENCY_STAGE_COUNT; i++) {
+                    Metrics::LatencyStage stage = static_cast<Metrics::LatencyStage>(i);
+                    Metrics::LatencySummary s = g_latency->summary(stage);
+                    ImGui::Text("%-11s %8llu %8.1f %8.1f %8.1f %8.1f", Metrics::latencyStageName(stage),
+                                static_cast<unsigned long long>(s.count),
+                                s.p50 * 1e-3, s.p99 * 1e-3, s.p999 * 1e-3, s.max * 1e-3);
+                }
+                if (g_latency->overBudget()) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "End-to-end p99 over budget");
+                }
+                if (ImGui::Button("Reset")) {
+                    g_latency->reset();
+                }
+                ImGui::TreePop();
+            }
             
             if (ImGui::TreeNode("Accelerometer Y-Axis Settings")) {
                 ImGui::Checkbox("Auto-fit Y-Axis", &g_accel_auto_fit);
@@ -621,6 +522,9 @@ namespace Plot {
         // Poll events and handle
         glfwPollEvents();
         
+        // Take in the samples that arrived since the last frame
+        drainSampleQueue();
+        
         // Start new frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -656,10 +560,33 @@ namespace Plot {
         // Swap buffers
         glfwSwapBuffers(g_window);
         
+        // The points drained this frame are on screen now
+        if (g_latency && !g_frame_times.empty()) {
+            int64_t shown = Serial::hostTimeNs();
+            for (const Metrics::SampleTimes& times : g_frame_times) {
+                g_latency->recordOutput(times, shown);
+            }
+            g_frame_times.clear();
+        }
+        
         return true;
     }
 
     bool isWindowOpen() {
         return g_initialized && !glfwWindowShouldClose(g_window);
     }
+
+    void setLatencyMonitor(Metrics::LatencyMonitor* monitor) {
+        g_latency = monitor;
+        g_frame_times.reserve(SAMPLE_QUEUE_CAPACITY);
+    }
+
+    QueueStats getQueueStats() {
+        QueueStats stats;
+        stats.occupancy = g_sample_queue.size();
+        stats.peak = g_queue_peak;
+        stats.capacity = g_sample_queue.capacity();
+        stats.overruns = g_sample_queue.overruns();
+        return stats;
+    }
 } // namespace Plot 
\ No newline at end of file
@@ -3,7 +3,11 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
-#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include "../libSerial/sample.h"
+#include "../libMetrics/latency_monitor.h"
+#include "history.h"
 
 // Forward declaration
 namespace Hand {
@@ -16,40 +20,15 @@ namespace Uncoupler {
 }
 
 namespace Plot {
-    // Maximum number of data points to store
-    constexpr int MAX_POINTS = 1000;
+    // Points the sensor thread can queue ahead of the renderer (several seconds at 1 kHz)
+    constexpr size_t SAMPLE_QUEUE_CAPACITY = 4096;
     
-    // Data structure to store sensor data for plotting
-    struct SensorData {
-        std::vector<float> times;
-        
-        // Accelerometer data
-        std::vector<float> ax_data;
-        std::vector<float> ay_data;
-        std::vector<float> az_data;
-        
-        // Gyroscope data
-        std::vector<float> gx_data;
-        std::vector<float> gy_data;
-        std::vector<float> gz_data;
-        
-        // Velocity data
-        std::vector<float> vx_data;
-        std::vector<float> vy_data;
-        std::vector<float> vz_data;
-        
-        // Gravity vector data
-        std::vector<float> gravity_x_data;
-        std::vector<float> gravity_y_data;
-        std::vector<float> gravity_z_data;
-        
-        // Linear acceleration (gravity removed) data
-        std::vector<float> linear_ax_data;
-        std::vector<float> linear_ay_data;
-        std::vector<float> linear_az_data;
-        
-        // Mutex for thread-safe access
-        std::mutex mtx;
+    // Fill level of the sensor-to-renderer queue
+    struct QueueStats {
+        size_t occupancy = 0;  // Points waiting right now
+        size_t peak = 0;       // Most points found waiting at the start of a frame
+        size_t capacity = 0;
+        uint64_t overruns = 0; // Points dropped because the renderer fell behind
     };
     
     // Initialize plotting system
@@ -61,7 +40,8 @@ namespace Plot {
     // Configure which plots to show
     void configurePlots(bool show_accelerometer, bool show_gyroscope, bool show_velocity = false, bool show_gravity = false, bool show_linear_accel = false);
     
-    // Add data point for plotting
+    // Add data point for plotting. The add functions may be called from one
+    // thread other than the renderer; they never block (see getQueueStats)
     void addDataPoint(const std::unordered_map<std::string, int>& sensor_data);
     
     // Add data point with gravity and linear acceleration information
@@ -69,9 +49,23 @@ namespace Plot {
                               float gravity_x, float gravity_y, float gravity_z,
                               float linear_ax, float linear_ay, float linear_az);
     
+    // Typed-sample versions of the above (no map lookups)
+    void addDataPoint(const Serial::ImuSample& sample);
+    // Pass the sample's stamps to have its first frame on screen recorded as its output time
+    void addDataPointWithGravity(const Serial::ImuSample& sample,
+                              float gravity_x, float gravity_y, float gravity_z,
+                              float linear_ax, float linear_ay, float linear_az,
+                              const Metrics::SampleTimes* times = nullptr);
+    
+    // Latency monitor the renderer records into and shows in the controls (null = none)
+    void setLatencyMonitor(Metrics::LatencyMonitor* monitor);
+    
     // Render a new frame (call this in your main loop)
     bool renderFrame();
     
     // Check if the window is still open
     bool isWindowOpen();
+    
+    // Get the sensor-to-renderer queue's fill level and overruns
+    QueueStats getQueueStats();
 } 
\ No newline at end of file
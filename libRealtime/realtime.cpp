@@ -0,0 +1,329 @@
+#include "realtime.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace Realtime {
+
+    // Wakeups timed at startup when any option is given and --jitter-check is not
+    static const size_t DEFAULT_JITTER_WAKEUPS = 500;
+
+    // Gap between timed wakeups, about one sample at 1 kHz
+    static const std::chrono::microseconds JITTER_PERIOD(1000);
+
+    // Stack touched on each configured thread when prefaulting (well inside every platform's default)
+    static const size_t PREFAULT_STACK_BYTES = 128 * 1024;
+
+    static const size_t PAGE_BYTES = 4096;
+
+    const char* threadRoleName(ThreadRole role) {
+        switch (role) {
+            case ThreadRole::Ingest: return "ingest";
+            case ThreadRole::Worker: return "worker";
+            case ThreadRole::Render: return "render";
+            default:                 return "?";
+        }
+    }
+
+    // "2", "2,3" or "4-7,9"; false on anything else
+    static bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+        cpus.clear();
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos) end = text.size();
+            std::string item = text.substr(begin, end - begin);
+
+            char* rest = nullptr;
+            long first = std::strtol(item.c_str(), &rest, 10);
+            long last = first;
+            if (rest == item.c_str()) return false;
+            if (*rest == '-') {
+                const char* from = rest + 1;
+                last = std::strtol(from, &rest, 10);
+                if (rest == from) return false;
+            }
+            if (*rest != '\0' || first < 0 || last < first || last > 1023) return false;
+            for (long cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+            begin = end + 1;
+        }
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return !cpus.empty();
+    }
+
+    static std::string formatCpuList(const std::vector<int>& cpus) {
+        std::string text;
+        for (size_t i = 0; i < cpus.size(); i++) {
+            if (i > 0) text += ",";
+            text += std::to_string(cpus[i]);
+        }
+        return text;
+    }
+
+    static std::string errorText(int error) {
+        return std::string("failed (") + std::strerror(error) + ")";
+    }
+
+    static void setThreadName(const std::string& name) {
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+        (void)name;
+#endif
+    }
+
+    static std::string pinThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        return error == 0 ? "ok" : errorText(error) + ", left unpinned";
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) mask |= DWORD_PTR(1) << cpu;
+        }
+        return SetThreadAffinityMask(GetCurrentThread(), mask) != 0 ? "ok" : "failed, left unpinned";
+#else
+        (void)cpus;
+        return "not supported here, left unpinned";
+#endif
+    }
+
+    static std::string raisePriority(int priority) {
+#ifdef _WIN32
+        // No SCHED_FIFO; the highest class a normal process may ask for
+        (void)priority;
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? "ok (TIME_CRITICAL)"
+                                                                                     : "failed, normal priority";
+#else
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO),
+                                        std::min(priority, sched_get_priority_max(SCHED_FIFO)));
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        return error == 0 ? "ok" : errorText(error) + ", normal priority";
+#endif
+    }
+
+    static void prefaultStack() {
+        // Writes go through a volatile pointer so they are kept, and the
+        // compiler sees the buffer used
+        unsigned char stack[PREFAULT_STACK_BYTES];
+        volatile unsigned char* page = stack;
+        for (size_t i = 0; i < PREFAULT_STACK_BYTES; i += PAGE_BYTES) {
+            page[i] = 0;
+        }
+    }
+
+    // Sleep until an absolute steady-clock time
+    static void sleepUntil(std::chrono::steady_clock::time_point deadline) {
+#if defined(__linux__)
+        // libstdc++'s steady_clock is CLOCK_MONOTONIC; an absolute sleep avoids a second clock read
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec when;
+        when.tv_sec = static_cast<time_t>(ns / 1000000000);
+        when.tv_nsec = static_cast<long>(ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(deadline);
+#endif
+    }
+
+    RealtimeOptions::RealtimeOptions()
+        : m_enabled(false), m_priority(0), m_lockMemory(false), m_prefaultBytes(0),
+          m_jitterWakeups(0), m_jitterWakeupsSet(false), m_jitterPeriod(JITTER_PERIOD)
+    {
+    }
+
+    bool RealtimeOptions::parseOption(const std::string& option, const std::string& value) {
+        ThreadRole role;
+        if (option == "--cpu-ingest") {
+            role = ThreadRole::Ingest;
+        } else if (option == "--cpu-workers") {
+            role = ThreadRole::Worker;
+        } else if (option == "--cpu-render") {
+            role = ThreadRole::Render;
+        } else if (option == "--mlock") {
+            if (value != "on" && value != "off") {
+                std::cerr << "Ignoring " << option << " " << value << ": expected on or off" << std::endl;
+                return true;
+            }
+            m_lockMemory = value == "on";
+            m_enabled |= m_lockMemory;
+            return true;
+        } else if (option == "--rt-priority" || option == "--prefault-mb" || option == "--jitter-check") {
+            char* end = nullptr;
+            unsigned long number = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0') {
+                std::cerr << "Ignoring " << option << " " << value << ": not a number" << std::endl;
+                return true;
+            }
+            if (option == "--rt-priority") {
+                m_priority = static_cast<int>(std::min(number, 99ul));
+                m_enabled |= m_priority > 0;
+            } else if (option == "--prefault-mb") {
+                m_prefaultBytes = static_cast<size_t>(number) * 1024 * 1024;
+                m_enabled |= m_prefaultBytes > 0;
+            } else {
+                m_jitterWakeups = static_cast<size_t>(number);
+                m_jitterWakeupsSet = true;
+            }
+            return true;
+        } else {
+            return false;
+        }
+
+        std::vector<int> cpus;
+        if (!parseCpuList(value, cpus)) {
+            std::cerr << "Ignoring " << option << " " << value << ": expected a CPU list like 2 or 4-7" << std::endl;
+            return true;
+        }
+        m_cpus[static_cast<size_t>(role)] = cpus;
+        m_enabled = true;
+        return true;
+    }
+
+    bool RealtimeOptions::enabled() const {
+        return m_enabled;
+    }
+
+    void RealtimeOptions::applyToProcess() {
+        std::vector<std::string> outcomes;
+        if (m_lockMemory) {
+#ifdef _WIN32
+            outcomes.push_back("memory          mlockall: not supported on Windows, pages may be paged out");
+#else
+            bool locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+            outcomes.push_back(std::string("memory          mlockall: ")
+                               + (locked ? "ok" : errorText(errno) + ", pages may be paged out"));
+#endif
+        }
+
+        if (m_prefaultBytes > 0) {
+#ifdef __GLIBC__
+            // Keep freed memory in the heap (and serve large blocks from it) so the touched pages stay
+            bool kept = mallopt(M_TRIM_THRESHOLD, -1) == 1 && mallopt(M_MMAP_MAX, 0) == 1;
+#else
+            bool kept = false;
+#endif
+            unsigned char* block = static_cast<unsigned char*>(std::malloc(m_prefaultBytes));
+            if (block) {
+                for (size_t i = 0; i < m_prefaultBytes; i += PAGE_BYTES) {
+                    block[i] = 1;
+                }
+                std::free(block);
+            }
+            char line[128];
+            std::snprintf(line, sizeof(line), "memory          prefault %zu MiB heap: %s", m_prefaultBytes / (1024 * 1024),
+                          !block ? "failed (out of memory)"
+                                 : kept ? "ok" : "touched, but the allocator may hand it back to the OS");
+            outcomes.push_back(line);
+            prefaultStack();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_outcomes.insert(m_outcomes.end(), outcomes.begin(), outcomes.end());
+    }
+
+    std::string RealtimeOptions::applyRole(ThreadRole role, const std::string& name) const {
+        setThreadName(name);
+
+        std::string outcome;
+        const std::vector<int>& cpus = m_cpus[static_cast<size_t>(role)];
+        if (!cpus.empty()) {
+            outcome += "cpus " + formatCpuList(cpus) + ": " + pinThread(cpus);
+        }
+        if (role == ThreadRole::Ingest && m_priority > 0) {
+            if (!outcome.empty()) outcome += "; ";
+            outcome += "SCHED_FIFO " + std::to_string(m_priority) + ": " + raisePriority(m_priority);
+        }
+        if (m_prefaultBytes > 0) {
+            prefaultStack();
+            if (!outcome.empty()) outcome += "; ";
+            outcome += "stack prefaulted";
+        }
+        return outcome.empty() ? "left to the OS" : outcome;
+    }
+
+    void RealtimeOptions::applyToThisThread(ThreadRole role, const std::string& name) {
+        if (!m_enabled) return;
+
+        std::string label = std::string(threadRoleName(role));
+        if (role == ThreadRole::Worker) label += " " + name;
+        label.resize(std::max<size_t>(label.size() + 1, 16), ' ');
+        std::string outcome = applyRole(role, name);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_outcomes.push_back(label + outcome);
+    }
+
+    void RealtimeOptions::measureWakeupJitter() {
+        size_t wakeups = m_jitterWakeupsSet ? m_jitterWakeups : m_enabled ? DEFAULT_JITTER_WAKEUPS : 0;
+        if (wakeups == 0) return;
+
+        // Same settings as the ingest thread, on a thread of its own so nothing else inherits them
+        Metrics::LatencyHistogram histogram;
+        std::thread probe([this, wakeups, &histogram]() {
+            applyRole(ThreadRole::Ingest, "jitter-probe");
+            auto deadline = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < wakeups; i++) {
+                deadline += m_jitterPeriod;
+                sleepUntil(deadline);
+                auto now = std::chrono::steady_clock::now();
+                histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+
+                // After a stall, start over from now instead of firing the missed wakeups back to back
+                if (now - deadline > m_jitterPeriod) deadline = now;
+            }
+        });
+        probe.join();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jitter = histogram.summary();
+    }
+
+    void RealtimeOptions::report(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_enabled && m_jitter.count == 0) {
+            out << "real-time settings: none, scheduling left to the OS" << std::endl;
+            return;
+        }
+
+        out << "real-time settings" << std::endl;
+        for (const std::string& outcome : m_outcomes) {
+            out << "  " << outcome << std::endl;
+        }
+        if (m_jitter.count > 0) {
+            char line[160];
+            std::snprintf(line, sizeof(line),
+                          "  wakeup jitter   %llu x %lld us with ingest settings: p50 %.1f us, p99 %.1f us, "
+                          "p99.9 %.1f us, max %.1f us\n",
+                          static_cast<unsigned long long>(m_jitter.count), static_cast<long long>(m_jitterPeriod.count()),
+                          m_jitter.p50 * 1e-3, m_jitter.p99 * 1e-3, m_jitter.p999 * 1e-3, m_jitter.max * 1e-3);
+            out << line;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../libMetrics/latency_histogram.h"
+
+namespace Realtime {
+
+    // Threads the options can be aimed at
+    enum class ThreadRole {
+        Ingest,  // Reads the ports and runs the fused stages
+        Worker,  // Threaded and broadcast pipeline stages (the sinks)
+        Render,  // Draws the plots
+        Count
+    };
+
+    constexpr size_t THREAD_ROLE_COUNT = static_cast<size_t>(ThreadRole::Count);
+
+    /**
+     * Get a role's display name
+     * @param role Role
+     * @return Short lowercase name
+     */
+    const char* threadRoleName(ThreadRole role);
+
+    /**
+     * Scheduling and memory settings from the command line. Every setting is
+     * best effort: when the OS refuses one (no CAP_SYS_NICE or
+     * CAP_IPC_LOCK, RLIMIT_MEMLOCK too low, a CPU that is not there) the
+     * thread carries on as it was and the refusal is kept for report().
+     *
+     * Threads inherit affinity and policy from the thread that creates them,
+     * so apply a role on the thread itself, after it has started any threads
+     * that should not share its settings.
+     */
+    class RealtimeOptions {
+    public:
+        RealtimeOptions();
+
+        /**
+         * Take a real-time option if it is one
+         *   --cpu-ingest LIST  --cpu-workers LIST  --cpu-render LIST   (LIST like 2, 2,3 or 4-7)
+         *   --rt-priority N    SCHED_FIFO priority of the ingest thread
+         *   --mlock on|off     lock every current and future page in memory
+         *   --prefault-mb N    fault in and keep N MiB of heap, and each configured thread's stack
+         *   --jitter-check N   wakeups to time at startup (1 ms apart, default 500 once any option is given)
+         * @param option Option name
+         * @param value Argument that follows it
+         * @return True if the option was a real-time option (the caller skips the value)
+         */
+        bool parseOption(const std::string& option, const std::string& value);
+
+        /**
+         * Check whether any option was given
+         * @return False when every setting is left to the OS
+         */
+        bool enabled() const;
+
+        /**
+         * Lock and prefault memory; call once at startup, before the threads start
+         */
+        void applyToProcess();
+
+        /**
+         * Pin and prioritise the calling thread as configured for its role
+         * @param role What the thread does
+         * @param name Thread name for tools like top -H (truncated to 15 characters)
+         */
+        void applyToThisThread(ThreadRole role, const std::string& name);
+
+        /**
+         * Time --jitter-check wakeups on a probe thread with the ingest
+         * thread's settings (blocks for about that many milliseconds)
+         */
+        void measureWakeupJitter();
+
+        /**
+         * Print what was asked for, what took effect and the wakeup jitter
+         * @param out Stream to write to
+         */
+        void report(std::ostream& out) const;
+
+    private:
+        // Apply a role's settings to the calling thread; returns what happened
+        std::string applyRole(ThreadRole role, const std::string& name) const;
+
+        bool m_enabled;
+        std::vector<int> m_cpus[THREAD_ROLE_COUNT];  // Empty = leave affinity alone
+        int m_priority;                              // 0 = leave the policy alone
+        bool m_lockMemory;
+        size_t m_prefaultBytes;
+        size_t m_jitterWakeups;
+        bool m_jitterWakeupsSet;
+
+        // Filled in as threads apply their settings (from several threads)
+        mutable std::mutex m_mutex;
+        std::vector<std::string> m_outcomes;
+        Metrics::LatencySummary m_jitter;
+        std::chrono::microseconds m_jitterPeriod;
+    };
+}
@@ -0,0 +1,215 @@
+#include "capture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace Serial {
+
+    // On-disk record header: time_ns then size, packed (12 bytes)
+    static const size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+
+    CaptureSource::CaptureSource(std::unique_ptr<SerialSource> source, std::FILE* file)
+        : m_source(std::move(source)), m_file(file),
+          m_start(std::chrono::steady_clock::now()), m_capturedBytes(0)
+    {
+    }
+
+    CaptureSource::~CaptureSource() {
+        close();
+    }
+
+    std::unique_ptr<CaptureSource> CaptureSource::open(std::unique_ptr<SerialSource> source, const std::string& path) {
+        if (!source) return nullptr;
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to create capture file " << path << std::endl;
+            return nullptr;
+        }
+        if (std::fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), file) != sizeof(CAPTURE_MAGIC)) {
+            std::cerr << "Failed to write capture file " << path << std::endl;
+            std::fclose(file);
+            return nullptr;
+        }
+
+        std::cout << "Capturing raw bytes to " << path << "...\n";
+        return std::unique_ptr<CaptureSource>(new CaptureSource(std::move(source), file));
+    }
+
+    bool CaptureSource::isOpen() const {
+        return m_source->isOpen();
+    }
+
+    long CaptureSource::read(char* buffer, size_t size) {
+        long n = m_source->read(buffer, size);
+        if (n <= 0 || !m_file) return n;
+
+        // Timestamp as close to the read as possible; stdio buffers the write
+        CaptureRecord record;
+        record.time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start).count());
+        record.size = static_cast<uint32_t>(n);
+
+        std::fwrite(&record.time_ns, sizeof(record.time_ns), 1, m_file);
+        std::fwrite(&record.size, sizeof(record.size), 1, m_file);
+        std::fwrite(buffer, 1, static_cast<size_t>(n), m_file);
+        m_capturedBytes += static_cast<uint64_t>(n);
+        return n;
+    }
+
+    bool CaptureSource::waitReadable(int timeout_ms) {
+        return m_source->waitReadable(timeout_ms);
+    }
+
+    NativeHandle CaptureSource::nativeHandle() const {
+        return m_source->nativeHandle();
+    }
+
+    void CaptureSource::close() {
+        m_source->close();
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    // Commands go straight to the device; only the device-to-host direction is captured
+    long CaptureSource::write(const char* data, size_t size) {
+        return m_source->write(data, size);
+    }
+
+    bool CaptureSource::setBaudRate(unsigned int baudRate) {
+        return m_source->setBaudRate(baudRate);
+    }
+
+    uint64_t CaptureSource::capturedBytes() const {
+        return m_capturedBytes;
+    }
+
+    ReplaySource::ReplaySource(std::vector<char> bytes, std::vector<Chunk> chunks, ReplayPace pace)
+        : m_bytes(std::move(bytes)), m_chunks(std::move(chunks)), m_pace(pace),
+          m_chunk(0), m_chunkOffset(0), m_open(true), m_started(false)
+    {
+    }
+
+    std::unique_ptr<ReplaySource> ReplaySource::open(const std::string& path, ReplayPace pace) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            std::cerr << "Failed to open capture file " << path << std::endl;
+            return nullptr;
+        }
+
+        std::vector<char> contents;
+        char block[65536];
+        size_t n;
+        while ((n = std::fread(block, 1, sizeof(block), file)) > 0) {
+            contents.insert(contents.end(), block, block + n);
+        }
+        std::fclose(file);
+
+        if (contents.size() < sizeof(CAPTURE_MAGIC) ||
+            std::memcmp(contents.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+            std::cerr << "Not a capture file: " << path << std::endl;
+            return nullptr;
+        }
+
+        // Index the records; payloads are compacted so chunks are contiguous in memory
+        std::vector<char> bytes;
+        std::vector<Chunk> chunks;
+        bytes.reserve(contents.size());
+        size_t pos = sizeof(CAPTURE_MAGIC);
+        while (pos + RECORD_HEADER_SIZE <= contents.size()) {
+            CaptureRecord record;
+            std::memcpy(&record.time_ns, contents.data() + pos, sizeof(record.time_ns));
+            std::memcpy(&record.size, contents.data() + pos + sizeof(record.time_ns), sizeof(record.size));
+            pos += RECORD_HEADER_SIZE;
+
+            // A capture cut off mid-record (e.g. the app was killed) keeps what is whole
+            if (record.size > contents.size() - pos) break;
+
+            Chunk chunk;
+            chunk.time_ns = record.time_ns;
+            chunk.offset = bytes.size();
+            chunk.size = record.size;
+            bytes.insert(bytes.end(), contents.begin() + pos, contents.begin() + pos + record.size);
+            chunks.push_back(chunk);
+            pos += record.size;
+        }
+
+        std::cout << "Replaying " << chunks.size() << " reads (" << bytes.size() << " bytes) from " << path << "...\n";
+        return std::unique_ptr<ReplaySource>(new ReplaySource(std::move(bytes), std::move(chunks), pace));
+    }
+
+    bool ReplaySource::isOpen() const {
+        return m_open;
+    }
+
+    std::chrono::nanoseconds ReplaySource::untilDue() {
+        if (m_pace == ReplayPace::AsFastAsPossible) return std::chrono::nanoseconds(0);
+
+        if (!m_started) {
+            m_start = std::chrono::steady_clock::now();
+            m_started = true;
+        }
+        auto due = m_start + std::chrono::nanoseconds(m_chunks[m_chunk].time_ns);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(due - std::chrono::steady_clock::now());
+    }
+
+    long ReplaySource::read(char* buffer, size_t size) {
+        if (!m_open || m_chunk >= m_chunks.size()) return -1;
+
+        // Like a driver queue: everything that has arrived by now, up to the buffer size
+        size_t n = 0;
+        while (n < size && m_chunk < m_chunks.size() && untilDue().count() <= 0) {
+            const Chunk& chunk = m_chunks[m_chunk];
+            size_t take = std::min(size - n, chunk.size - m_chunkOffset);
+            std::memcpy(buffer + n, m_bytes.data() + chunk.offset + m_chunkOffset, take);
+            n += take;
+            m_chunkOffset += take;
+            if (m_chunkOffset == chunk.size) {
+                m_chunk++;
+                m_chunkOffset = 0;
+            }
+        }
+        return static_cast<long>(n);
+    }
+
+    bool ReplaySource::waitReadable(int timeout_ms) {
+        if (!m_open) return false;
+        // Exhausted: report readable so the next read() returns -1
+        if (m_chunk >= m_chunks.size()) return true;
+
+        std::chrono::nanoseconds wait = untilDue();
+        if (wait.count() <= 0) return true;
+        if (timeout_ms >= 0 && wait > std::chrono::milliseconds(timeout_ms)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return false;
+        }
+        std::this_thread::sleep_for(wait);
+        return true;
+    }
+
+    NativeHandle ReplaySource::nativeHandle() const {
+        return INVALID_NATIVE_HANDLE;
+    }
+
+    void ReplaySource::close() {
+        m_open = false;
+    }
+
+    void ReplaySource::rewind() {
+        m_chunk = 0;
+        m_chunkOffset = 0;
+        m_started = false;
+        m_open = true;
+    }
+
+    uint64_t ReplaySource::totalBytes() const {
+        return m_bytes.size();
+    }
+
+    uint64_t ReplaySource::durationNs() const {
+        return m_chunks.empty() ? 0 : m_chunks.back().time_ns;
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "serial_port.h"
+
+namespace Serial {
+
+    // First bytes of every capture file
+    constexpr char CAPTURE_MAGIC[8] = { 'M', 'C', 'E', 'C', 'A', 'P', '0', '1' };
+
+    // Each read() is stored as these two fields (packed, 12 bytes) followed by `size` raw bytes
+    struct CaptureRecord {
+        uint64_t time_ns;  // Arrival time relative to the start of the capture
+        uint32_t size;
+    };
+
+    /**
+     * Source decorator that tees every byte read from the wrapped port, with
+     * its arrival time, into a capture file. Waiting and the native handle
+     * are forwarded untouched, so it drops into an IngestMux like the port.
+     */
+    class CaptureSource : public SerialSource {
+    public:
+        ~CaptureSource() override;
+
+        /**
+         * Start capturing a source
+         * @param source Port to wrap (ownership is taken)
+         * @param path Capture file to create (overwritten if it exists)
+         * @return Capturing source, or nullptr if the file could not be created
+         */
+        static std::unique_ptr<CaptureSource> open(std::unique_ptr<SerialSource> source, const std::string& path);
+
+        bool isOpen() const override;
+        long read(char* buffer, size_t size) override;
+        bool waitReadable(int timeout_ms) override;
+        NativeHandle nativeHandle() const override;
+        void close() override;
+        long write(const char* data, size_t size) override;
+        bool setBaudRate(unsigned int baudRate) override;
+
+        /**
+         * Get the number of payload bytes written to the capture so far
+         * @return Captured byte count
+         */
+        uint64_t capturedBytes() const;
+
+    private:
+        CaptureSource(std::unique_ptr<SerialSource> source, std::FILE* file);
+
+        std::unique_ptr<SerialSource> m_source;
+        std::FILE* m_file;
+        std::chrono::steady_clock::time_point m_start;
+        uint64_t m_capturedBytes;
+    };
+
+    // How a replay hands out the recorded bytes
+    enum class ReplayPace {
+        Recorded,        // Each chunk becomes readable at its recorded arrival time
+        AsFastAsPossible // Every chunk is readable immediately
+    };
+
+    /**
+     * Source that plays a capture file back through the normal ingest path.
+     * A read returns every recorded byte that has "arrived" by now, the way a
+     * driver queue would. It has no OS handle to wait on (nativeHandle() is
+     * INVALID_NATIVE_HANDLE); IngestMux polls it instead.
+     */
+    class ReplaySource : public SerialSource {
+    public:
+        /**
+         * Load a capture file into memory
+         * @param path File written by CaptureSource
+         * @param pace Recorded timing or as fast as possible
+         * @return Replay source, or nullptr if the file is missing or malformed
+         */
+        static std::unique_ptr<ReplaySource> open(const std::string& path, ReplayPace pace = ReplayPace::Recorded);
+
+        bool isOpen() const override;
+
+        /**
+         * Read the next due bytes of the recording
+         * @return Bytes read, 0 if the next chunk is not due yet, -1 once the recording is exhausted
+         */
+        long read(char* buffer, size_t size) override;
+
+        bool waitReadable(int timeout_ms) override;
+        NativeHandle nativeHandle() const override;
+        void close() override;
+
+        /**
+         * Start the recording again from the first chunk (also reopens a finished replay)
+         */
+        void rewind();
+
+        /**
+         * Get the number of payload bytes in the recording
+         * @return Total byte count
+         */
+        uint64_t totalBytes() const;
+
+        /**
+         * Get the recorded duration
+         * @return Arrival time of the last chunk in nanoseconds
+         */
+        uint64_t durationNs() const;
+
+    private:
+        struct Chunk {
+            uint64_t time_ns;
+            size_t offset;
+            size_t size;
+        };
+
+        ReplaySource(std::vector<char> bytes, std::vector<Chunk> chunks, ReplayPace pace);
+
+        // Time until the current chunk is due (zero or negative when due)
+        std::chrono::nanoseconds untilDue();
+
+        std::vector<char> m_bytes;
+        std::vector<Chunk> m_chunks;
+        ReplayPace m_pace;
+        size_t m_chunk;        // Index of the chunk being handed out
+        size_t m_chunkOffset;  // Bytes of that chunk already returned
+        bool m_open;
+        bool m_started;        // Clock starts on the first wait or read, not at load
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
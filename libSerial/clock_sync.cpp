@@ -0,0 +1,166 @@
+#include "clock_sync.h"
+
+namespace Serial {
+
+    // Host nanoseconds per device microsecond for a perfect crystal
+    static const double NOMINAL_SLOPE = 1000.0;
+
+    // Below this many points the slope is not trusted and the nominal rate is used
+    static const size_t MIN_FIT_POINTS = 16;
+
+    // A jump in device time larger than this means the device restarted
+    static const int64_t RESYNC_GAP_US = 10000000;
+
+    ClockSync::ClockSync(size_t window, uint32_t bucket_us)
+        : m_points(window < MIN_FIT_POINTS ? MIN_FIT_POINTS : window),
+          m_bucketUs(bucket_us > 0 ? bucket_us : 1)
+    {
+        reset();
+    }
+
+    void ClockSync::reset() {
+        m_next = 0;
+        m_count = 0;
+        m_sinceRebase = 0;
+        m_lastDevice = 0;
+        m_hasLast = false;
+        m_bucketStart = 0;
+        m_bucketBest.device_us = 0;
+        m_bucketBest.host_ns = 0;
+        m_bucketOpen = false;
+        m_baseDevice = 0;
+        m_baseHost = 0;
+        m_sumX = m_sumY = m_sumXX = m_sumXY = 0.0;
+        m_slope = NOMINAL_SLOPE;
+        m_intercept = 0.0;
+    }
+
+    uint64_t ClockSync::unwrap(uint32_t device_us) const {
+        if (!m_hasLast) return device_us;
+        int32_t delta = static_cast<int32_t>(device_us - static_cast<uint32_t>(m_lastDevice));
+        return m_lastDevice + static_cast<int64_t>(delta);
+    }
+
+    int64_t ClockSync::update(uint32_t device_us, int64_t arrival_ns) {
+        uint64_t device = unwrap(device_us);
+        if (m_hasLast) {
+            int64_t jump = static_cast<int64_t>(device - m_lastDevice);
+            if (jump > RESYNC_GAP_US || jump < -RESYNC_GAP_US) {
+                reset();
+                device = device_us;
+            }
+        }
+        m_lastDevice = device;
+        m_hasLast = true;
+
+        // Close the bucket once it spans bucket_us of device time
+        if (m_bucketOpen && static_cast<int64_t>(device - m_bucketStart) >= static_cast<int64_t>(m_bucketUs)) {
+            addPoint(m_bucketBest.device_us, m_bucketBest.host_ns);
+            m_bucketOpen = false;
+        }
+
+        // Keep the observation with the least delay relative to the nominal rate
+        if (!m_bucketOpen) {
+            m_bucketStart = device;
+            m_bucketBest.device_us = device;
+            m_bucketBest.host_ns = arrival_ns;
+            m_bucketOpen = true;
+        } else {
+            double delay = static_cast<double>(arrival_ns - m_bucketBest.host_ns) -
+                           NOMINAL_SLOPE * static_cast<double>(static_cast<int64_t>(device - m_bucketBest.device_us));
+            if (delay < 0.0) {
+                m_bucketBest.device_us = device;
+                m_bucketBest.host_ns = arrival_ns;
+            }
+        }
+
+        return toHost(device_us);
+    }
+
+    void ClockSync::addPoint(uint64_t device_us, int64_t host_ns) {
+        if (m_count == 0) {
+            m_baseDevice = device_us;
+            m_baseHost = host_ns;
+        }
+
+        // Slide the window: drop the oldest point from the sums
+        if (m_count == m_points.size()) {
+            const Point& old = m_points[m_next];
+            double x = static_cast<double>(static_cast<int64_t>(old.device_us - m_baseDevice));
+            double y = static_cast<double>(old.host_ns - m_baseHost);
+            m_sumX -= x;
+            m_sumY -= y;
+            m_sumXX -= x * x;
+            m_sumXY -= x * y;
+        } else {
+            m_count++;
+        }
+
+        m_points[m_next].device_us = device_us;
+        m_points[m_next].host_ns = host_ns;
+        m_next = (m_next + 1) % m_points.size();
+
+        double x = static_cast<double>(static_cast<int64_t>(device_us - m_baseDevice));
+        double y = static_cast<double>(host_ns - m_baseHost);
+        m_sumX += x;
+        m_sumY += y;
+        m_sumXX += x * x;
+        m_sumXY += x * y;
+
+        // Re-centre once per window so the running sums never lose precision
+        if (++m_sinceRebase >= m_points.size()) {
+            rebase();
+        }
+
+        solve();
+    }
+
+    void ClockSync::rebase() {
+        size_t oldest = m_count == m_points.size() ? m_next : 0;
+        m_baseDevice = m_points[oldest].device_us;
+        m_baseHost = m_points[oldest].host_ns;
+        m_sumX = m_sumY = m_sumXX = m_sumXY = 0.0;
+
+        for (size_t i = 0; i < m_count; i++) {
+            const Point& point = m_points[(oldest + i) % m_points.size()];
+            double x = static_cast<double>(static_cast<int64_t>(point.device_us - m_baseDevice));
+            double y = static_cast<double>(point.host_ns - m_baseHost);
+            m_sumX += x;
+            m_sumY += y;
+            m_sumXX += x * x;
+            m_sumXY += x * y;
+        }
+        m_sinceRebase = 0;
+    }
+
+    void ClockSync::solve() {
+        double n = static_cast<double>(m_count);
+        double meanX = m_sumX / n;
+        double meanY = m_sumY / n;
+        double varX = m_sumXX - n * meanX * meanX;
+
+        m_slope = NOMINAL_SLOPE;
+        if (m_count >= MIN_FIT_POINTS && varX > 0.0) {
+            m_slope = (m_sumXY - n * meanX * meanY) / varX;
+        }
+        m_intercept = meanY - m_slope * meanX;
+    }
+
+    int64_t ClockSync::toHost(uint32_t device_us) const {
+        // No bucket finished yet: anchor on the best observation so far at the nominal rate
+        if (m_count == 0) {
+            double x = static_cast<double>(static_cast<int64_t>(unwrap(device_us) - m_bucketBest.device_us));
+            return m_bucketBest.host_ns + static_cast<int64_t>(NOMINAL_SLOPE * x);
+        }
+        double x = static_cast<double>(static_cast<int64_t>(unwrap(device_us) - m_baseDevice));
+        return m_baseHost + static_cast<int64_t>(m_intercept + m_slope * x);
+    }
+
+    double ClockSync::driftPpm() const {
+        return (NOMINAL_SLOPE / m_slope - 1.0) * 1e6;
+    }
+
+    size_t ClockSync::sampleCount() const {
+        return m_count;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Serial {
+
+    // Host steady_clock time in nanoseconds (the time base of ImuSample::host_time_ns)
+    inline int64_t hostTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Maps a device's micros() counter onto the host steady clock.
+     * Arrival times are grouped into short buckets of device time and the
+     * least-delayed sample of each bucket goes into a least-squares line over
+     * a sliding window of buckets. The slope tracks crystal drift and the
+     * intercept absorbs the offset plus the minimum transport latency.
+     * Samples mapped through the line keep the device's even spacing instead
+     * of the USB/scheduler jitter in their arrival times.
+     */
+    class ClockSync {
+    public:
+        /**
+         * Constructor
+         * @param window Number of buckets the fit covers
+         * @param bucket_us Device time per bucket in microseconds
+         */
+        explicit ClockSync(size_t window = 256, uint32_t bucket_us = 250000);
+
+        /**
+         * Add one observation and map it
+         * @param device_us Device timestamp (32-bit micros(), wraps every ~71 minutes)
+         * @param arrival_ns Host time the sample's bytes were read
+         * @return Host time of the reading in nanoseconds
+         */
+        int64_t update(uint32_t device_us, int64_t arrival_ns);
+
+        /**
+         * Map a device timestamp with the current fit (no new observation)
+         * @param device_us Device timestamp near the most recent one
+         * @return Host time in nanoseconds
+         */
+        int64_t toHost(uint32_t device_us) const;
+
+        /**
+         * Get the estimated device clock error
+         * @return Parts per million the device clock runs fast (+) or slow (-)
+         */
+        double driftPpm() const;
+
+        /**
+         * Get the number of buckets in the current fit
+         * @return Window fill level
+         */
+        size_t sampleCount() const;
+
+        /**
+         * Forget all observations (e.g. after the device rebooted)
+         */
+        void reset();
+
+    private:
+        // Extend a 32-bit timestamp to 64 bits relative to the last one seen
+        uint64_t unwrap(uint32_t device_us) const;
+
+        // Add a bucket's best observation to the fit
+        void addPoint(uint64_t device_us, int64_t host_ns);
+
+        // Rebuild the sums around the oldest point in the window
+        void rebase();
+
+        // Refresh slope and intercept from the sums
+        void solve();
+
+        struct Point {
+            uint64_t device_us;
+            int64_t host_ns;
+        };
+
+        std::vector<Point> m_points;  // Ring of recent bucket minima
+        uint32_t m_bucketUs;
+        size_t m_next;
+        size_t m_count;
+        size_t m_sinceRebase;
+
+        uint64_t m_lastDevice;        // Unwrapped device time of the latest observation
+        bool m_hasLast;
+
+        // Bucket being filled: when it started and its least-delayed observation
+        uint64_t m_bucketStart;
+        Point m_bucketBest;
+        bool m_bucketOpen;
+
+        // Sums of x = device - m_baseDevice (us) and y = host - m_baseHost (ns)
+        uint64_t m_baseDevice;
+        int64_t m_baseHost;
+        double m_sumX, m_sumY, m_sumXX, m_sumXY;
+
+        double m_slope;      // ns of host time per us of device time (1000 = no drift)
+        double m_intercept;  // ns, relative to m_baseHost at x = 0
+    };
+}
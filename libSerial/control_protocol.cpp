@@ -0,0 +1,202 @@
+#include "control_protocol.h"
+#include "wire_protocol.h"
+#include <cstdio>
+#include <cstring>
+
+namespace Serial {
+
+    // Share of the UART a stream may use, leaving room for reports and clock error
+    static const double LINK_HEADROOM = 0.9;
+
+    // UART rates the ESP32 and common USB bridges handle
+    static const uint32_t MIN_BAUD = 9600;
+    static const uint32_t MAX_BAUD = 2000000;
+
+    // Bits on the wire per byte (8N1)
+    static const uint32_t BITS_PER_BYTE = 10;
+
+    static inline void putUint32(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value & 0xFF);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+        out[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    static inline uint32_t getUint32(const uint8_t* in) {
+        return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+               (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+
+    // Add the CRC, COBS-encode and terminate a payload whose last two bytes are reserved for the CRC
+    static size_t finishFrame(uint8_t* payload, size_t size, uint8_t* out) {
+        uint16_t crc = crc16(payload, size - 2);
+        payload[size - 2] = static_cast<uint8_t>(crc & 0xFF);
+        payload[size - 1] = static_cast<uint8_t>(crc >> 8);
+
+        size_t length = cobsEncode(payload, size, out);
+        out[length++] = BINARY_FRAME_DELIMITER;
+        return length;
+    }
+
+    size_t encodeCommand(ControlCommand command, uint32_t value, uint8_t* out) {
+        uint8_t payload[CONTROL_COMMAND_PAYLOAD_SIZE];
+        payload[0] = static_cast<uint8_t>(command);
+        putUint32(payload + 1, value);
+        return finishFrame(payload, sizeof(payload), out);
+    }
+
+    bool decodeCommand(const uint8_t* payload, size_t size, ControlCommand& command, uint32_t& value) {
+        if (size != CONTROL_COMMAND_PAYLOAD_SIZE - 2) return false;
+        command = static_cast<ControlCommand>(payload[0]);
+        value = getUint32(payload + 1);
+        return true;
+    }
+
+    uint32_t maxRateForLink(const DeviceConfig& config) {
+        size_t frameBytes = config.binary ? BINARY_TIMED_SAMPLE_WIRE_SIZE : JSON_SAMPLE_MAX_SIZE;
+        return static_cast<uint32_t>(config.baud_rate * LINK_HEADROOM / (frameBytes * BITS_PER_BYTE));
+    }
+
+    uint8_t sampleRateDivider(const DeviceConfig& config) {
+        // The gyro output runs at 8 kHz with the DLPF disabled (0 or 7), otherwise 1 kHz
+        uint32_t base = (config.dlpf == 0 || config.dlpf == 7) ? 8000 : 1000;
+        uint32_t rate = config.rate_hz > 0 ? config.rate_hz : 1;
+        uint32_t divider = base / rate;
+        divider = divider > 0 ? divider - 1 : 0;
+        return static_cast<uint8_t>(divider > 255 ? 255 : divider);
+    }
+
+    ControlStatus applyCommand(DeviceConfig& config, ControlCommand command, uint32_t value) {
+        DeviceConfig next = config;
+        switch (command) {
+            case ControlCommand::GetConfig:
+                return ControlStatus::Ok;
+            case ControlCommand::SetRate:
+                if (value < 1 || value > MAX_OUTPUT_RATE_HZ) return ControlStatus::BadValue;
+                next.rate_hz = static_cast<uint16_t>(value);
+                break;
+            case ControlCommand::SetFilter:
+                if (value > 6) return ControlStatus::BadValue;
+                next.dlpf = static_cast<uint8_t>(value);
+                break;
+            case ControlCommand::SetAccelRange:
+                if (value > 3) return ControlStatus::BadValue;
+                next.accel_range = static_cast<uint8_t>(value);
+                break;
+            case ControlCommand::SetGyroRange:
+                if (value > 3) return ControlStatus::BadValue;
+                next.gyro_range = static_cast<uint8_t>(value);
+                break;
+            case ControlCommand::SetBaud:
+                if (value < MIN_BAUD || value > MAX_BAUD) return ControlStatus::BadValue;
+                next.baud_rate = value;
+                break;
+            case ControlCommand::SetFormat:
+                if (value > 1) return ControlStatus::BadValue;
+                next.binary = value == 1;
+                break;
+            default:
+                return ControlStatus::Unknown;
+        }
+
+        // Never accept a setting that makes the stream overrun the UART
+        if (next.rate_hz > maxRateForLink(next)) return ControlStatus::LinkTooSlow;
+
+        config = next;
+        return ControlStatus::Ok;
+    }
+
+    size_t encodeConfigReport(const ConfigReport& report, bool binary, char* out) {
+        const DeviceConfig& config = report.config;
+
+        if (binary) {
+            uint8_t payload[CONFIG_REPORT_PAYLOAD_SIZE];
+            payload[0] = BINARY_TYPE_CONFIG;
+            payload[1] = static_cast<uint8_t>(report.command);
+            payload[2] = static_cast<uint8_t>(report.status);
+            payload[3] = static_cast<uint8_t>(config.rate_hz & 0xFF);
+            payload[4] = static_cast<uint8_t>(config.rate_hz >> 8);
+            payload[5] = config.dlpf;
+            payload[6] = config.accel_range;
+            payload[7] = config.gyro_range;
+            payload[8] = config.binary ? 1 : 0;
+            putUint32(payload + 9, config.baud_rate);
+            return finishFrame(payload, sizeof(payload), reinterpret_cast<uint8_t*>(out));
+        }
+
+        int length = std::snprintf(out, CONFIG_REPORT_MAX_SIZE,
+            "{\"cfg\":%u,\"st\":%u,\"rate\":%u,\"dlpf\":%u,\"ar\":%u,\"gr\":%u,\"fmt\":%u,\"baud\":%lu}\n",
+            static_cast<unsigned>(report.command), static_cast<unsigned>(report.status),
+            static_cast<unsigned>(config.rate_hz), static_cast<unsigned>(config.dlpf),
+            static_cast<unsigned>(config.accel_range), static_cast<unsigned>(config.gyro_range),
+            config.binary ? 1u : 0u, static_cast<unsigned long>(config.baud_rate));
+        return length > 0 ? static_cast<size_t>(length) : 0;
+    }
+
+    // Read "key":unsigned pairs from a JSON report; false if any other shape is found
+    static bool parseJsonReport(const char* p, const char* end, ConfigReport& report) {
+        enum : unsigned { HAS_CFG = 1, HAS_ST = 2, HAS_RATE = 4, HAS_BAUD = 8, HAS_ALL = 15 };
+        unsigned seen = 0;
+
+        if (p >= end || *p++ != '{') return false;
+        while (p < end && *p != '}') {
+            if (*p++ != '"') return false;
+            const char* key = p;
+            while (p < end && *p != '"') p++;
+            if (end - p < 2 || p[1] != ':') return false;
+            size_t keyLength = static_cast<size_t>(p - key);
+            p += 2;
+
+            unsigned long value = 0;
+            const char* digits = p;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10 + static_cast<unsigned long>(*p++ - '0');
+                if (p - digits > 10) return false;
+            }
+            if (p == digits) return false;
+            if (p < end && *p == ',') p++;
+
+            if (keyLength == 3 && std::memcmp(key, "cfg", 3) == 0) {
+                report.command = static_cast<ControlCommand>(value);
+                seen |= HAS_CFG;
+            } else if (keyLength == 2 && std::memcmp(key, "st", 2) == 0) {
+                report.status = static_cast<ControlStatus>(value);
+                seen |= HAS_ST;
+            } else if (keyLength == 4 && std::memcmp(key, "rate", 4) == 0) {
+                report.config.rate_hz = static_cast<uint16_t>(value);
+                seen |= HAS_RATE;
+            } else if (keyLength == 4 && std::memcmp(key, "dlpf", 4) == 0) {
+                report.config.dlpf = static_cast<uint8_t>(value);
+            } else if (keyLength == 2 && std::memcmp(key, "ar", 2) == 0) {
+                report.config.accel_range = static_cast<uint8_t>(value);
+            } else if (keyLength == 2 && std::memcmp(key, "gr", 2) == 0) {
+                report.config.gyro_range = static_cast<uint8_t>(value);
+            } else if (keyLength == 3 && std::memcmp(key, "fmt", 3) == 0) {
+                report.config.binary = value == 1;
+            } else if (keyLength == 4 && std::memcmp(key, "baud", 4) == 0) {
+                report.config.baud_rate = static_cast<uint32_t>(value);
+                seen |= HAS_BAUD;
+            }
+        }
+        return seen == HAS_ALL;
+    }
+
+    bool decodeConfigReport(const Frame& frame, ConfigReport& report) {
+        if (frame.type == FrameType::Json) {
+            return parseJsonReport(frame.data, frame.data + frame.size, report);
+        }
+
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(frame.data);
+        if (frame.size != CONFIG_REPORT_PAYLOAD_SIZE - 2 || payload[0] != BINARY_TYPE_CONFIG) return false;
+
+        report.command = static_cast<ControlCommand>(payload[1]);
+        report.status = static_cast<ControlStatus>(payload[2]);
+        report.config.rate_hz = static_cast<uint16_t>(payload[3] | (payload[4] << 8));
+        report.config.dlpf = payload[5];
+        report.config.accel_range = payload[6];
+        report.config.gyro_range = payload[7];
+        report.config.binary = payload[8] == 1;
+        report.config.baud_rate = getUint32(payload + 9);
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "frame_decoder.h"
+
+// Host-to-device control channel shared with esp32-files/src/main.cpp.
+//
+// Commands always travel as COBS/CRC16 frames (see wire_protocol.h):
+//     type u8 | value u32 | crc16 u16
+// The device answers every command with a config report in its current
+// output format, so the report sits in the sample stream like any frame:
+//     type 0x03 u8 | command u8 | status u8 | rate u16 | dlpf u8 |
+//     accel_range u8 | gyro_range u8 | format u8 | baud u32 | crc16 u16
+// or as a JSON line
+//     {"cfg":17,"st":0,"rate":200,"dlpf":3,"ar":0,"gr":0,"fmt":0,"baud":115200}
+// A report for SetFormat or SetBaud is the last frame sent the old way.
+namespace Serial {
+
+    // Command type tags (value meaning in brackets)
+    enum class ControlCommand : uint8_t {
+        GetConfig = 0x10,      // Report only (ignored)
+        SetRate = 0x11,        // Output data rate [Hz]
+        SetFilter = 0x12,      // MPU6050 DLPF_CFG [0..6]
+        SetAccelRange = 0x13,  // AFS_SEL [0..3] = +-2/4/8/16 g
+        SetGyroRange = 0x14,   // FS_SEL [0..3] = +-250/500/1000/2000 deg/s
+        SetBaud = 0x15,        // UART rate [bits/s]
+        SetFormat = 0x16       // 0 = JSON lines, 1 = binary frames
+    };
+
+    // Outcome carried in a config report
+    enum class ControlStatus : uint8_t {
+        Ok = 0,
+        BadValue = 1,     // Out of range for the sensor or UART
+        LinkTooSlow = 2,  // The baud rate cannot carry the requested stream
+        Unknown = 3       // Command type not recognised
+    };
+
+    constexpr uint8_t BINARY_TYPE_CONFIG = 0x03;
+
+    // Sizes at each stage
+    constexpr size_t CONTROL_COMMAND_PAYLOAD_SIZE = 1 + 4 + 2;
+    constexpr size_t CONTROL_COMMAND_WIRE_SIZE = CONTROL_COMMAND_PAYLOAD_SIZE + 2;
+    constexpr size_t CONFIG_REPORT_PAYLOAD_SIZE = 1 + 1 + 1 + 2 + 4 * 1 + 4 + 2;
+    constexpr size_t CONFIG_REPORT_MAX_SIZE = 128;  // Either format, including terminator
+
+    // Longest JSON sample line the firmware prints (all fields at their widest)
+    constexpr size_t JSON_SAMPLE_MAX_SIZE = 100;
+
+    // Fastest output rate the MPU6050 accelerometer supports
+    constexpr uint16_t MAX_OUTPUT_RATE_HZ = 1000;
+
+    // Sensor and link settings of one device
+    struct DeviceConfig {
+        uint16_t rate_hz = 50;
+        uint8_t dlpf = 0;
+        uint8_t accel_range = 0;
+        uint8_t gyro_range = 0;
+        bool binary = false;
+        uint32_t baud_rate = 115200;
+    };
+
+    // A device's answer to one command
+    struct ConfigReport {
+        ControlCommand command = ControlCommand::GetConfig;
+        ControlStatus status = ControlStatus::Ok;
+        DeviceConfig config;  // Settings in force after the command
+    };
+
+    /**
+     * Build a command frame including the trailing delimiter
+     * @param command Command type
+     * @param value Argument (see ControlCommand)
+     * @param out Destination, at least CONTROL_COMMAND_WIRE_SIZE bytes
+     * @return Number of bytes written
+     */
+    size_t encodeCommand(ControlCommand command, uint32_t value, uint8_t* out);
+
+    /**
+     * Unpack a decoded, CRC-checked command payload (device side)
+     * @param payload Payload bytes (CRC already stripped)
+     * @param size Payload length
+     * @param command Receives the type tag, even if unknown
+     * @param value Receives the argument
+     * @return True if the payload has the command layout
+     */
+    bool decodeCommand(const uint8_t* payload, size_t size, ControlCommand& command, uint32_t& value);
+
+    /**
+     * Apply a command the way the firmware does: validate it and update config
+     * @param config Current settings, changed only if the command is accepted
+     * @param command Command type
+     * @param value Argument
+     * @return Outcome to report
+     */
+    ControlStatus applyCommand(DeviceConfig& config, ControlCommand command, uint32_t value);
+
+    /**
+     * Get the fastest output rate a UART can carry in the configured format
+     * @param config Settings to check (format and baud rate)
+     * @return Samples per second that fit in the link with some headroom
+     */
+    uint32_t maxRateForLink(const DeviceConfig& config);
+
+    /**
+     * Get the MPU6050 SMPLRT_DIV register value for an output rate
+     * @param config Settings (rate and DLPF, which sets the 1 or 8 kHz base rate)
+     * @return Divider; the sensor then samples at base / (1 + divider)
+     */
+    uint8_t sampleRateDivider(const DeviceConfig& config);
+
+    /**
+     * Build a config report
+     * @param report Report to send
+     * @param binary Format to send it in (the one in force before the command)
+     * @param out Destination, at least CONFIG_REPORT_MAX_SIZE bytes
+     * @return Number of bytes written (JSON line with '\n' or binary frame with delimiter)
+     */
+    size_t encodeConfigReport(const ConfigReport& report, bool binary, char* out);
+
+    /**
+     * Recognise a config report among decoded frames (host side)
+     * @param frame Frame from a FrameDecoder
+     * @param report Receives the report
+     * @return True if the frame is a well-formed report
+     */
+    bool decodeConfigReport(const Frame& frame, ConfigReport& report);
+}
@@ -0,0 +1,64 @@
+#include "device_setup.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace Serial {
+
+    bool DeviceSetup::parseOption(const std::string& option, const std::string& value) {
+        ControlCommand command;
+        if (option == "--format") {
+            m_commands.emplace_back(ControlCommand::SetFormat, value == "binary" ? 1u : 0u);
+            return true;
+        } else if (option == "--baud") {
+            command = ControlCommand::SetBaud;
+        } else if (option == "--dlpf") {
+            command = ControlCommand::SetFilter;
+        } else if (option == "--accel-range") {
+            command = ControlCommand::SetAccelRange;
+        } else if (option == "--gyro-range") {
+            command = ControlCommand::SetGyroRange;
+        } else if (option == "--rate") {
+            command = ControlCommand::SetRate;
+        } else {
+            return false;
+        }
+
+        // The device range-checks the value; only reject what is not a number
+        char* end = nullptr;
+        unsigned long number = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            std::cerr << "Ignoring " << option << " " << value << ": not a number" << std::endl;
+            return true;
+        }
+        m_commands.emplace_back(command, static_cast<uint32_t>(number));
+        return true;
+    }
+
+    void DeviceSetup::start(IngestMux& mux, std::function<void(int, const ConfigReport&)> onReport) {
+        std::stable_sort(m_commands.begin(), m_commands.end(),
+            [](const std::pair<ControlCommand, uint32_t>& a, const std::pair<ControlCommand, uint32_t>& b) {
+                auto order = [](ControlCommand command) {
+                    return command == ControlCommand::SetFormat ? 0 : command == ControlCommand::SetBaud ? 1 : 2;
+                };
+                return order(a.first) < order(b.first);
+            });
+        m_step.assign(mux.deviceCount(), 0);
+
+        // Each report triggers the next command
+        mux.setConfigCallback([this, &mux, onReport](int id, const ConfigReport& report) {
+            if (onReport) onReport(id, report);
+            if (m_step[id] < m_commands.size()) {
+                const std::pair<ControlCommand, uint32_t>& next = m_commands[m_step[id]++];
+                mux.sendCommand(id, next.first, next.second);
+            }
+        });
+
+        for (size_t i = 0; i < mux.deviceCount() && !m_commands.empty(); i++) {
+            const std::pair<ControlCommand, uint32_t>& first = m_commands[m_step[i]++];
+            if (!mux.sendCommand(static_cast<int>(i), first.first, first.second)) {
+                std::cerr << "Device " << i << " does not accept commands; keeping its settings." << std::endl;
+            }
+        }
+    }
+}
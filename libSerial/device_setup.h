@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "control_protocol.h"
+#include "ingest_mux.h"
+
+namespace Serial {
+
+    /**
+     * Device settings requested on the command line. The commands are sent
+     * one at a time, each after the previous report, so a baud switch never
+     * cuts a command in half; format and baud go first so a higher rate fits
+     * the link.
+     */
+    class DeviceSetup {
+    public:
+        /**
+         * Take a device option if it is one
+         *   --format json|binary  --baud N  --dlpf N  --accel-range N  --gyro-range N  --rate HZ
+         * @param option Option name
+         * @param value Argument that follows it
+         * @return True if the option was a device option (the caller skips the value)
+         */
+        bool parseOption(const std::string& option, const std::string& value);
+
+        /**
+         * Send the first command to every device and chain the rest through
+         * the mux's config callback. The setup must outlive the mux's polling.
+         * @param mux Mux with every source added
+         * @param onReport Called for every report before the next command goes out
+         */
+        void start(IngestMux& mux, std::function<void(int, const ConfigReport&)> onReport);
+
+    private:
+        std::vector<std::pair<ControlCommand, uint32_t>> m_commands;
+        std::vector<size_t> m_step;  // Next command per device
+    };
+}
@@ -0,0 +1,231 @@
+#include "frame_decoder.h"
+#include "wire_protocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Serial {
+
+    static_assert((DECODER_CAPACITY & (DECODER_CAPACITY - 1)) == 0, "DECODER_CAPACITY must be a power of two");
+    static_assert(MAX_FRAME_SIZE < DECODER_CAPACITY, "A full frame must fit in the ring");
+
+    FrameDecoder::FrameDecoder()
+        : m_start(0), m_head(0), m_tail(0), m_scanned(0), m_zeroScanned(0),
+          m_frameEnd(0), m_inFrame(false), m_binaryMode(false), m_skipLineEnd(false)
+    {
+    }
+
+    size_t FrameDecoder::write(const char* data, size_t size) {
+        size_t n = std::min(size, DECODER_CAPACITY - buffered());
+        size_t offset = m_tail & (DECODER_CAPACITY - 1);
+        size_t first = std::min(n, DECODER_CAPACITY - offset);
+
+        std::memcpy(m_ring + offset, data, first);
+        std::memcpy(m_ring, data + first, n - first);
+
+        m_tail += n;
+
+        m_stats.bytes_in += n;
+        m_stats.overflow_bytes += size - n;
+        m_stats.high_water = std::max(m_stats.high_water, buffered());
+        return n;
+    }
+
+    size_t FrameDecoder::find(char c, size_t from, size_t to) const {
+        // At most two contiguous segments; memchr is vectorised by the C library
+        while (from < to) {
+            size_t offset = from & (DECODER_CAPACITY - 1);
+            size_t length = std::min(to - from, DECODER_CAPACITY - offset);
+            const void* hit = std::memchr(m_ring + offset, c, length);
+            if (hit) {
+                return from + (static_cast<const char*>(hit) - (m_ring + offset));
+            }
+            from += length;
+        }
+        return to;
+    }
+
+    void FrameDecoder::copyOut(size_t from, size_t size, char* out) const {
+        size_t offset = from & (DECODER_CAPACITY - 1);
+        size_t first = std::min(size, DECODER_CAPACITY - offset);
+        std::memcpy(out, m_ring + offset, first);
+        std::memcpy(out + first, m_ring, size - first);
+    }
+
+    bool FrameDecoder::takeBinary(size_t delimiter, Frame& frame) {
+        size_t size = delimiter - m_start;
+        size_t from = m_start;
+
+        // Consume the candidate and its delimiter whether or not it decodes
+        m_start = m_head = m_scanned = m_zeroScanned = m_frameEnd = delimiter + 1;
+        m_inFrame = false;
+
+        size_t decoded = 0;
+        if (size >= 3 && size <= MAX_FRAME_SIZE) {
+            copyOut(from, size, m_encoded);
+            decoded = cobsDecode(reinterpret_cast<const uint8_t*>(m_encoded), size,
+                                 reinterpret_cast<uint8_t*>(m_scratch));
+        }
+
+        // CRC is stored little-endian after the payload
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(m_scratch);
+        if (decoded < 3 ||
+            crc16(payload, decoded - 2) != static_cast<uint16_t>(payload[decoded - 2] | (payload[decoded - 1] << 8))) {
+            m_stats.crc_failures++;
+            m_stats.discarded_bytes += size + 1;
+            return false;
+        }
+
+        frame.type = FrameType::Binary;
+        frame.data = m_scratch;
+        frame.size = decoded - 2;
+        m_stats.frames++;
+        return true;
+    }
+
+    bool FrameDecoder::next(Frame& frame) {
+        while (true) {
+            // Bytes that far behind the JSON cursor are too old to start a binary frame
+            if (m_head - m_start > MAX_FRAME_SIZE) {
+                m_start = m_head - MAX_FRAME_SIZE;
+            }
+
+            // Next delimiter; JSON frames can never span one
+            size_t zero = find(static_cast<char>(BINARY_FRAME_DELIMITER), std::max(m_zeroScanned, m_start), m_tail);
+            m_zeroScanned = zero;
+
+            if (m_binaryMode) {
+                // The text line before a format switch ends in a terminator that is not part of the first binary frame
+                while (m_skipLineEnd && m_start < m_tail) {
+                    char c = m_ring[m_start & (DECODER_CAPACITY - 1)];
+                    if (c != '\r' && c != '\n') {
+                        m_skipLineEnd = false;
+                        break;
+                    }
+                    m_start++;
+                    m_head = m_frameEnd = m_start;
+                }
+
+                // No delimiter within a frame's worth of bytes: the device went back to
+                // text, even if a later binary frame is already buffered
+                if (zero - m_start > MAX_FRAME_SIZE) {
+                    m_binaryMode = false;
+                    m_head = m_start;
+                    continue;
+                }
+                if (zero < m_tail) {
+                    if (takeBinary(zero, frame)) return true;
+                    continue;
+                }
+                return false;
+            }
+
+            if (!m_inFrame) {
+                // Resynchronise: skip everything up to the next opening brace
+                m_head = find('{', m_head, zero);
+                if (m_head == zero) {
+                    if (zero < m_tail) {
+                        if (takeBinary(zero, frame)) {
+                            m_binaryMode = true;
+                            return true;
+                        }
+                        continue;
+                    }
+                    // Only garbage buffered: keep one frame's worth in case it starts a binary frame
+                    if (m_tail - m_start > MAX_FRAME_SIZE) {
+                        m_start = m_tail - MAX_FRAME_SIZE;
+                    }
+                    return false;
+                }
+
+                // More than a line terminator between frames is garbage
+                size_t skipped = m_head > m_frameEnd ? m_head - m_frameEnd : 0;
+                if (skipped > 2) {
+                    m_stats.resyncs++;
+                    m_stats.discarded_bytes += skipped;
+                }
+                m_frameEnd = m_head;
+                m_inFrame = true;
+                m_scanned = m_head + 1;
+            }
+
+            size_t limit = std::min(zero, m_head + MAX_FRAME_SIZE);
+            size_t close = find('}', m_scanned, limit);
+
+            // A second '{' before the '}' means the frame was cut short
+            size_t reopen = find('{', m_scanned, close);
+            if (reopen < close) {
+                m_stats.resyncs++;
+                m_stats.discarded_bytes += reopen - m_head;
+                m_head = m_frameEnd = reopen;
+                m_scanned = reopen + 1;
+                continue;
+            }
+
+            if (close < limit) {
+                size_t size = close - m_head + 1;
+                size_t offset = m_head & (DECODER_CAPACITY - 1);
+
+                if (offset + size <= DECODER_CAPACITY) {
+                    frame.data = m_ring + offset;
+                } else {
+                    // Frame wraps the end of the ring: make it contiguous
+                    copyOut(m_head, size, m_scratch);
+                    frame.data = m_scratch;
+                }
+                frame.type = FrameType::Json;
+                frame.size = size;
+
+                m_start = m_head = m_frameEnd = close + 1;
+                m_inFrame = false;
+                m_stats.frames++;
+                return true;
+            }
+
+            if (limit - m_head >= MAX_FRAME_SIZE) {
+                // Too long to be a frame: drop the brace and look again (counted
+                // as garbage when the next '{' is found)
+                m_head++;
+                m_inFrame = false;
+                continue;
+            }
+
+            if (zero < m_tail) {
+                // A delimiter inside an unfinished text frame: the '{' was binary data
+                if (takeBinary(zero, frame)) {
+                    m_binaryMode = true;
+                    return true;
+                }
+                continue;
+            }
+
+            // Incomplete frame: remember how far we searched and wait for more bytes
+            m_scanned = close;
+            return false;
+        }
+    }
+
+    void FrameDecoder::reset() {
+        m_start = m_head = m_tail = m_scanned = m_zeroScanned = m_frameEnd = 0;
+        m_inFrame = false;
+        m_binaryMode = false;
+        m_skipLineEnd = false;
+    }
+
+    size_t FrameDecoder::buffered() const {
+        return m_tail - m_start;
+    }
+
+    bool FrameDecoder::isBinaryMode() const {
+        return m_binaryMode;
+    }
+
+    void FrameDecoder::expectFormat(FrameType type) {
+        m_skipLineEnd = type == FrameType::Binary && !m_binaryMode;
+        m_binaryMode = type == FrameType::Binary;
+        m_inFrame = false;
+    }
+
+    const DecoderStats& FrameDecoder::stats() const {
+        return m_stats;
+    }
+}
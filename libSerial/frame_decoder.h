@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Serial {
+
+    // Bytes held between reads (power of two so indices wrap with a mask)
+    constexpr size_t DECODER_CAPACITY = 4096;
+
+    // Longest frame accepted; anything longer is treated as garbage
+    constexpr size_t MAX_FRAME_SIZE = 256;
+
+    // Wire format a frame arrived in
+    enum class FrameType {
+        Json,   // "{...}" text line
+        Binary  // COBS frame (see wire_protocol.h)
+    };
+
+    // A complete frame. Json frames include their braces; Binary frames hold
+    // the COBS-decoded, CRC-checked payload without the CRC. Points either
+    // into the decoder's ring or its scratch buffers, so it is only valid
+    // until the next call to write()/next()/feed().
+    struct Frame {
+        FrameType type = FrameType::Json;
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Running totals kept by a FrameDecoder (plain counters, owned by the reading thread)
+    struct DecoderStats {
+        uint64_t bytes_in = 0;         // Bytes accepted by write()
+        uint64_t frames = 0;           // Frames returned by next()
+        uint64_t crc_failures = 0;     // Binary candidates that failed COBS framing or CRC
+        uint64_t resyncs = 0;          // Times garbage or a cut-off frame had to be skipped
+        uint64_t discarded_bytes = 0;  // Bytes thrown away by resyncs and failed binary frames
+        uint64_t overflow_bytes = 0;   // Bytes write() refused because the ring was full
+        size_t high_water = 0;         // Most bytes ever buffered at once
+    };
+
+    /**
+     * Long-lived incremental decoder for the firmware's serial stream.
+     * Accepts "{...}" JSON lines and zero-delimited COBS binary frames on the
+     * same port and follows the device if it switches between them.
+     * Bytes that follow a frame stay buffered for the next read instead of
+     * being thrown away, and nothing is allocated after construction.
+     */
+    class FrameDecoder {
+    public:
+        FrameDecoder();
+
+        /**
+         * Append bytes read from the port
+         * @param data Incoming bytes
+         * @param size Number of bytes
+         * @return Number of bytes accepted (less than size only if the ring is full)
+         */
+        size_t write(const char* data, size_t size);
+
+        /**
+         * Extract the next complete frame, skipping any garbage before it
+         * @param frame Receives the frame on success
+         * @return True if a frame was extracted
+         */
+        bool next(Frame& frame);
+
+        /**
+         * Append a chunk and hand every complete frame in it to a callback
+         * @param data Incoming bytes
+         * @param size Number of bytes
+         * @param onFrame Called as onFrame(const Frame&) for each frame
+         * @return Number of frames delivered
+         */
+        template <typename Callback>
+        size_t feed(const char* data, size_t size, Callback&& onFrame) {
+            size_t frames = 0;
+            Frame frame;
+            do {
+                size_t accepted = write(data, size);
+                data += accepted;
+                size -= accepted;
+                while (next(frame)) {
+                    onFrame(static_cast<const Frame&>(frame));
+                    frames++;
+                }
+            } while (size > 0);
+            return frames;
+        }
+
+        /**
+         * Drop all buffered bytes (e.g. after reopening the port)
+         */
+        void reset();
+
+        /**
+         * Get the number of bytes waiting for the rest of their frame
+         * @return Buffered byte count
+         */
+        size_t buffered() const;
+
+        /**
+         * Check which format the decoder is currently locked onto
+         * @return True after a binary frame was last accepted
+         */
+        bool isBinaryMode() const;
+
+        /**
+         * Switch format without waiting for auto-detection (e.g. once the
+         * device acknowledged a format change). Safe to call from a feed()
+         * callback: bytes after the current frame are decoded the new way.
+         * @param type Format of the frames that follow
+         */
+        void expectFormat(FrameType type);
+
+        /**
+         * Get the decoder's health counters (kept across reset())
+         * @return Totals since construction
+         */
+        const DecoderStats& stats() const;
+
+    private:
+        // Position of the first c in [from, to), or to if none
+        size_t find(char c, size_t from, size_t to) const;
+
+        // Copy [from, from + size) out of the ring into a contiguous buffer
+        void copyOut(size_t from, size_t size, char* out) const;
+
+        // Try to decode [m_start, delimiter) as a binary frame and consume it
+        bool takeBinary(size_t delimiter, Frame& frame);
+
+        char m_ring[DECODER_CAPACITY];
+        char m_scratch[MAX_FRAME_SIZE];  // Json frames that wrap the ring end, or decoded binary payloads
+        char m_encoded[MAX_FRAME_SIZE];  // Binary frame being COBS-decoded
+
+        // Monotonic positions; only their difference and low bits matter
+        size_t m_start;        // First retained byte (start of a possible binary frame)
+        size_t m_head;         // JSON cursor, m_start <= m_head
+        size_t m_tail;         // One past the last written byte
+        size_t m_scanned;      // Bytes in [m_head, m_scanned) are known not to close the frame
+        size_t m_zeroScanned;  // Bytes in [m_start, m_zeroScanned) contain no delimiter
+        size_t m_frameEnd;     // One past the last frame or skipped region (for counting garbage)
+        bool m_inFrame;        // m_head sits on a '{'
+        bool m_binaryMode;     // Last accepted frame was binary
+        bool m_skipLineEnd;    // Drop the '\n' after the last JSON frame before looking for binary
+        DecoderStats m_stats;
+    };
+}
@@ -0,0 +1,315 @@
+#include "ingest_mux.h"
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace Serial {
+
+    // epoll tag of the wake descriptor (device ids stay below MAX_DEVICES)
+    static const uint32_t WAKE_TAG = 0xFFFFFFFFu;
+
+    IngestMux::IngestMux()
+        : m_pollFd(-1), m_wakeFd{-1, -1}, m_wakeEvent(nullptr)
+    {
+#ifdef _WIN32
+        m_wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+#elif defined(__linux__)
+        m_pollFd = epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_pollFd >= 0 && m_wakeFd[0] >= 0) {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = WAKE_TAG;
+            epoll_ctl(m_pollFd, EPOLL_CTL_ADD, m_wakeFd[0], &event);
+        }
+#else
+        if (pipe(m_wakeFd) == 0) {
+            for (int fd : m_wakeFd) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+        } else {
+            m_wakeFd[0] = m_wakeFd[1] = -1;
+        }
+#endif
+        m_devices.reserve(MAX_DEVICES);
+    }
+
+    IngestMux::~IngestMux() {
+#ifdef _WIN32
+        if (m_wakeEvent) {
+            CloseHandle(m_wakeEvent);
+        }
+#else
+        for (int fd : m_wakeFd) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+#if defined(__linux__)
+        if (m_pollFd >= 0) {
+            ::close(m_pollFd);
+        }
+#endif
+#endif
+    }
+
+    void IngestMux::wake() {
+#ifdef _WIN32
+        if (m_wakeEvent) {
+            SetEvent(m_wakeEvent);
+        }
+#elif defined(__linux__)
+        uint64_t one = 1;
+        if (m_wakeFd[0] >= 0 && ::write(m_wakeFd[0], &one, sizeof(one)) < 0) {
+            // Counter already pending: the wait will return anyway
+        }
+#else
+        char byte = 1;
+        if (m_wakeFd[1] >= 0 && ::write(m_wakeFd[1], &byte, 1) < 0) {
+            // Pipe full: a wake is already pending
+        }
+#endif
+    }
+
+    int IngestMux::addSource(std::unique_ptr<SerialSource> source) {
+        if (!source || m_devices.size() >= MAX_DEVICES) return -1;
+
+        int id = static_cast<int>(m_devices.size());
+        if (source->nativeHandle() == INVALID_NATIVE_HANDLE) {
+            m_handleless.push_back(id);
+        }
+#if defined(__linux__)
+        else {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = static_cast<uint32_t>(id);
+            if (epoll_ctl(m_pollFd, EPOLL_CTL_ADD, source->nativeHandle(), &event) != 0) return -1;
+        }
+#endif
+
+        std::unique_ptr<Device> device = std::make_unique<Device>();
+        device->source = std::move(source);
+        m_devices.push_back(std::move(device));
+        return id;
+    }
+
+    size_t IngestMux::deviceCount() const {
+        return m_devices.size();
+    }
+
+    size_t IngestMux::openDeviceCount() const {
+        size_t count = 0;
+        for (const std::unique_ptr<Device>& device : m_devices) {
+            if (device->source->isOpen()) count++;
+        }
+        return count;
+    }
+
+    IngestCounters IngestMux::stats(int id) const {
+        if (id < 0 || static_cast<size_t>(id) >= m_devices.size()) return IngestCounters();
+        return m_devices[id]->stats.snapshot();
+    }
+
+    void IngestMux::publishStats(Device& device) {
+        const DecoderStats& decoder = device.decoder.stats();
+        IngestCounters counters;
+        counters.bytes_in = decoder.bytes_in;
+        counters.frames_decoded = decoder.frames - device.parseFailures - device.reports;
+        counters.crc_failures = decoder.crc_failures;
+        counters.parse_failures = device.parseFailures;
+        counters.resyncs = decoder.resyncs;
+        counters.discarded_bytes = decoder.discarded_bytes;
+        counters.overflow_bytes = decoder.overflow_bytes;
+        counters.sequence_gaps = device.sequenceGaps;
+        counters.buffer_high_water = decoder.high_water;
+        device.stats.publish(counters);
+    }
+
+    bool IngestMux::sendCommand(int id, ControlCommand command, uint32_t value) {
+        if (id < 0 || static_cast<size_t>(id) >= m_devices.size()) return false;
+
+        uint8_t frame[CONTROL_COMMAND_WIRE_SIZE];
+        size_t length = encodeCommand(command, value, frame);
+        return m_devices[id]->source->write(reinterpret_cast<const char*>(frame), length) == static_cast<long>(length);
+    }
+
+    void IngestMux::setConfigCallback(std::function<void(int, const ConfigReport&)> onReport) {
+        m_onReport = std::move(onReport);
+    }
+
+    void IngestMux::applyReport(int id, const ConfigReport& report) {
+        Device& device = *m_devices[id];
+        const DeviceConfig& previous = device.config;
+
+        // The report was the device's last frame in the old format or at the old rate
+        if (report.config.binary != previous.binary) {
+            device.decoder.expectFormat(report.config.binary ? FrameType::Binary : FrameType::Json);
+        }
+        if (report.config.baud_rate != previous.baud_rate) {
+            if (!device.source->setBaudRate(report.config.baud_rate)) {
+                std::cerr << "Device " << id << " switched to " << report.config.baud_rate
+                          << " baud but the port could not follow." << std::endl;
+            }
+        }
+        device.config = report.config;
+
+        if (m_onReport) {
+            m_onReport(id, report);
+        }
+    }
+
+    void IngestMux::removeDevice(int id) {
+        SerialSource& source = *m_devices[id]->source;
+        if (!source.isOpen()) return;
+
+#if defined(__linux__)
+        if (source.nativeHandle() != INVALID_NATIVE_HANDLE) {
+            epoll_ctl(m_pollFd, EPOLL_CTL_DEL, source.nativeHandle(), nullptr);
+        }
+#endif
+        source.close();
+    }
+
+    size_t IngestMux::pollHandleless(int* ready, size_t capacity) {
+        size_t count = 0;
+        for (int id : m_handleless) {
+            if (count == capacity) break;
+            SerialSource& source = *m_devices[id]->source;
+            if (source.isOpen() && source.waitReadable(0)) {
+                ready[count++] = id;
+            }
+        }
+        return count;
+    }
+
+    size_t IngestMux::waitReady(int timeout_ms, int* ready, size_t capacity) {
+        // Handle-less sources are checked first; if any has data the OS wait
+        // only collects ports that are already ready, otherwise it wakes up
+        // often enough to notice when they do
+        size_t count = pollHandleless(ready, capacity);
+        if (count > 0) {
+            timeout_ms = 0;
+        } else if (!m_handleless.empty() && (timeout_ms < 0 || timeout_ms > POLLED_INTERVAL_MS)) {
+            timeout_ms = POLLED_INTERVAL_MS;
+        }
+        if (m_handleless.size() == m_devices.size()) {
+            // Nothing for the OS to wait on: let a polled source sleep until its data is due
+            if (count == 0 && timeout_ms > 0) {
+                for (int id : m_handleless) {
+                    SerialSource& source = *m_devices[id]->source;
+                    if (source.isOpen()) {
+                        source.waitReadable(timeout_ms);
+                        break;
+                    }
+                }
+                count = pollHandleless(ready, capacity);
+            }
+            return count;
+        }
+
+#if defined(__linux__)
+        epoll_event events[MAX_DEVICES];
+        size_t room = capacity - count;
+        int maxEvents = static_cast<int>(room < MAX_DEVICES ? room : MAX_DEVICES);
+        if (maxEvents == 0) return count;
+        int n = epoll_wait(m_pollFd, events, maxEvents, timeout_ms);
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == WAKE_TAG) {
+                uint64_t pending;
+                if (::read(m_wakeFd[0], &pending, sizeof(pending)) < 0) {
+                    // Already cleared
+                }
+                continue;
+            }
+            ready[count++] = static_cast<int>(events[i].data.u32);
+        }
+        return count;
+#elif defined(_WIN32)
+        // waitReadable(0) reports queued bytes or arms the port's comm event
+        for (size_t id = 0; id < m_devices.size() && count < capacity; id++) {
+            SerialSource& source = *m_devices[id]->source;
+            if (source.nativeHandle() == INVALID_NATIVE_HANDLE) continue;
+            if (source.isOpen() && source.waitReadable(0)) {
+                ready[count++] = static_cast<int>(id);
+            }
+        }
+        if (count > 0) return count;
+
+        HANDLE handles[MAX_DEVICES + 1];
+        int ids[MAX_DEVICES];
+        DWORD handleCount = 0;
+        for (size_t id = 0; id < m_devices.size(); id++) {
+            SerialSource& source = *m_devices[id]->source;
+            if (!source.isOpen() || source.nativeHandle() == INVALID_NATIVE_HANDLE) continue;
+            handles[handleCount] = source.nativeHandle();
+            ids[handleCount] = static_cast<int>(id);
+            handleCount++;
+        }
+        if (handleCount == 0) return count;
+
+        // The wake event goes last so a port that is also ready wins; with
+        // every slot taken by ports, poll() still returns on its timeout
+        DWORD waitCount = handleCount;
+        if (m_wakeEvent && waitCount < MAXIMUM_WAIT_OBJECTS) {
+            handles[waitCount++] = m_wakeEvent;
+        }
+
+        DWORD timeout = timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms);
+        DWORD result = WaitForMultipleObjects(waitCount, handles, FALSE, timeout);
+        if (result >= WAIT_OBJECT_0 + handleCount) return count;
+
+        // The signalled port and any others that became ready meanwhile
+        for (DWORD i = result - WAIT_OBJECT_0; i < handleCount && count < capacity; i++) {
+            if (m_devices[ids[i]]->source->waitReadable(0)) {
+                ready[count++] = ids[i];
+            }
+        }
+        return count;
+#else
+        pollfd fds[MAX_DEVICES + 1];
+        int ids[MAX_DEVICES];
+        nfds_t fdCount = 0;
+        for (size_t id = 0; id < m_devices.size(); id++) {
+            SerialSource& source = *m_devices[id]->source;
+            if (!source.isOpen() || source.nativeHandle() == INVALID_NATIVE_HANDLE) continue;
+            fds[fdCount].fd = source.nativeHandle();
+            fds[fdCount].events = POLLIN;
+            fds[fdCount].revents = 0;
+            ids[fdCount] = static_cast<int>(id);
+            fdCount++;
+        }
+        nfds_t portCount = fdCount;
+        if (m_wakeFd[0] >= 0) {
+            fds[fdCount].fd = m_wakeFd[0];
+            fds[fdCount].events = POLLIN;
+            fds[fdCount].revents = 0;
+            fdCount++;
+        }
+
+        if (::poll(fds, fdCount, timeout_ms) <= 0) return count;
+
+        if (fdCount > portCount && (fds[portCount].revents & POLLIN)) {
+            char drainBuffer[64];
+            while (::read(m_wakeFd[0], drainBuffer, sizeof(drainBuffer)) > 0) {
+            }
+        }
+
+        for (nfds_t i = 0; i < portCount && count < capacity; i++) {
+            if (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+                ready[count++] = ids[i];
+            }
+        }
+        return count;
+#endif
+    }
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "serial.h"
+#include "clock_sync.h"
+#include "control_protocol.h"
+#include "ingest_stats.h"
+
+namespace Serial {
+
+    // Most ports one mux can own (WaitForMultipleObjects limit on Windows)
+    constexpr size_t MAX_DEVICES = 64;
+
+    /**
+     * Single-threaded ingest loop over several serial sources.
+     * One epoll (Linux), poll (other POSIX) or WaitForMultipleObjects
+     * (Windows) call waits on every port; each wakeup drains all ready ports
+     * and hands every decoded sample, tagged with its device id, to the caller.
+     * Sources without a native handle (replays) are polled alongside.
+     * Config reports from the control channel are consumed here: the decoder
+     * and port follow format and baud changes, and samples are rescaled to
+     * the default ranges so the rest of the engine never sees a range switch.
+     */
+    class IngestMux {
+    public:
+        IngestMux();
+        ~IngestMux();
+
+        IngestMux(const IngestMux&) = delete;
+        IngestMux& operator=(const IngestMux&) = delete;
+
+        /**
+         * Take ownership of an open source
+         * @param source Port to add
+         * @return Device id stamped on its samples, or -1 if the mux is full
+         */
+        int addSource(std::unique_ptr<SerialSource> source);
+
+        /**
+         * Get the number of sources added so far
+         * @return Device count (ids are 0..count-1)
+         */
+        size_t deviceCount() const;
+
+        /**
+         * Get the number of sources that are still open
+         * @return Open device count
+         */
+        size_t openDeviceCount() const;
+
+        /**
+         * Get a device's ingest health counters (safe from any thread)
+         * @param id Device id returned by addSource
+         * @return Totals as of the device's last drain
+         */
+        IngestCounters stats(int id) const;
+
+        /**
+         * Send a control command to a device (safe from any thread; the
+         * answer arrives as a config report during poll())
+         * @param id Device id returned by addSource
+         * @param command Command type
+         * @param value Argument (see ControlCommand)
+         * @return True if the whole command was written
+         */
+        bool sendCommand(int id, ControlCommand command, uint32_t value = 0);
+
+        /**
+         * Set the function called on the polling thread for every config report
+         * @param onReport Called as onReport(device id, report) after the mux has applied it
+         */
+        void setConfigCallback(std::function<void(int, const ConfigReport&)> onReport);
+
+        /**
+         * Make the poll() in progress, or the next one, return without waiting (safe from any thread)
+         */
+        void wake();
+
+        /**
+         * Wait for bytes on any port, then decode everything that is available
+         * @param timeout_ms Maximum time to wait in milliseconds (-1 = forever or until wake())
+         * @param onSample Called as onSample(const ImuSample&) with sample.device and sample.host_time_ns set
+         * @return Number of samples delivered (0 on timeout)
+         */
+        template <typename Callback>
+        size_t poll(int timeout_ms, Callback&& onSample) {
+            int ready[MAX_DEVICES];
+            size_t readyCount = waitReady(timeout_ms, ready, MAX_DEVICES);
+
+            size_t delivered = 0;
+            for (size_t i = 0; i < readyCount; i++) {
+                delivered += drain(ready[i], onSample);
+            }
+            return delivered;
+        }
+
+    private:
+        struct Device {
+            std::unique_ptr<SerialSource> source;
+            FrameDecoder decoder;
+            ClockSync clock;  // Device micros() -> host time for this port
+
+            // Counters the decoder does not keep (ingest thread only)
+            uint64_t parseFailures = 0;
+            uint64_t sequenceGaps = 0;
+            uint16_t lastSequence = 0;
+            bool hasSequence = false;
+            uint64_t reports = 0;
+
+            // Last settings the device reported (firmware defaults until then)
+            DeviceConfig config;
+
+            IngestStats stats;  // Published copy for other threads
+        };
+
+        // Bytes pulled from a port per read() call
+        static constexpr size_t READ_CHUNK = 1024;
+
+        // Larger sequence jumps are a device restart or a corrupted number, not lost frames
+        static constexpr uint16_t MAX_SEQUENCE_GAP = 1024;
+
+        // Longest the OS wait may block while handle-less sources are attached
+        static constexpr int POLLED_INTERVAL_MS = 1;
+
+        // Block until at least one port is readable; fills ready with device ids
+        size_t waitReady(int timeout_ms, int* ready, size_t capacity);
+
+        // Check sources without a native handle; fills ready with device ids
+        size_t pollHandleless(int* ready, size_t capacity);
+
+        // Stop waiting on a port that failed
+        void removeDevice(int id);
+
+        // Copy a device's counters into its published stats
+        static void publishStats(Device& device);
+
+        // Follow a device's new settings and pass the report on
+        void applyReport(int id, const ConfigReport& report);
+
+        // Read a port until it is empty and decode every frame
+        template <typename Callback>
+        size_t drain(int id, Callback& onSample) {
+            Device& device = *m_devices[id];
+            char buffer[READ_CHUNK];
+            size_t delivered = 0;
+
+            while (true) {
+                long n = device.source->read(buffer, sizeof(buffer));
+                if (n < 0) {
+                    removeDevice(id);
+                    break;
+                }
+                if (n == 0) break;
+
+                // Every frame completed by this read arrived now
+                int64_t arrival = hostTimeNs();
+                device.decoder.feed(buffer, static_cast<size_t>(n), [&](const Frame& frame) {
+                    ImuSample sample;
+                    if (!decodeSample(frame, sample)) {
+                        ConfigReport report;
+                        if (decodeConfigReport(frame, report)) {
+                            device.reports++;
+                            applyReport(id, report);
+                        } else {
+                            device.parseFailures++;
+                        }
+                        return;
+                    }
+
+                    // The sequence number is 16 bits on the wire; a small forward jump means frames were lost
+                    if (sample.has_sequence) {
+                        uint16_t sequence = static_cast<uint16_t>(sample.sequence);
+                        uint16_t gap = static_cast<uint16_t>(sequence - device.lastSequence - 1);
+                        if (device.hasSequence && gap < MAX_SEQUENCE_GAP) {
+                            device.sequenceGaps += gap;
+                        }
+                        device.lastSequence = sequence;
+                        device.hasSequence = true;
+                    }
+
+                    // Counts per g halve with every range step; scale back to +-2 g / +-250 deg/s
+                    int accelScale = 1 << device.config.accel_range;
+                    int gyroScale = 1 << device.config.gyro_range;
+                    sample.ax *= accelScale;
+                    sample.ay *= accelScale;
+                    sample.az *= accelScale;
+                    sample.gx *= gyroScale;
+                    sample.gy *= gyroScale;
+                    sample.gz *= gyroScale;
+
+                    sample.device = static_cast<unsigned int>(id);
+                    sample.host_time_ns = sample.has_device_time
+                        ? device.clock.update(sample.device_time_us, arrival)
+                        : arrival;
+                    sample.arrival_ns = arrival;
+                    sample.decoded_ns = hostTimeNs();
+                    onSample(static_cast<const ImuSample&>(sample));
+                    delivered++;
+                });
+
+                // A short read means the driver queue is empty
+                if (static_cast<size_t>(n) < sizeof(buffer)) break;
+            }
+
+            publishStats(device);
+            return delivered;
+        }
+
+        std::vector<std::unique_ptr<Device>> m_devices;
+        std::vector<int> m_handleless;  // Ids of sources that can only be polled (e.g. replays)
+        std::function<void(int, const ConfigReport&)> m_onReport;
+        int m_pollFd;      // epoll instance (Linux only)
+        int m_wakeFd[2];   // eventfd in [0] (Linux) or self-pipe (other POSIX)
+        void* m_wakeEvent; // Auto-reset event (Windows only)
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Serial {
+
+    // Health of one device's byte stream since it was added
+    struct IngestCounters {
+        uint64_t bytes_in = 0;           // Bytes read from the port
+        uint64_t frames_decoded = 0;     // Frames that became samples
+        uint64_t crc_failures = 0;       // Binary frames with bad COBS framing or CRC
+        uint64_t parse_failures = 0;     // Well-framed frames that were not a valid sample
+        uint64_t resyncs = 0;            // Times the decoder skipped garbage to find the next frame
+        uint64_t discarded_bytes = 0;    // Bytes thrown away by resyncs and failed frames
+        uint64_t overflow_bytes = 0;     // Bytes lost because the decoder buffer was full
+        uint64_t sequence_gaps = 0;      // Frames missing according to the device's sequence numbers
+        uint64_t buffer_high_water = 0;  // Most bytes ever waiting in the decoder
+    };
+
+    /**
+     * IngestCounters that one thread (the ingest loop) publishes and any
+     * other thread can read without locking. Each counter is a relaxed
+     * atomic, so a snapshot is consistent per field but not across fields.
+     */
+    class IngestStats {
+    public:
+        /**
+         * Store new totals (ingest thread only)
+         * @param counters Current totals
+         */
+        void publish(const IngestCounters& counters) {
+            m_bytesIn.store(counters.bytes_in, std::memory_order_relaxed);
+            m_framesDecoded.store(counters.frames_decoded, std::memory_order_relaxed);
+            m_crcFailures.store(counters.crc_failures, std::memory_order_relaxed);
+            m_parseFailures.store(counters.parse_failures, std::memory_order_relaxed);
+            m_resyncs.store(counters.resyncs, std::memory_order_relaxed);
+            m_discardedBytes.store(counters.discarded_bytes, std::memory_order_relaxed);
+            m_overflowBytes.store(counters.overflow_bytes, std::memory_order_relaxed);
+            m_sequenceGaps.store(counters.sequence_gaps, std::memory_order_relaxed);
+            m_bufferHighWater.store(counters.buffer_high_water, std::memory_order_relaxed);
+        }
+
+        /**
+         * Read the latest totals (any thread)
+         * @return Copy of the counters
+         */
+        IngestCounters snapshot() const {
+            IngestCounters counters;
+            counters.bytes_in = m_bytesIn.load(std::memory_order_relaxed);
+            counters.frames_decoded = m_framesDecoded.load(std::memory_order_relaxed);
+            counters.crc_failures = m_crcFailures.load(std::memory_order_relaxed);
+            counters.parse_failures = m_parseFailures.load(std::memory_order_relaxed);
+            counters.resyncs = m_resyncs.load(std::memory_order_relaxed);
+            counters.discarded_bytes = m_discardedBytes.load(std::memory_order_relaxed);
+            counters.overflow_bytes = m_overflowBytes.load(std::memory_order_relaxed);
+            counters.sequence_gaps = m_sequenceGaps.load(std::memory_order_relaxed);
+            counters.buffer_high_water = m_bufferHighWater.load(std::memory_order_relaxed);
+            return counters;
+        }
+
+    private:
+        std::atomic<uint64_t> m_bytesIn{0};
+        std::atomic<uint64_t> m_framesDecoded{0};
+        std::atomic<uint64_t> m_crcFailures{0};
+        std::atomic<uint64_t> m_parseFailures{0};
+        std::atomic<uint64_t> m_resyncs{0};
+        std::atomic<uint64_t> m_discardedBytes{0};
+        std::atomic<uint64_t> m_overflowBytes{0};
+        std::atomic<uint64_t> m_sequenceGaps{0};
+        std::atomic<uint64_t> m_bufferHighWater{0};
+    };
+}
@@ -0,0 +1,107 @@
+#include "pty_loopback.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace Serial {
+
+    PtyLoopback::PtyLoopback()
+        : m_masterFd(-1), m_slaveFd(-1)
+    {
+    }
+
+    PtyLoopback::~PtyLoopback() {
+        close();
+    }
+
+    bool PtyLoopback::open() {
+        close();
+
+        m_masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (m_masterFd < 0 || grantpt(m_masterFd) != 0 || unlockpt(m_masterFd) != 0) {
+            std::cerr << "Failed to allocate pseudo-terminal: " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+
+        const char* name = ptsname(m_masterFd);
+        if (!name) {
+            close();
+            return false;
+        }
+        m_devicePath = name;
+
+        // Raw mode on the device end so no echo or newline translation happens
+        // before the host has opened and configured it
+        m_slaveFd = ::open(m_devicePath.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (m_slaveFd < 0) {
+            close();
+            return false;
+        }
+
+        termios tty;
+        if (tcgetattr(m_slaveFd, &tty) == 0) {
+            cfmakeraw(&tty);
+            tcsetattr(m_slaveFd, TCSANOW, &tty);
+        }
+
+        // Non-blocking master so read() can poll for host-to-device bytes
+        fcntl(m_masterFd, F_SETFL, fcntl(m_masterFd, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+
+    const std::string& PtyLoopback::devicePath() const {
+        return m_devicePath;
+    }
+
+    long PtyLoopback::write(const char* data, size_t size) {
+        if (m_masterFd < 0) return -1;
+
+        size_t written = 0;
+        while (written < size) {
+            ssize_t n = ::write(m_masterFd, data + written, size - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // The pty buffer is full: wait for the host to drain it
+                pollfd pfd = { m_masterFd, POLLOUT, 0 };
+                ::poll(&pfd, 1, 100);
+            } else if (n < 0 && errno != EINTR) {
+                return -1;
+            }
+        }
+        return static_cast<long>(written);
+    }
+
+    long PtyLoopback::read(char* buffer, size_t size) {
+        if (m_masterFd < 0) return -1;
+
+        ssize_t n = ::read(m_masterFd, buffer, size);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+            return -1;
+        }
+        return static_cast<long>(n);
+    }
+
+    int PtyLoopback::masterFd() const {
+        return m_masterFd;
+    }
+
+    void PtyLoopback::close() {
+        if (m_slaveFd >= 0) {
+            ::close(m_slaveFd);
+            m_slaveFd = -1;
+        }
+        if (m_masterFd >= 0) {
+            ::close(m_masterFd);
+            m_masterFd = -1;
+        }
+        m_devicePath.clear();
+    }
+}
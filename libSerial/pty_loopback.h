@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Serial {
+
+    /**
+     * Pseudo-terminal pair standing in for a serial device (POSIX only).
+     * The host side opens devicePath() with openSerialSource() exactly like a
+     * real port, while the harness writes device bytes into the master end.
+     */
+    class PtyLoopback {
+    public:
+        PtyLoopback();
+        ~PtyLoopback();
+
+        PtyLoopback(const PtyLoopback&) = delete;
+        PtyLoopback& operator=(const PtyLoopback&) = delete;
+
+        /**
+         * Allocate the pty pair and put the device end in raw mode
+         * @return True if the pair was created
+         */
+        bool open();
+
+        /**
+         * Get the path of the device end (e.g. "/dev/pts/3")
+         * @return Path to pass to openSerialSource()
+         */
+        const std::string& devicePath() const;
+
+        /**
+         * Write bytes as if they came from the device (blocks until all are written)
+         * @param data Bytes to send to the host
+         * @param size Number of bytes
+         * @return Number of bytes written, -1 on error
+         */
+        long write(const char* data, size_t size);
+
+        /**
+         * Read bytes the host sent to the device without blocking
+         * @param buffer Destination buffer
+         * @param size Capacity of the destination buffer
+         * @return Number of bytes read, 0 if none were pending, -1 on error
+         */
+        long read(char* buffer, size_t size);
+
+        /**
+         * Get the master fd (for waiting on host-to-device traffic)
+         * @return Master file descriptor, -1 if not open
+         */
+        int masterFd() const;
+
+        /**
+         * Release both ends of the pair
+         */
+        void close();
+
+    private:
+        int m_masterFd;
+        int m_slaveFd;  // Held open so the master never sees EIO between host opens
+        std::string m_devicePath;
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Serial {
+
+    // One IMU reading in the firmware's channel order. Plain fixed-layout
+    // struct that replaces the per-sample std::unordered_map<std::string, int>.
+    struct ImuSample {
+        // Raw accelerometer counts (IngestMux rescales them to the +-2 g range
+        // and the gyroscope to +-250 deg/s, whatever range the device uses)
+        int ax = 0;
+        int ay = 0;
+        int az = 0;
+
+        // Raw gyroscope counts
+        int gx = 0;
+        int gy = 0;
+        int gz = 0;
+
+        // Frame counter from the device (valid if has_sequence)
+        unsigned int sequence = 0;
+        bool has_sequence = false;
+
+        // Index of the port the sample arrived on (see IngestMux)
+        unsigned int device = 0;
+
+        // Device micros() when the sensor was read (valid if has_device_time)
+        uint32_t device_time_us = 0;
+        bool has_device_time = false;
+
+        // Host steady_clock time of the reading in nanoseconds (0 if unknown).
+        // Mapped from the device clock by ClockSync when the firmware sends
+        // timestamps, otherwise the time the bytes arrived.
+        int64_t host_time_ns = 0;
+
+        // Host steady_clock times (ns) the bytes were read and the frame
+        // decoded, for latency accounting (0 if the sample did not come from IngestMux)
+        int64_t arrival_ns = 0;
+        int64_t decoded_ns = 0;
+    };
+}
@@ -0,0 +1,138 @@
+#include "serial.h"
+
+namespace Serial {
+
+    // Bit per channel, used to check that every field was present
+    enum : unsigned {
+        FIELD_AX = 1u << 0,
+        FIELD_AY = 1u << 1,
+        FIELD_AZ = 1u << 2,
+        FIELD_GX = 1u << 3,
+        FIELD_GY = 1u << 4,
+        FIELD_GZ = 1u << 5,
+        FIELD_ALL = (1u << 6) - 1
+    };
+
+    static inline bool isDigit(char c) {
+        return static_cast<unsigned>(c - '0') <= 9u;
+    }
+
+    static inline void skipSpaces(const char*& p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+    }
+
+    // Signed decimal integer; at most 18 digits so the accumulator cannot overflow
+    static inline bool parseInteger(const char*& p, const char* end, long long& value) {
+        bool negative = false;
+        if (p < end && *p == '-') {
+            negative = true;
+            p++;
+        }
+
+        const char* digitsStart = p;
+        long long result = 0;
+        while (p < end && isDigit(*p)) {
+            result = result * 10 + (*p - '0');
+            p++;
+        }
+
+        size_t digits = static_cast<size_t>(p - digitsStart);
+        if (digits == 0 || digits > 18) return false;
+
+        value = negative ? -result : result;
+        return true;
+    }
+
+    bool parseSample(const char* frame, size_t size, ImuSample& sample) {
+        const char* p = frame;
+        const char* end = frame + size;
+
+        skipSpaces(p, end);
+        if (p >= end || *p != '{') return false;
+        p++;
+
+        unsigned seen = 0;
+        while (true) {
+            skipSpaces(p, end);
+            if (p < end && *p == '}') break;
+
+            // "key"
+            if (p >= end || *p != '"') return false;
+            const char* keyStart = ++p;
+            while (p < end && *p != '"') p++;
+            if (p >= end) return false;
+            size_t keyLength = static_cast<size_t>(p - keyStart);
+            p++;
+
+            // :
+            skipSpaces(p, end);
+            if (p >= end || *p != ':') return false;
+            p++;
+            skipSpaces(p, end);
+
+            long long value = 0;
+            if (!parseInteger(p, end, value)) return false;
+
+            // Two-character keys dispatch on a packed code; unknown keys are skipped
+            if (keyLength == 1) {
+                switch (keyStart[0]) {
+                    case 't':
+                        sample.device_time_us = static_cast<uint32_t>(value);
+                        sample.has_device_time = true;
+                        break;
+                    case 'n':
+                        sample.sequence = static_cast<unsigned int>(value);
+                        sample.has_sequence = true;
+                        break;
+                    default: break;
+                }
+            } else if (keyLength == 2) {
+                switch ((static_cast<unsigned>(keyStart[0]) << 8) | static_cast<unsigned char>(keyStart[1])) {
+                    case ('a' << 8) | 'x': sample.ax = static_cast<int>(value); seen |= FIELD_AX; break;
+                    case ('a' << 8) | 'y': sample.ay = static_cast<int>(value); seen |= FIELD_AY; break;
+                    case ('a' << 8) | 'z': sample.az = static_cast<int>(value); seen |= FIELD_AZ; break;
+                    case ('g' << 8) | 'x': sample.gx = static_cast<int>(value); seen |= FIELD_GX; break;
+                    case ('g' << 8) | 'y': sample.gy = static_cast<int>(value); seen |= FIELD_GY; break;
+                    case ('g' << 8) | 'z': sample.gz = static_cast<int>(value); seen |= FIELD_GZ; break;
+                    default: break;
+                }
+            }
+
+            skipSpaces(p, end);
+            if (p < end && *p == ',') {
+                p++;
+            } else if (p >= end || *p != '}') {
+                return false;
+            }
+        }
+
+        return seen == FIELD_ALL;
+    }
+
+    bool decodeSample(const Frame& frame, ImuSample& sample) {
+        if (frame.type == FrameType::Binary) {
+            return decodeBinarySample(reinterpret_cast<const uint8_t*>(frame.data), frame.size, sample);
+        }
+        return parseSample(frame.data, frame.size, sample);
+    }
+
+    bool readSample(SerialSource& source, FrameDecoder& decoder, ImuSample& sample) {
+        const size_t bufSize = 512;
+        char buffer[bufSize];
+        Frame frame;
+
+        while (true) {
+            // Drain queued frames first, skipping any that do not parse
+            while (decoder.next(frame)) {
+                if (decodeSample(frame, sample)) return true;
+            }
+
+            if (!source.isOpen()) return false;
+            if (!source.waitReadable(50)) continue;
+
+            long bytesRead = source.read(buffer, bufSize);
+            if (bytesRead < 0) return false;
+            decoder.write(buffer, static_cast<size_t>(bytesRead));
+        }
+    }
+}
@@ -1,56 +1,5 @@
 #include "serial.h"
-/*
-#include <windows.h>
-#include <iostream>
-#include <string>
-
-// for json parsing
-#include <unordered_map>
-#include <sstream>
-*/
-
-// Opens the serial port
-HANDLE openSerialPort(const std::string& portName) {
-    HANDLE hSerial = CreateFileA(
-        portName.c_str(),
-        GENERIC_READ,
-        0,
-        nullptr,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
-        nullptr
-    );
-
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        std::cerr << "Error opening port." << std::endl;
-    }
-
-    return hSerial;
-}
-
-// Configures the port: 115200 8N1
-bool configurePort(HANDLE hSerial) {
-    DCB dcbSerialParams = { 0 };
-    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
-
-    if (!GetCommState(hSerial, &dcbSerialParams)) return false;
-
-    dcbSerialParams.BaudRate = CBR_115200;
-    dcbSerialParams.ByteSize = 8;
-    dcbSerialParams.StopBits = ONESTOPBIT;
-    dcbSerialParams.Parity   = NOPARITY;
-
-    return SetCommState(hSerial, &dcbSerialParams);
-}
-
-// Sets timeouts to allow non-blocking reads
-bool configureTimeouts(HANDLE hSerial) {
-    COMMTIMEOUTS timeouts = { 0 };
-    timeouts.ReadIntervalTimeout         = 50;
-    timeouts.ReadTotalTimeoutConstant    = 50;
-    timeouts.ReadTotalTimeoutMultiplier  = 10;
-    return SetCommTimeouts(hSerial, &timeouts);
-}
+#include <cstdlib>
 
 std::unordered_map<std::string, int> parseJsonToDict(const std::string& completedMsg) {
     std::unordered_map<std::string, int> data;
@@ -83,76 +32,76 @@ std::unordered_map<std::string, int> parseJsonToDict(const std::string& complete
             valueStr.erase(0, valueStr.find_first_not_of(" \t"));
             valueStr.erase(valueStr.find_last_not_of(" \t") + 1);
             
-            // Convert the value string to an integer
-            int value = std::stoi(valueStr);
+            // Convert the value string to an integer; a damaged frame yields no data
+            char* valueEnd = nullptr;
+            long value = std::strtol(valueStr.c_str(), &valueEnd, 10);
+            if (valueStr.empty() || *valueEnd != '\0') return {};
             
             // Insert the key-value pair into the unordered_map
-            data[key] = value;
+            data[key] = static_cast<int>(value);
         }
     }
     
     return data;
 }
 
-// Read one complete message from the serial port and return the parsed data
-std::unordered_map<std::string, int> readAndProcess(HANDLE hSerial) {
-    const DWORD bufSize = 64;
+// Convert a decoded frame of either wire format to the key/value form
+std::unordered_map<std::string, int> frameToDict(const Serial::Frame& frame) {
+    if (frame.type == Serial::FrameType::Json) {
+        return parseJsonToDict(std::string(frame.data, frame.size));
+    }
+
+    std::unordered_map<std::string, int> data;
+    Serial::ImuSample sample;
+    if (Serial::decodeSample(frame, sample)) {
+        data["ax"] = sample.ax;
+        data["ay"] = sample.ay;
+        data["az"] = sample.az;
+        data["gx"] = sample.gx;
+        data["gy"] = sample.gy;
+        data["gz"] = sample.gz;
+    }
+    return data;
+}
+
+// Read one complete message from the serial source and return the parsed data.
+// Bytes after that message stay in the decoder and are returned by later calls.
+std::unordered_map<std::string, int> readAndProcess(Serial::SerialSource& source, Serial::FrameDecoder& decoder) {
+    const size_t bufSize = 512;
     char buffer[bufSize];
-    DWORD bytesRead;
-    std::string msgBuffer;
-    std::unordered_map<std::string, int> result;
+    Serial::Frame frame;
 
     // Keep reading until we get a complete message
-    while (true) {
-        if (ReadFile(hSerial, buffer, bufSize, &bytesRead, nullptr) && bytesRead > 0) {
-            msgBuffer.append(buffer, bytesRead);
+    while (!decoder.next(frame)) {
+        if (!source.isOpen()) return {};
+        if (!source.waitReadable(50)) continue;
 
-            // Look for complete JSON messages
-            size_t start = msgBuffer.find('{');
-            size_t end = msgBuffer.find('}', start);
+        long bytesRead = source.read(buffer, bufSize);
+        if (bytesRead < 0) return {};
 
-            if (start != std::string::npos && end != std::string::npos) {
-                std::string completeMsg = msgBuffer.substr(start, end - start + 1);
-                result = parseJsonToDict(completeMsg);
-                break; // Exit after getting one complete message
-            }
-        }
+        // The decoder is drained before every read, so it only holds a partial
+        // frame here and the whole chunk fits
+        decoder.write(buffer, static_cast<size_t>(bytesRead));
     }
 
-    return result;
+    return frameToDict(frame);
 }
 
 namespace Serial {
-    HANDLE getSerialHandle(const std::string& portName) {
-        HANDLE hSerial = openSerialPort(portName);
-
-        if (hSerial == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
-        
-        if (!configurePort(hSerial)) {
-            std::cerr << "Failed to configure port." << std::endl;
-            return INVALID_HANDLE_VALUE;
-        }
-
-        if (!configureTimeouts(hSerial)) {
-            std::cerr << "Failed to set timeouts." << std::endl;
-            return INVALID_HANDLE_VALUE;
-        }
-
-        std::cout << "Connected to " << portName << "...\n";
-        return hSerial;
-    }
-
     int doStuff() {
+#ifdef _WIN32
         std::string portName = "\\\\.\\COM3"; // Adjust as needed (e.g. COM4)
-        HANDLE hSerial = getSerialHandle(portName);
+#else
+        std::string portName = "/dev/ttyUSB0"; // Adjust as needed (e.g. /dev/ttyACM0)
+#endif
+        std::unique_ptr<SerialSource> source = openSerialSource(portName);
 
-        if (hSerial == INVALID_HANDLE_VALUE) return 1;
+        if (!source) return 1;
 
         // Get one reading
-        std::unordered_map<std::string, int> result = readAndProcess(hSerial);
+        FrameDecoder decoder;
+        std::unordered_map<std::string, int> result = readAndProcess(*source, decoder);
         
-        CloseHandle(hSerial);
         return 0;
     }
 }
-
@@ -1,6 +1,8 @@
 #pragma once
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <iostream>
 #include <string>
 
@@ -8,13 +10,33 @@
 #include <unordered_map>
 #include <sstream>
 
+#include "serial_port.h"
+#include "frame_decoder.h"
+#include "sample.h"
+#include "wire_protocol.h"
+
+#ifdef _WIN32
 HANDLE openSerialPort(const std::string& portName);
 bool configurePort(HANDLE hSerial);
 bool configureTimeouts(HANDLE hSerial);
+std::unordered_map<std::string, int> readAndProcess(HANDLE hSerial, Serial::FrameDecoder& decoder);
+#endif
 std::unordered_map<std::string, int> parseJsonToDict(const std::string& completedMsg);
-std::unordered_map<std::string, int> readAndProcess(HANDLE hSerial);
+std::unordered_map<std::string, int> frameToDict(const Serial::Frame& frame);
+std::unordered_map<std::string, int> readAndProcess(Serial::SerialSource& source, Serial::FrameDecoder& decoder);
 
 namespace Serial {
+    // Parse one "{\"ax\":..,\"gz\":..}" frame without allocating; false if malformed
+    bool parseSample(const char* frame, size_t size, ImuSample& sample);
+
+    // Parse a decoder frame of either wire format; false if malformed
+    bool decodeSample(const Frame& frame, ImuSample& sample);
+
+    // Read until the decoder yields a frame that parses; false if the source closed
+    bool readSample(SerialSource& source, FrameDecoder& decoder, ImuSample& sample);
+
+#ifdef _WIN32
     HANDLE getSerialHandle(const std::string& portName);
+#endif
     int doStuff();
 }
@@ -0,0 +1,19 @@
+// Arbitrary baud rates on Linux go through termios2/BOTHER, whose kernel
+// header clashes with glibc's <termios.h>, so it lives in its own file.
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+namespace Serial {
+
+    bool setCustomBaudRate(int fd, unsigned int baudRate) {
+        struct termios2 tio;
+        if (ioctl(fd, TCGETS2, &tio) != 0) return false;
+
+        tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+        tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+        tio.c_ispeed = baudRate;
+        tio.c_ospeed = baudRate;
+
+        return ioctl(fd, TCSETS2, &tio) == 0;
+    }
+}
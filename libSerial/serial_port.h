@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Serial {
+
+#ifdef _WIN32
+    // Waitable HANDLE signalled when bytes arrive (used with WaitForMultipleObjects)
+    using NativeHandle = void*;
+    constexpr NativeHandle INVALID_NATIVE_HANDLE = nullptr;
+#else
+    // Non-blocking file descriptor (usable with epoll/poll)
+    using NativeHandle = int;
+    constexpr NativeHandle INVALID_NATIVE_HANDLE = -1;
+#endif
+
+    // How a source waits for incoming bytes
+    enum class WaitMode {
+        Event,    // Sleep in epoll/WaitCommEvent until bytes arrive
+        BusyPoll  // Spin on non-blocking reads for minimum wakeup latency
+    };
+
+    // Settings applied when a port is opened
+    struct PortConfig {
+        unsigned int baud_rate = 115200;  // Any rate the driver accepts, not only the standard table
+        WaitMode wait_mode = WaitMode::Event;
+    };
+
+    /**
+     * Platform-independent byte source for the ingest path.
+     * Implemented by the Win32 and POSIX serial backends.
+     */
+    class SerialSource {
+    public:
+        virtual ~SerialSource() = default;
+
+        /**
+         * Check if the underlying port is open
+         * @return True if the source can be read from
+         */
+        virtual bool isOpen() const = 0;
+
+        /**
+         * Read whatever bytes are currently available without blocking
+         * @param buffer Destination buffer
+         * @param size Capacity of the destination buffer
+         * @return Number of bytes read, 0 if none were pending, -1 on error
+         */
+        virtual long read(char* buffer, size_t size) = 0;
+
+        /**
+         * Wait until bytes are available to read
+         * @param timeout_ms Maximum time to wait in milliseconds (-1 = forever)
+         * @return True if bytes are available, false on timeout or error
+         */
+        virtual bool waitReadable(int timeout_ms) = 0;
+
+        /**
+         * Get the handle an external event loop can wait on
+         * @return fd on POSIX, event HANDLE on Windows, INVALID_NATIVE_HANDLE if the source can only be polled
+         */
+        virtual NativeHandle nativeHandle() const = 0;
+
+        /**
+         * Send bytes to the device (the control channel; sources without a
+         * device to talk to, such as replays, refuse)
+         * @param data Bytes to send
+         * @param size Number of bytes
+         * @return Number of bytes written, -1 on error or if the source is read-only
+         */
+        virtual long write(const char* data, size_t size) {
+            (void)data;
+            (void)size;
+            return -1;
+        }
+
+        /**
+         * Change the port speed without reopening it (after the device switched)
+         * @param baudRate New rate in bits per second
+         * @return True if the port now runs at that rate
+         */
+        virtual bool setBaudRate(unsigned int baudRate) {
+            (void)baudRate;
+            return false;
+        }
+
+        /**
+         * Close the port (also done by the destructor)
+         */
+        virtual void close() = 0;
+    };
+
+    /**
+     * Open and configure a serial port with the backend for this platform
+     * @param portName Device path (e.g. "/dev/ttyUSB0" or "\\\\.\\COM3")
+     * @param config Baud rate and wait mode
+     * @return Open source, or nullptr if the port could not be opened
+     */
+    std::unique_ptr<SerialSource> openSerialSource(const std::string& portName,
+                                                   const PortConfig& config = PortConfig());
+}
@@ -0,0 +1,210 @@
+#include "serial_port.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace Serial {
+
+#ifdef __linux__
+    // Defined in serial_linux_baud.cpp (termios2 cannot share a TU with <termios.h>)
+    bool setCustomBaudRate(int fd, unsigned int baudRate);
+#endif
+
+    // Map a baud rate onto the standard speed_t table (0 if not standard)
+    static speed_t standardBaudRate(unsigned int baudRate) {
+        switch (baudRate) {
+            case 9600:    return B9600;
+            case 19200:   return B19200;
+            case 38400:   return B38400;
+            case 57600:   return B57600;
+            case 115200:  return B115200;
+            case 230400:  return B230400;
+#ifdef B460800
+            case 460800:  return B460800;
+#endif
+#ifdef B921600
+            case 921600:  return B921600;
+#endif
+#ifdef B2000000
+            case 2000000: return B2000000;
+#endif
+            default:      return 0;
+        }
+    }
+
+    // Put the tty in raw 8N1 mode at the requested rate
+    static bool configureTermios(int fd, unsigned int baudRate) {
+        termios tty;
+        if (tcgetattr(fd, &tty) != 0) return false;
+
+        cfmakeraw(&tty);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+
+        speed_t speed = standardBaudRate(baudRate);
+        if (speed != 0) {
+            cfsetispeed(&tty, speed);
+            cfsetospeed(&tty, speed);
+        }
+
+        if (tcsetattr(fd, TCSANOW, &tty) != 0) return false;
+
+        bool configured = true;
+        if (speed == 0) {
+#ifdef __linux__
+            configured = setCustomBaudRate(fd, baudRate);
+#else
+            std::cerr << "Baud rate " << baudRate << " is not supported on this platform." << std::endl;
+            configured = false;
+#endif
+        }
+
+        // Drop whatever arrived before the port was configured, at any rate
+        tcflush(fd, TCIFLUSH);
+        return configured;
+    }
+
+    // Raw termios port read through a non-blocking fd. In Event mode the
+    // thread sleeps in epoll_wait (poll() off Linux); in BusyPoll mode it
+    // spins on read() and never yields to the scheduler.
+    class PosixSerialPort : public SerialSource {
+    public:
+        PosixSerialPort(int fd, WaitMode waitMode)
+            : m_fd(fd), m_waitMode(waitMode), m_pollFd(-1)
+        {
+#ifdef __linux__
+            m_pollFd = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = m_fd;
+            epoll_ctl(m_pollFd, EPOLL_CTL_ADD, m_fd, &event);
+#endif
+        }
+
+        ~PosixSerialPort() override {
+            close();
+        }
+
+        bool isOpen() const override {
+            return m_fd >= 0;
+        }
+
+        long read(char* buffer, size_t size) override {
+            if (m_fd < 0) return -1;
+
+            ssize_t bytesRead = ::read(m_fd, buffer, size);
+            if (bytesRead < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+                return -1;
+            }
+            return static_cast<long>(bytesRead);
+        }
+
+        bool waitReadable(int timeout_ms) override {
+            if (m_fd < 0) return false;
+
+            if (m_waitMode == WaitMode::BusyPoll) {
+                return spinUntilReadable(timeout_ms);
+            }
+
+#ifdef __linux__
+            epoll_event event;
+            int ready = epoll_wait(m_pollFd, &event, 1, timeout_ms);
+            return ready > 0 && (event.events & EPOLLIN);
+#else
+            pollfd pfd = { m_fd, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, timeout_ms);
+            return ready > 0 && (pfd.revents & POLLIN);
+#endif
+        }
+
+        NativeHandle nativeHandle() const override {
+            return m_fd;
+        }
+
+        long write(const char* data, size_t size) override {
+            if (m_fd < 0) return -1;
+
+            // Commands are a few bytes; wait briefly if the driver's output queue is full
+            size_t written = 0;
+            while (written < size) {
+                ssize_t n = ::write(m_fd, data + written, size - written);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+                    pollfd pfd = { m_fd, POLLOUT, 0 };
+                    if (::poll(&pfd, 1, WRITE_TIMEOUT_MS) <= 0) break;
+                    continue;
+                }
+                written += static_cast<size_t>(n);
+            }
+            return static_cast<long>(written);
+        }
+
+        bool setBaudRate(unsigned int baudRate) override {
+            if (m_fd < 0) return false;
+            return configureTermios(m_fd, baudRate);
+        }
+
+        void close() override {
+            if (m_pollFd >= 0) {
+                ::close(m_pollFd);
+                m_pollFd = -1;
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+    private:
+        // Longest a write() waits for room in the output queue
+        static constexpr int WRITE_TIMEOUT_MS = 100;
+
+        // Zero-timeout readiness checks in a tight loop
+        bool spinUntilReadable(int timeout_ms) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            while (true) {
+#ifdef __linux__
+                epoll_event event;
+                if (epoll_wait(m_pollFd, &event, 1, 0) > 0) return true;
+#else
+                pollfd pfd = { m_fd, POLLIN, 0 };
+                if (::poll(&pfd, 1, 0) > 0) return true;
+#endif
+                if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= deadline) return false;
+            }
+        }
+
+        int m_fd;
+        WaitMode m_waitMode;
+        int m_pollFd;
+    };
+
+    std::unique_ptr<SerialSource> openSerialSource(const std::string& portName, const PortConfig& config) {
+        int fd = ::open(portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Error opening port " << portName << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        if (!configureTermios(fd, config.baud_rate)) {
+            std::cerr << "Failed to configure port." << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+
+        std::cout << "Connected to " << portName << "...\n";
+        return std::make_unique<PosixSerialPort>(fd, config.wait_mode);
+    }
+}
@@ -0,0 +1,272 @@
+#include "serial.h"
+
+// Opens the serial port
+HANDLE openSerialPort(const std::string& portName) {
+    HANDLE hSerial = CreateFileA(
+        portName.c_str(),
+        GENERIC_READ,
+        0,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+
+    if (hSerial == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening port." << std::endl;
+    }
+
+    return hSerial;
+}
+
+// Configures the port: 115200 8N1
+bool configurePort(HANDLE hSerial) {
+    DCB dcbSerialParams = { 0 };
+    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+
+    if (!GetCommState(hSerial, &dcbSerialParams)) return false;
+
+    dcbSerialParams.BaudRate = CBR_115200;
+    dcbSerialParams.ByteSize = 8;
+    dcbSerialParams.StopBits = ONESTOPBIT;
+    dcbSerialParams.Parity   = NOPARITY;
+
+    return SetCommState(hSerial, &dcbSerialParams);
+}
+
+// Sets timeouts to allow non-blocking reads
+bool configureTimeouts(HANDLE hSerial) {
+    COMMTIMEOUTS timeouts = { 0 };
+    timeouts.ReadIntervalTimeout         = 50;
+    timeouts.ReadTotalTimeoutConstant    = 50;
+    timeouts.ReadTotalTimeoutMultiplier  = 10;
+    return SetCommTimeouts(hSerial, &timeouts);
+}
+
+// Read one complete message from the serial port and return the parsed data.
+// Bytes after that message stay in the decoder and are returned by later calls.
+std::unordered_map<std::string, int> readAndProcess(HANDLE hSerial, Serial::FrameDecoder& decoder) {
+    const DWORD bufSize = 512;
+    char buffer[bufSize];
+    DWORD bytesRead;
+    Serial::Frame frame;
+
+    // Keep reading until we get a complete message
+    while (!decoder.next(frame)) {
+        if (ReadFile(hSerial, buffer, bufSize, &bytesRead, nullptr) && bytesRead > 0) {
+            decoder.write(buffer, bytesRead);
+        }
+    }
+
+    return frameToDict(frame);
+}
+
+namespace Serial {
+    HANDLE getSerialHandle(const std::string& portName) {
+        HANDLE hSerial = openSerialPort(portName);
+
+        if (hSerial == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+
+        if (!configurePort(hSerial)) {
+            std::cerr << "Failed to configure port." << std::endl;
+            return INVALID_HANDLE_VALUE;
+        }
+
+        if (!configureTimeouts(hSerial)) {
+            std::cerr << "Failed to set timeouts." << std::endl;
+            return INVALID_HANDLE_VALUE;
+        }
+
+        std::cout << "Connected to " << portName << "...\n";
+        return hSerial;
+    }
+
+    // Overlapped Win32 port. Reads return immediately with whatever is queued,
+    // and waiting is done on an EV_RXCHAR comm event so the event HANDLE can
+    // be handed to WaitForMultipleObjects.
+    class Win32SerialPort : public SerialSource {
+    public:
+        Win32SerialPort(HANDLE hSerial, WaitMode waitMode)
+            : m_hSerial(hSerial), m_waitMode(waitMode), m_waitPending(false), m_eventMask(0)
+        {
+            ZeroMemory(&m_waitOverlapped, sizeof(m_waitOverlapped));
+            ZeroMemory(&m_readOverlapped, sizeof(m_readOverlapped));
+            ZeroMemory(&m_writeOverlapped, sizeof(m_writeOverlapped));
+            m_waitOverlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            m_readOverlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            m_writeOverlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            SetCommMask(m_hSerial, EV_RXCHAR);
+        }
+
+        ~Win32SerialPort() override {
+            close();
+        }
+
+        bool isOpen() const override {
+            return m_hSerial != INVALID_HANDLE_VALUE;
+        }
+
+        long read(char* buffer, size_t size) override {
+            if (!isOpen()) return -1;
+
+            DWORD bytesRead = 0;
+            ResetEvent(m_readOverlapped.hEvent);
+            if (!ReadFile(m_hSerial, buffer, static_cast<DWORD>(size), &bytesRead, &m_readOverlapped)) {
+                if (GetLastError() != ERROR_IO_PENDING) return -1;
+                // Zero total timeouts make the read complete with what is queued
+                if (!GetOverlappedResult(m_hSerial, &m_readOverlapped, &bytesRead, TRUE)) return -1;
+            }
+            return static_cast<long>(bytesRead);
+        }
+
+        bool waitReadable(int timeout_ms) override {
+            if (!isOpen()) return false;
+            if (bytesQueued() > 0) return true;
+
+            if (m_waitMode == WaitMode::BusyPoll) {
+                ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeout_ms);
+                while (timeout_ms < 0 || GetTickCount64() < deadline) {
+                    if (bytesQueued() > 0) return true;
+                    YieldProcessor();
+                }
+                return false;
+            }
+
+            // Arm the comm event unless a previous wait is still outstanding
+            if (!m_waitPending) {
+                ResetEvent(m_waitOverlapped.hEvent);
+                if (WaitCommEvent(m_hSerial, &m_eventMask, &m_waitOverlapped)) {
+                    return true;
+                }
+                if (GetLastError() != ERROR_IO_PENDING) return false;
+                m_waitPending = true;
+            }
+
+            DWORD timeout = timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms);
+            if (WaitForSingleObject(m_waitOverlapped.hEvent, timeout) != WAIT_OBJECT_0) {
+                return false;
+            }
+
+            DWORD unused = 0;
+            m_waitPending = false;
+            return GetOverlappedResult(m_hSerial, &m_waitOverlapped, &unused, FALSE) != 0;
+        }
+
+        NativeHandle nativeHandle() const override {
+            return m_waitOverlapped.hEvent;
+        }
+
+        long write(const char* data, size_t size) override {
+            if (!isOpen()) return -1;
+
+            // Own OVERLAPPED so a command can go out while a read or wait is in flight
+            DWORD bytesWritten = 0;
+            ResetEvent(m_writeOverlapped.hEvent);
+            if (!WriteFile(m_hSerial, data, static_cast<DWORD>(size), &bytesWritten, &m_writeOverlapped)) {
+                if (GetLastError() != ERROR_IO_PENDING) return -1;
+                if (!GetOverlappedResult(m_hSerial, &m_writeOverlapped, &bytesWritten, TRUE)) return -1;
+            }
+            return static_cast<long>(bytesWritten);
+        }
+
+        bool setBaudRate(unsigned int baudRate) override {
+            if (!isOpen()) return false;
+
+            DCB dcbSerialParams = { 0 };
+            dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+            if (!GetCommState(m_hSerial, &dcbSerialParams)) return false;
+            dcbSerialParams.BaudRate = baudRate;
+            if (!SetCommState(m_hSerial, &dcbSerialParams)) return false;
+
+            // Bytes queued at the old rate are noise now
+            PurgeComm(m_hSerial, PURGE_RXCLEAR);
+            return true;
+        }
+
+        void close() override {
+            if (m_hSerial != INVALID_HANDLE_VALUE) {
+                CancelIo(m_hSerial);
+                CloseHandle(m_hSerial);
+                m_hSerial = INVALID_HANDLE_VALUE;
+            }
+            if (m_waitOverlapped.hEvent) {
+                CloseHandle(m_waitOverlapped.hEvent);
+                m_waitOverlapped.hEvent = nullptr;
+            }
+            if (m_readOverlapped.hEvent) {
+                CloseHandle(m_readOverlapped.hEvent);
+                m_readOverlapped.hEvent = nullptr;
+            }
+            if (m_writeOverlapped.hEvent) {
+                CloseHandle(m_writeOverlapped.hEvent);
+                m_writeOverlapped.hEvent = nullptr;
+            }
+        }
+
+    private:
+        // Number of bytes sitting in the driver's receive queue
+        DWORD bytesQueued() {
+            COMSTAT status = { 0 };
+            DWORD errors = 0;
+            if (!ClearCommError(m_hSerial, &errors, &status)) return 0;
+            return status.cbInQue;
+        }
+
+        HANDLE m_hSerial;
+        WaitMode m_waitMode;
+        bool m_waitPending;
+        DWORD m_eventMask;
+        OVERLAPPED m_waitOverlapped;
+        OVERLAPPED m_readOverlapped;
+        OVERLAPPED m_writeOverlapped;
+    };
+
+    std::unique_ptr<SerialSource> openSerialSource(const std::string& portName, const PortConfig& config) {
+        HANDLE hSerial = CreateFileA(
+            portName.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED,
+            nullptr
+        );
+
+        if (hSerial == INVALID_HANDLE_VALUE) {
+            std::cerr << "Error opening port." << std::endl;
+            return nullptr;
+        }
+
+        // 8N1 at the requested rate (DCB takes the rate as a plain integer)
+        DCB dcbSerialParams = { 0 };
+        dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+        if (!GetCommState(hSerial, &dcbSerialParams)) {
+            std::cerr << "Failed to configure port." << std::endl;
+            CloseHandle(hSerial);
+            return nullptr;
+        }
+
+        dcbSerialParams.BaudRate = config.baud_rate;
+        dcbSerialParams.ByteSize = 8;
+        dcbSerialParams.StopBits = ONESTOPBIT;
+        dcbSerialParams.Parity   = NOPARITY;
+
+        if (!SetCommState(hSerial, &dcbSerialParams)) {
+            std::cerr << "Failed to configure port." << std::endl;
+            CloseHandle(hSerial);
+            return nullptr;
+        }
+
+        // Return immediately with whatever bytes are queued
+        COMMTIMEOUTS timeouts = { 0 };
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        if (!SetCommTimeouts(hSerial, &timeouts)) {
+            std::cerr << "Failed to set timeouts." << std::endl;
+            CloseHandle(hSerial);
+            return nullptr;
+        }
+
+        std::cout << "Connected to " << portName << "...\n";
+        return std::make_unique<Win32SerialPort>(hSerial, config.wait_mode);
+    }
+}
@@ -0,0 +1,133 @@
+#include "wire_protocol.h"
+
+namespace Serial {
+
+    // 256-entry table for CRC-16/CCITT-FALSE, built once at compile time
+    struct Crc16Table {
+        uint16_t entries[256];
+
+        constexpr Crc16Table() : entries() {
+            for (int i = 0; i < 256; i++) {
+                uint16_t crc = static_cast<uint16_t>(i << 8);
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+
+    static constexpr Crc16Table CRC16_TABLE;
+
+    uint16_t crc16(const uint8_t* data, size_t size) {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < size; i++) {
+            crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE.entries[((crc >> 8) ^ data[i]) & 0xFF]);
+        }
+        return crc;
+    }
+
+    size_t cobsEncode(const uint8_t* in, size_t size, uint8_t* out) {
+        size_t codeIndex = 0;
+        size_t writeIndex = 1;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i < size; i++) {
+            if (in[i] == 0) {
+                out[codeIndex] = code;
+                codeIndex = writeIndex++;
+                code = 1;
+            } else {
+                out[writeIndex++] = in[i];
+                code++;
+            }
+        }
+        out[codeIndex] = code;
+        return writeIndex;
+    }
+
+    size_t cobsDecode(const uint8_t* in, size_t size, uint8_t* out) {
+        size_t readIndex = 0;
+        size_t writeIndex = 0;
+
+        while (readIndex < size) {
+            uint8_t code = in[readIndex++];
+            if (code == 0 || readIndex + code - 1 > size) return 0;
+
+            for (uint8_t i = 1; i < code; i++) {
+                out[writeIndex++] = in[readIndex++];
+            }
+            // A code below 0xFF marks a zero, except after the last block
+            if (code != 0xFF && readIndex < size) {
+                out[writeIndex++] = 0;
+            }
+        }
+        return writeIndex;
+    }
+
+    static inline void putInt16(uint8_t* out, int value) {
+        uint16_t bits = static_cast<uint16_t>(static_cast<int16_t>(value));
+        out[0] = static_cast<uint8_t>(bits & 0xFF);
+        out[1] = static_cast<uint8_t>(bits >> 8);
+    }
+
+    static inline int getInt16(const uint8_t* in) {
+        return static_cast<int16_t>(static_cast<uint16_t>(in[0] | (in[1] << 8)));
+    }
+
+    size_t encodeBinarySample(const ImuSample& sample, uint16_t sequence, uint8_t* out) {
+        uint8_t payload[BINARY_TIMED_SAMPLE_PAYLOAD_SIZE];
+        size_t size = sample.has_device_time ? BINARY_TIMED_SAMPLE_PAYLOAD_SIZE : BINARY_SAMPLE_PAYLOAD_SIZE;
+        payload[0] = sample.has_device_time ? BINARY_TYPE_TIMED_SAMPLE : BINARY_TYPE_SAMPLE;
+        payload[1] = static_cast<uint8_t>(sequence & 0xFF);
+        payload[2] = static_cast<uint8_t>(sequence >> 8);
+
+        uint8_t* channels = payload + 3;
+        if (sample.has_device_time) {
+            for (int i = 0; i < 4; i++) {
+                payload[3 + i] = static_cast<uint8_t>(sample.device_time_us >> (8 * i));
+            }
+            channels += 4;
+        }
+        putInt16(channels + 0, sample.ax);
+        putInt16(channels + 2, sample.ay);
+        putInt16(channels + 4, sample.az);
+        putInt16(channels + 6, sample.gx);
+        putInt16(channels + 8, sample.gy);
+        putInt16(channels + 10, sample.gz);
+
+        uint16_t crc = crc16(payload, size - 2);
+        payload[size - 2] = static_cast<uint8_t>(crc & 0xFF);
+        payload[size - 1] = static_cast<uint8_t>(crc >> 8);
+
+        size_t length = cobsEncode(payload, size, out);
+        out[length++] = BINARY_FRAME_DELIMITER;
+        return length;
+    }
+
+    bool decodeBinarySample(const uint8_t* payload, size_t size, ImuSample& sample) {
+        const uint8_t* channels;
+        if (size == BINARY_SAMPLE_PAYLOAD_SIZE - 2 && payload[0] == BINARY_TYPE_SAMPLE) {
+            channels = payload + 3;
+        } else if (size == BINARY_TIMED_SAMPLE_PAYLOAD_SIZE - 2 && payload[0] == BINARY_TYPE_TIMED_SAMPLE) {
+            sample.device_time_us = static_cast<uint32_t>(payload[3]) |
+                                    (static_cast<uint32_t>(payload[4]) << 8) |
+                                    (static_cast<uint32_t>(payload[5]) << 16) |
+                                    (static_cast<uint32_t>(payload[6]) << 24);
+            sample.has_device_time = true;
+            channels = payload + 7;
+        } else {
+            return false;
+        }
+
+        sample.sequence = static_cast<unsigned int>(payload[1] | (payload[2] << 8));
+        sample.has_sequence = true;
+        sample.ax = getInt16(channels + 0);
+        sample.ay = getInt16(channels + 2);
+        sample.az = getInt16(channels + 4);
+        sample.gx = getInt16(channels + 6);
+        sample.gy = getInt16(channels + 8);
+        sample.gz = getInt16(channels + 10);
+        return true;
+    }
+}
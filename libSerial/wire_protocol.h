@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+
+// Binary wire format shared with esp32-files/src/main.cpp.
+//
+// Each sample is a little-endian payload
+//     type u8 | sequence u16 | ax ay az gx gy gz int16 | crc16 u16
+// or, from firmware that timestamps its readings,
+//     type u8 | sequence u16 | micros u32 | ax ay az gx gy gz int16 | crc16 u16
+// COBS-encoded so it contains no zero bytes, then terminated by 0x00.
+// JSON lines never contain 0x00 either, which is what lets the decoder
+// tell the two formats apart on the same port.
+namespace Serial {
+
+    constexpr uint8_t BINARY_FRAME_DELIMITER = 0x00;
+
+    // Payload type tags
+    constexpr uint8_t BINARY_TYPE_SAMPLE = 0x01;
+    constexpr uint8_t BINARY_TYPE_TIMED_SAMPLE = 0x02;
+
+    // Sizes of a sample frame at each stage
+    constexpr size_t BINARY_SAMPLE_PAYLOAD_SIZE = 1 + 2 + 6 * 2 + 2;
+    constexpr size_t BINARY_SAMPLE_WIRE_SIZE = BINARY_SAMPLE_PAYLOAD_SIZE + 2;  // + COBS overhead + delimiter
+    constexpr size_t BINARY_TIMED_SAMPLE_PAYLOAD_SIZE = BINARY_SAMPLE_PAYLOAD_SIZE + 4;
+    constexpr size_t BINARY_TIMED_SAMPLE_WIRE_SIZE = BINARY_TIMED_SAMPLE_PAYLOAD_SIZE + 2;
+
+    /**
+     * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), table driven
+     * @param data Bytes to checksum
+     * @param size Number of bytes
+     * @return CRC of the bytes
+     */
+    uint16_t crc16(const uint8_t* data, size_t size);
+
+    /**
+     * COBS-encode a block (output has no zero bytes, no delimiter appended)
+     * @param in Bytes to encode
+     * @param size Number of bytes (at most 254 so one code block suffices)
+     * @param out Destination, at least size + 1 bytes
+     * @return Encoded length
+     */
+    size_t cobsEncode(const uint8_t* in, size_t size, uint8_t* out);
+
+    /**
+     * Decode a COBS block (without its delimiter)
+     * @param in Encoded bytes
+     * @param size Number of encoded bytes
+     * @param out Destination, at least size bytes
+     * @return Decoded length, 0 if the block is malformed
+     */
+    size_t cobsDecode(const uint8_t* in, size_t size, uint8_t* out);
+
+    /**
+     * Build a complete binary sample frame including the trailing delimiter
+     * (the timed layout if sample.has_device_time is set)
+     * @param sample Channels to send
+     * @param sequence Frame sequence number
+     * @param out Destination, at least BINARY_TIMED_SAMPLE_WIRE_SIZE bytes
+     * @return Number of bytes written
+     */
+    size_t encodeBinarySample(const ImuSample& sample, uint16_t sequence, uint8_t* out);
+
+    /**
+     * Unpack a decoded, CRC-checked sample payload
+     * @param payload Payload bytes (CRC already stripped)
+     * @param size Payload length
+     * @param sample Receives the channels, sequence number and device time if present
+     * @return True if the payload is a sample
+     */
+    bool decodeBinarySample(const uint8_t* payload, size_t size, ImuSample& sample);
+}
@@ -0,0 +1,313 @@
+#include "simulator.h"
+#include "../libSerial/wire_protocol.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace Simulator {
+
+    static const double PI = 3.14159265358979323846;
+
+    // Length of the acceleration spike in a tap
+    static const double TAP_PULSE_S = 0.02;
+
+    // How long a tap segment lasts in total (spike plus settling)
+    static const double TAP_SEGMENT_S = 0.5;
+
+    static bool parseAxis(const std::string& text, int& axis) {
+        if (text == "x") axis = 0;
+        else if (text == "y") axis = 1;
+        else if (text == "z") axis = 2;
+        else return false;
+        return true;
+    }
+
+    static bool parseNumber(const std::string& text, double& value) {
+        char* end = nullptr;
+        value = std::strtod(text.c_str(), &end);
+        return !text.empty() && end == text.c_str() + text.size();
+    }
+
+    bool parseProfile(const std::string& spec, std::vector<MotionSegment>& profile) {
+        profile.clear();
+        std::stringstream segments(spec);
+        std::string segmentText;
+
+        while (std::getline(segments, segmentText, ',')) {
+            std::vector<std::string> fields;
+            std::stringstream parts(segmentText);
+            std::string field;
+            while (std::getline(parts, field, ':')) {
+                fields.push_back(field);
+            }
+            if (fields.empty()) return false;
+
+            MotionSegment segment;
+            const std::string& kind = fields[0];
+            if (kind == "rest" && fields.size() == 2) {
+                segment.kind = MotionKind::Rest;
+                if (!parseNumber(fields[1], segment.duration_s)) return false;
+            } else if (kind == "rotate" && fields.size() == 4) {
+                segment.kind = MotionKind::Rotate;
+                if (!parseAxis(fields[1], segment.axis) ||
+                    !parseNumber(fields[2], segment.magnitude) ||
+                    !parseNumber(fields[3], segment.duration_s)) return false;
+            } else if (kind == "shake" && fields.size() == 5) {
+                segment.kind = MotionKind::Shake;
+                if (!parseAxis(fields[1], segment.axis) ||
+                    !parseNumber(fields[2], segment.magnitude) ||
+                    !parseNumber(fields[3], segment.frequency_hz) ||
+                    !parseNumber(fields[4], segment.duration_s)) return false;
+            } else if (kind == "tap" && fields.size() == 3) {
+                segment.kind = MotionKind::Tap;
+                segment.duration_s = TAP_SEGMENT_S;
+                if (!parseAxis(fields[1], segment.axis) ||
+                    !parseNumber(fields[2], segment.magnitude)) return false;
+            } else {
+                return false;
+            }
+
+            if (segment.duration_s <= 0.0) return false;
+            profile.push_back(segment);
+        }
+        return !profile.empty();
+    }
+
+    ImuModel::ImuModel(const std::vector<MotionSegment>& profile, const SensorErrors& errors, uint32_t seed)
+        : m_profile(profile), m_profileLength(0.0), m_errors(errors), m_rng(seed),
+          m_gauss(0.0, 1.0), m_time(0.0), m_accelScale(ACCEL_COUNTS_PER_G), m_gyroScale(GYRO_COUNTS_PER_DPS)
+    {
+        if (m_profile.empty()) {
+            m_profile.push_back(MotionSegment());
+        }
+        for (const MotionSegment& segment : m_profile) {
+            m_profileLength += segment.duration_s;
+        }
+
+        m_q[0] = 1.0;
+        m_q[1] = m_q[2] = m_q[3] = 0.0;
+        m_gyroDrift[0] = m_gyroDrift[1] = m_gyroDrift[2] = 0.0;
+    }
+
+    const MotionSegment& ImuModel::segmentAt(double t, double& elapsed) const {
+        double local = std::fmod(t, m_profileLength);
+        for (const MotionSegment& segment : m_profile) {
+            if (local < segment.duration_s) {
+                elapsed = local;
+                return segment;
+            }
+            local -= segment.duration_s;
+        }
+        elapsed = 0.0;
+        return m_profile.back();
+    }
+
+    void ImuModel::worldToBody(const double v[3], double out[3]) const {
+        // R^T v for the unit quaternion (w, x, y, z)
+        double w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+        out[0] = (1 - 2 * (y * y + z * z)) * v[0] + 2 * (x * y + w * z) * v[1] + 2 * (x * z - w * y) * v[2];
+        out[1] = 2 * (x * y - w * z) * v[0] + (1 - 2 * (x * x + z * z)) * v[1] + 2 * (y * z + w * x) * v[2];
+        out[2] = 2 * (x * z + w * y) * v[0] + 2 * (y * z - w * x) * v[1] + (1 - 2 * (x * x + y * y)) * v[2];
+    }
+
+    int ImuModel::toCounts(double value, double scale) {
+        double counts = std::round(value * scale);
+        return static_cast<int>(std::max(-32768.0, std::min(32767.0, counts)));
+    }
+
+    Serial::ImuSample ImuModel::next(double dt) {
+        double elapsed = 0.0;
+        const MotionSegment& segment = segmentAt(m_time, elapsed);
+
+        // Ideal body rates (deg/s) and linear acceleration (g) for this instant
+        double rate[3] = { 0.0, 0.0, 0.0 };
+        double linear[3] = { 0.0, 0.0, 0.0 };
+        switch (segment.kind) {
+            case MotionKind::Rest:
+                break;
+            case MotionKind::Rotate:
+                rate[segment.axis] = segment.magnitude;
+                break;
+            case MotionKind::Shake:
+                linear[segment.axis] = segment.magnitude * std::sin(2.0 * PI * segment.frequency_hz * elapsed);
+                break;
+            case MotionKind::Tap:
+                if (elapsed < TAP_PULSE_S) {
+                    linear[segment.axis] = segment.magnitude * std::sin(PI * elapsed / TAP_PULSE_S);
+                }
+                break;
+        }
+
+        // Integrate orientation: q <- q * [1, w*dt/2]
+        double half[3];
+        for (int i = 0; i < 3; i++) {
+            half[i] = rate[i] * PI / 180.0 * dt * 0.5;
+        }
+        double w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+        m_q[0] = w - x * half[0] - y * half[1] - z * half[2];
+        m_q[1] = x + w * half[0] + y * half[2] - z * half[1];
+        m_q[2] = y + w * half[1] - x * half[2] + z * half[0];
+        m_q[3] = z + w * half[2] + x * half[1] - y * half[0];
+        double norm = std::sqrt(m_q[0] * m_q[0] + m_q[1] * m_q[1] + m_q[2] * m_q[2] + m_q[3] * m_q[3]);
+        for (double& component : m_q) {
+            component /= norm;
+        }
+
+        // At rest the accelerometer reads +1 g along world up
+        const double up[3] = { 0.0, 0.0, 1.0 };
+        double specificForce[3];
+        worldToBody(up, specificForce);
+
+        double driftStep = m_errors.gyro_drift_dps * std::sqrt(dt);
+        double accel[3];
+        double gyro[3];
+        for (int i = 0; i < 3; i++) {
+            m_gyroDrift[i] += driftStep * m_gauss(m_rng);
+            accel[i] = specificForce[i] + linear[i] + m_errors.accel_bias_g[i] + m_errors.accel_noise_g * m_gauss(m_rng);
+            gyro[i] = rate[i] + m_errors.gyro_bias_dps[i] + m_gyroDrift[i] + m_errors.gyro_noise_dps * m_gauss(m_rng);
+        }
+
+        Serial::ImuSample sample;
+        sample.device_time_us = static_cast<uint32_t>(static_cast<uint64_t>(
+            m_time * 1e6 * (1.0 + m_errors.clock_error_ppm * 1e-6)));
+        sample.has_device_time = true;
+        m_time += dt;
+
+        sample.ax = toCounts(accel[0], m_accelScale);
+        sample.ay = toCounts(accel[1], m_accelScale);
+        sample.az = toCounts(accel[2], m_accelScale);
+        sample.gx = toCounts(gyro[0], m_gyroScale);
+        sample.gy = toCounts(gyro[1], m_gyroScale);
+        sample.gz = toCounts(gyro[2], m_gyroScale);
+        return sample;
+    }
+
+    double ImuModel::time() const {
+        return m_time;
+    }
+
+    void ImuModel::gravityDirection(double out[3]) const {
+        const double up[3] = { 0.0, 0.0, 1.0 };
+        worldToBody(up, out);
+    }
+
+    void ImuModel::gyroBias(double out[3]) const {
+        for (int i = 0; i < 3; i++) {
+            out[i] = m_errors.gyro_bias_dps[i] + m_gyroDrift[i];
+        }
+    }
+
+    void ImuModel::setRanges(int accel_range, int gyro_range) {
+        m_accelScale = ACCEL_COUNTS_PER_G / (1 << accel_range);
+        m_gyroScale = GYRO_COUNTS_PER_DPS / (1 << gyro_range);
+    }
+
+    StreamEncoder::StreamEncoder(bool binary, const FaultConfig& faults, uint32_t seed)
+        : m_binary(binary), m_faults(faults), m_rng(seed), m_uniform(0.0, 1.0), m_sequence(0)
+    {
+    }
+
+    void StreamEncoder::encode(const Serial::ImuSample& sample, std::vector<char>& out) {
+        // The firmware numbers every frame it reads, so a drop shows up as a sequence gap
+        uint16_t sequence = m_sequence++;
+        m_stats.frames++;
+
+        if (m_faults.burst_rate > 0.0 && m_uniform(m_rng) < m_faults.burst_rate) {
+            std::uniform_int_distribution<int> byte(0, 255);
+            for (size_t i = 0; i < m_faults.burst_bytes; i++) {
+                out.push_back(static_cast<char>(byte(m_rng)));
+            }
+            m_stats.bursts++;
+            m_stats.bytes += m_faults.burst_bytes;
+        }
+
+        if (m_faults.drop_rate > 0.0 && m_uniform(m_rng) < m_faults.drop_rate) {
+            m_stats.dropped++;
+            return;
+        }
+
+        // Same bytes as esp32-files/src/main.cpp
+        char frame[128];
+        size_t length;
+        if (m_binary) {
+            length = Serial::encodeBinarySample(sample, sequence, reinterpret_cast<uint8_t*>(frame));
+        } else {
+            length = static_cast<size_t>(std::snprintf(frame, sizeof(frame),
+                "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d,\"t\":%lu,\"n\":%u}\n",
+                sample.ax, sample.ay, sample.az, sample.gx, sample.gy, sample.gz,
+                static_cast<unsigned long>(sample.device_time_us), static_cast<unsigned>(sequence)));
+        }
+
+        if (m_faults.corrupt_rate > 0.0 && m_uniform(m_rng) < m_faults.corrupt_rate) {
+            std::uniform_int_distribution<size_t> position(0, length - 1);
+            std::uniform_int_distribution<int> bit(0, 7);
+            frame[position(m_rng)] ^= static_cast<char>(1 << bit(m_rng));
+            m_stats.corrupted++;
+        }
+
+        out.insert(out.end(), frame, frame + length);
+        m_stats.bytes += length;
+    }
+
+    const StreamStats& StreamEncoder::stats() const {
+        return m_stats;
+    }
+
+    void StreamEncoder::setBinary(bool binary) {
+        m_binary = binary;
+    }
+
+    FakeDevice::FakeDevice(const std::vector<MotionSegment>& profile, const SensorErrors& errors,
+                           const FaultConfig& faults, const Serial::DeviceConfig& config, uint32_t seed)
+        : m_model(profile, errors, seed), m_encoder(config.binary, faults, seed * 104729u + 1),
+          m_config(config)
+    {
+        m_model.setRanges(m_config.accel_range, m_config.gyro_range);
+    }
+
+    size_t FakeDevice::receive(const char* data, size_t size, std::vector<char>& out) {
+        size_t handled = 0;
+        m_commands.feed(data, size, [&](const Serial::Frame& frame) {
+            Serial::ControlCommand command;
+            uint32_t value = 0;
+            if (frame.type != Serial::FrameType::Binary ||
+                !Serial::decodeCommand(reinterpret_cast<const uint8_t*>(frame.data), frame.size, command, value)) {
+                return;
+            }
+
+            // Answer in the format the host is still expecting, then switch
+            bool wasBinary = m_config.binary;
+            Serial::ConfigReport report;
+            report.command = command;
+            report.status = Serial::applyCommand(m_config, command, value);
+            report.config = m_config;
+
+            char buffer[Serial::CONFIG_REPORT_MAX_SIZE];
+            size_t length = Serial::encodeConfigReport(report, wasBinary, buffer);
+            out.insert(out.end(), buffer, buffer + length);
+
+            m_encoder.setBinary(m_config.binary);
+            m_model.setRanges(m_config.accel_range, m_config.gyro_range);
+            handled++;
+        });
+        return handled;
+    }
+
+    void FakeDevice::sample(std::vector<char>& out) {
+        m_encoder.encode(m_model.next(samplePeriod()), out);
+    }
+
+    const Serial::DeviceConfig& FakeDevice::config() const {
+        return m_config;
+    }
+
+    double FakeDevice::samplePeriod() const {
+        return 1.0 / m_config.rate_hz;
+    }
+
+    const StreamStats& FakeDevice::stats() const {
+        return m_encoder.stats();
+    }
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "../libSerial/sample.h"
+#include "../libSerial/control_protocol.h"
+#include "../libSerial/frame_decoder.h"
+
+namespace Simulator {
+
+    // MPU6050 defaults used by the firmware (+-2 g, +-250 deg/s)
+    constexpr double ACCEL_COUNTS_PER_G = 16384.0;
+    constexpr double GYRO_COUNTS_PER_DPS = 131.0;
+
+    // Kinds of scripted motion
+    enum class MotionKind {
+        Rest,    // Held still
+        Rotate,  // Constant angular rate about one axis
+        Shake,   // Sinusoidal linear acceleration along one axis
+        Tap      // Short acceleration spike along one axis, then still
+    };
+
+    // One step of a motion profile
+    struct MotionSegment {
+        MotionKind kind = MotionKind::Rest;
+        double duration_s = 1.0;
+        int axis = 2;              // 0 = x, 1 = y, 2 = z (body frame)
+        double magnitude = 0.0;    // deg/s for Rotate, g for Shake and Tap
+        double frequency_hz = 0.0; // Shake frequency
+    };
+
+    // Sensor imperfections layered on top of the ideal motion
+    struct SensorErrors {
+        double accel_noise_g = 0.002;       // White noise, standard deviation
+        double gyro_noise_dps = 0.05;
+        double accel_bias_g[3] = { 0.0, 0.0, 0.0 };
+        double gyro_bias_dps[3] = { 0.0, 0.0, 0.0 };
+        double gyro_drift_dps = 0.0;        // Bias random walk per sqrt(second)
+        double clock_error_ppm = 0.0;       // Device micros() runs this much fast (+) or slow (-)
+    };
+
+    /**
+     * Parse a motion profile from text, segments separated by commas:
+     *   rest:SECONDS
+     *   rotate:AXIS:DEG_PER_S:SECONDS
+     *   shake:AXIS:G:HZ:SECONDS
+     *   tap:AXIS:G
+     * e.g. "rest:2,rotate:z:90:4,shake:x:0.5:5:2,tap:z:3"
+     * @param spec Profile text
+     * @param profile Receives the segments
+     * @return True if every segment parsed
+     */
+    bool parseProfile(const std::string& spec, std::vector<MotionSegment>& profile);
+
+    /**
+     * Rigid-body IMU model that plays a motion profile (looping) and produces
+     * raw MPU6050 counts. Orientation is integrated so gravity moves between
+     * the accelerometer axes during rotations. Deterministic for a given seed.
+     */
+    class ImuModel {
+    public:
+        /**
+         * Constructor
+         * @param profile Motion segments, played in order and repeated
+         * @param errors Noise, bias and drift to add
+         * @param seed Random seed (each virtual device should use its own)
+         */
+        ImuModel(const std::vector<MotionSegment>& profile, const SensorErrors& errors, uint32_t seed);
+
+        /**
+         * Advance the simulation by one sample period
+         * @param dt Sample period in seconds
+         * @return Raw counts and device timestamp as the firmware would send them
+         */
+        Serial::ImuSample next(double dt);
+
+        /**
+         * Get the simulated time
+         * @return Seconds since the model started
+         */
+        double time() const;
+
+        /**
+         * Get the true gravity direction as of the last sample, for scoring estimators
+         * @param out Receives world up in the body frame (what the accelerometer reads at rest, normalized)
+         */
+        void gravityDirection(double out[3]) const;
+
+        /**
+         * Get the true gyro bias as of the last sample, for scoring bias estimators
+         * @param out Receives x, y, z in deg/s (the configured bias plus the drift so far)
+         */
+        void gyroBias(double out[3]) const;
+
+        /**
+         * Select the full-scale ranges (counts per unit halve with each step)
+         * @param accel_range AFS_SEL 0..3 (+-2/4/8/16 g)
+         * @param gyro_range FS_SEL 0..3 (+-250/500/1000/2000 deg/s)
+         */
+        void setRanges(int accel_range, int gyro_range);
+
+    private:
+        // Segment active at profile time t, and the time elapsed within it
+        const MotionSegment& segmentAt(double t, double& elapsed) const;
+
+        // Rotate v from the world frame into the body frame
+        void worldToBody(const double v[3], double out[3]) const;
+
+        // Clamp and round to an int16 register value
+        static int toCounts(double value, double scale);
+
+        std::vector<MotionSegment> m_profile;
+        double m_profileLength;
+        SensorErrors m_errors;
+        std::mt19937 m_rng;
+        std::normal_distribution<double> m_gauss;
+        double m_time;
+        double m_q[4];           // Body-to-world orientation (w, x, y, z)
+        double m_gyroDrift[3];   // Random-walk part of the gyro bias
+        double m_accelScale;     // Counts per g at the current range
+        double m_gyroScale;      // Counts per deg/s at the current range
+    };
+
+    // Ways to damage the byte stream
+    struct FaultConfig {
+        double corrupt_rate = 0.0;   // Probability a frame has one byte flipped
+        double drop_rate = 0.0;      // Probability a frame is never sent
+        double burst_rate = 0.0;     // Probability of a garbage burst before a frame
+        size_t burst_bytes = 64;     // Length of each burst
+    };
+
+    // Counts of what the encoder did
+    struct StreamStats {
+        uint64_t frames = 0;
+        uint64_t dropped = 0;
+        uint64_t corrupted = 0;
+        uint64_t bursts = 0;
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * Turns samples into the exact bytes esp32-files/src/main.cpp sends
+     * (JSON lines or COBS/CRC16 binary frames, with micros() and sequence
+     * number) and injects faults.
+     */
+    class StreamEncoder {
+    public:
+        /**
+         * Constructor
+         * @param binary True for binary frames, false for JSON lines
+         * @param faults Fault injection settings
+         * @param seed Random seed for fault placement
+         */
+        StreamEncoder(bool binary, const FaultConfig& faults, uint32_t seed);
+
+        /**
+         * Append one sample's bytes (or nothing, if dropped) to out
+         * @param sample Sample to send
+         * @param out Byte buffer to append to
+         */
+        void encode(const Serial::ImuSample& sample, std::vector<char>& out);
+
+        /**
+         * Get what has been sent so far
+         * @return Frame, fault and byte counts
+         */
+        const StreamStats& stats() const;
+
+        /**
+         * Switch output format (as after a SetFormat command)
+         * @param binary True for binary frames, false for JSON lines
+         */
+        void setBinary(bool binary);
+
+    private:
+        bool m_binary;
+        FaultConfig m_faults;
+        std::mt19937 m_rng;
+        std::uniform_real_distribution<double> m_uniform;
+        uint16_t m_sequence;
+        StreamStats m_stats;
+    };
+
+    /**
+     * Host-side stand-in for the ESP32: an ImuModel and StreamEncoder behind
+     * the firmware's control channel. Commands written by the host are
+     * applied with the same rules as esp32-files/src/main.cpp and answered
+     * with config reports, so renegotiation can be exercised without hardware.
+     */
+    class FakeDevice {
+    public:
+        /**
+         * Constructor
+         * @param profile Motion segments to play
+         * @param errors Sensor imperfections
+         * @param faults Damage applied to sample frames (never to reports)
+         * @param config Settings at power-up (rate may exceed the real sensor's limit)
+         * @param seed Random seed
+         */
+        FakeDevice(const std::vector<MotionSegment>& profile, const SensorErrors& errors,
+                   const FaultConfig& faults, const Serial::DeviceConfig& config, uint32_t seed);
+
+        /**
+         * Handle bytes the host sent; every complete command is applied and answered
+         * @param data Bytes from the host
+         * @param size Number of bytes
+         * @param out Byte buffer the reports are appended to
+         * @return Number of commands handled
+         */
+        size_t receive(const char* data, size_t size, std::vector<char>& out);
+
+        /**
+         * Read the sensor once and append the sample in the current format
+         * @param out Byte buffer to append to
+         */
+        void sample(std::vector<char>& out);
+
+        /**
+         * Get the current settings
+         * @return Settings after the last accepted command
+         */
+        const Serial::DeviceConfig& config() const;
+
+        /**
+         * Get the time between samples at the current rate
+         * @return Seconds per sample
+         */
+        double samplePeriod() const;
+
+        /**
+         * Get what has been sent so far
+         * @return Frame, fault and byte counts of the sample stream
+         */
+        const StreamStats& stats() const;
+
+    private:
+        ImuModel m_model;
+        StreamEncoder m_encoder;
+        Serial::DeviceConfig m_config;
+        Serial::FrameDecoder m_commands;  // Reassembles command frames from the host
+    };
+}
@@ -0,0 +1,222 @@
+#include "batch_uncoupler.h"
+#include "lanes.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Uncoupler {
+
+// Sensors advanced together in one set of registers
+static const size_t LANE_COUNT = 4;
+
+// Steps in the window before its average is used, as in SensorUncoupler
+static const size_t MIN_HISTORY = 5;
+
+// Magnitude low-pass cutoff as a fraction of the gravity vector's, as in SensorUncoupler
+static const float MAGNITUDE_CUTOFF_RATIO = 0.5f;
+
+// Gravity reported until then, as in SensorUncoupler
+static const float PLACEHOLDER_GRAVITY[3] = { 0.0f, 0.0f, 9.81f };
+
+BatchUncoupler::BatchUncoupler(size_t sensors, size_t gravity_filter_size)
+    : m_sensors(sensors),
+      m_stride((sensors + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT),
+      m_gyroCalibrationEnabled(false),
+      m_gravity_filter_size(std::max(size_t(1), gravity_filter_size)),
+      m_sample_rate(50.0f),
+      m_gyro_offset(3 * m_stride, 0.0f),
+      m_accel(3 * m_stride, 0.0f),
+      m_history_sum(3 * m_stride, 0.0),
+      m_history_capacity(0),
+      m_history_head(0),
+      m_history_count(0),
+      m_gravity_ic1(4 * m_stride, 0.0),
+      m_gravity_ic2(4 * m_stride, 0.0),
+      m_linear_ic1(3 * m_stride, 0.0),
+      m_linear_ic2(3 * m_stride, 0.0),
+      m_gravityPrimed(false),
+      m_linearPrimed(false),
+      m_gravity(4 * m_stride, 0.0f),
+      m_linear(3 * m_stride, 0.0f)
+{
+    // Same defaults as a SensorUncoupler's settings
+    UncouplerSettings defaults;
+    m_gravity_cutoff_hz = defaults.gravity_cutoff_hz;
+    m_linear_cutoff_hz = defaults.linear_cutoff_hz;
+    deriveCoefficients();
+    restart();
+}
+
+size_t BatchUncoupler::sensorCount() const {
+    return m_sensors;
+}
+
+void BatchUncoupler::setGyroCalibrationOffsets(size_t sensor, float gx_offset, float gy_offset, float gz_offset) {
+    if (sensor >= m_sensors) return;
+    m_gyro_offset[0 * m_stride + sensor] = gx_offset;
+    m_gyro_offset[1 * m_stride + sensor] = gy_offset;
+    m_gyro_offset[2 * m_stride + sensor] = gz_offset;
+}
+
+void BatchUncoupler::enableGyroCalibration(bool enable) {
+    m_gyroCalibrationEnabled = enable;
+}
+
+void BatchUncoupler::setGravityCutoff(float cutoff_hz) {
+    if (cutoff_hz <= 0.0f) return;
+    m_gravity_cutoff_hz = cutoff_hz;
+    deriveCoefficients();
+}
+
+void BatchUncoupler::setLinearCutoff(float cutoff_hz) {
+    if (cutoff_hz <= 0.0f) return;
+    m_linear_cutoff_hz = cutoff_hz;
+    deriveCoefficients();
+}
+
+void BatchUncoupler::setGravityFilterSize(size_t size) {
+    // Minimum size of 1 to avoid division by zero
+    m_gravity_filter_size = std::max(size_t(1), size);
+    restart();
+}
+
+void BatchUncoupler::setSampleRate(float rate_hz) {
+    if (rate_hz <= 0.0f || rate_hz == m_sample_rate) return;
+
+    // Same window length in seconds
+    float windowSeconds = m_gravity_filter_size / m_sample_rate;
+    m_sample_rate = rate_hz;
+    deriveCoefficients();
+    setGravityFilterSize(static_cast<size_t>(std::lround(windowSeconds * rate_hz)));
+}
+
+float BatchUncoupler::getGravityMagnitude(size_t sensor) const {
+    return sensor < m_sensors ? m_gravity[MAGNITUDE * m_stride + sensor] : 0.0f;
+}
+
+void BatchUncoupler::deriveCoefficients() {
+    m_gravityCoefficients = sectionCoefficients(FilterType::LowPass, m_gravity_cutoff_hz, BUTTERWORTH_Q, m_sample_rate);
+    m_magnitudeCoefficients = sectionCoefficients(FilterType::LowPass, MAGNITUDE_CUTOFF_RATIO * m_gravity_cutoff_hz,
+                                                  BUTTERWORTH_Q, m_sample_rate);
+    m_linearCoefficients = sectionCoefficients(FilterType::LowPass, m_linear_cutoff_hz, BUTTERWORTH_Q, m_sample_rate);
+}
+
+void BatchUncoupler::restart() {
+    // Only grows, so going back to a smaller window allocates nothing
+    if (m_gravity_filter_size > m_history_capacity) {
+        m_history_capacity = m_gravity_filter_size;
+        m_history.assign(3 * m_history_capacity * m_stride, 0.0f);
+    }
+    std::fill(m_history_sum.begin(), m_history_sum.end(), 0.0);
+    m_history_head = 0;
+    m_history_count = 0;
+    m_gravityPrimed = false;
+    m_linearPrimed = false;
+    for (size_t sensor = 0; sensor < m_stride; sensor++) {
+        for (size_t axis = 0; axis < 3; axis++) {
+            m_gravity[axis * m_stride + sensor] = PLACEHOLDER_GRAVITY[axis];
+        }
+        m_gravity[MAGNITUDE * m_stride + sensor] = PLACEHOLDER_GRAVITY[2];
+    }
+}
+
+void BatchUncoupler::process(const Serial::ImuSample* samples, UncoupledData* out) {
+    // Gather the readings into one array per axis (padding lanes stay at zero)
+    for (size_t sensor = 0; sensor < m_sensors; sensor++) {
+        m_accel[0 * m_stride + sensor] = static_cast<float>(samples[sensor].ax);
+        m_accel[1 * m_stride + sensor] = static_cast<float>(samples[sensor].ay);
+        m_accel[2 * m_stride + sensor] = static_cast<float>(samples[sensor].az);
+    }
+
+    // The window slides the same way for every sensor, so the branches below are per step, not per lane
+    bool full = m_history_count == m_gravity_filter_size;
+    if (!full) m_history_count++;
+    size_t slot = m_history_head;
+    if (++m_history_head == m_gravity_filter_size) m_history_head = 0;
+    bool averaged = m_history_count >= MIN_HISTORY;
+    bool primeGravity = averaged && !m_gravityPrimed;
+    bool primeLinear = !m_linearPrimed;
+    Lanes inverseCount = Lanes::all(1.0 / m_history_count);
+    Lanes zero = Lanes::all(0.0);
+
+    for (size_t first = 0; first < m_stride; first += LANE_COUNT) {
+        Lanes accel[3];
+        Lanes gravity[3];
+        for (size_t axis = 0; axis < 3; axis++) {
+            size_t at = axis * m_stride + first;
+            float* history = &m_history[(axis * m_history_capacity + slot) * m_stride + first];
+
+            // Slide the window: the oldest step leaves the sum once it is full
+            accel[axis] = Lanes::load(&m_accel[at]);
+            Lanes sum = Lanes::load(&m_history_sum[at]) + accel[axis];
+            if (full) sum = sum - Lanes::load(history);
+            sum.store(&m_history_sum[at]);
+            std::copy(&m_accel[at], &m_accel[at] + LANE_COUNT, history);
+
+            gravity[axis] = sum * inverseCount;
+        }
+
+        if (averaged) {
+            // Low-pass the average and its magnitude, starting settled on the first average
+            Lanes magnitude = sqrt(gravity[0] * gravity[0] + gravity[1] * gravity[1] + gravity[2] * gravity[2]);
+            Lanes window[4] = { gravity[0], gravity[1], gravity[2], magnitude };
+            for (size_t quantity = 0; quantity < 4; quantity++) {
+                size_t at = quantity * m_stride + first;
+                if (primeGravity) {
+                    zero.store(&m_gravity_ic1[at]);
+                    window[quantity].store(&m_gravity_ic2[at]);
+                }
+                const SectionCoefficients& c = quantity == MAGNITUDE ? m_magnitudeCoefficients : m_gravityCoefficients;
+                Lanes filtered = runSection(c, window[quantity], &m_gravity_ic1[at], &m_gravity_ic2[at]);
+                filtered.store(&m_gravity[at]);
+                if (quantity < 3) gravity[quantity] = filtered;
+            }
+        } else {
+            for (size_t axis = 0; axis < 3; axis++) {
+                gravity[axis] = Lanes::all(PLACEHOLDER_GRAVITY[axis]);
+            }
+        }
+
+        // Remove gravity and smooth what is left; the filter settles again on
+        // every step until gravity has an estimate
+        for (size_t axis = 0; axis < 3; axis++) {
+            size_t at = axis * m_stride + first;
+            Lanes linear = accel[axis] - gravity[axis];
+            if (primeLinear) {
+                zero.store(&m_linear_ic1[at]);
+                linear.store(&m_linear_ic2[at]);
+            }
+            runSection(m_linearCoefficients, linear, &m_linear_ic1[at], &m_linear_ic2[at]).store(&m_linear[at]);
+        }
+    }
+    m_gravityPrimed = m_gravityPrimed || primeGravity;
+    m_linearPrimed = m_gravityPrimed;
+
+    // Scatter into one record per sensor
+    for (size_t sensor = 0; sensor < m_sensors; sensor++) {
+        const Serial::ImuSample& sample = samples[sensor];
+        UncoupledData& result = out[sensor];
+        result.ax_raw = m_accel[0 * m_stride + sensor];
+        result.ay_raw = m_accel[1 * m_stride + sensor];
+        result.az_raw = m_accel[2 * m_stride + sensor];
+
+        // Offsets are whole counts, as in SensorUncoupler
+        int gx = sample.gx, gy = sample.gy, gz = sample.gz;
+        if (m_gyroCalibrationEnabled) {
+            gx -= static_cast<int>(m_gyro_offset[0 * m_stride + sensor]);
+            gy -= static_cast<int>(m_gyro_offset[1 * m_stride + sensor]);
+            gz -= static_cast<int>(m_gyro_offset[2 * m_stride + sensor]);
+        }
+        result.gx_cal = static_cast<float>(gx);
+        result.gy_cal = static_cast<float>(gy);
+        result.gz_cal = static_cast<float>(gz);
+
+        result.grav_x = m_gravity[X * m_stride + sensor];
+        result.grav_y = m_gravity[Y * m_stride + sensor];
+        result.grav_z = m_gravity[Z * m_stride + sensor];
+        result.ax_linear = m_linear[X * m_stride + sensor];
+        result.ay_linear = m_linear[Y * m_stride + sensor];
+        result.az_linear = m_linear[Z * m_stride + sensor];
+    }
+}
+
+} // namespace Uncoupler
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "../libSerial/sample.h"
+#include "uncoupler.h"
+
+namespace Uncoupler {
+
+    /**
+     * Moving-average uncoupler for many IMUs stepped together, e.g. every
+     * sensor on a glove. It computes what one SensorUncoupler per sensor
+     * computes in the MovingAverage mode (window average, gravity low-pass,
+     * gravity removal, linear acceleration low-pass, gyro offsets), but keeps
+     * all sensors' state in structure-of-arrays layout: each quantity is one
+     * contiguous array indexed by sensor. A step advances sensors four at a
+     * time in SIMD registers (AVX, SSE2 or NEON, scalar elsewhere), and the
+     * whole state of a 16-sensor glove at the default window is about 13 KB.
+     *
+     * All sensors share the window, cutoffs and sample rate. The gyro-aided
+     * gravity modes need per-sensor attitude filters and stay with
+     * SensorUncoupler, as do sample rates measured from device timestamps:
+     * call setSampleRate with the rate the sensors are stepped at.
+     *
+     * Not thread-safe; configure it from the thread that calls process().
+     */
+    class BatchUncoupler {
+    public:
+        /**
+         * Constructor
+         * @param sensors Number of sensors stepped together
+         * @param gravity_filter_size Size of the moving average window, in steps
+         */
+        explicit BatchUncoupler(size_t sensors, size_t gravity_filter_size = 50);
+
+        /**
+         * Get the number of sensors
+         * @return Sensors each process call expects
+         */
+        size_t sensorCount() const;
+
+        /**
+         * Set one sensor's gyroscope calibration offsets
+         * @param sensor Sensor index
+         * @param gx_offset X-axis gyroscope offset
+         * @param gy_offset Y-axis gyroscope offset
+         * @param gz_offset Z-axis gyroscope offset
+         */
+        void setGyroCalibrationOffsets(size_t sensor, float gx_offset, float gy_offset, float gz_offset);
+
+        /**
+         * Enable/disable gyroscope calibration for every sensor
+         * @param enable True to subtract the offsets
+         */
+        void enableGyroCalibration(bool enable);
+
+        /**
+         * Set the cutoff of the gravity low-pass (2nd-order Butterworth)
+         * @param cutoff_hz -3 dB frequency
+         */
+        void setGravityCutoff(float cutoff_hz);
+
+        /**
+         * Set the cutoff of the linear acceleration low-pass (2nd-order Butterworth)
+         * @param cutoff_hz -3 dB frequency
+         */
+        void setLinearCutoff(float cutoff_hz);
+
+        /**
+         * Set gravity filter window size; the window restarts empty
+         * @param size The new size for the moving average window, in steps
+         */
+        void setGravityFilterSize(size_t size);
+
+        /**
+         * Tell the filters the step rate changed. The window is rescaled to
+         * keep its length in seconds and the cutoffs stay where they are.
+         * @param rate_hz New steps per second (the defaults assume 50 Hz)
+         */
+        void setSampleRate(float rate_hz);
+
+        /**
+         * Advance every sensor by one sample
+         * @param samples One sample per sensor, in sensor order (sensorCount() of them)
+         * @param out Receives the uncoupled data per sensor (sensorCount() entries)
+         */
+        void process(const Serial::ImuSample* samples, UncoupledData* out);
+
+        /**
+         * Get one sensor's estimated gravity magnitude
+         * @param sensor Sensor index
+         * @return Low-pass filtered magnitude of the window average
+         */
+        float getGravityMagnitude(size_t sensor) const;
+
+    private:
+        // Clear the window and the filters, so the next steps start over
+        void restart();
+
+        // Re-derive the low-passes' coefficients for the current cutoffs and rate
+        void deriveCoefficients();
+
+        // Quantities with a value per sensor; each is one array of m_stride floats or doubles
+        enum Quantity { X, Y, Z, MAGNITUDE };
+
+        size_t m_sensors;
+        size_t m_stride;        // Sensors rounded up to a whole number of lanes
+        bool m_gyroCalibrationEnabled;
+
+        // Settings shared by every sensor
+        size_t m_gravity_filter_size;
+        float m_gravity_cutoff_hz;
+        float m_linear_cutoff_hz;
+        float m_sample_rate;
+        SectionCoefficients m_gravityCoefficients;
+        SectionCoefficients m_magnitudeCoefficients;   // Half the gravity cutoff
+        SectionCoefficients m_linearCoefficients;
+
+        // Per-sensor gyro offsets, [axis * m_stride + sensor]
+        std::vector<float> m_gyro_offset;
+
+        // Accelerometer readings of the current step, [axis * m_stride + sensor]
+        std::vector<float> m_accel;
+
+        // Window: a ring of the latest steps, [(axis * capacity + slot) * m_stride + sensor],
+        // and exact running sums of the readings in it (counts are integers, so a
+        // double sum never rounds and never needs re-summing)
+        std::vector<float> m_history;
+        std::vector<double> m_history_sum;
+        size_t m_history_capacity;
+        size_t m_history_head;
+        size_t m_history_count;
+
+        // Low-pass integrator states, [quantity * m_stride + sensor]: gravity over
+        // x, y, z and magnitude, linear acceleration over x, y, z
+        std::vector<double> m_gravity_ic1;
+        std::vector<double> m_gravity_ic2;
+        std::vector<double> m_linear_ic1;
+        std::vector<double> m_linear_ic2;
+        bool m_gravityPrimed;   // Gravity filter settled on the first window average
+        bool m_linearPrimed;    // Linear filter settled since gravity had an estimate
+
+        // Outputs of the current step, [quantity * m_stride + sensor]
+        std::vector<float> m_gravity;
+        std::vector<float> m_linear;
+    };
+
+} // namespace Uncoupler
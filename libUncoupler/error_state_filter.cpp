@@ -0,0 +1,169 @@
+#include "error_state_filter.h"
+#include "orientation.h"
+#include <cmath>
+
+namespace Uncoupler {
+
+// Keep the symmetric blocks symmetric; rounding would otherwise split them apart
+static void symmetrize(Matrix3& a) {
+    for (size_t r = 0; r < 3; r++) {
+        for (size_t c = r + 1; c < 3; c++) {
+            float mean = 0.5f * (a.m[r][c] + a.m[c][r]);
+            a.m[r][c] = mean;
+            a.m[c][r] = mean;
+        }
+    }
+}
+
+ErrorStateFilter::ErrorStateFilter(const ErrorStateNoise& noise)
+    : m_noise(noise),
+      m_q{1.0f, 0.0f, 0.0f, 0.0f},
+      m_bias{0.0f, 0.0f, 0.0f},
+      m_Ptt(Matrix3::zero()),
+      m_Ptb(Matrix3::zero()),
+      m_Pbb(Matrix3::zero()),
+      m_rejectedTime(0.0f),
+      m_initialized(false)
+{
+}
+
+void ErrorStateFilter::reset(float ax, float ay, float az) {
+    quaternionFromUp(ax, ay, az, m_q);
+    m_bias[0] = m_bias[1] = m_bias[2] = 0.0f;
+    m_Ptt = (m_noise.initial_attitude * m_noise.initial_attitude) * Matrix3::identity();
+    m_Ptb = Matrix3::zero();
+    m_Pbb = (m_noise.initial_bias * m_noise.initial_bias) * Matrix3::identity();
+    m_rejectedTime = 0.0f;
+    m_initialized = true;
+}
+
+void ErrorStateFilter::update(float gx, float gy, float gz, float ax, float ay, float az, float dt,
+                              float gravity_magnitude) {
+    float rate[3] = { gx - m_bias[0], gy - m_bias[1], gz - m_bias[2] };
+    predict(rate, dt);
+
+    float norm = std::sqrt(ax * ax + ay * ay + az * az);
+    if (norm <= 0.0f) return;
+
+    float up[3] = { ax / norm, ay / norm, az / norm };
+    float deviation = gravity_magnitude > 0.0f ? std::fabs(norm / gravity_magnitude - 1.0f) : 0.0f;
+    if (correct(up, deviation, deviation <= m_noise.bias_trust)) {
+        m_rejectedTime = 0.0f;
+        return;
+    }
+
+    // Rejected for long enough that the attitude itself may be off: widen its
+    // uncertainty again so the accelerometer can pull it back
+    m_rejectedTime += dt;
+    if (m_rejectedTime > m_noise.max_rejected_time) {
+        m_Ptt = (m_noise.initial_attitude * m_noise.initial_attitude) * Matrix3::identity();
+        m_Ptb = Matrix3::zero();
+        m_rejectedTime = 0.0f;
+    }
+}
+
+void ErrorStateFilter::predict(const float rate[3], float dt) {
+    float angle[3] = { rate[0] * dt, rate[1] * dt, rate[2] * dt };
+    rotate(angle);
+
+    // Error transition F = [A, -I dt; 0, I] with A = R(angle)^T to second order;
+    // F P F^T worked out block by block instead of as a 6x6 product
+    Matrix3 K = skew(angle);
+    Matrix3 A = Matrix3::identity() - K + 0.5f * (K * K);
+    Matrix3 APtb = A * m_Ptb;
+    Matrix3 cross = APtb + transpose(APtb);
+
+    float attitudeNoise = m_noise.gyro_noise * m_noise.gyro_noise * dt * dt;
+    float biasNoise = m_noise.gyro_bias_walk * m_noise.gyro_bias_walk * dt;
+
+    m_Ptt = A * m_Ptt * transpose(A) - dt * cross + (dt * dt) * m_Pbb + attitudeNoise * Matrix3::identity();
+    m_Ptb = APtb - dt * m_Pbb;
+    m_Pbb = m_Pbb + biasNoise * Matrix3::identity();
+    symmetrize(m_Ptt);
+}
+
+bool ErrorStateFilter::correct(const float up[3], float deviation, bool updateBias) {
+    // Predicted reading h and its Jacobian: h(q * Exp(e)) = h + skew(h) e
+    float h[3];
+    upFromQuaternion(m_q, h);
+    Matrix3 H = skew(h);
+    Matrix3 Ht = transpose(H);
+
+    // Gains for the attitude and bias halves of the error state
+    Matrix3 PHt_t = m_Ptt * Ht;
+    Matrix3 PHt_b = transpose(m_Ptb) * Ht;
+    // A reading off gravity's magnitude is partly linear acceleration: trust it less
+    float sigma = m_noise.accel_noise * (1.0f + deviation / m_noise.bias_trust);
+    Matrix3 S = H * PHt_t + (sigma * sigma) * Matrix3::identity();
+    Matrix3 Sinv;
+    if (!invert(S, Sinv)) return false;
+
+    // Normalized innovation squared: reject readings the model says are too unlikely
+    float residual[3] = { up[0] - h[0], up[1] - h[1], up[2] - h[2] };
+    float nis = 0.0f;
+    for (size_t r = 0; r < 3; r++) {
+        nis += residual[r] * (Sinv.m[r][0] * residual[0] + Sinv.m[r][1] * residual[1] + Sinv.m[r][2] * residual[2]);
+    }
+    if (nis > m_noise.innovation_gate) return false;
+
+    Matrix3 Kt = PHt_t * Sinv;
+    Matrix3 Kb = PHt_b * Sinv;
+
+    // Error estimate from the innovation, folded into the nominal state
+    float attitudeError[3];
+    for (size_t r = 0; r < 3; r++) {
+        attitudeError[r] = Kt.m[r][0] * residual[0] + Kt.m[r][1] * residual[1] + Kt.m[r][2] * residual[2];
+        if (updateBias) {
+            m_bias[r] += Kb.m[r][0] * residual[0] + Kb.m[r][1] * residual[1] + Kb.m[r][2] * residual[2];
+        }
+    }
+    rotate(attitudeError);
+
+    // P <- P - K H P, with H P = (P H^T)^T. With the bias held, its gain is
+    // zero and only the attitude rows change (the bias block stays as it was)
+    m_Ptt = m_Ptt - Kt * transpose(PHt_t);
+    m_Ptb = m_Ptb - Kt * transpose(PHt_b);
+    if (updateBias) {
+        m_Pbb = m_Pbb - Kb * transpose(PHt_b);
+        symmetrize(m_Pbb);
+    }
+    symmetrize(m_Ptt);
+    return true;
+}
+
+void ErrorStateFilter::rotate(const float angle[3]) {
+    // Exp(angle) as a unit quaternion
+    float theta = std::sqrt(angle[0] * angle[0] + angle[1] * angle[1] + angle[2] * angle[2]);
+    float w = std::cos(0.5f * theta);
+    float s = theta > 1e-6f ? std::sin(0.5f * theta) / theta : 0.5f;
+    float x = angle[0] * s, y = angle[1] * s, z = angle[2] * s;
+
+    float q0 = m_q[0], q1 = m_q[1], q2 = m_q[2], q3 = m_q[3];
+    float r0 = q0 * w - q1 * x - q2 * y - q3 * z;
+    float r1 = q0 * x + q1 * w + q2 * z - q3 * y;
+    float r2 = q0 * y - q1 * z + q2 * w + q3 * x;
+    float r3 = q0 * z + q1 * y - q2 * x + q3 * w;
+    float norm = std::sqrt(r0 * r0 + r1 * r1 + r2 * r2 + r3 * r3);
+    m_q[0] = r0 / norm;
+    m_q[1] = r1 / norm;
+    m_q[2] = r2 / norm;
+    m_q[3] = r3 / norm;
+}
+
+void ErrorStateFilter::gravity(float out[3]) const {
+    upFromQuaternion(m_q, out);
+}
+
+const float* ErrorStateFilter::quaternion() const {
+    return m_q;
+}
+
+const float* ErrorStateFilter::gyroBias() const {
+    return m_bias;
+}
+
+bool ErrorStateFilter::isInitialized() const {
+    return m_initialized;
+}
+
+} // namespace Uncoupler
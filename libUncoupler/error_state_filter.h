@@ -0,0 +1,117 @@
+#pragma once
+
+#include "matrix.h"
+
+namespace Uncoupler {
+
+    // Noise the error-state filter assumes. Accelerometer readings are used
+    // normalized, so their noise is in g.
+    struct ErrorStateNoise {
+        float gyro_noise = 0.01f;        // rad/s, white
+        float gyro_bias_walk = 2e-4f;    // rad/s per sqrt(s), how fast the bias may wander
+        float accel_noise = 0.03f;       // g, including the small accelerations of ordinary handling
+        float initial_attitude = 0.1f;   // rad, standard deviation after reset
+        float initial_bias = 0.02f;      // rad/s, standard deviation after reset
+        float bias_trust = 0.02f;        // Largest ||a| / g - 1| at which a reading may also correct the bias
+        float innovation_gate = 16.27f;  // Chi-square, 3 dof at 99.9%: readings less likely than this are rejected
+        float max_rejected_time = 1.0f;  // s of back-to-back rejections before the attitude uncertainty is reset
+    };
+
+    /**
+     * Error-state Kalman filter for attitude and gyro bias. The nominal state
+     * is the orientation quaternion and the gyro bias; the filter tracks the
+     * 6x6 covariance of small errors in them (3 attitude, 3 bias). Each
+     * sample the nominal attitude is propagated with the bias-corrected gyro
+     * rates, and the accelerometer's up direction corrects both the attitude
+     * and the bias, so a bias that drifts over a long session is learned
+     * instead of turning into tilt error. Bias about the vertical axis is not
+     * observable from the accelerometer and stays near its last estimate.
+     *
+     * Linear acceleration looks like tilt to the accelerometer, and a wrong
+     * bias learned from it would stay (about the vertical axis) until the
+     * sensor rotates. So the further a reading's magnitude is from gravity's,
+     * the noisier it is taken to be; readings whose innovation fails a
+     * chi-square test are rejected; and outside a narrow band around gravity
+     * the bias is held (a Schmidt update: only the attitude is corrected).
+     *
+     * The covariance is kept as three 3x3 blocks (attitude, cross and bias)
+     * and every product is a fixed-size Matrix, so an update allocates
+     * nothing and costs a few hundred flops.
+     *
+     * Not thread-safe; SensorUncoupler owns one and runs it on the processing thread.
+     */
+    class ErrorStateFilter {
+    public:
+        /**
+         * Constructor
+         * @param noise Noise model
+         */
+        explicit ErrorStateFilter(const ErrorStateNoise& noise = ErrorStateNoise());
+
+        /**
+         * Start from the attitude an accelerometer reading implies, with zero bias
+         * @param ax X-axis acceleration (any units)
+         * @param ay Y-axis acceleration
+         * @param az Z-axis acceleration
+         */
+        void reset(float ax, float ay, float az);
+
+        /**
+         * Predict with the gyro, then correct with the accelerometer
+         * @param gx X-axis rate in rad/s
+         * @param gy Y-axis rate in rad/s
+         * @param gz Z-axis rate in rad/s
+         * @param ax X-axis acceleration (any units; all three zero = predict only)
+         * @param ay Y-axis acceleration
+         * @param az Z-axis acceleration
+         * @param dt Seconds since the previous sample
+         * @param gravity_magnitude Gravity's size in the units of a (0 = take every reading as gravity)
+         */
+        void update(float gx, float gy, float gz, float ax, float ay, float az, float dt, float gravity_magnitude = 0.0f);
+
+        /**
+         * Get the direction the accelerometer reads at rest (world up in the sensor frame)
+         * @param out Receives the normalized x, y, z
+         */
+        void gravity(float out[3]) const;
+
+        /**
+         * Get the orientation
+         * @return Sensor-to-world quaternion as w, x, y, z
+         */
+        const float* quaternion() const;
+
+        /**
+         * Get the estimated gyro bias
+         * @return x, y, z in rad/s (already subtracted from the rates update is given)
+         */
+        const float* gyroBias() const;
+
+        /**
+         * Check whether reset has been called
+         * @return True once the filter has a starting attitude
+         */
+        bool isInitialized() const;
+
+    private:
+        // Propagate the nominal attitude and the covariance by one gyro sample
+        void predict(const float rate[3], float dt);
+
+        // Fold in one normalized accelerometer reading, whose magnitude was off gravity's by
+        // deviation (a fraction); false if the innovation test rejected it
+        bool correct(const float up[3], float deviation, bool updateBias);
+
+        // q <- q * Exp(angle), renormalized
+        void rotate(const float angle[3]);
+
+        ErrorStateNoise m_noise;
+        float m_q[4];     // w, x, y, z
+        float m_bias[3];  // rad/s
+        Matrix3 m_Ptt;    // Attitude error covariance
+        Matrix3 m_Ptb;    // Attitude-bias cross covariance (the bias-attitude block is its transpose)
+        Matrix3 m_Pbb;    // Bias error covariance
+        float m_rejectedTime;  // Seconds since a reading last passed the innovation test
+        bool m_initialized;
+    };
+
+} // namespace Uncoupler
@@ -0,0 +1,119 @@
+#include "filter_bank.h"
+#include "lanes.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Uncoupler {
+
+static const double PI = 3.14159265358979323846;
+
+// Cutoffs at or above this fraction of the sample rate are pulled just under Nyquist
+static const double MAX_RELATIVE_FREQUENCY = 0.49;
+
+FilterBank::FilterBank(double sample_rate_hz)
+    : m_count(0),
+      m_sample_rate(sample_rate_hz > 0.0 ? sample_rate_hz : 50.0)
+{
+    clear();
+}
+
+void FilterBank::clear() {
+    m_count = 0;
+    for (size_t s = 0; s < MAX_SECTIONS; s++) {
+        std::fill(m_ic1[s], m_ic1[s] + LANES, 0.0);
+        std::fill(m_ic2[s], m_ic2[s] + LANES, 0.0);
+    }
+}
+
+bool FilterBank::addSection(FilterType type, double frequency_hz, double q) {
+    if (m_count == MAX_SECTIONS || frequency_hz <= 0.0 || q <= 0.0) return false;
+
+    Section& section = m_sections[m_count];
+    section.type = type;
+    section.frequency_hz = frequency_hz;
+    section.q = q;
+    derive(m_count);
+    std::fill(m_ic1[m_count], m_ic1[m_count] + LANES, 0.0);
+    std::fill(m_ic2[m_count], m_ic2[m_count] + LANES, 0.0);
+    m_count++;
+    return true;
+}
+
+bool FilterBank::addButterworth(FilterType type, double cutoff_hz, int order) {
+    if (type == FilterType::Notch || order <= 0 || order % 2 != 0) return false;
+    size_t sections = static_cast<size_t>(order / 2);
+    if (m_count + sections > MAX_SECTIONS) return false;
+
+    // Pole pairs of an order-N Butterworth: Q_k = 1 / (2 cos((2k - 1) pi / 2N))
+    for (size_t k = 1; k <= sections; k++) {
+        double q = 1.0 / (2.0 * std::cos((2.0 * k - 1.0) * PI / (2.0 * order)));
+        if (!addSection(type, cutoff_hz, q)) return false;
+    }
+    return true;
+}
+
+void FilterBank::setSampleRate(double sample_rate_hz) {
+    if (sample_rate_hz <= 0.0) return;
+    m_sample_rate = sample_rate_hz;
+    for (size_t s = 0; s < m_count; s++) {
+        derive(s);
+    }
+}
+
+double FilterBank::sampleRate() const {
+    return m_sample_rate;
+}
+
+size_t FilterBank::sectionCount() const {
+    return m_count;
+}
+
+SectionCoefficients sectionCoefficients(FilterType type, double frequency_hz, double q, double sample_rate_hz) {
+    double frequency = std::min(frequency_hz, MAX_RELATIVE_FREQUENCY * sample_rate_hz);
+
+    // Trapezoidal state-variable filter (prewarped, so the cutoff lands exactly)
+    SectionCoefficients c;
+    double g = std::tan(PI * frequency / sample_rate_hz);
+    double k = 1.0 / q;
+    c.a1 = 1.0 / (1.0 + g * (g + k));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+
+    // Output = m0 * input + m1 * band + m2 * low
+    switch (type) {
+        case FilterType::LowPass:  c.m0 = 0.0; c.m1 = 0.0; c.m2 = 1.0; break;
+        case FilterType::HighPass: c.m0 = 1.0; c.m1 = -k;  c.m2 = -1.0; break;
+        case FilterType::Notch:    c.m0 = 1.0; c.m1 = -k;  c.m2 = 0.0; break;
+    }
+    return c;
+}
+
+void FilterBank::derive(size_t index) {
+    Section& section = m_sections[index];
+    section.c = sectionCoefficients(section.type, section.frequency_hz, section.q, m_sample_rate);
+}
+
+void FilterBank::reset(const float value[LANES]) {
+    // With a constant input the band output is zero and the low output equals the
+    // input, so each section holds its input in ic2; its output feeds the next
+    double level[LANES];
+    std::copy(value, value + LANES, level);
+    for (size_t s = 0; s < m_count; s++) {
+        const Section& section = m_sections[s];
+        for (size_t lane = 0; lane < LANES; lane++) {
+            m_ic1[s][lane] = 0.0;
+            m_ic2[s][lane] = level[lane];
+            level[lane] = (section.c.m0 + section.c.m2) * level[lane];
+        }
+    }
+}
+
+void FilterBank::process(const float in[LANES], float out[LANES]) {
+    Lanes x = Lanes::load(in);
+    for (size_t s = 0; s < m_count; s++) {
+        x = runSection(m_sections[s].c, x, m_ic1[s], m_ic2[s]);
+    }
+    x.store(out);
+}
+
+} // namespace Uncoupler
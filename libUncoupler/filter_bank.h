@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Uncoupler {
+
+    // Responses a filter section can have
+    enum class FilterType {
+        LowPass,
+        HighPass,
+        Notch
+    };
+
+    // Q of a single second-order Butterworth section
+    constexpr double BUTTERWORTH_Q = 0.70710678118654752;
+
+    // One second-order section in state-variable form: integrator gains
+    // a1..a3 and the output mix of input, band and low (m0..m2)
+    struct SectionCoefficients {
+        double a1, a2, a3;
+        double m0, m1, m2;
+    };
+
+    /**
+     * Derive a section's coefficients
+     * @param type Response
+     * @param frequency_hz Cutoff, or centre frequency for a notch (pulled just under Nyquist if above it)
+     * @param q Quality factor
+     * @param sample_rate_hz Samples per second
+     * @return Coefficients for that rate
+     */
+    SectionCoefficients sectionCoefficients(FilterType type, double frequency_hz, double q, double sample_rate_hz);
+
+    /**
+     * Cascade of second-order (biquad) sections run on four lanes at once:
+     * x, y, z and one spare channel share the coefficients and each have
+     * their own state. Sections are specified by frequency in Hz and their
+     * coefficients are derived from the sample rate, so changing the rate
+     * keeps every cutoff where it was.
+     *
+     * Each section is a biquad in state-variable form (trapezoidal
+     * integrators) run in double precision. The direct forms lose the
+     * response to rounding when the cutoff is a tiny fraction of the sample
+     * rate, e.g. 0.04 Hz at 1 kHz on a signal with a 16384-count offset;
+     * this form does not. The lanes are processed in SIMD registers (AVX,
+     * SSE2 or NEON, scalar elsewhere).
+     *
+     * Not thread-safe; one owner runs process().
+     */
+    class FilterBank {
+    public:
+        static constexpr size_t MAX_SECTIONS = 8;
+        static constexpr size_t LANES = 4;
+
+        /**
+         * Constructor
+         * @param sample_rate_hz Samples per second the coefficients are derived for
+         */
+        explicit FilterBank(double sample_rate_hz = 50.0);
+
+        /**
+         * Remove every section (the bank then passes its input through)
+         */
+        void clear();
+
+        /**
+         * Append one second-order section
+         * @param type Response
+         * @param frequency_hz Cutoff, or centre frequency for a notch
+         * @param q Quality factor (BUTTERWORTH_Q for a flat low-pass or high-pass; higher = narrower notch)
+         * @return False if the bank is full or the parameters are not positive
+         */
+        bool addSection(FilterType type, double frequency_hz, double q = BUTTERWORTH_Q);
+
+        /**
+         * Append a Butterworth low-pass or high-pass as a cascade of sections
+         * @param type LowPass or HighPass
+         * @param cutoff_hz -3 dB frequency
+         * @param order Even filter order (2 = one section, 4 = two, ...)
+         * @return False if the order is not even and positive, or the sections do not fit
+         */
+        bool addButterworth(FilterType type, double cutoff_hz, int order);
+
+        /**
+         * Re-derive every section's coefficients; the filter state is kept
+         * @param sample_rate_hz Samples per second
+         */
+        void setSampleRate(double sample_rate_hz);
+
+        /**
+         * Get the sample rate the coefficients were derived for
+         * @return Samples per second
+         */
+        double sampleRate() const;
+
+        /**
+         * Get the number of sections
+         * @return Sections in the cascade
+         */
+        size_t sectionCount() const;
+
+        /**
+         * Settle every lane as if its input had been constant forever
+         * @param value Input per lane
+         */
+        void reset(const float value[LANES]);
+
+        /**
+         * Filter one sample on every lane
+         * @param in Input per lane
+         * @param out Receives the output per lane (may be the same array as in)
+         */
+        void process(const float in[LANES], float out[LANES]);
+
+    private:
+        // Recompute one section's coefficients from its specification
+        void derive(size_t section);
+
+        struct Section {
+            FilterType type;
+            double frequency_hz;
+            double q;
+            SectionCoefficients c;
+        };
+
+        Section m_sections[MAX_SECTIONS];
+        size_t m_count;
+        double m_sample_rate;
+
+        // Integrator states per section and lane
+        double m_ic1[MAX_SECTIONS][LANES];
+        double m_ic2[MAX_SECTIONS][LANES];
+    };
+
+} // namespace Uncoupler
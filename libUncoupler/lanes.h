@@ -0,0 +1,98 @@
+#pragma once
+
+// Four double lanes with the few operations the filters need, in whatever
+// registers the target has: one AVX register, two SSE2 or NEON registers,
+// or plain doubles. Only this library's sources include it, since its layout
+// follows the flags they are compiled with.
+
+#include "filter_bank.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace Uncoupler {
+
+#if defined(__AVX__)
+    struct Lanes {
+        __m256d v;
+        static Lanes load(const double* p) { return { _mm256_loadu_pd(p) }; }
+        static Lanes load(const float* p) { return { _mm256_cvtps_pd(_mm_loadu_ps(p)) }; }
+        static Lanes all(double x) { return { _mm256_set1_pd(x) }; }
+        void store(double* p) const { _mm256_storeu_pd(p, v); }
+        void store(float* p) const { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); }
+    };
+    inline Lanes operator+(Lanes a, Lanes b) { return { _mm256_add_pd(a.v, b.v) }; }
+    inline Lanes operator-(Lanes a, Lanes b) { return { _mm256_sub_pd(a.v, b.v) }; }
+    inline Lanes operator*(Lanes a, Lanes b) { return { _mm256_mul_pd(a.v, b.v) }; }
+    inline Lanes sqrt(Lanes a) { return { _mm256_sqrt_pd(a.v) }; }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    struct Lanes {
+        __m128d lo, hi;
+        static Lanes load(const double* p) { return { _mm_loadu_pd(p), _mm_loadu_pd(p + 2) }; }
+        static Lanes load(const float* p) {
+            __m128 x = _mm_loadu_ps(p);
+            return { _mm_cvtps_pd(x), _mm_cvtps_pd(_mm_movehl_ps(x, x)) };
+        }
+        static Lanes all(double x) { return { _mm_set1_pd(x), _mm_set1_pd(x) }; }
+        void store(double* p) const { _mm_storeu_pd(p, lo); _mm_storeu_pd(p + 2, hi); }
+        void store(float* p) const { _mm_storeu_ps(p, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi))); }
+    };
+    inline Lanes operator+(Lanes a, Lanes b) { return { _mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi) }; }
+    inline Lanes operator-(Lanes a, Lanes b) { return { _mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi) }; }
+    inline Lanes operator*(Lanes a, Lanes b) { return { _mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi) }; }
+    inline Lanes sqrt(Lanes a) { return { _mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi) }; }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    struct Lanes {
+        float64x2_t lo, hi;
+        static Lanes load(const double* p) { return { vld1q_f64(p), vld1q_f64(p + 2) }; }
+        static Lanes load(const float* p) { return { vcvt_f64_f32(vld1_f32(p)), vcvt_f64_f32(vld1_f32(p + 2)) }; }
+        static Lanes all(double x) { return { vdupq_n_f64(x), vdupq_n_f64(x) }; }
+        void store(double* p) const { vst1q_f64(p, lo); vst1q_f64(p + 2, hi); }
+        void store(float* p) const { vst1q_f32(p, vcombine_f32(vcvt_f32_f64(lo), vcvt_f32_f64(hi))); }
+    };
+    inline Lanes operator+(Lanes a, Lanes b) { return { vaddq_f64(a.lo, b.lo), vaddq_f64(a.hi, b.hi) }; }
+    inline Lanes operator-(Lanes a, Lanes b) { return { vsubq_f64(a.lo, b.lo), vsubq_f64(a.hi, b.hi) }; }
+    inline Lanes operator*(Lanes a, Lanes b) { return { vmulq_f64(a.lo, b.lo), vmulq_f64(a.hi, b.hi) }; }
+    inline Lanes sqrt(Lanes a) { return { vsqrtq_f64(a.lo), vsqrtq_f64(a.hi) }; }
+#else
+    struct Lanes {
+        double v[4];
+        static Lanes load(const double* p) { return { { p[0], p[1], p[2], p[3] } }; }
+        static Lanes load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+        static Lanes all(double x) { return { { x, x, x, x } }; }
+        void store(double* p) const { std::copy(v, v + 4, p); }
+        void store(float* p) const {
+            for (int i = 0; i < 4; i++) p[i] = static_cast<float>(v[i]);
+        }
+    };
+    inline Lanes operator+(Lanes a, Lanes b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    inline Lanes operator-(Lanes a, Lanes b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+    inline Lanes operator*(Lanes a, Lanes b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+    inline Lanes sqrt(Lanes a) { return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+#endif
+
+    // One state-variable-form section on four lanes: advances the integrator
+    // states ic1 and ic2 (four doubles each) and returns the section's output
+    inline Lanes runSection(const SectionCoefficients& c, Lanes x, double* ic1, double* ic2) {
+        Lanes s1 = Lanes::load(ic1);
+        Lanes s2 = Lanes::load(ic2);
+        Lanes a2 = Lanes::all(c.a2);
+        Lanes two = Lanes::all(2.0);
+
+        Lanes v3 = x - s2;
+        Lanes band = Lanes::all(c.a1) * s1 + a2 * v3;
+        Lanes low = s2 + a2 * s1 + Lanes::all(c.a3) * v3;
+        (two * band - s1).store(ic1);
+        (two * low - s2).store(ic2);
+
+        return Lanes::all(c.m0) * x + Lanes::all(c.m1) * band + Lanes::all(c.m2) * low;
+    }
+
+} // namespace Uncoupler
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Uncoupler {
+
+    /**
+     * Fixed-size row-major float matrix. The dimensions are template
+     * parameters, so every loop has a compile-time trip count the compiler
+     * can unroll, and nothing is ever allocated.
+     */
+    template <size_t R, size_t C>
+    struct Matrix {
+        float m[R][C];
+
+        float& operator()(size_t r, size_t c) { return m[r][c]; }
+        float operator()(size_t r, size_t c) const { return m[r][c]; }
+
+        static Matrix zero() {
+            Matrix out;
+            for (size_t r = 0; r < R; r++)
+                for (size_t c = 0; c < C; c++) out.m[r][c] = 0.0f;
+            return out;
+        }
+
+        static Matrix identity() {
+            static_assert(R == C, "identity needs a square matrix");
+            Matrix out = zero();
+            for (size_t i = 0; i < R; i++) out.m[i][i] = 1.0f;
+            return out;
+        }
+    };
+
+    using Matrix3 = Matrix<3, 3>;
+
+    template <size_t R, size_t K, size_t C>
+    Matrix<R, C> operator*(const Matrix<R, K>& a, const Matrix<K, C>& b) {
+        Matrix<R, C> out;
+        for (size_t r = 0; r < R; r++) {
+            for (size_t c = 0; c < C; c++) {
+                float sum = 0.0f;
+                for (size_t k = 0; k < K; k++) sum += a.m[r][k] * b.m[k][c];
+                out.m[r][c] = sum;
+            }
+        }
+        return out;
+    }
+
+    template <size_t R, size_t C>
+    Matrix<R, C> operator+(const Matrix<R, C>& a, const Matrix<R, C>& b) {
+        Matrix<R, C> out;
+        for (size_t r = 0; r < R; r++)
+            for (size_t c = 0; c < C; c++) out.m[r][c] = a.m[r][c] + b.m[r][c];
+        return out;
+    }
+
+    template <size_t R, size_t C>
+    Matrix<R, C> operator-(const Matrix<R, C>& a, const Matrix<R, C>& b) {
+        Matrix<R, C> out;
+        for (size_t r = 0; r < R; r++)
+            for (size_t c = 0; c < C; c++) out.m[r][c] = a.m[r][c] - b.m[r][c];
+        return out;
+    }
+
+    template <size_t R, size_t C>
+    Matrix<R, C> operator*(float s, const Matrix<R, C>& a) {
+        Matrix<R, C> out;
+        for (size_t r = 0; r < R; r++)
+            for (size_t c = 0; c < C; c++) out.m[r][c] = s * a.m[r][c];
+        return out;
+    }
+
+    template <size_t R, size_t C>
+    Matrix<C, R> transpose(const Matrix<R, C>& a) {
+        Matrix<C, R> out;
+        for (size_t r = 0; r < R; r++)
+            for (size_t c = 0; c < C; c++) out.m[c][r] = a.m[r][c];
+        return out;
+    }
+
+    /**
+     * Cross-product matrix: skew(v) * u == v x u
+     * @param v Vector
+     * @return 3x3 skew-symmetric matrix
+     */
+    inline Matrix3 skew(const float v[3]) {
+        Matrix3 out;
+        out.m[0][0] = 0.0f;   out.m[0][1] = -v[2];  out.m[0][2] = v[1];
+        out.m[1][0] = v[2];   out.m[1][1] = 0.0f;   out.m[1][2] = -v[0];
+        out.m[2][0] = -v[1];  out.m[2][1] = v[0];   out.m[2][2] = 0.0f;
+        return out;
+    }
+
+    /**
+     * Invert a 3x3 matrix by cofactors
+     * @param a Matrix to invert
+     * @param out Receives the inverse
+     * @return False if a is singular (out is left unchanged)
+     */
+    inline bool invert(const Matrix3& a, Matrix3& out) {
+        float c00 = a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1];
+        float c01 = a.m[1][2] * a.m[2][0] - a.m[1][0] * a.m[2][2];
+        float c02 = a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0];
+        float det = a.m[0][0] * c00 + a.m[0][1] * c01 + a.m[0][2] * c02;
+        if (det == 0.0f) return false;
+
+        float inv = 1.0f / det;
+        out.m[0][0] = c00 * inv;
+        out.m[0][1] = (a.m[0][2] * a.m[2][1] - a.m[0][1] * a.m[2][2]) * inv;
+        out.m[0][2] = (a.m[0][1] * a.m[1][2] - a.m[0][2] * a.m[1][1]) * inv;
+        out.m[1][0] = c01 * inv;
+        out.m[1][1] = (a.m[0][0] * a.m[2][2] - a.m[0][2] * a.m[2][0]) * inv;
+        out.m[1][2] = (a.m[0][2] * a.m[1][0] - a.m[0][0] * a.m[1][2]) * inv;
+        out.m[2][0] = c02 * inv;
+        out.m[2][1] = (a.m[0][1] * a.m[2][0] - a.m[0][0] * a.m[2][1]) * inv;
+        out.m[2][2] = (a.m[0][0] * a.m[1][1] - a.m[0][1] * a.m[1][0]) * inv;
+        return true;
+    }
+
+} // namespace Uncoupler
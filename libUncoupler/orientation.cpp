@@ -0,0 +1,117 @@
+#include "orientation.h"
+#include <cmath>
+
+namespace Uncoupler {
+
+void quaternionFromUp(float ax, float ay, float az, float q[4]) {
+    q[0] = 1.0f;
+    q[1] = 0.0f;
+    q[2] = 0.0f;
+    q[3] = 0.0f;
+
+    float norm = std::sqrt(ax * ax + ay * ay + az * az);
+    if (norm <= 0.0f) return;
+    ax /= norm;
+    ay /= norm;
+    az /= norm;
+
+    // Shortest rotation taking the measured up direction onto world up
+    if (az < -0.9999f) {
+        q[0] = 0.0f;
+        q[1] = 1.0f;  // Upside down: half a turn about x
+        return;
+    }
+    float w = 1.0f + az;
+    float scale = 1.0f / std::sqrt(w * w + ay * ay + ax * ax);
+    q[0] = w * scale;
+    q[1] = ay * scale;
+    q[2] = -ax * scale;
+}
+
+void upFromQuaternion(const float q[4], float out[3]) {
+    // Third row of the sensor-to-world rotation: world z seen from the sensor
+    out[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    out[1] = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    out[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+OrientationFilter::OrientationFilter(float beta)
+    : m_q{1.0f, 0.0f, 0.0f, 0.0f},
+      m_beta(beta),
+      m_initialized(false)
+{
+}
+
+void OrientationFilter::reset(float ax, float ay, float az) {
+    quaternionFromUp(ax, ay, az, m_q);
+    m_initialized = true;
+}
+
+void OrientationFilter::update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    float q0 = m_q[0], q1 = m_q[1], q2 = m_q[2], q3 = m_q[3];
+
+    // Rate of change of the quaternion from the gyroscope
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    // Gradient descent step toward the accelerometer's up direction
+    float accelNorm = std::sqrt(ax * ax + ay * ay + az * az);
+    if (accelNorm > 0.0f) {
+        ax /= accelNorm;
+        ay /= accelNorm;
+        az /= accelNorm;
+
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        // Zero when the estimate already agrees with the accelerometer
+        float stepNorm = std::sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+        if (stepNorm > 0.0f) {
+            float gain = m_beta / stepNorm;
+            qDot0 -= gain * s0;
+            qDot1 -= gain * s1;
+            qDot2 -= gain * s2;
+            qDot3 -= gain * s3;
+        }
+    }
+
+    // Integrate and renormalize
+    q0 += qDot0 * dt;
+    q1 += qDot1 * dt;
+    q2 += qDot2 * dt;
+    q3 += qDot3 * dt;
+    float norm = std::sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    if (norm > 0.0f) {
+        m_q[0] = q0 / norm;
+        m_q[1] = q1 / norm;
+        m_q[2] = q2 / norm;
+        m_q[3] = q3 / norm;
+    }
+}
+
+void OrientationFilter::gravity(float out[3]) const {
+    upFromQuaternion(m_q, out);
+}
+
+const float* OrientationFilter::quaternion() const {
+    return m_q;
+}
+
+void OrientationFilter::setBeta(float beta) {
+    m_beta = beta;
+}
+
+bool OrientationFilter::isInitialized() const {
+    return m_initialized;
+}
+
+} // namespace Uncoupler
@@ -0,0 +1,90 @@
+#pragma once
+
+namespace Uncoupler {
+
+    /**
+     * Attitude with heading zero that puts an accelerometer reading on world up
+     * @param ax X-axis acceleration (any units)
+     * @param ay Y-axis acceleration
+     * @param az Z-axis acceleration
+     * @param q Receives the sensor-to-world quaternion as w, x, y, z (identity for a zero reading)
+     */
+    void quaternionFromUp(float ax, float ay, float az, float q[4]);
+
+    /**
+     * World up in the sensor frame, i.e. what the accelerometer reads at rest
+     * @param q Sensor-to-world quaternion as w, x, y, z
+     * @param out Receives the normalized x, y, z
+     */
+    void upFromQuaternion(const float q[4], float out[3]);
+
+    /**
+     * Madgwick gradient-descent orientation filter (gyroscope and
+     * accelerometer, no magnetometer). The quaternion is propagated from the
+     * gyro rates each sample and nudged toward the accelerometer's idea of
+     * "up" at a rate set by beta, so gravity follows rotations immediately
+     * instead of waiting for an average to catch up. Heading is not
+     * observable without a magnetometer and drifts; the gravity direction
+     * does not depend on it.
+     *
+     * Not thread-safe; SensorUncoupler owns one and runs it on the processing thread.
+     */
+    class OrientationFilter {
+    public:
+        /**
+         * Constructor
+         * @param beta Accelerometer correction gain (rad/s; higher = trusts the accelerometer more)
+         */
+        explicit OrientationFilter(float beta = 0.05f);
+
+        /**
+         * Start from the attitude an accelerometer reading implies (heading zero)
+         * @param ax X-axis acceleration (any units)
+         * @param ay Y-axis acceleration
+         * @param az Z-axis acceleration
+         */
+        void reset(float ax, float ay, float az);
+
+        /**
+         * Advance one sample
+         * @param gx X-axis rate in rad/s
+         * @param gy Y-axis rate in rad/s
+         * @param gz Z-axis rate in rad/s
+         * @param ax X-axis acceleration (any units; all three zero = gyro only)
+         * @param ay Y-axis acceleration
+         * @param az Z-axis acceleration
+         * @param dt Seconds since the previous sample
+         */
+        void update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+        /**
+         * Get the direction the accelerometer reads at rest (world up in the sensor frame)
+         * @param out Receives the normalized x, y, z
+         */
+        void gravity(float out[3]) const;
+
+        /**
+         * Get the orientation
+         * @return Sensor-to-world quaternion as w, x, y, z
+         */
+        const float* quaternion() const;
+
+        /**
+         * Set the accelerometer correction gain
+         * @param beta Gain in rad/s
+         */
+        void setBeta(float beta);
+
+        /**
+         * Check whether reset has been called
+         * @return True once the filter has a starting attitude
+         */
+        bool isInitialized() const;
+
+    private:
+        float m_q[4];  // w, x, y, z
+        float m_beta;
+        bool m_initialized;
+    };
+
+} // namespace Uncoupler
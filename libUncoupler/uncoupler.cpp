@@ -1,62 +1,318 @@
 #include "uncoupler.h"
 #include <cmath>
-#include <numeric>
 #include <algorithm>
 
 namespace Uncoupler {
 
+static const float PI = 3.14159265358979f;
+
+// The orientation mode only corrects toward the accelerometer while its
+// magnitude is within this fraction of gravity; beyond that it is measuring
+// motion as much as gravity, so the gyro carries the attitude alone
+static const float ACCEL_TRUST_BAND = 0.1f;
+
+// Device clock steps outside (0, this] are gaps or restarts, not sample periods
+static const float MAX_SAMPLE_PERIOD = 0.25f;
+
+// Filter coefficients are re-derived when the measured rate drifts further than this from theirs
+static const double RATE_TOLERANCE = 0.02;
+
+// Weight of each new device clock step in the measured sample period
+static const float PERIOD_AVERAGING = 0.01f;
+
+// Q of the optional linear acceleration notch (bandwidth = frequency / Q)
+static const double NOTCH_Q = 2.0;
+
+// Cutoff of the 2nd-order Butterworth low-pass that follows a step (a tilt) as
+// fast as an EMA with this coefficient: the EMA reaches 63% of a step after its
+// time constant 1 / (2 pi fc), the Butterworth after 1.753 / (2 pi fc). Above the
+// cutoff it then rejects noise twice as steeply. (Matching the low-frequency delay
+// instead, a factor of sqrt(2), leaves the Butterworth 25% slower to settle on a
+// tilt, which more than undoes the gain in noise.)
+static const float STEP_MATCH = 1.753f;
+static float cutoffFromAlpha(float alpha, float rate_hz) {
+    alpha = std::max(1e-6f, std::min(0.999f, alpha));
+    return STEP_MATCH * -std::log(1.0f - alpha) * rate_hz / (2.0f * PI);
+}
+
+// Gravity magnitude cutoff as a fraction of the vector's: the magnitude only
+// changes with the sensor's scale, so it is smoothed harder
+static const float MAGNITUDE_CUTOFF_RATIO = 0.5f;
+
+const char* gravityModeName(GravityMode mode) {
+    switch (mode) {
+        case GravityMode::Orientation: return "orientation";
+        case GravityMode::Kalman: return "kalman";
+        default: return "average";
+    }
+}
+
+bool parseGravityMode(const std::string& text, GravityMode& mode) {
+    if (text == "average") {
+        mode = GravityMode::MovingAverage;
+    } else if (text == "orientation") {
+        mode = GravityMode::Orientation;
+    } else if (text == "kalman") {
+        mode = GravityMode::Kalman;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Largest gravity window the setters accept: covers the '+' key's 500 samples
+// and the default 50-sample window rescaled from 50 Hz to 1 kHz. The rings are
+// sized once, in the constructor, so processData never allocates.
+static const size_t HISTORY_RESERVE = 1000;
+
 SensorUncoupler::SensorUncoupler(size_t gravity_filter_size, float alpha)
     : m_gx_offset(0.0f), m_gy_offset(0.0f), m_gz_offset(0.0f),
       m_gyroCalibrationEnabled(false),
       m_gravity_vector{0.0f, 0.0f, 1.0f}, // Initial assumption: gravity points down (z-axis)
       m_gravity_magnitude(9.81f),         // Initial gravity magnitude (standard Earth gravity)
       m_filtered_gravity{0.0f, 0.0f, 9.81f}, // Initial filtered gravity
-      m_alpha(alpha),
-      m_gravity_filter_size(gravity_filter_size),
+      m_gravityFilterPrimed(false),
+      m_gravity_cutoff_hz(cutoffFromAlpha(alpha, 50.0f)),
+      m_linear_cutoff_hz(0.25f * m_gravity_cutoff_hz),
+      m_linear_notch_hz(0.0f),
+      m_sample_rate(50.0f),
+      m_history_head(0),
+      m_history_count(0),
+      m_history_since_resum(0),
+      m_history_sum{0.0, 0.0, 0.0},
+      m_gravity_filter_size(std::max(size_t(1), gravity_filter_size)),
+      m_window_magnitude(0.0f),
+      m_gravityMode(GravityMode::MovingAverage),
+      m_orientation(0.05f),
+      m_orientationActive(false),
+      m_gyro_rad_per_count(PI / 180.0f / 131.0f),
+      m_sample_period(1.0f / 50.0f),
+      m_last_device_time_us(0),
+      m_has_device_time(false),
+      m_measured_period(0.0f),
       m_prev_linear_accel{0.0f, 0.0f, 0.0f},
-      m_filters_initialized(false)
+      m_filters_initialized(false),
+      m_appliedVersion(0),
+      m_samples(0)
 {
     // Initialize filtered gravity to point down
     m_filtered_gravity[0] = 0.0f;
     m_filtered_gravity[1] = 0.0f;
     m_filtered_gravity[2] = 9.81f;
+    size_t capacity = std::max(m_gravity_filter_size, HISTORY_RESERVE);
+    m_ax_history.assign(capacity, 0.0f);
+    m_ay_history.assign(capacity, 0.0f);
+    m_az_history.assign(capacity, 0.0f);
+    configureFilters();
+
+    // The published settings start out as the working copy
+    UncouplerSettings settings;
+    settings.gravity_cutoff_hz = m_gravity_cutoff_hz;
+    settings.linear_cutoff_hz = m_linear_cutoff_hz;
+    settings.gravity_filter_size = m_gravity_filter_size;
+    settings.gravity_window_seconds = m_gravity_filter_size / m_sample_rate;
+    m_settings.store(settings);
+    m_appliedVersion = m_settings.version();
+}
+
+template <typename Change>
+void SensorUncoupler::changeSettings(Change&& change) {
+    // Read-modify-publish; processData never takes this lock
+    std::lock_guard<std::mutex> lock(m_settingsMutex);
+    UncouplerSettings settings = m_settings.load();
+    change(settings);
+    m_settings.store(settings);
+}
+
+void SensorUncoupler::applySettings() {
+    m_appliedVersion = m_settings.version();
+    UncouplerSettings settings = m_settings.load();
+
+    m_gx_offset = settings.gx_offset;
+    m_gy_offset = settings.gy_offset;
+    m_gz_offset = settings.gz_offset;
+    m_gyroCalibrationEnabled = settings.gyroCalibrationEnabled;
+    m_gravity_filter_size = settings.gravity_filter_size;
+    if (settings.gravity_mode != m_gravityMode) {
+        m_orientationActive = false;  // The newly selected filter starts over
+    }
+    m_gravityMode = settings.gravity_mode;
+    m_gyro_rad_per_count = PI / 180.0f / settings.gyro_counts_per_dps;
+    m_orientation.setBeta(settings.orientation_gain);
+    m_sample_period = 1.0f / settings.sample_rate;
+    
+    fitHistoryToWindow();
+
+    if (settings.gravity_cutoff_hz != m_gravity_cutoff_hz || settings.linear_cutoff_hz != m_linear_cutoff_hz ||
+        settings.linear_notch_hz != m_linear_notch_hz) {
+        m_gravity_cutoff_hz = settings.gravity_cutoff_hz;
+        m_linear_cutoff_hz = settings.linear_cutoff_hz;
+        m_linear_notch_hz = settings.linear_notch_hz;
+        configureFilters();
+    }
+}
+
+void SensorUncoupler::configureFilters() {
+    m_gravityFilter.clear();
+    m_gravityFilter.addButterworth(FilterType::LowPass, m_gravity_cutoff_hz, 2);
+    m_magnitudeFilter.clear();
+    m_magnitudeFilter.addButterworth(FilterType::LowPass, MAGNITUDE_CUTOFF_RATIO * m_gravity_cutoff_hz, 2);
+    m_linearFilter.clear();
+    m_linearFilter.addButterworth(FilterType::LowPass, m_linear_cutoff_hz, 2);
+    if (m_linear_notch_hz > 0.0f) {
+        m_linearFilter.addSection(FilterType::Notch, m_linear_notch_hz, NOTCH_Q);
+    }
+
+    // Carry on from the current outputs rather than restarting from zero
+    float gravity[FilterBank::LANES] = { m_filtered_gravity[0], m_filtered_gravity[1], m_filtered_gravity[2], 0.0f };
+    m_gravityFilter.reset(gravity);
+    float magnitude[FilterBank::LANES] = { m_gravity_magnitude, 0.0f, 0.0f, 0.0f };
+    m_magnitudeFilter.reset(magnitude);
+    float linear[FilterBank::LANES] = { m_prev_linear_accel[0], m_prev_linear_accel[1], m_prev_linear_accel[2], 0.0f };
+    m_linearFilter.reset(linear);
+}
+
+void SensorUncoupler::fitHistoryToWindow() {
+    // A larger window fills up from the samples already there; the setters
+    // keep it within the rings
+    if (m_history_count > m_gravity_filter_size) {
+        // Smaller window: the oldest samples drop out of it where they are
+        m_history_count = m_gravity_filter_size;
+        resumHistory();
+    }
+}
+
+size_t SensorUncoupler::clampWindow(size_t size) const {
+    // Minimum size of 1 to avoid division by zero; the rings' size never changes
+    // after construction, so any thread may read it
+    return std::min(std::max(size_t(1), size), m_ax_history.size());
+}
+
+void SensorUncoupler::resumHistory() {
+    size_t capacity = m_ax_history.size();
+    size_t slot = (m_history_head + capacity - m_history_count) % capacity;
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < m_history_count; i++) {
+        sum[0] += m_ax_history[slot];
+        sum[1] += m_ay_history[slot];
+        sum[2] += m_az_history[slot];
+        if (++slot == capacity) slot = 0;
+    }
+    std::copy(sum, sum + 3, m_history_sum);
+    m_history_since_resum = 0;
 }
 
 void SensorUncoupler::setGyroCalibrationOffsets(float gx_offset, float gy_offset, float gz_offset) {
-    m_gx_offset = gx_offset;
-    m_gy_offset = gy_offset;
-    m_gz_offset = gz_offset;
+    changeSettings([&](UncouplerSettings& settings) {
+        settings.gx_offset = gx_offset;
+        settings.gy_offset = gy_offset;
+        settings.gz_offset = gz_offset;
+    });
 }
 
 void SensorUncoupler::setLowPassFilterAlpha(float alpha) {
-    // Ensure alpha is in the valid range [0,1]
-    m_alpha = std::max(0.0f, std::min(1.0f, alpha));
+    changeSettings([alpha](UncouplerSettings& settings) {
+        float cutoff = cutoffFromAlpha(alpha, settings.sample_rate);
+        settings.gravity_cutoff_hz = cutoff;
+        settings.linear_cutoff_hz = 0.25f * cutoff;
+    });
+}
+
+void SensorUncoupler::setGravityCutoff(float cutoff_hz) {
+    if (cutoff_hz <= 0.0f) return;
+    changeSettings([cutoff_hz](UncouplerSettings& settings) {
+        settings.gravity_cutoff_hz = cutoff_hz;
+    });
+}
+
+float SensorUncoupler::getGravityCutoff() const {
+    return m_settings.load().gravity_cutoff_hz;
+}
+
+void SensorUncoupler::setLinearCutoff(float cutoff_hz) {
+    if (cutoff_hz <= 0.0f) return;
+    changeSettings([cutoff_hz](UncouplerSettings& settings) {
+        settings.linear_cutoff_hz = cutoff_hz;
+    });
+}
+
+void SensorUncoupler::setLinearNotch(float frequency_hz) {
+    changeSettings([frequency_hz](UncouplerSettings& settings) {
+        settings.linear_notch_hz = std::max(0.0f, frequency_hz);
+    });
+}
+
+void SensorUncoupler::setSampleRate(float rate_hz) {
+    if (rate_hz <= 0.0f) return;
+
+    changeSettings([this, rate_hz](UncouplerSettings& settings) {
+        if (rate_hz == m_sample_rate) return;
+
+        // Same window length in seconds as last requested, even if an earlier rate capped it
+        size_t size = static_cast<size_t>(std::lround(settings.gravity_window_seconds * rate_hz));
+        settings.gravity_filter_size = clampWindow(size);
+        settings.sample_rate = rate_hz;
+        m_sample_rate = rate_hz;
+    });
 }
 
 void SensorUncoupler::setGravityFilterSize(size_t size) {
-    // Minimum size of 1 to avoid division by zero
-    m_gravity_filter_size = std::max(size_t(1), size);
-    
-    // Resize history if needed
-    if (m_ax_history.size() > m_gravity_filter_size) {
-        while (m_ax_history.size() > m_gravity_filter_size) {
-            m_ax_history.pop_front();
-            m_ay_history.pop_front();
-            m_az_history.pop_front();
-        }
-    }
+    changeSettings([this, size](UncouplerSettings& settings) {
+        settings.gravity_window_seconds = std::max(size_t(1), size) / settings.sample_rate;
+        settings.gravity_filter_size = clampWindow(size);
+    });
+}
+
+void SensorUncoupler::setGravityMode(GravityMode mode) {
+    changeSettings([mode](UncouplerSettings& settings) {
+        settings.gravity_mode = mode;
+    });
+}
+
+GravityMode SensorUncoupler::getGravityMode() const {
+    return m_settings.load().gravity_mode;
+}
+
+void SensorUncoupler::setGyroScale(float counts_per_dps) {
+    if (counts_per_dps <= 0.0f) return;
+
+    changeSettings([counts_per_dps](UncouplerSettings& settings) {
+        settings.gyro_counts_per_dps = counts_per_dps;
+    });
+}
+
+void SensorUncoupler::setOrientationGain(float beta) {
+    changeSettings([beta](UncouplerSettings& settings) {
+        settings.orientation_gain = std::max(0.0f, beta);
+    });
 }
 
 UncoupledData SensorUncoupler::processData(const std::unordered_map<std::string, int>& sensorData) {
+    Serial::ImuSample sample;
+    sample.ax = sensorData.at("ax");
+    sample.ay = sensorData.at("ay");
+    sample.az = sensorData.at("az");
+    sample.gx = sensorData.at("gx");
+    sample.gy = sensorData.at("gy");
+    sample.gz = sensorData.at("gz");
+    return processData(sample);
+}
+
+UncoupledData SensorUncoupler::processData(const Serial::ImuSample& sample) {
     UncoupledData result;
     
+    // Pick up settings changed since the last sample (one atomic load when nothing changed)
+    if (m_settings.version() != m_appliedVersion) {
+        applySettings();
+    }
+    
     // Get raw data
-    int raw_ax = sensorData.at("ax");
-    int raw_ay = sensorData.at("ay");
-    int raw_az = sensorData.at("az");
-    int raw_gx = sensorData.at("gx");
-    int raw_gy = sensorData.at("gy");
-    int raw_gz = sensorData.at("gz");
+    int raw_ax = sample.ax;
+    int raw_ay = sample.ay;
+    int raw_az = sample.az;
+    int raw_gx = sample.gx;
+    int raw_gy = sample.gy;
+    int raw_gz = sample.gz;
     
     // Store raw accelerometer data as-is (with gravity)
     result.ax_raw = static_cast<float>(raw_ax);
@@ -75,8 +331,23 @@ UncoupledData SensorUncoupler::processData(const std::unordered_map<std::string,
         result.gz_cal = static_cast<float>(raw_gz);
     }
     
-    // Update gravity vector estimation
+    // Filter coefficients follow the rate the device actually delivers when it stamps its samples
+    float dt = samplePeriod(sample);
+    double period = m_measured_period > 0.0f ? m_measured_period : m_sample_period;
+    if (std::fabs(period * m_gravityFilter.sampleRate() - 1.0) > RATE_TOLERANCE) {
+        m_gravityFilter.setSampleRate(1.0 / period);
+        m_magnitudeFilter.setSampleRate(1.0 / period);
+        m_linearFilter.setSampleRate(1.0 / period);
+    }
+    
+    // Update gravity vector estimation; the average keeps running in the gyro-aided
+    // modes too, for the magnitude and so switching back needs no warm-up
     updateGravityEstimation(result.ax_raw, result.ay_raw, result.az_raw);
+    if (m_gravityMode != GravityMode::MovingAverage) {
+        updateOrientation(result, dt);
+    } else {
+        m_orientationActive = false;
+    }
     
     // Set gravity components in result - use filtered gravity for smoother output
     result.grav_x = m_filtered_gravity[0];
@@ -88,25 +359,43 @@ UncoupledData SensorUncoupler::processData(const std::unordered_map<std::string,
     float linear_ay = result.ay_raw - result.grav_y;
     float linear_az = result.az_raw - result.grav_z;
     
-    // Initialize linear acceleration filters if needed
-    if (!m_filters_initialized) {
-        m_prev_linear_accel[0] = linear_ax;
-        m_prev_linear_accel[1] = linear_ay;
-        m_prev_linear_accel[2] = linear_az;
-        m_filters_initialized = true;
+    float linear[FilterBank::LANES] = { linear_ax, linear_ay, linear_az, 0.0f };
+    if (m_gravityMode != GravityMode::MovingAverage) {
+        // Gravity already follows the motion sample by sample; smoothing here would add the lag back
+        std::copy(linear, linear + 3, m_prev_linear_accel);
+        m_filters_initialized = false;  // Settle again on the first sample back in the average mode
+    } else {
+        // Settle the filter once gravity has its first estimate, so the output ramps
+        // neither from zero nor from the placeholder gravity
+        if (!m_filters_initialized) {
+            m_linearFilter.reset(linear);
+            m_filters_initialized = m_gravityFilterPrimed;
+        }
+
+        // Smooth linear acceleration with a lower cutoff than gravity to reduce noise
+        m_linearFilter.process(linear, linear);
+        std::copy(linear, linear + 3, m_prev_linear_accel);
     }
     
-    // Apply additional low-pass filtering to linear acceleration for smoother output
-    // Using a stronger filter (alpha/4) for linear acceleration to reduce noise
-    applyLowPassFilter(m_prev_linear_accel[0], linear_ax, m_alpha * 0.25f);
-    applyLowPassFilter(m_prev_linear_accel[1], linear_ay, m_alpha * 0.25f);
-    applyLowPassFilter(m_prev_linear_accel[2], linear_az, m_alpha * 0.25f);
-    
     // Store filtered linear acceleration
     result.ax_linear = m_prev_linear_accel[0];
     result.ay_linear = m_prev_linear_accel[1];
     result.az_linear = m_prev_linear_accel[2];
     
+    // Publish the gravity estimate for readers on other threads
+    GravityEstimate estimate;
+    std::copy(m_gravity_vector, m_gravity_vector + 3, estimate.direction);
+    estimate.magnitude = m_gravity_magnitude;
+    std::copy(m_filtered_gravity, m_filtered_gravity + 3, estimate.filtered);
+    estimate.samples = ++m_samples;
+    if (m_gravityMode == GravityMode::Kalman) {
+        const float* bias = m_kalman.gyroBias();
+        for (int i = 0; i < 3; i++) {
+            estimate.gyro_bias[i] = bias[i] / m_gyro_rad_per_count;
+        }
+    }
+    m_estimate.store(estimate);
+    
     return result;
 }
 
@@ -117,54 +406,124 @@ int SensorUncoupler::applyGyroCalibration(int value, float offset) const {
 }
 
 void SensorUncoupler::updateGravityEstimation(float ax, float ay, float az) {
-    // Add new accelerometer values to history
-    m_ax_history.push_back(ax);
-    m_ay_history.push_back(ay);
-    m_az_history.push_back(az);
-    
-    // Remove oldest values if we exceed the filter size
-    if (m_ax_history.size() > m_gravity_filter_size) {
-        m_ax_history.pop_front();
-        m_ay_history.pop_front();
-        m_az_history.pop_front();
+    // Slide the window: once it is full, its oldest sample comes out of the running sums
+    size_t capacity = m_ax_history.size();
+    if (m_history_count == m_gravity_filter_size) {
+        size_t oldest = (m_history_head + capacity - m_history_count) % capacity;
+        m_history_sum[0] -= m_ax_history[oldest];
+        m_history_sum[1] -= m_ay_history[oldest];
+        m_history_sum[2] -= m_az_history[oldest];
+    } else {
+        m_history_count++;
+    }
+    m_ax_history[m_history_head] = ax;
+    m_ay_history[m_history_head] = ay;
+    m_az_history[m_history_head] = az;
+    m_history_sum[0] += ax;
+    m_history_sum[1] += ay;
+    m_history_sum[2] += az;
+    if (++m_history_head == capacity) m_history_head = 0;
+
+    // Re-sum once per window length so rounding never builds up in the running sums
+    if (++m_history_since_resum >= m_gravity_filter_size) {
+        resumHistory();
     }
     
     // Calculate average values if we have enough data
-    if (m_ax_history.size() >= 5) {  // Require at least 5 samples for a meaningful average
+    if (m_history_count >= 5) {  // Require at least 5 samples for a meaningful average
         // Calculate average of each component
-        float avg_ax = std::accumulate(m_ax_history.begin(), m_ax_history.end(), 0.0f) / m_ax_history.size();
-        float avg_ay = std::accumulate(m_ay_history.begin(), m_ay_history.end(), 0.0f) / m_ay_history.size();
-        float avg_az = std::accumulate(m_az_history.begin(), m_az_history.end(), 0.0f) / m_az_history.size();
+        float avg_ax = static_cast<float>(m_history_sum[0] / m_history_count);
+        float avg_ay = static_cast<float>(m_history_sum[1] / m_history_count);
+        float avg_az = static_cast<float>(m_history_sum[2] / m_history_count);
         
         // Calculate magnitude of the average acceleration vector
         float magnitude = std::sqrt(avg_ax * avg_ax + avg_ay * avg_ay + avg_az * avg_az);
+        m_window_magnitude = magnitude;
         
-        // Update gravity magnitude estimate (low-pass filtered for stability)
-        applyLowPassFilter(m_gravity_magnitude, magnitude, m_alpha * 0.5f);
+        // Low-pass the average and its magnitude, starting settled on the first average
+        float window[FilterBank::LANES] = { avg_ax, avg_ay, avg_az, 0.0f };
+        float windowMagnitude[FilterBank::LANES] = { magnitude, 0.0f, 0.0f, 0.0f };
+        if (!m_gravityFilterPrimed) {
+            m_gravityFilter.reset(window);
+            m_magnitudeFilter.reset(windowMagnitude);
+            m_gravityFilterPrimed = true;
+        }
+        float filtered[FilterBank::LANES];
+        m_magnitudeFilter.process(windowMagnitude, filtered);
+        m_gravity_magnitude = filtered[0];
+        m_gravityFilter.process(window, filtered);
         
         // Normalize to get the direction vector
         if (magnitude > 0.1f) {  // Avoid division by zero or very small values
-            // Calculate gravity direction
-            float gx = avg_ax / magnitude;
-            float gy = avg_ay / magnitude;
-            float gz = avg_az / magnitude;
-            
             // Update raw gravity vector
-            m_gravity_vector[0] = gx;
-            m_gravity_vector[1] = gy;
-            m_gravity_vector[2] = gz;
+            m_gravity_vector[0] = avg_ax / magnitude;
+            m_gravity_vector[1] = avg_ay / magnitude;
+            m_gravity_vector[2] = avg_az / magnitude;
             
-            // Apply low-pass filter to gravity vector components for smoother output
-            applyLowPassFilter(m_filtered_gravity[0], gx * m_gravity_magnitude, m_alpha);
-            applyLowPassFilter(m_filtered_gravity[1], gy * m_gravity_magnitude, m_alpha);
-            applyLowPassFilter(m_filtered_gravity[2], gz * m_gravity_magnitude, m_alpha);
+            // Smoothed vector for output
+            std::copy(filtered, filtered + 3, m_filtered_gravity);
+        }
+    }
+}
+
+void SensorUncoupler::updateOrientation(const UncoupledData& result, float dt) {
+    float ax = result.ax_raw;
+    float ay = result.ay_raw;
+    float az = result.az_raw;
+    float accelMagnitude = std::sqrt(ax * ax + ay * ay + az * az);
+
+    // Start from the averaged direction when there is one, so a switch does not jump
+    if (!m_orientationActive) {
+        const float* up = m_gravity_vector;
+        float reading[3] = { ax, ay, az };
+        if (m_window_magnitude <= 0.0f) up = reading;
+        if (m_gravityMode == GravityMode::Kalman) {
+            m_kalman.reset(up[0], up[1], up[2]);
+        } else {
+            m_orientation.reset(up[0], up[1], up[2]);
         }
+        m_orientationActive = true;
+    }
+
+    // Gravity's size comes from the window average; this sample's reading if there is none yet
+    float magnitude = m_window_magnitude > 0.0f ? m_window_magnitude : accelMagnitude;
+    if (std::fabs(accelMagnitude - magnitude) > ACCEL_TRUST_BAND * magnitude) {
+        ax = ay = az = 0.0f;  // Gyro only for this sample
+    }
+    float gx = result.gx_cal * m_gyro_rad_per_count;
+    float gy = result.gy_cal * m_gyro_rad_per_count;
+    float gz = result.gz_cal * m_gyro_rad_per_count;
+    if (m_gravityMode == GravityMode::Kalman) {
+        m_kalman.update(gx, gy, gz, ax, ay, az, dt, magnitude);
+        m_kalman.gravity(m_gravity_vector);
+    } else {
+        m_orientation.update(gx, gy, gz, ax, ay, az, dt);
+        m_orientation.gravity(m_gravity_vector);
+    }
+
+    // No low-pass filter: the attitude is already smooth and filtering would bring back the lag
+    for (int i = 0; i < 3; i++) {
+        m_filtered_gravity[i] = m_gravity_vector[i] * magnitude;
     }
 }
 
-void SensorUncoupler::applyLowPassFilter(float& value, float newValue, float alpha) {
-    // Low pass filter: output = alpha * newValue + (1 - alpha) * previousOutput
-    value = alpha * newValue + (1.0f - alpha) * value;
+float SensorUncoupler::samplePeriod(const Serial::ImuSample& sample) {
+    float dt = m_sample_period;
+    if (sample.has_device_time) {
+        if (m_has_device_time) {
+            // Unsigned difference, so the 71-minute micros() wrap still gives the right step
+            float measured = static_cast<uint32_t>(sample.device_time_us - m_last_device_time_us) * 1e-6f;
+            if (measured > 0.0f && measured <= MAX_SAMPLE_PERIOD) {
+                dt = measured;
+                m_measured_period = m_measured_period > 0.0f
+                    ? m_measured_period + PERIOD_AVERAGING * (measured - m_measured_period)
+                    : measured;
+            }
+        }
+        m_last_device_time_us = sample.device_time_us;
+        m_has_device_time = true;
+    }
+    return dt;
 }
 
 void SensorUncoupler::normalizeVector(float& x, float& y, float& z) {
@@ -181,15 +540,21 @@ const float* SensorUncoupler::getGravityVector() const {
 }
 
 float SensorUncoupler::getGravityMagnitude() const {
-    return m_gravity_magnitude;
+    return m_estimate.load().magnitude;
+}
+
+GravityEstimate SensorUncoupler::getGravityEstimate() const {
+    return m_estimate.load();
 }
 
 void SensorUncoupler::enableGyroCalibration(bool enable) {
-    m_gyroCalibrationEnabled = enable;
+    changeSettings([enable](UncouplerSettings& settings) {
+        settings.gyroCalibrationEnabled = enable;
+    });
 }
 
 bool SensorUncoupler::isGyroCalibrationEnabled() const {
-    return m_gyroCalibrationEnabled;
+    return m_settings.load().gyroCalibrationEnabled;
 }
 
 } // namespace Uncoupler
@@ -1,8 +1,16 @@
 #pragma once
 
 #include <unordered_map>
-#include <deque>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <vector>
+#include "../libSerial/sample.h"
+#include "../libConcurrency/seqlock.h"
+#include "orientation.h"
+#include "error_state_filter.h"
+#include "filter_bank.h"
 
 namespace Uncoupler {
 
@@ -29,15 +37,68 @@ namespace Uncoupler {
         float az_linear = 0.0f;
     };
 
+    // Ways to estimate gravity
+    enum class GravityMode {
+        MovingAverage,  // Windowed accelerometer average, then a low-pass filter (accelerometer only)
+        Orientation,    // Attitude propagated from the gyro and corrected toward the accelerometer
+        Kalman          // Error-state Kalman filter over attitude and gyro bias (learns bias drift)
+    };
+
+    /**
+     * Get a gravity mode's name as used on the command line
+     * @param mode Mode
+     * @return "average", "orientation" or "kalman"
+     */
+    const char* gravityModeName(GravityMode mode);
+
     /**
-     * Class to handle uncoupling of linear acceleration from rotational acceleration
+     * Parse a gravity mode name
+     * @param text "average", "orientation" or "kalman"
+     * @param mode Receives the mode
+     * @return True if the name was recognised
+     */
+    bool parseGravityMode(const std::string& text, GravityMode& mode);
+
+    // Settings the filters run with; set from any thread, applied by processData
+    struct UncouplerSettings {
+        float gx_offset = 0.0f;
+        float gy_offset = 0.0f;
+        float gz_offset = 0.0f;
+        bool gyroCalibrationEnabled = false;
+        float gravity_cutoff_hz = 0.28f;  // Low-pass on the averaged gravity vector (its magnitude at half this)
+        float linear_cutoff_hz = 0.07f;   // Low-pass on linear acceleration (moving average mode only)
+        float linear_notch_hz = 0.0f;     // Notch on linear acceleration, e.g. mains or motor hum (0 = none)
+        size_t gravity_filter_size = 50;     // Samples; gravity_window_seconds at sample_rate, capped by the rings
+        float gravity_window_seconds = 1.0f; // Window length last asked for, kept across rate changes
+        GravityMode gravity_mode = GravityMode::MovingAverage;
+        float gyro_counts_per_dps = 131.0f;  // MPU6050 at +-250 deg/s
+        float orientation_gain = 0.05f;
+        float sample_rate = 50.0f;           // Used for the time step when samples carry no device time
+    };
+
+    // Gravity estimate as of the last processed sample
+    struct GravityEstimate {
+        float direction[3] = { 0.0f, 0.0f, 1.0f };  // Normalized
+        float magnitude = 9.81f;
+        float filtered[3] = { 0.0f, 0.0f, 9.81f };  // Low-pass filtered gravity vector
+        uint64_t samples = 0;                       // Samples processed so far
+        float gyro_bias[3] = { 0.0f, 0.0f, 0.0f };  // Kalman mode's gyro bias estimate in raw counts (else zero)
+    };
+
+    /**
+     * Class to handle uncoupling of linear acceleration from rotational acceleration.
+     * processData must be called from one thread at a time. The setters may
+     * be called from any thread; a change takes effect from the next sample
+     * processed, so the filters never see it half way through one. The
+     * gravity estimate is published after every sample for readers elsewhere.
      */
     class SensorUncoupler {
     public:
         /**
          * Constructor
          * @param gravity_filter_size Size of the moving average filter for gravity estimation
-         * @param alpha Low-pass filter coefficient (0-1, lower = smoother but slower response)
+         * @param alpha Smoothing as an EMA coefficient at 50 Hz (0-1, lower = smoother
+         *        but slower response); converted to the equivalent cutoff frequencies
          */
         SensorUncoupler(size_t gravity_filter_size = 50, float alpha = 0.02f);
 
@@ -50,17 +111,81 @@ namespace Uncoupler {
         void setGyroCalibrationOffsets(float gx_offset, float gy_offset, float gz_offset);
 
         /**
-         * Set low-pass filter alpha value
+         * Set the smoothing as an EMA coefficient at the current sample rate.
+         * Converted to the cutoffs that settle on a step as fast: gravity's, and linear acceleration's at a quarter of it.
          * @param alpha Filter coefficient (0-1, lower = smoother but slower response)
          */
         void setLowPassFilterAlpha(float alpha);
 
         /**
-         * Set gravity filter window size
+         * Set the cutoff of the gravity low-pass (2nd-order Butterworth; the
+         * magnitude is smoothed at half this)
+         * @param cutoff_hz -3 dB frequency (0.28 Hz by default; lower = smoother but slower response)
+         */
+        void setGravityCutoff(float cutoff_hz);
+
+        /**
+         * Get the cutoff of the gravity low-pass
+         * @return Frequency last set, in Hz
+         */
+        float getGravityCutoff() const;
+
+        /**
+         * Set the cutoff of the linear acceleration low-pass (2nd-order Butterworth)
+         * @param cutoff_hz -3 dB frequency (0.07 Hz by default)
+         */
+        void setLinearCutoff(float cutoff_hz);
+
+        /**
+         * Add a notch to the linear acceleration filter, or remove it
+         * @param frequency_hz Centre frequency (0 = no notch)
+         */
+        void setLinearNotch(float frequency_hz);
+
+        /**
+         * Set gravity filter window size. It is capped at the rings allocated
+         * on construction: 1000 samples, or the constructor's window if larger.
+         * The length in seconds is remembered uncapped, so a later rate change
+         * restores as much of it as fits.
          * @param size The new size for the moving average window
          */
         void setGravityFilterSize(size_t size);
 
+        /**
+         * Choose how gravity is estimated. Both estimators keep running, so
+         * switching takes effect on the next sample without a settling period.
+         * @param mode MovingAverage (the default), Orientation or Kalman
+         */
+        void setGravityMode(GravityMode mode);
+
+        /**
+         * Get the gravity estimation mode
+         * @return Mode last set
+         */
+        GravityMode getGravityMode() const;
+
+        /**
+         * Set the gyroscope scale the orientation mode converts raw counts with
+         * @param counts_per_dps Counts per deg/s (131 at +-250 deg/s, halving with each range step)
+         */
+        void setGyroScale(float counts_per_dps);
+
+        /**
+         * Set how strongly the orientation mode pulls toward the accelerometer
+         * @param beta Madgwick gain in rad/s (0.05 by default; higher converges faster but is noisier)
+         */
+        void setOrientationGain(float beta);
+
+        /**
+         * Tell the filters the sample rate changed. The window size is
+         * per-sample, so it is rescaled to keep the same length in seconds
+         * (within the cap of setGravityFilterSize);
+         * the cutoffs are in Hz and stay where they are. Samples with a
+         * device timestamp override this with the rate actually measured.
+         * @param rate_hz New samples per second (the defaults assume 50 Hz)
+         */
+        void setSampleRate(float rate_hz);
+
         /**
          * Process sensor data to separate linear and rotational components
          * @param sensorData Raw sensor data from IMU
@@ -69,7 +194,15 @@ namespace Uncoupler {
         UncoupledData processData(const std::unordered_map<std::string, int>& sensorData);
 
         /**
-         * Get the estimated gravity vector
+         * Process a typed sample to separate linear and rotational components
+         * @param sample Raw sensor sample from IMU
+         * @return Uncoupled sensor data with calibrated gyro values
+         */
+        UncoupledData processData(const Serial::ImuSample& sample);
+
+        /**
+         * Get the estimated gravity vector (processing thread only; use
+         * getGravityEstimate elsewhere)
          * @return Array of 3 floats [x, y, z] representing gravity direction
          */
         const float* getGravityVector() const;
@@ -80,6 +213,12 @@ namespace Uncoupler {
          */
         float getGravityMagnitude() const;
 
+        /**
+         * Get the gravity direction, magnitude and filtered vector from the same sample (any thread)
+         * @return Estimate published by the last processData call
+         */
+        GravityEstimate getGravityEstimate() const;
+
         /**
          * Enable/disable gyroscope calibration
          * @param enable True to enable calibration, false to disable
@@ -93,18 +232,41 @@ namespace Uncoupler {
         bool isGyroCalibrationEnabled() const;
 
     private:
+        // Change the settings (serialised, since several threads may set them)
+        template <typename Change>
+        void changeSettings(Change&& change);
+
+        // Copy newly published settings into the working state (processing thread)
+        void applySettings();
+
         // Apply calibration to gyroscope value
         int applyGyroCalibration(int value, float offset) const;
         
+        // Fit the moving average to m_gravity_filter_size, keeping the newest samples
+        void fitHistoryToWindow();
+
+        // Limit a window size to what the rings hold
+        size_t clampWindow(size_t size) const;
+
+        // Recompute the running sums from the samples in the window
+        void resumHistory();
+        
         // Update gravity vector estimation with new accelerometer data
         void updateGravityEstimation(float ax, float ay, float az);
+
+        // Orientation and Kalman modes: advance the attitude and take gravity from it
+        void updateOrientation(const UncoupledData& result, float dt);
+
+        // Seconds since the previous sample, from the device clock when there is one
+        float samplePeriod(const Serial::ImuSample& sample);
         
-        // Apply low-pass filter for smoother gravity estimation
-        void applyLowPassFilter(float& value, float newValue, float alpha);
+        // Rebuild both filter banks from the working copy of the cutoffs, continuing from the current outputs
+        void configureFilters();
         
         // Normalize a 3D vector
         void normalizeVector(float& x, float& y, float& z);
 
+        // Working copy of the settings, only touched by the processing thread
         // Gyroscope calibration offsets
         float m_gx_offset;
         float m_gy_offset;
@@ -118,20 +280,62 @@ namespace Uncoupler {
         float m_gravity_magnitude;  // Estimated gravity magnitude
         float m_filtered_gravity[3];  // Low-pass filtered gravity vector
         
-        // Low-pass filter alpha value (0-1)
-        float m_alpha;
+        // Gravity low-pass over (x, y, z, unused) of the window average, and one at
+        // half its cutoff over (magnitude, unused, unused, unused)
+        FilterBank m_gravityFilter;
+        FilterBank m_magnitudeFilter;
+        bool m_gravityFilterPrimed;
+        float m_gravity_cutoff_hz;
+
+        // Linear acceleration low-pass (and optional notch) over (x, y, z, unused)
+        FilterBank m_linearFilter;
+        float m_linear_cutoff_hz;
+        float m_linear_notch_hz;
+
+        // Sample rate the window size was chosen for (guarded by m_settingsMutex)
+        float m_sample_rate;
         
-        // Moving average filters for gravity estimation
-        std::deque<float> m_ax_history;
-        std::deque<float> m_ay_history;
-        std::deque<float> m_az_history;
+        // Moving average filters for gravity estimation: rings of the latest
+        // samples (m_history_head is the next slot written) with running sums
+        // over the newest m_history_count of them, the current window. The
+        // rings are allocated once, in the constructor, and bound the window.
+        std::vector<float> m_ax_history;
+        std::vector<float> m_ay_history;
+        std::vector<float> m_az_history;
+        size_t m_history_head;
+        size_t m_history_count;
+        size_t m_history_since_resum;
+        double m_history_sum[3];
         size_t m_gravity_filter_size;
         
+        // Magnitude of the current window's average (0 until it has 5 samples)
+        float m_window_magnitude;
+
+        // Orientation and Kalman modes
+        GravityMode m_gravityMode;
+        OrientationFilter m_orientation;
+        ErrorStateFilter m_kalman;
+        bool m_orientationActive;      // False until the first sample in the current gyro-aided mode
+        float m_gyro_rad_per_count;
+        float m_sample_period;         // Nominal seconds per sample
+        uint32_t m_last_device_time_us;
+        bool m_has_device_time;
+        float m_measured_period;       // Slow average of the device clock's steps (0 until measured)
+        
         // Previous computed linear acceleration values for filtering
         float m_prev_linear_accel[3];
         
-        // Whether we have initialized the filters
+        // Whether the linear acceleration filter has been settled since gravity had an estimate
         bool m_filters_initialized;
+
+        // Requested settings; the mutex only orders the setters, processData never takes it
+        Concurrency::Seqlock<UncouplerSettings> m_settings;
+        std::mutex m_settingsMutex;
+        uint64_t m_appliedVersion;  // Settings version the working copy was taken from
+
+        // What readers on other threads see
+        Concurrency::Seqlock<GravityEstimate> m_estimate;
+        uint64_t m_samples;
     };
 
 } // namespace Uncoupler
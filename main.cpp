@@ -4,13 +4,24 @@
 #include <atomic>
 #include <conio.h> // For _kbhit() and _getch()
 #include <filesystem>
+#include <memory>
+#include <vector>
 #include <algorithm> // For std::min and std::max
+#include <cstdlib>
 #include "libSerial/serial.h"
+#include "libSerial/ingest_mux.h"
+#include "libSerial/capture.h"
+#include "libSerial/device_setup.h"
 #include "libPlot/plot.h"
 #include "libHand/hand.h"
 #include "libAudio/Audio.h"
 #include "libCalibrator/calibration.h"
 #include "libUncoupler/uncoupler.h"
+#include "libPipeline/pipeline.h"
+#include "libPipeline/core_stages.h"
+#include "libPipeline/sinks.h"
+#include "libMetrics/latency_monitor.h"
+#include "libRealtime/realtime.h"
 
 // Global flag for termination
 std::atomic<bool> g_running(true);
@@ -24,6 +35,15 @@ Calibration::Calibrator g_calibrator;
 // Global Uncoupler
 Uncoupler::SensorUncoupler g_uncoupler;
 
+// Latency of the primary IMU's samples from byte arrival to the screen (or first sink)
+Metrics::LatencyMonitor g_latency;
+
+// Core pinning, priority and memory locking from the command line
+Realtime::RealtimeOptions g_realtime;
+
+// Cleared by the sensor thread once every port has closed
+std::atomic<bool> g_ingesting(true);
+
 // Path to the calibration sound
 std::string g_calibrationSoundPath;
 bool g_audioInitialized = false;
@@ -109,28 +129,28 @@ void onCalibrationComplete(const Calibration::CalibrationResults& results) {
 }
 
 // Initialize and connect to the serial port
-HANDLE initializeSerialPort(const std::string& portName) {
-    HANDLE hSerial = Serial::getSerialHandle(portName);
+std::unique_ptr<Serial::SerialSource> initializeSerialPort(const std::string& portName) {
+    std::unique_ptr<Serial::SerialSource> source = Serial::openSerialSource(portName);
     
-    if (hSerial == INVALID_HANDLE_VALUE) {
+    if (!source) {
         std::cerr << "Failed to open serial port." << std::endl;
     } else {
         std::cout << "Reading sensor data. Press ESC to exit..." << std::endl;
     }
     
-    return hSerial;
+    return source;
 }
 
 // Display the IMU values
-void stringifyMap(std::unordered_map<std::string, int>& result) {
+void stringifySample(const Serial::ImuSample& result) {
     // Comment out the sensor data logging as requested
     /*
-    std::cout << "ax: " << result["ax"] << ", ";
-    std::cout << "ay: " << result["ay"] << ", ";
-    std::cout << "az: " << result["az"] << ", ";
-    std::cout << "gx: " << result["gx"] << ", ";
-    std::cout << "gy: " << result["gy"] << ", ";
-    std::cout << "gz: " << result["gz"] << ", ";
+    std::cout << "ax: " << result.ax << ", ";
+    std::cout << "ay: " << result.ay << ", ";
+    std::cout << "az: " << result.az << ", ";
+    std::cout << "gx: " << result.gx << ", ";
+    std::cout << "gy: " << result.gy << ", ";
+    std::cout << "gz: " << result.gz << ", ";
     
     // Display calculated velocity
     Hand::Vector3D velocity = g_tracker.getVelocity();
@@ -140,8 +160,36 @@ void stringifyMap(std::unordered_map<std::string, int>& result) {
     */
 }
 
+// Print each port's ingest health counters
+void printIngestStats(const Serial::IngestMux* mux) {
+    for (size_t i = 0; i < mux->deviceCount(); i++) {
+        Serial::IngestCounters stats = mux->stats(static_cast<int>(i));
+        std::cout << "Device " << i << ": " << stats.bytes_in << " bytes, "
+                  << stats.frames_decoded << " frames, "
+                  << stats.crc_failures << " CRC failures, "
+                  << stats.parse_failures << " parse failures, "
+                  << stats.resyncs << " resyncs (" << stats.discarded_bytes << " bytes skipped), "
+                  << stats.sequence_gaps << " missing frames, "
+                  << stats.overflow_bytes << " bytes overflowed, "
+                  << "buffer high-water " << stats.buffer_high_water << std::endl;
+    }
+}
+
+// Print each processing stage's throughput and queue
+void printPipelineStats(const Pipeline::Pipeline* pipeline) {
+    for (const Pipeline::StageStats& stage : pipeline->stats()) {
+        std::cout << "Stage " << stage.name << ": " << stage.processed << " samples ("
+                  << stage.samples_per_second << "/s, " << stage.mean_process_ns << " ns each)";
+        if (stage.execution != Pipeline::Execution::Fused) {
+            std::cout << ", queue " << stage.queue_depth << "/" << stage.queue_capacity
+                      << ", " << stage.dropped << " dropped";
+        }
+        std::cout << std::endl;
+    }
+}
+
 // Thread function to check for keyboard input
-void keyboardThread() {
+void keyboardThread(const Serial::IngestMux* mux, const Pipeline::Pipeline* pipeline) {
     while (g_running) {
         if (_kbhit()) {
             int key = _getch();
@@ -195,17 +243,17 @@ void keyboardThread() {
             }
             // Increase gravity filter smoothing with 'S' key
             else if (key == 's' || key == 'S') {
-                static float currentAlpha = 0.02f;  // Default alpha
-                currentAlpha = (std::max)(0.001f, currentAlpha * 0.8f);  // Reduce by 20%
-                g_uncoupler.setLowPassFilterAlpha(currentAlpha);
-                std::cout << "Increased gravity smoothing (alpha = " << currentAlpha << ")" << std::endl;
+                float cutoff = (std::max)(0.01f, g_uncoupler.getGravityCutoff() * 0.8f);  // Reduce by 20%
+                g_uncoupler.setGravityCutoff(cutoff);
+                g_uncoupler.setLinearCutoff(cutoff * 0.25f);
+                std::cout << "Increased gravity smoothing (cutoff = " << cutoff << " Hz)" << std::endl;
             }
             // Decrease gravity filter smoothing with 'F' key
             else if (key == 'f' || key == 'F') {
-                static float currentAlpha = 0.02f;  // Default alpha
-                currentAlpha = (std::min)(0.5f, currentAlpha * 1.25f);  // Increase by 25%
-                g_uncoupler.setLowPassFilterAlpha(currentAlpha);
-                std::cout << "Decreased gravity smoothing (alpha = " << currentAlpha << ")" << std::endl;
+                float cutoff = (std::min)(5.0f, g_uncoupler.getGravityCutoff() * 1.25f);  // Increase by 25%
+                g_uncoupler.setGravityCutoff(cutoff);
+                g_uncoupler.setLinearCutoff(cutoff * 0.25f);
+                std::cout << "Decreased gravity smoothing (cutoff = " << cutoff << " Hz)" << std::endl;
             }
             // Increase gravity filter window size with '+' key
             else if (key == 43 || key == 61) {  // 43 is '+', 61 is '='
@@ -221,6 +269,24 @@ void keyboardThread() {
                 g_uncoupler.setGravityFilterSize(currentWindowSize);
                 std::cout << "Decreased gravity filter window size to " << currentWindowSize << " samples" << std::endl;
             }
+            // Cycle the gravity estimate (average, orientation, kalman) with 'G' key
+            else if (key == 'g' || key == 'G') {
+                Uncoupler::GravityMode mode = Uncoupler::GravityMode::Orientation;
+                if (g_uncoupler.getGravityMode() == Uncoupler::GravityMode::Orientation) {
+                    mode = Uncoupler::GravityMode::Kalman;
+                } else if (g_uncoupler.getGravityMode() == Uncoupler::GravityMode::Kalman) {
+                    mode = Uncoupler::GravityMode::MovingAverage;
+                }
+                g_uncoupler.setGravityMode(mode);
+                std::cout << "Gravity estimation: " << Uncoupler::gravityModeName(mode) << std::endl;
+            }
+            // Show ingest health with 'I' key
+            else if (key == 'i' || key == 'I') {
+                printIngestStats(mux);
+                printPipelineStats(pipeline);
+                g_latency.print(std::cout);
+                if (g_realtime.enabled()) g_realtime.report(std::cout);
+            }
             
             // ESC key to exit
             if (key == 27) {
@@ -233,96 +299,201 @@ void keyboardThread() {
     }
 }
 
-// Thread function to read sensor data
-void sensorThread(HANDLE hSerial) {
-    while (g_running) {
-        try {
-            // Read one complete message using the global function (not in Serial namespace)
-            std::unordered_map<std::string, int> result = ::readAndProcess(hSerial);
-            
-            // Print all six IMU values (now commented out)
-            stringifyMap(result);
-            
-            // Process raw data through the uncoupler to get gravity vector estimation
-            Uncoupler::UncoupledData uncoupledData = g_uncoupler.processData(result);
-            
-            // Update the hand tracker with raw data
-            g_tracker.update(result);
+// Declare the processing chain for the primary IMU. The core stages share
+// state with the keyboard and render threads and stay on the ingest thread;
+// sinks from the command line each read the broadcast ring on their own
+// thread, so a slow one only loses its own samples.
+bool buildPipeline(Pipeline::Pipeline& pipeline, const std::vector<std::string>& sinkSpecs, bool withPlot) {
+    // Uncoupler and hand tracker, as in the headless build
+    Pipeline::addCoreStages(pipeline, g_uncoupler, g_tracker, g_latency);
+    
+    if (withPlot) pipeline.addStage("plot", [](Pipeline::FusedSample& sample) {
+        // Add calibrated data point to the plot
+        Plot::addDataPoint(sample.calibrated);
+        
+        // Add data to plot with gravity and linear acceleration information
+        Plot::addDataPointWithGravity(
+            sample.calibrated,
+            sample.uncoupled.grav_x,
+            sample.uncoupled.grav_y,
+            sample.uncoupled.grav_z,
+            sample.uncoupled.ax_linear,
+            sample.uncoupled.ay_linear,
+            sample.uncoupled.az_linear,
+            &sample.times
+        );
+    });
+    
+    // Update calibration state if active
+    pipeline.addStage("calibrate", [](Pipeline::FusedSample& sample) {
+        if (g_calibrator.isCalibrating()) {
+            g_calibrator.update(&sample.raw);
+        } else {
+            g_calibrator.update(nullptr);
+        }
+    });
+    
+    // Without a window a sample is out once the first sink has written it
+    return Pipeline::addSinks(pipeline, sinkSpecs, withPlot ? nullptr : &g_latency);
+}
 
-            
-            // Use calibrated values from the hand tracker instead of raw data
-            std::unordered_map<std::string, int> calibratedData;
-            Hand::Vector3D accel = g_tracker.getAcceleration();
-            Hand::Vector3D gyro = g_tracker.getGyroscope();
-            
-            calibratedData["ax"] = static_cast<int>(accel.x);
-            calibratedData["ay"] = static_cast<int>(accel.y);
-            calibratedData["az"] = static_cast<int>(accel.z);
-            calibratedData["gx"] = static_cast<int>(gyro.x);
-            calibratedData["gy"] = static_cast<int>(gyro.y);
-            calibratedData["gz"] = static_cast<int>(gyro.z);
-            
-            // Add calibrated data point to the plot
-            Plot::addDataPoint(calibratedData);
-            
-            // Add data to plot with gravity and linear acceleration information
-            Plot::addDataPointWithGravity(
-                calibratedData,
-                uncoupledData.grav_x,
-                uncoupledData.grav_y, 
-                uncoupledData.grav_z,
-                uncoupledData.ax_linear,
-                uncoupledData.ay_linear,
-                uncoupledData.az_linear
-            );
-            
-            // Update calibration state if active
-            if (g_calibrator.isCalibrating()) {
-                g_calibrator.update(&result);
-            } else {
-                g_calibrator.update(nullptr);
-            }
-            
-            // Add a small delay between readings
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+// Show a device's answer to a control command and follow its new rate
+void onConfigReport(int id, const Serial::ConfigReport& report) {
+    if (report.status != Serial::ControlStatus::Ok) {
+        std::cerr << "Device " << id << " rejected command 0x" << std::hex << static_cast<int>(report.command)
+                  << std::dec << " (status " << static_cast<int>(report.status) << ")" << std::endl;
+        return;
+    }
+
+    const Serial::DeviceConfig& config = report.config;
+    std::cout << "Device " << id << ": " << config.rate_hz << " Hz, DLPF " << static_cast<int>(config.dlpf)
+              << ", accel range " << static_cast<int>(config.accel_range)
+              << ", gyro range " << static_cast<int>(config.gyro_range)
+              << ", " << (config.binary ? "binary" : "JSON") << " at " << config.baud_rate << " baud" << std::endl;
+
+    // The gravity window is counted in samples, so it is rescaled to the new rate (as
+    // is the time step used without device timestamps); the filter cutoffs are in Hz
+    // and stay put. The orientation mode needs the gyro in deg/s: 131 counts at
+    // FS_SEL 0, halving per step
+    if (id == 0) {
+        g_uncoupler.setSampleRate(static_cast<float>(config.rate_hz));
+        g_uncoupler.setGyroScale(131.0f / (1 << config.gyro_range));
+    }
+}
+
+// Thread function to read sensor data from every port
+void sensorThread(Serial::IngestMux* mux, Pipeline::Pipeline* pipeline) {
+    g_realtime.applyToThisThread(Realtime::ThreadRole::Ingest, "ingest");
+    while (g_running && mux->openDeviceCount() > 0) {
+        try {
+            // Sleep until bytes arrive on any port (or main calls wake() to
+            // stop us), then decode every sample that arrived.
+            // Device 0 drives the hand model; the others are ingested alongside it.
+            mux->poll(-1, [pipeline](const Serial::ImuSample& sample) {
+                if (sample.device == 0) {
+                    pipeline->push(sample);
+                }
+            });
         }
         catch (const std::exception& e) {
+            // A bad frame only costs that frame; keep reading
             std::cerr << "Error in sensor thread: " << e.what() << std::endl;
-            break;
         }
     }
+    g_ingesting = false;
 }
 
-int main() {
+int main(int argc, char** argv) {
     // Initialize audio
     bool audioInitialized = initializeAudio();
     if (!audioInitialized) {
         std::cerr << "Warning: Audio WAV file initialization failed. Will use system sounds instead." << std::endl;
     }
     
-    // Initialize plotting library
-    if (!Plot::initialize("Motion Capture Data Visualization")) {
-        std::cerr << "Failed to initialize plotting library" << std::endl;
+    // Command line: [port ...] [--capture file] [--replay file ...] [--fast] [--headless]
+    //               [--format json|binary] [--baud N] [--dlpf N] [--accel-range N] [--gyro-range N] [--rate HZ]
+    //               [--sink csv:file|jsonl:file ...] [--latency-budget-us N] [--gravity average|orientation|kalman]
+    //               [--cpu-ingest LIST] [--cpu-workers LIST] [--cpu-render LIST] [--rt-priority N]
+    //               [--mlock on|off] [--prefault-mb N] [--jitter-check N]
+    Serial::DeviceSetup deviceSetup;
+    bool headless = false;
+    std::vector<std::string> portNames;
+    std::vector<std::string> sinkSpecs;
+    std::vector<std::string> replayFiles;
+    std::string capturePath;
+    Serial::ReplayPace replayPace = Serial::ReplayPace::Recorded;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFiles.push_back(argv[++i]);
+        } else if (arg == "--fast") {
+            replayPace = Serial::ReplayPace::AsFastAsPossible;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--sink" && i + 1 < argc) {
+            sinkSpecs.push_back(argv[++i]);
+        } else if (arg == "--latency-budget-us" && i + 1 < argc) {
+            g_latency.setBudget(static_cast<int64_t>(std::atof(argv[++i]) * 1000.0));
+        } else if (arg == "--gravity" && i + 1 < argc) {
+            Uncoupler::GravityMode mode;
+            if (Uncoupler::parseGravityMode(argv[++i], mode)) {
+                g_uncoupler.setGravityMode(mode);
+            } else {
+                std::cerr << "Ignoring --gravity " << argv[i] << ": expected average, orientation or kalman" << std::endl;
+            }
+        } else if (i + 1 < argc && deviceSetup.parseOption(arg, argv[i + 1])) {
+            i++;
+        } else if (i + 1 < argc && g_realtime.parseOption(arg, argv[i + 1])) {
+            i++;
+        } else {
+            portNames.push_back(arg);
+        }
+    }
+    if (portNames.empty() && replayFiles.empty()) {
+        portNames.push_back("\\\\.\\COM3"); // Adjust as needed (e.g. COM4)
+    }
+    
+    // Initialize plotting library (headless runs the same engine with no window)
+    if (!headless && !Plot::initialize("Motion Capture Data Visualization")) {
+        std::cerr << "Failed to initialize plotting library (use --headless on machines without a display)" << std::endl;
         return 1;
     }
     
     // Configure which plots to show by default
     Plot::configurePlots(true, true, false, true, false);
+    Plot::setLatencyMonitor(&g_latency);
     
-    // Connect to the serial port
-    std::string portName = "\\\\.\\COM3"; // Adjust as needed (e.g. COM4)
-    HANDLE hSerial = initializeSerialPort(portName);
+    // Connect to every port given on the command line (one per IMU)
+    Serial::IngestMux mux;
+    for (size_t i = 0; i < portNames.size(); i++) {
+        std::unique_ptr<Serial::SerialSource> source = initializeSerialPort(portNames[i]);
+        
+        // Tee the raw bytes to disk; one file per port when there are several
+        if (source && !capturePath.empty()) {
+            std::string path = portNames.size() > 1 ? capturePath + "." + std::to_string(i) : capturePath;
+            source = Serial::CaptureSource::open(std::move(source), path);
+        }
+        
+        if (!source || mux.addSource(std::move(source)) < 0) {
+            Plot::shutdown();
+            return 1;
+        }
+    }
+    
+    // Recorded sessions go through the same decoder and processing chain
+    for (const std::string& replayFile : replayFiles) {
+        std::unique_ptr<Serial::SerialSource> source = Serial::ReplaySource::open(replayFile, replayPace);
+        if (!source || mux.addSource(std::move(source)) < 0) {
+            Plot::shutdown();
+            return 1;
+        }
+    }
     
-    if (hSerial == INVALID_HANDLE_VALUE) {
+    // Apply the requested device settings, one command per report
+    deviceSetup.start(mux, onConfigReport);
+    
+    // Lock and prefault memory before the pipeline allocates its buffers
+    g_realtime.applyToProcess();
+    g_realtime.measureWakeupJitter();
+    
+    // Processing stages for the primary IMU
+    Pipeline::Pipeline pipeline;
+    if (!buildPipeline(pipeline, sinkSpecs, !headless)) {
         Plot::shutdown();
         return 1;
     }
+    pipeline.setWorkerSetup([](const std::string& stage) {
+        g_realtime.applyToThisThread(Realtime::ThreadRole::Worker, stage);
+    });
+    pipeline.start();
     
     // Start sensor reading thread
-    std::thread sensor_thread(sensorThread, hSerial);
+    std::thread sensor_thread(sensorThread, &mux, &pipeline);
     
     // Start keyboard input thread
-    std::thread keyboard_thread(keyboardThread);
+    std::thread keyboard_thread(keyboardThread, &mux, &pipeline);
     
     // Print instructions
     std::cout << "Keyboard Controls:" << std::endl;
@@ -340,10 +511,24 @@ int main() {
     std::cout << "F: Decrease gravity smoothing" << std::endl;
     std::cout << "+: Increase gravity filter window size" << std::endl;
     std::cout << "-: Decrease gravity filter window size" << std::endl;
+    std::cout << "G: Cycle gravity estimate (average/orientation/kalman)" << std::endl;
+    std::cout << "I: Show ingest and latency statistics" << std::endl;
     std::cout << "ESC: Exit" << std::endl;
     
+    if (headless) {
+        // Nothing to draw: wait for ESC or for every port to close
+        while (g_running && g_ingesting) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    
+    // This thread draws from here on; the threads above were started without its settings
+    if (!headless) {
+        g_realtime.applyToThisThread(Realtime::ThreadRole::Render, "render");
+    }
+    
     // Main rendering loop
-    while (g_running && Plot::isWindowOpen()) {
+    while (!headless && g_running && Plot::isWindowOpen()) {
         // Render frame and break loop if window is closed
         if (!Plot::renderFrame()) {
             g_running = false;
@@ -351,18 +536,22 @@ int main() {
         }
     }
     
-    // Wait for threads to finish
+    // Wait for threads to finish; the sensor thread may be blocked waiting for bytes
     g_running = false;
+    mux.wake();
     if (sensor_thread.joinable()) {
         sensor_thread.join();
     }
+    pipeline.stop();
     if (keyboard_thread.joinable()) {
         keyboard_thread.join();
     }
     
-    // Clean up
-    CloseHandle(hSerial);
+    // Clean up (the mux closes its ports when it goes out of scope)
     Plot::shutdown();
     
-    return 0;
+    // Latency dump; a missed --latency-budget-us fails the run
+    g_latency.print(std::cout);
+    if (g_realtime.enabled()) g_realtime.report(std::cout);
+    return g_latency.overBudget() ? 2 : 0;
 }
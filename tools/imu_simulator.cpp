@@ -0,0 +1,323 @@
+// Synthetic IMU load generator.
+//
+// Plays a scripted motion profile through a rigid-body MPU6050 model and sends
+// the result in the firmware's exact wire format, either live into pseudo
+// terminals (one per virtual device, open them with `main /dev/pts/N ...`) or
+// into capture files for `main --replay`. Faults can be injected to exercise
+// the decoder's resync paths, and --consume runs the host ingest path in
+// process to find the throughput ceiling. Live devices answer the firmware's
+// control commands, so rate, range, format and baud changes from the host
+// take effect mid-stream.
+//
+//   imu_simulator [options]
+//     --devices N        virtual devices (default 1)
+//     --rate HZ          samples per second per device (default 1000, up to 10000)
+//     --seconds S        run time, 0 = until killed (default 10)
+//     --format F         json | binary (default json)
+//     --profile SPEC     motion script, see Simulator::parseProfile
+//     --accel-noise G    accelerometer noise sigma in g (default 0.002)
+//     --gyro-noise DPS   gyroscope noise sigma in deg/s (default 0.05)
+//     --gyro-bias DPS    constant gyro bias on every axis (default 0)
+//     --drift DPS        gyro bias random walk per sqrt(s) (default 0)
+//     --clock-ppm PPM    device clock error (default 0)
+//     --corrupt P        probability of a flipped bit per frame
+//     --drop P           probability a frame is not sent
+//     --burst P          probability of a garbage burst before a frame
+//     --burst-bytes N    length of each burst (default 64)
+//     --seed N           random seed (default 1)
+//     --out PATH         write capture files instead of ptys (PATH.N for several devices)
+//     --consume          read the ptys back through IngestMux + SensorUncoupler
+#include "simulator.h"
+#include "capture.h"
+#include "ingest_mux.h"
+#include "pty_loopback.h"
+#include "uncoupler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int devices = 1;
+    double rate = 1000.0;
+    double seconds = 10.0;
+    bool binary = false;
+    std::string profile = "rest:2,rotate:z:90:4,shake:x:0.5:5:2,tap:z:3,rest:1";
+    Simulator::SensorErrors errors;
+    Simulator::FaultConfig faults;
+    uint32_t seed = 1;
+    std::string outPath;
+    bool consume = false;
+};
+
+// One simulated ESP32
+struct VirtualDevice {
+    Simulator::FakeDevice device;
+    std::vector<char> pending;
+    double nextSample = 0.0;  // Seconds since start when the next reading is due
+
+    VirtualDevice(const std::vector<Simulator::MotionSegment>& profile, const Options& options, int index)
+        : device(profile, options.errors, options.faults, initialConfig(options), options.seed * 7919u + index)
+    {
+    }
+
+    // Power-up settings from the command line (the rate may exceed what real hardware allows)
+    static Serial::DeviceConfig initialConfig(const Options& options) {
+        Serial::DeviceConfig config;
+        config.rate_hz = static_cast<uint16_t>(options.rate);
+        config.binary = options.binary;
+        return config;
+    }
+};
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--consume") {
+            options.consume = true;
+        } else if (!hasValue) {
+            std::fprintf(stderr, "unknown or incomplete option %s\n", arg.c_str());
+            return false;
+        } else if (arg == "--devices") {
+            options.devices = std::atoi(argv[++i]);
+        } else if (arg == "--rate") {
+            options.rate = std::atof(argv[++i]);
+        } else if (arg == "--seconds") {
+            options.seconds = std::atof(argv[++i]);
+        } else if (arg == "--format") {
+            options.binary = std::strcmp(argv[++i], "binary") == 0;
+        } else if (arg == "--profile") {
+            options.profile = argv[++i];
+        } else if (arg == "--accel-noise") {
+            options.errors.accel_noise_g = std::atof(argv[++i]);
+        } else if (arg == "--gyro-noise") {
+            options.errors.gyro_noise_dps = std::atof(argv[++i]);
+        } else if (arg == "--gyro-bias") {
+            double bias = std::atof(argv[++i]);
+            for (double& axis : options.errors.gyro_bias_dps) axis = bias;
+        } else if (arg == "--drift") {
+            options.errors.gyro_drift_dps = std::atof(argv[++i]);
+        } else if (arg == "--clock-ppm") {
+            options.errors.clock_error_ppm = std::atof(argv[++i]);
+        } else if (arg == "--corrupt") {
+            options.faults.corrupt_rate = std::atof(argv[++i]);
+        } else if (arg == "--drop") {
+            options.faults.drop_rate = std::atof(argv[++i]);
+        } else if (arg == "--burst") {
+            options.faults.burst_rate = std::atof(argv[++i]);
+        } else if (arg == "--burst-bytes") {
+            options.faults.burst_bytes = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--out") {
+            options.outPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (options.devices < 1 || options.devices > static_cast<int>(Serial::MAX_DEVICES)) {
+        std::fprintf(stderr, "--devices must be 1..%zu\n", Serial::MAX_DEVICES);
+        return false;
+    }
+    if (options.rate < 1.0 || options.rate > 65535.0) {
+        std::fprintf(stderr, "--rate must be 1..65535\n");
+        return false;
+    }
+    if (options.outPath.empty() && options.seconds <= 0.0 && options.consume) {
+        std::fprintf(stderr, "--consume needs a finite --seconds\n");
+        return false;
+    }
+    return true;
+}
+
+static void printTotals(const std::vector<std::unique_ptr<VirtualDevice>>& devices, double elapsed) {
+    Simulator::StreamStats total;
+    for (const std::unique_ptr<VirtualDevice>& device : devices) {
+        const Simulator::StreamStats& stats = device->device.stats();
+        total.frames += stats.frames;
+        total.dropped += stats.dropped;
+        total.corrupted += stats.corrupted;
+        total.bursts += stats.bursts;
+        total.bytes += stats.bytes;
+    }
+    std::printf("sent     %llu frames (%llu dropped, %llu corrupted, %llu bursts), %.1f MB\n",
+                static_cast<unsigned long long>(total.frames), static_cast<unsigned long long>(total.dropped),
+                static_cast<unsigned long long>(total.corrupted), static_cast<unsigned long long>(total.bursts),
+                total.bytes / 1e6);
+    std::printf("rate     %.0f frames/s total over %.2f s\n", total.frames / elapsed, elapsed);
+}
+
+// Generate the whole run into capture files, timestamped at the nominal sample times
+static int writeCaptureFiles(const Options& options, std::vector<std::unique_ptr<VirtualDevice>>& devices) {
+    uint64_t samples = static_cast<uint64_t>(options.seconds * options.rate);
+    double dt = 1.0 / options.rate;
+    auto start = Clock::now();
+
+    for (size_t d = 0; d < devices.size(); d++) {
+        std::string path = devices.size() > 1 ? options.outPath + "." + std::to_string(d) : options.outPath;
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::fprintf(stderr, "cannot create %s\n", path.c_str());
+            return 1;
+        }
+        std::fwrite(Serial::CAPTURE_MAGIC, 1, sizeof(Serial::CAPTURE_MAGIC), file);
+
+        VirtualDevice& device = *devices[d];
+        for (uint64_t i = 0; i < samples; i++) {
+            device.pending.clear();
+            device.device.sample(device.pending);
+            if (device.pending.empty()) continue;
+
+            Serial::CaptureRecord record;
+            record.time_ns = static_cast<uint64_t>(i * dt * 1e9);
+            record.size = static_cast<uint32_t>(device.pending.size());
+            std::fwrite(&record.time_ns, sizeof(record.time_ns), 1, file);
+            std::fwrite(&record.size, sizeof(record.size), 1, file);
+            std::fwrite(device.pending.data(), 1, device.pending.size(), file);
+        }
+        std::fclose(file);
+        std::printf("wrote %s\n", path.c_str());
+    }
+
+    printTotals(devices, std::chrono::duration<double>(Clock::now() - start).count());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 1;
+
+    std::vector<Simulator::MotionSegment> profile;
+    if (!Simulator::parseProfile(options.profile, profile)) {
+        std::fprintf(stderr, "bad --profile \"%s\"\n", options.profile.c_str());
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<VirtualDevice>> devices;
+    for (int d = 0; d < options.devices; d++) {
+        devices.push_back(std::make_unique<VirtualDevice>(profile, options, d));
+    }
+
+    if (!options.outPath.empty()) {
+        return writeCaptureFiles(options, devices);
+    }
+
+    std::vector<std::unique_ptr<Serial::PtyLoopback>> ptys;
+    for (int d = 0; d < options.devices; d++) {
+        std::unique_ptr<Serial::PtyLoopback> pty = std::make_unique<Serial::PtyLoopback>();
+        if (!pty->open()) return 1;
+        std::printf("device %d: %s\n", d, pty->devicePath().c_str());
+        ptys.push_back(std::move(pty));
+    }
+    std::fflush(stdout);
+
+    // Host side, opened before the first byte is written
+    Serial::IngestMux mux;
+    if (options.consume) {
+        for (const std::unique_ptr<Serial::PtyLoopback>& pty : ptys) {
+            if (mux.addSource(Serial::openSerialSource(pty->devicePath())) < 0) return 1;
+        }
+    }
+
+    // Writer: wakes every half millisecond, answers any commands and sends
+    // every sample that is due at each device's current rate
+    std::atomic<bool> writing(true);
+    double elapsed = 0.0;
+    std::thread writer([&]() {
+        auto start = Clock::now();
+        auto wake = std::chrono::microseconds(500);
+        auto nextWake = start;
+        char commands[256];
+
+        while (true) {
+            double now = std::chrono::duration<double>(Clock::now() - start).count();
+            if (options.seconds > 0.0 && now >= options.seconds) break;
+
+            for (size_t d = 0; d < devices.size(); d++) {
+                VirtualDevice& device = *devices[d];
+                device.pending.clear();
+
+                long n;
+                while ((n = ptys[d]->read(commands, sizeof(commands))) > 0) {
+                    device.device.receive(commands, static_cast<size_t>(n), device.pending);
+                }
+                while (device.nextSample <= now) {
+                    device.device.sample(device.pending);
+                    device.nextSample += device.device.samplePeriod();
+                }
+                if (!device.pending.empty()) {
+                    ptys[d]->write(device.pending.data(), device.pending.size());
+                }
+            }
+            nextWake += wake;
+            std::this_thread::sleep_until(nextWake);
+        }
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        writing = false;
+    });
+
+    if (options.consume) {
+        std::vector<Uncoupler::SensorUncoupler> uncouplers(devices.size());
+        uint64_t received = 0;
+        double cpuStart = threadCpuSeconds();
+        auto wallStart = Clock::now();
+        int idlePolls = 0;
+        while (writing || idlePolls < 3) {
+            size_t n = mux.poll(100, [&](const Serial::ImuSample& sample) {
+                uncouplers[sample.device].processData(sample);
+                received++;
+            });
+            idlePolls = (n == 0 && !writing) ? idlePolls + 1 : 0;
+        }
+        double cpu = threadCpuSeconds() - cpuStart;
+        double wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+        writer.join();
+
+        printTotals(devices, elapsed);
+        std::printf("received %llu samples, %.0f samples/s, host ingest %.1f%% of one core (%.0f ns/sample)\n",
+                    static_cast<unsigned long long>(received), received / elapsed, 100.0 * cpu / wall,
+                    received > 0 ? cpu * 1e9 / received : 0.0);
+
+        // What the host noticed, to compare with the faults injected above
+        Serial::IngestCounters total;
+        for (size_t d = 0; d < mux.deviceCount(); d++) {
+            Serial::IngestCounters stats = mux.stats(static_cast<int>(d));
+            total.crc_failures += stats.crc_failures;
+            total.parse_failures += stats.parse_failures;
+            total.resyncs += stats.resyncs;
+            total.discarded_bytes += stats.discarded_bytes;
+            total.sequence_gaps += stats.sequence_gaps;
+            total.buffer_high_water = std::max(total.buffer_high_water, stats.buffer_high_water);
+        }
+        std::printf("ingest   %llu CRC failures, %llu parse failures, %llu resyncs (%llu bytes), "
+                    "%llu missing frames, buffer high-water %llu bytes\n",
+                    static_cast<unsigned long long>(total.crc_failures),
+                    static_cast<unsigned long long>(total.parse_failures),
+                    static_cast<unsigned long long>(total.resyncs),
+                    static_cast<unsigned long long>(total.discarded_bytes),
+                    static_cast<unsigned long long>(total.sequence_gaps),
+                    static_cast<unsigned long long>(total.buffer_high_water));
+        return 0;
+    }
+
+    writer.join();
+    printTotals(devices, elapsed);
+    return 0;
+}